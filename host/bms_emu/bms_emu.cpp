@@ -0,0 +1,150 @@
+// BMS emulator on a pseudo-terminal (emu/BmsEmulator.h): answers the charge
+// controller's 5A 5A 00 00 00 00 polls with 121-byte status frames from a
+// modelled 20s pack. Point anything that polls the BMS (cc_vcan --bms, a
+// script, a USB-serial bridge to the Teensy) at the printed tty or --link.
+//
+// The pack charges at --current and can be changed on stdin while running:
+//   current A       pack current (positive charges)
+//   bias CELL MV    offset one cell's reading (1-based; 0 mV clears)
+//   silent | talk   stop / resume answering
+//   latency MS, jitter MS, drop RATE, corrupt RATE
+//   status
+//
+//   bms_emu [--link PATH] [--soc PCT] [--capacity AH] [--current A] [--imbalance MV]
+//           [--latency MS] [--jitter MS] [--drop RATE] [--corrupt RATE] [--seed N]
+//           [--status SEC]
+
+#include <poll.h>
+#include <signal.h>
+#include <unistd.h>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include "BatteryPack.h"
+#include "BmsEmulator.h"
+#include "Pty.h"
+#include "SocketCan.h"
+
+using namespace emu;
+
+namespace {
+
+volatile bool stopRequested = false;
+
+void onSignal(int) {
+  stopRequested = true;
+}
+
+void printStatus(BmsEmulator &bms, const BatteryPack &pack, double t) {
+  uint8_t frame[BMS_REPLY_LEN];
+  bms.encode(frame);
+  const BmsStats &s = bms.stats();
+  printf("%9.1f s  %6.2f A  pack %6.2f V  soc %5.1f%%  cells %.3f..%.3f V  %4.1f C  "
+         "%llu requests, %llu replies, %llu dropped, %llu corrupted%s\n",
+         t, pack.current(), ((frame[4] << 8) | frame[5]) / 10.0, pack.soc() * 100.0,
+         ((frame[119] << 8) | frame[120]) / 1000.0, ((frame[116] << 8) | frame[117]) / 1000.0, bms.temperature(),
+         (unsigned long long)s.requests, (unsigned long long)s.replies, (unsigned long long)s.bytes_dropped,
+         (unsigned long long)s.bytes_corrupted, bms.silent() ? "  SILENT" : "");
+  fflush(stdout);
+}
+
+void command(const std::string &cmd, BmsEmulator &bms, const BatteryPack &pack, float &current, double t) {
+  BmsConfig &c = bms.config();
+  float v;
+  int cell;
+  if (sscanf(cmd.c_str(), "current %f", &v) == 1) current = v;
+  else if (sscanf(cmd.c_str(), "bias %d %f", &cell, &v) == 2) bms.setCellBias(cell - 1, v / 1000.0f);
+  else if (cmd == "silent") bms.setSilent(true);
+  else if (cmd == "talk") bms.setSilent(false);
+  else if (sscanf(cmd.c_str(), "latency %f", &v) == 1) c.latency_ms = (uint32_t)v;
+  else if (sscanf(cmd.c_str(), "jitter %f", &v) == 1) c.jitter_ms = (uint32_t)v;
+  else if (sscanf(cmd.c_str(), "drop %f", &v) == 1) c.drop_rate = v;
+  else if (sscanf(cmd.c_str(), "corrupt %f", &v) == 1) c.corrupt_rate = v;
+  else if (cmd == "status") printStatus(bms, pack, t);
+  else if (!cmd.empty())
+    fprintf(stderr, "bms_emu: commands: current A, bias CELL MV, silent, talk, latency MS, jitter MS, "
+                    "drop RATE, corrupt RATE, status\n");
+}
+
+void usage() {
+  fprintf(stderr,
+          "usage: bms_emu [--link PATH] [--soc PCT] [--capacity AH] [--current A] [--imbalance MV]\n"
+          "               [--latency MS] [--jitter MS] [--drop RATE] [--corrupt RATE] [--seed N]\n"
+          "               [--status SEC]\n");
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+  std::string link;
+  BatteryPackConfig packConfig;
+  BmsConfig config;
+  float current = 0;
+  double statusS = 5;
+
+  for (int i = 1; i < argc; i++) {
+    auto next = [&]() -> const char * {
+      if (i + 1 >= argc) { usage(); exit(2); }
+      return argv[++i];
+    };
+    if (!strcmp(argv[i], "--link")) link = next();
+    else if (!strcmp(argv[i], "--soc")) packConfig.soc = (float)atof(next()) / 100.0f;
+    else if (!strcmp(argv[i], "--capacity")) packConfig.capacity_Ah = (float)atof(next());
+    else if (!strcmp(argv[i], "--current")) current = (float)atof(next());
+    else if (!strcmp(argv[i], "--imbalance")) config.imbalance_V = (float)atof(next()) / 1000.0f;
+    else if (!strcmp(argv[i], "--latency")) config.latency_ms = (uint32_t)atoi(next());
+    else if (!strcmp(argv[i], "--jitter")) config.jitter_ms = (uint32_t)atoi(next());
+    else if (!strcmp(argv[i], "--drop")) config.drop_rate = (float)atof(next());
+    else if (!strcmp(argv[i], "--corrupt")) config.corrupt_rate = (float)atof(next());
+    else if (!strcmp(argv[i], "--seed")) config.seed = (uint32_t)strtoul(next(), nullptr, 10);
+    else if (!strcmp(argv[i], "--status")) statusS = atof(next());
+    else { usage(); return 2; }
+  }
+
+  Pty pty;
+  std::string err;
+  if (!pty.open(err, link)) {
+    fprintf(stderr, "bms_emu: %s\n", err.c_str());
+    return 1;
+  }
+
+  BatteryPack pack(packConfig);
+  BmsEmulator bms(&pack, config);
+  signal(SIGINT, onSignal);
+  signal(SIGTERM, onSignal);
+  fprintf(stderr, "bms_emu: BMS on %s%s%s, pack %.0f Ah at %.0f%%\n", pty.path().c_str(),
+          link.empty() ? "" : " -> ", link.c_str(), packConfig.capacity_Ah, pack.soc() * 100.0);
+
+  const uint64_t t0 = monotonicUs();
+  uint64_t last = t0, nextStatus = t0;
+  std::string line;
+
+  runOnPty(pty, bms, &stopRequested, [&](uint64_t now) {
+    pack.flow(current, (now - last) / 1e6f);
+    last = now;
+
+    struct pollfd p = {STDIN_FILENO, POLLIN, 0};
+    char buf[256];
+    ssize_t n;
+    while (poll(&p, 1, 0) > 0 && (p.revents & POLLIN) && (n = read(STDIN_FILENO, buf, sizeof(buf))) > 0) {
+      line.append(buf, (size_t)n);
+      size_t eol;
+      while ((eol = line.find('\n')) != std::string::npos) {
+        command(line.substr(0, eol), bms, pack, current, (now - t0) / 1e6);
+        line.erase(0, eol + 1);
+      }
+    }
+
+    if (statusS > 0 && now >= nextStatus) {
+      printStatus(bms, pack, (now - t0) / 1e6);
+      nextStatus = now + (uint64_t)(statusS * 1e6);
+    }
+  });
+
+  const BmsStats &s = bms.stats();
+  fprintf(stderr, "bms_emu: %llu requests, %llu replies (%llu bytes, %llu dropped, %llu corrupted), %llu stray bytes\n",
+          (unsigned long long)s.requests, (unsigned long long)s.replies, (unsigned long long)s.bytes_sent,
+          (unsigned long long)s.bytes_dropped, (unsigned long long)s.bytes_corrupted, (unsigned long long)s.ignored);
+  return 0;
+}
@@ -0,0 +1,44 @@
+#pragma once
+// Host-side in-memory form of a CAN (or BMS/state) log, shared by the text,
+// device and chunked log readers and writers.
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include "CanLogFormat.h"
+
+namespace canlog {
+
+struct Frame {
+  uint64_t t_us;     // microseconds since the start of the log
+  uint32_t id;       // CAN id | ID_EXTENDED, or source specific (see Source)
+  uint8_t  source;   // Source
+  uint8_t  dlc;
+  uint8_t  reserved[2];
+  uint8_t  data[8];
+};
+static_assert(sizeof(Frame) == 24, "canlog::Frame is stored as-is in .cbl chunks");
+
+struct Log {
+  uint64_t start_epoch_us = 0;   // wall clock of t_us = 0, 0 if unknown
+  std::vector<Frame> frames;     // ordered by t_us
+};
+
+inline bool isCanSource(uint8_t source) {
+  return source >= (uint8_t)Source::CAN1_RX && source <= (uint8_t)Source::CAN3_TX;
+}
+
+// 1..3 for CAN sources, 0 otherwise
+inline int canChannel(uint8_t source) {
+  return isCanSource(source) ? (source + 1) / 2 : 0;
+}
+
+inline bool isTx(uint8_t source) {
+  return isCanSource(source) && (source % 2) == 0;
+}
+
+inline uint8_t canSource(int channel, bool tx) {
+  return (uint8_t)(2 * channel - 1 + (tx ? 1 : 0));
+}
+
+} // namespace canlog
@@ -0,0 +1,294 @@
+#include "ChunkedLog.h"
+#include <algorithm>
+#include <cstring>
+#include <map>
+
+namespace canlog {
+
+uint32_t crc32(const void *data, size_t len, uint32_t crc) {
+  static uint32_t table[256];
+  static bool ready = false;
+  if (!ready) {
+    for (uint32_t i = 0; i < 256; i++) {
+      uint32_t c = i;
+      for (int k = 0; k < 8; k++) c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+      table[i] = c;
+    }
+    ready = true;
+  }
+
+  const uint8_t *p = (const uint8_t *)data;
+  crc = ~crc;
+  while (len--) crc = table[(crc ^ *p++) & 0xFF] ^ (crc >> 8);
+  return ~crc;
+}
+
+uint32_t idBloomBit(uint32_t id) {
+  return (id * 0x9E3779B1u) >> 24;
+}
+
+// -------------------- Writer --------------------
+CblWriter::~CblWriter() {
+  if (f_) fclose(f_);
+}
+
+bool CblWriter::open(const std::string &path, uint64_t start_epoch_us, std::string &err,
+                     uint32_t chunk_frames) {
+  path_ = path;
+  chunkFrames_ = chunk_frames ? chunk_frames : CBL_DEFAULT_CHUNK_FRAMES;
+  f_ = fopen(path.c_str(), "wb");
+  if (!f_) {
+    err = "cannot create " + path;
+    return false;
+  }
+
+  CblFileHeader hdr = {};
+  memcpy(hdr.magic, CBL_MAGIC, sizeof(hdr.magic));
+  hdr.version = CBL_VERSION;
+  hdr.frame_size = sizeof(Frame);
+  hdr.chunk_frames = chunkFrames_;
+  hdr.start_epoch_us = start_epoch_us;
+  failed_ = fwrite(&hdr, sizeof(hdr), 1, f_) != 1;
+  chunk_.reserve(chunkFrames_);
+  return !failed_;
+}
+
+bool CblWriter::add(const Frame &f) {
+  if (!chunk_.empty() && f.t_us < chunk_.back().t_us) failed_ = true;
+  chunk_.push_back(f);
+  frameCount_++;
+  if (chunk_.size() >= chunkFrames_) return flushChunk();
+  return !failed_;
+}
+
+bool CblWriter::flushChunk() {
+  if (chunk_.empty() || failed_) return !failed_;
+
+  std::map<uint32_t, uint32_t> counts;
+  for (const Frame &fr : chunk_) counts[fr.id]++;
+
+  std::vector<CblIdEntry> ids;
+  ids.reserve(counts.size());
+  CblIndexEntry entry = {};
+  for (const auto &kv : counts) {
+    ids.push_back({kv.first, kv.second});
+    uint32_t bit = idBloomBit(kv.first);
+    entry.id_bloom[bit / 64] |= 1ULL << (bit % 64);
+  }
+
+  std::vector<uint64_t> timeIndex;
+  for (size_t i = 0; i < chunk_.size(); i += TIME_INDEX_STRIDE) timeIndex.push_back(chunk_[i].t_us);
+
+  CblChunkHeader hdr = {};
+  memcpy(hdr.magic, CBL_CHUNK_MAGIC, sizeof(hdr.magic));
+  hdr.frame_count = (uint32_t)chunk_.size();
+  hdr.t_first_us = chunk_.front().t_us;
+  hdr.t_last_us = chunk_.back().t_us;
+  hdr.id_count = (uint32_t)ids.size();
+  hdr.time_index_count = (uint32_t)timeIndex.size();
+  uint32_t crc = crc32(ids.data(), ids.size() * sizeof(CblIdEntry));
+  crc = crc32(timeIndex.data(), timeIndex.size() * sizeof(uint64_t), crc);
+  hdr.crc32 = crc32(chunk_.data(), chunk_.size() * sizeof(Frame), crc);
+
+  entry.offset = (uint64_t)ftello(f_);
+  entry.t_first_us = hdr.t_first_us;
+  entry.t_last_us = hdr.t_last_us;
+  entry.frame_count = hdr.frame_count;
+  entry.id_count = hdr.id_count;
+  index_.push_back(entry);
+
+  failed_ = fwrite(&hdr, sizeof(hdr), 1, f_) != 1 ||
+            fwrite(ids.data(), sizeof(CblIdEntry), ids.size(), f_) != ids.size() ||
+            fwrite(timeIndex.data(), sizeof(uint64_t), timeIndex.size(), f_) != timeIndex.size() ||
+            fwrite(chunk_.data(), sizeof(Frame), chunk_.size(), f_) != chunk_.size();
+  chunk_.clear();
+  return !failed_;
+}
+
+bool CblWriter::close(std::string &err) {
+  if (!f_) return false;
+  flushChunk();
+
+  CblFooter footer = {};
+  memcpy(footer.magic, CBL_FOOTER_MAGIC, sizeof(footer.magic));
+  footer.index_offset = (uint64_t)ftello(f_);
+  footer.frame_count = frameCount_;
+  footer.chunk_count = (uint32_t)index_.size();
+  footer.crc32 = crc32(index_.data(), index_.size() * sizeof(CblIndexEntry));
+
+  if (!failed_) {
+    failed_ = fwrite(index_.data(), sizeof(CblIndexEntry), index_.size(), f_) != index_.size() ||
+              fwrite(&footer, sizeof(footer), 1, f_) != 1;
+  }
+  if (fclose(f_) != 0) failed_ = true;
+  f_ = nullptr;
+
+  if (failed_) err = "write failed (or frames out of time order): " + path_;
+  return !failed_;
+}
+
+// -------------------- Reader --------------------
+CblReader::~CblReader() {
+  if (f_) fclose(f_);
+}
+
+bool CblReader::readAt(uint64_t offset, void *dst, size_t len, CblQueryStats *stats) {
+  if (len == 0) return true;
+  if (fseeko(f_, (off_t)offset, SEEK_SET) != 0 || fread(dst, 1, len, f_) != len) return false;
+  if (stats) stats->bytes_read += len;
+  return true;
+}
+
+bool CblReader::open(const std::string &path, std::string &err) {
+  path_ = path;
+  f_ = fopen(path.c_str(), "rb");
+  if (!f_) {
+    err = "cannot open " + path;
+    return false;
+  }
+
+  if (fseeko(f_, 0, SEEK_END) != 0) return false;
+  const uint64_t size = (uint64_t)ftello(f_);
+
+  if (size < sizeof(CblFileHeader) + sizeof(CblFooter) ||
+      !readAt(0, &header_, sizeof(header_), nullptr) ||
+      memcmp(header_.magic, CBL_MAGIC, sizeof(header_.magic)) != 0 ||
+      !readAt(size - sizeof(CblFooter), &footer_, sizeof(footer_), nullptr) ||
+      memcmp(footer_.magic, CBL_FOOTER_MAGIC, sizeof(footer_.magic)) != 0) {
+    err = path + ": not a complete .cbl file";
+    return false;
+  }
+  if (header_.version != CBL_VERSION || header_.frame_size != sizeof(Frame)) {
+    err = path + ": unsupported .cbl version " + std::to_string(header_.version);
+    return false;
+  }
+
+  index_.resize(footer_.chunk_count);
+  if (!readAt(footer_.index_offset, index_.data(), index_.size() * sizeof(CblIndexEntry), nullptr) ||
+      crc32(index_.data(), index_.size() * sizeof(CblIndexEntry)) != footer_.crc32) {
+    err = path + ": corrupt chunk index";
+    return false;
+  }
+  return true;
+}
+
+bool CblReader::chunkFrames(size_t chunk, const CblQuery &q, std::vector<Frame> &out,
+                            CblQueryStats *stats, std::string &err) {
+  out.clear();
+  const CblIndexEntry &e = index_[chunk];
+  if (e.t_last_us < q.t_from_us || e.t_first_us > q.t_to_us) return true;
+
+  if (!q.ids.empty()) {
+    bool maybe = false;
+    for (uint32_t id : q.ids) {
+      uint32_t bit = idBloomBit(id);
+      if (e.id_bloom[bit / 64] & (1ULL << (bit % 64))) maybe = true;
+    }
+    if (!maybe) return true;
+  }
+
+  CblChunkHeader hdr;
+  std::vector<CblIdEntry> ids;
+  std::vector<uint64_t> timeIndex;
+  if (!readAt(e.offset, &hdr, sizeof(hdr), stats) || memcmp(hdr.magic, CBL_CHUNK_MAGIC, sizeof(hdr.magic)) != 0) {
+    err = path_ + ": bad chunk header at offset " + std::to_string(e.offset);
+    return false;
+  }
+  ids.resize(hdr.id_count);
+  timeIndex.resize(hdr.time_index_count);
+  const uint64_t idsAt = e.offset + sizeof(hdr);
+  const uint64_t timeAt = idsAt + ids.size() * sizeof(CblIdEntry);
+  const uint64_t framesAt = timeAt + timeIndex.size() * sizeof(uint64_t);
+
+  if (!q.ids.empty()) {
+    if (!readAt(idsAt, ids.data(), ids.size() * sizeof(CblIdEntry), stats)) {
+      err = path_ + ": short chunk";
+      return false;
+    }
+    bool present = false;
+    for (uint32_t id : q.ids) {
+      present |= std::binary_search(ids.begin(), ids.end(), CblIdEntry{id, 0},
+                                    [](const CblIdEntry &a, const CblIdEntry &b) { return a.id < b.id; });
+    }
+    if (!present) return true;
+  }
+
+  // Narrow to the strides that can hold [t_from, t_to]
+  size_t first = 0, last = hdr.frame_count;
+  if (q.t_from_us > e.t_first_us || q.t_to_us < e.t_last_us) {
+    if (!readAt(timeAt, timeIndex.data(), timeIndex.size() * sizeof(uint64_t), stats)) {
+      err = path_ + ": short chunk";
+      return false;
+    }
+    auto lo = std::lower_bound(timeIndex.begin(), timeIndex.end(), q.t_from_us);
+    if (lo != timeIndex.begin()) first = (size_t)(lo - timeIndex.begin() - 1) * TIME_INDEX_STRIDE;
+    auto hi = std::upper_bound(timeIndex.begin(), timeIndex.end(), q.t_to_us);
+    if (hi != timeIndex.end()) last = (size_t)(hi - timeIndex.begin()) * TIME_INDEX_STRIDE;
+  }
+  if (first >= last) return true;
+
+  out.resize(last - first);
+  if (!readAt(framesAt + first * sizeof(Frame), out.data(), out.size() * sizeof(Frame), stats)) {
+    err = path_ + ": short chunk";
+    return false;
+  }
+  if (stats) {
+    stats->chunks_read++;
+    stats->frames_read += out.size();
+  }
+
+  auto miss = [&](const Frame &fr) {
+    if (fr.t_us < q.t_from_us || fr.t_us > q.t_to_us) return true;
+    return !q.ids.empty() && std::find(q.ids.begin(), q.ids.end(), fr.id) == q.ids.end();
+  };
+  out.erase(std::remove_if(out.begin(), out.end(), miss), out.end());
+  return true;
+}
+
+bool CblReader::verify(std::string &err) {
+  for (const CblIndexEntry &e : index_) {
+    CblChunkHeader hdr;
+    if (!readAt(e.offset, &hdr, sizeof(hdr), nullptr)) {
+      err = path_ + ": short chunk";
+      return false;
+    }
+    size_t len = hdr.id_count * sizeof(CblIdEntry) + hdr.time_index_count * sizeof(uint64_t) +
+                 (size_t)hdr.frame_count * sizeof(Frame);
+    std::vector<uint8_t> body(len);
+    if (!readAt(e.offset + sizeof(hdr), body.data(), len, nullptr) || crc32(body.data(), len) != hdr.crc32) {
+      err = path_ + ": CRC mismatch in chunk at offset " + std::to_string(e.offset);
+      return false;
+    }
+  }
+  return true;
+}
+
+bool CblReader::readAll(Log &log, std::string &err) {
+  log = Log();
+  log.start_epoch_us = header_.start_epoch_us;
+  log.frames.reserve(footer_.frame_count);
+  return query(CblQuery(), [&](const Frame &f) { log.frames.push_back(f); }, nullptr, err);
+}
+
+// -------------------- Whole-file helpers --------------------
+bool writeCbl(const std::string &path, const Log &log, std::string &err, uint32_t chunk_frames) {
+  CblWriter w;
+  if (!w.open(path, log.start_epoch_us, err, chunk_frames)) return false;
+
+  if (std::is_sorted(log.frames.begin(), log.frames.end(),
+                     [](const Frame &a, const Frame &b) { return a.t_us < b.t_us; })) {
+    for (const Frame &f : log.frames) w.add(f);
+  } else {
+    std::vector<Frame> sorted = log.frames;
+    std::stable_sort(sorted.begin(), sorted.end(), [](const Frame &a, const Frame &b) { return a.t_us < b.t_us; });
+    for (const Frame &f : sorted) w.add(f);
+  }
+  return w.close(err);
+}
+
+bool readCbl(const std::string &path, Log &log, std::string &err) {
+  CblReader r;
+  return r.open(path, err) && r.readAll(log, err);
+}
+
+} // namespace canlog
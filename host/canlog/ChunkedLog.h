@@ -0,0 +1,165 @@
+#pragma once
+// .cbl: chunked, indexed binary container for long CAN recordings.
+//
+// File layout (little-endian):
+//   CblFileHeader                        64 bytes
+//   chunk 0 .. n-1, each:
+//     CblChunkHeader                     40 bytes
+//     CblIdEntry[id_count]               distinct ids in the chunk, sorted
+//     uint64_t time_index[time_index_count]
+//                                        t_us of frames 0, TIME_INDEX_STRIDE, ...
+//     Frame[frame_count]                 ordered by t_us
+//   CblIndexEntry[chunk_count]           footer index, one per chunk
+//   CblFooter                            32 bytes, always the last bytes
+//
+// A reader loads the footer and index only. Time queries skip chunks whose
+// [t_first, t_last] misses the range. ID queries skip chunks whose id bloom
+// misses every wanted id, then confirm with the chunk's id list. Within a
+// chunk the time index narrows the frames read to one stride either side.
+
+#include <cstdio>
+#include "CanFrame.h"
+
+namespace canlog {
+
+constexpr char CBL_MAGIC[8] = {'C', 'B', '5', '5', 'C', 'B', 'L', '1'};
+constexpr char CBL_FOOTER_MAGIC[8] = {'C', 'B', 'L', 'I', 'N', 'D', 'E', 'X'};
+constexpr char CBL_CHUNK_MAGIC[4] = {'C', 'H', 'N', 'K'};
+constexpr uint16_t CBL_VERSION = 1;
+constexpr uint32_t CBL_DEFAULT_CHUNK_FRAMES = 8192;
+constexpr uint32_t TIME_INDEX_STRIDE = 256;
+
+struct CblFileHeader {
+  char     magic[8];        // CBL_MAGIC
+  uint16_t version;         // CBL_VERSION
+  uint16_t frame_size;      // sizeof(Frame)
+  uint32_t chunk_frames;    // target frames per chunk
+  uint64_t start_epoch_us;  // Log::start_epoch_us
+  uint8_t  reserved[40];
+};
+static_assert(sizeof(CblFileHeader) == 64, "CblFileHeader layout");
+
+struct CblChunkHeader {
+  char     magic[4];        // CBL_CHUNK_MAGIC
+  uint32_t frame_count;
+  uint64_t t_first_us;
+  uint64_t t_last_us;
+  uint32_t id_count;
+  uint32_t time_index_count;
+  uint32_t crc32;           // of the id list, time index and frames
+  uint32_t reserved;
+};
+static_assert(sizeof(CblChunkHeader) == 40, "CblChunkHeader layout");
+
+struct CblIdEntry {
+  uint32_t id;              // Frame::id (with ID_EXTENDED); source is not part of it
+  uint32_t count;           // frames with this id in the chunk
+};
+
+struct CblIndexEntry {
+  uint64_t offset;          // file offset of the CblChunkHeader
+  uint64_t t_first_us;
+  uint64_t t_last_us;
+  uint32_t frame_count;
+  uint32_t id_count;
+  uint64_t id_bloom[4];     // bit (hash(id) & 255) set for every id in the chunk
+};
+static_assert(sizeof(CblIndexEntry) == 64, "CblIndexEntry layout");
+
+struct CblFooter {
+  char     magic[8];        // CBL_FOOTER_MAGIC
+  uint64_t index_offset;
+  uint64_t frame_count;
+  uint32_t chunk_count;
+  uint32_t crc32;           // of the index entries
+};
+static_assert(sizeof(CblFooter) == 32, "CblFooter layout");
+
+uint32_t crc32(const void *data, size_t len, uint32_t crc = 0);
+uint32_t idBloomBit(uint32_t id);
+
+// Streams frames into a .cbl file, one chunk at a time. Frames must be added
+// in t_us order.
+class CblWriter {
+public:
+  ~CblWriter();
+  bool open(const std::string &path, uint64_t start_epoch_us, std::string &err,
+            uint32_t chunk_frames = CBL_DEFAULT_CHUNK_FRAMES);
+  bool add(const Frame &f);
+  bool close(std::string &err);
+
+private:
+  bool flushChunk();
+
+  FILE *f_ = nullptr;
+  std::string path_;
+  uint32_t chunkFrames_ = CBL_DEFAULT_CHUNK_FRAMES;
+  uint64_t frameCount_ = 0;
+  std::vector<Frame> chunk_;
+  std::vector<CblIndexEntry> index_;
+  bool failed_ = false;
+};
+
+struct CblQuery {
+  uint64_t t_from_us = 0;
+  uint64_t t_to_us = UINT64_MAX;     // inclusive
+  std::vector<uint32_t> ids;         // empty = all ids
+};
+
+struct CblQueryStats {
+  uint32_t chunks_total = 0;
+  uint32_t chunks_read = 0;          // chunks whose frames were read
+  uint64_t frames_read = 0;
+  uint64_t bytes_read = 0;
+};
+
+// Random access over a .cbl file. Only the footer and index are loaded by
+// open(); chunks are read on demand.
+class CblReader {
+public:
+  ~CblReader();
+  bool open(const std::string &path, std::string &err);
+
+  const CblFileHeader &header() const { return header_; }
+  const std::vector<CblIndexEntry> &index() const { return index_; }
+  uint64_t frameCount() const { return footer_.frame_count; }
+
+  // Calls emit(frame) for every matching frame in time order.
+  template <typename Emit>
+  bool query(const CblQuery &q, Emit emit, CblQueryStats *stats, std::string &err);
+
+  // Reads every chunk in full and checks its CRC.
+  bool verify(std::string &err);
+
+  bool readAll(Log &log, std::string &err);
+
+private:
+  bool readAt(uint64_t offset, void *dst, size_t len, CblQueryStats *stats);
+  bool chunkFrames(size_t chunk, const CblQuery &q, std::vector<Frame> &out,
+                   CblQueryStats *stats, std::string &err);
+
+  FILE *f_ = nullptr;
+  std::string path_;
+  CblFileHeader header_ = {};
+  CblFooter footer_ = {};
+  std::vector<CblIndexEntry> index_;
+};
+
+template <typename Emit>
+bool CblReader::query(const CblQuery &q, Emit emit, CblQueryStats *stats, std::string &err) {
+  if (stats) stats->chunks_total = (uint32_t)index_.size();
+
+  std::vector<Frame> frames;
+  for (size_t c = 0; c < index_.size(); c++) {
+    if (!chunkFrames(c, q, frames, stats, err)) return false;
+    for (const Frame &fr : frames) emit(fr);
+  }
+  return true;
+}
+
+// Whole-file helpers for the converter
+bool writeCbl(const std::string &path, const Log &log, std::string &err,
+              uint32_t chunk_frames = CBL_DEFAULT_CHUNK_FRAMES);
+bool readCbl(const std::string &path, Log &log, std::string &err);
+
+} // namespace canlog
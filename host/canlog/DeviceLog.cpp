@@ -0,0 +1,129 @@
+#include "DeviceLog.h"
+#include <cstdio>
+#include <cstring>
+#include <vector>
+#include "CanLogCodec.h"
+
+namespace canlog {
+
+bool readDeviceLog(const std::string &path, Log &log, std::string &err, DeviceLogInfo *info) {
+  FILE *in = fopen(path.c_str(), "rb");
+  if (!in) {
+    err = "cannot open " + path;
+    return false;
+  }
+
+  DeviceLogInfo local;
+  DeviceLogInfo &inf = info ? *info : local;
+  inf = DeviceLogInfo();
+
+  FileHeader &hdr = inf.header;
+  if (fread(&hdr, sizeof(hdr), 1, in) != 1 || memcmp(hdr.magic, FILE_MAGIC, sizeof(hdr.magic)) != 0) {
+    fclose(in);
+    err = path + ": not a CAN log file";
+    return false;
+  }
+  const bool compressed = hdr.version == FORMAT_COMPRESSED;
+  if ((hdr.version != FORMAT_RAW && !compressed) || hdr.record_size != sizeof(Record) ||
+      (compressed && hdr.block_bytes != CODEC_BLOCK_BYTES)) {
+    fclose(in);
+    err = path + ": unsupported version " + std::to_string(hdr.version);
+    return false;
+  }
+
+  log = Log();
+  uint64_t base = 0;    // accumulated micros() wraps
+  uint32_t first = 0, prev = 0;
+  uint16_t expectSeq = 0;
+
+  // False at the end of valid data
+  auto accept = [&](const Record &r) {
+    if (r.source == (uint8_t)Source::None) return false;
+    if (inf.records > 0 && r.seq != expectSeq) return false;   // stale preallocated data
+
+    if (inf.records == 0) first = prev = r.t_us;
+    if (r.t_us < prev) base += 1ULL << 32;
+    prev = r.t_us;
+    expectSeq = (uint16_t)(r.seq + 1);
+    inf.records++;
+
+    if (r.source == (uint8_t)Source::DROPPED) inf.dropped += r.id;
+
+    Frame f = {};
+    f.t_us = base + r.t_us - first;
+    f.id = r.id;
+    f.source = r.source;
+    f.dlc = r.dlc > 8 ? 8 : r.dlc;
+    memcpy(f.data, r.data, sizeof(f.data));
+    log.frames.push_back(f);
+    return true;
+  };
+
+  if (!compressed) {
+    Record r;
+    while (fread(&r, sizeof(r), 1, in) == 1 && accept(r)) {}
+  } else {
+    std::vector<uint8_t> block(CODEC_BLOCK_BYTES);
+    std::vector<Record> records(CODEC_MAX_BLOCK_RECORDS);
+    bool more = true;
+    while (more && fread(block.data(), block.size(), 1, in) == 1) {
+      int n = decodeBlock(block.data(), records.data());
+      if (n <= 0) break;
+      inf.blocks++;
+      for (int i = 0; i < n && more; i++) more = accept(records[i]);
+    }
+  }
+
+  fclose(in);
+  return true;
+}
+
+bool writeDeviceLog(const std::string &path, const Log &log, std::string &err, bool compressed) {
+  FILE *out = fopen(path.c_str(), "wb");
+  if (!out) {
+    err = "cannot create " + path;
+    return false;
+  }
+
+  FileHeader hdr;
+  memset(&hdr, 0, sizeof(hdr));
+  memcpy(hdr.magic, FILE_MAGIC, sizeof(hdr.magic));
+  hdr.version = compressed ? FORMAT_COMPRESSED : FORMAT_RAW;
+  hdr.record_size = sizeof(Record);
+  hdr.block_bytes = compressed ? CODEC_BLOCK_BYTES : 0;
+  bool ok = fwrite(&hdr, sizeof(hdr), 1, out) == 1;
+
+  std::vector<uint8_t> block(CODEC_BLOCK_BYTES);
+  BlockEncoder encoder;
+  encoder.begin(block.data());
+
+  for (size_t i = 0; i < log.frames.size() && ok; i++) {
+    const Frame &f = log.frames[i];
+    Record r;
+    r.t_us = (uint32_t)f.t_us;
+    r.id = f.id;
+    r.source = f.source;
+    r.dlc = f.dlc;
+    r.seq = (uint16_t)i;
+    memcpy(r.data, f.data, sizeof(r.data));
+
+    if (!compressed) {
+      ok = fwrite(&r, sizeof(r), 1, out) == 1;
+    } else if (!encoder.add(r)) {
+      encoder.finish();
+      ok = fwrite(block.data(), block.size(), 1, out) == 1;
+      encoder.begin(block.data());
+      encoder.add(r);
+    }
+  }
+  if (ok && compressed && encoder.records()) {
+    encoder.finish();
+    ok = fwrite(block.data(), block.size(), 1, out) == 1;
+  }
+
+  if (fclose(out) != 0) ok = false;
+  if (!ok) err = "write failed: " + path;
+  return ok;
+}
+
+} // namespace canlog
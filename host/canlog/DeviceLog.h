@@ -0,0 +1,27 @@
+#pragma once
+// Reader for the binary files the charge controller writes to its SD card
+// (CANnnnnn.BIN from the CAN logger, BBXnnnnn.BIN black box dumps); see
+// teensy/charge_controller/CanLogFormat.h.
+
+#include "CanFrame.h"
+
+namespace canlog {
+
+struct DeviceLogInfo {
+  FileHeader header;
+  uint32_t records = 0;   // valid records read
+  uint32_t dropped = 0;   // sum of DROPPED markers
+  uint32_t blocks = 0;    // compressed blocks read (FORMAT_COMPRESSED)
+};
+
+// Reads records (raw or compressed) up to the end of valid data, unwrapping the 32-bit micros()
+// stamps. t_us = 0 is the first record. The card has no wall clock, so
+// start_epoch_us is left at 0.
+bool readDeviceLog(const std::string &path, Log &log, std::string &err, DeviceLogInfo *info = nullptr);
+
+// Writes log in the controller's SD format, compressed like the CAN logger
+// does or as raw records like a black box dump. t_us is truncated to 32 bits
+// (the reader unwraps it again) and seq numbers the frames from 0.
+bool writeDeviceLog(const std::string &path, const Log &log, std::string &err, bool compressed = true);
+
+} // namespace canlog
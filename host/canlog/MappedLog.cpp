@@ -0,0 +1,354 @@
+#include "MappedLog.h"
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <thread>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace canlog {
+
+// -------------------- MappedFile --------------------
+MappedFile::~MappedFile() {
+  if (data_) munmap((void *)data_, size_);
+}
+
+bool MappedFile::open(const std::string &path, std::string &err) {
+  int fd = ::open(path.c_str(), O_RDONLY);
+  if (fd < 0) {
+    err = "cannot open " + path;
+    return false;
+  }
+
+  struct stat st;
+  if (fstat(fd, &st) != 0) {
+    ::close(fd);
+    err = "cannot stat " + path;
+    return false;
+  }
+  size_ = (size_t)st.st_size;
+  if (size_ == 0) {
+    ::close(fd);
+    return true;   // empty file: data() stays null
+  }
+
+  void *p = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+  ::close(fd);
+  if (p == MAP_FAILED) {
+    size_ = 0;
+    err = "cannot map " + path;
+    return false;
+  }
+  madvise(p, size_, MADV_SEQUENTIAL);
+  data_ = (const char *)p;
+  return true;
+}
+
+// -------------------- FrameColumns --------------------
+void FrameColumns::reserve(size_t n) {
+  t_us.reserve(n);
+  id.reserve(n);
+  source.reserve(n);
+  dlc.reserve(n);
+  data.reserve(n);
+}
+
+void FrameColumns::append(const FrameColumns &o) {
+  t_us.insert(t_us.end(), o.t_us.begin(), o.t_us.end());
+  id.insert(id.end(), o.id.begin(), o.id.end());
+  source.insert(source.end(), o.source.begin(), o.source.end());
+  dlc.insert(dlc.end(), o.dlc.begin(), o.dlc.end());
+  data.insert(data.end(), o.data.begin(), o.data.end());
+}
+
+Frame FrameColumns::frame(size_t i) const {
+  Frame f = {};
+  f.t_us = t_us[i];
+  f.id = id[i];
+  f.source = source[i];
+  f.dlc = dlc[i];
+  for (int b = 0; b < 8; b++) f.data[b] = (uint8_t)(data[i] >> (8 * b));
+  return f;
+}
+
+void FrameColumns::toLog(Log &log) const {
+  log = Log();
+  log.start_epoch_us = start_epoch_us;
+  log.frames.resize(size());
+  for (size_t i = 0; i < size(); i++) log.frames[i] = frame(i);
+}
+
+// -------------------- Scanner --------------------
+namespace {
+
+struct HexTable {
+  int8_t v[256];
+  HexTable() {
+    memset(v, -1, sizeof(v));
+    for (int i = 0; i < 10; i++) v['0' + i] = (int8_t)i;
+    for (int i = 0; i < 6; i++) v['a' + i] = v['A' + i] = (int8_t)(10 + i);
+  }
+};
+const HexTable kHex;
+
+inline int hexVal(char c) { return kHex.v[(uint8_t)c]; }
+inline bool isDigit(char c) { return (unsigned)(c - '0') < 10; }
+
+// All helpers advance p and never read at or past e.
+inline void skipSpaces(const char *&p, const char *e) {
+  while (p < e && (*p == ' ' || *p == '\t')) p++;
+}
+
+inline bool seconds(const char *&p, const char *e, uint64_t &us) {
+  const char *start = p;
+  uint64_t whole = 0;
+  while (p < e && isDigit(*p)) whole = whole * 10 + (uint64_t)(*p++ - '0');
+  if (p == start) return false;
+
+  uint32_t frac = 0;
+  int digits = 0;
+  if (p < e && *p == '.') {
+    p++;
+    for (; p < e && isDigit(*p); p++) {
+      if (digits < 6) {
+        frac = frac * 10 + (uint32_t)(*p - '0');
+        digits++;
+      }
+    }
+  }
+  static const uint32_t scale[7] = {1000000, 100000, 10000, 1000, 100, 10, 1};
+  us = whole * 1000000ULL + (uint64_t)frac * scale[digits];
+  return true;
+}
+
+inline bool hexNumber(const char *&p, const char *e, uint32_t &v, int &digits) {
+  v = 0;
+  digits = 0;
+  int d;
+  while (p < e && (d = hexVal(*p)) >= 0) {
+    v = (v << 4) | (uint32_t)d;
+    digits++;
+    p++;
+  }
+  return digits > 0;
+}
+
+inline bool channel(const char *&p, const char *e, int &ch) {
+  if (e - p < 4 || p[0] != 'c' || p[1] != 'a' || p[2] != 'n' || p[3] < '1' || p[3] > '3') return false;
+  ch = p[3] - '0';
+  p += 4;
+  return true;
+}
+
+inline bool hexByte(const char *p, uint8_t &b) {
+  int hi = hexVal(p[0]), lo = hexVal(p[1]);
+  b = (uint8_t)((hi << 4) | lo);
+  return (hi | lo) >= 0;
+}
+
+inline void push(FrameColumns &out, uint64_t t, uint32_t id, uint8_t source, uint8_t dlc, uint64_t data) {
+  out.t_us.push_back(t);
+  out.id.push_back(id);
+  out.source.push_back(source);
+  out.dlc.push_back(dlc);
+  out.data.push_back(data);
+}
+
+// " 5.809869 can1 08A Rx d 8  00 00 00 00 00 00 00 00"
+// Returns 1 for a frame, 0 for a header/blank line, -1 for a bad line.
+int parseTrcLine(const char *p, const char *e, FrameColumns &out) {
+  skipSpaces(p, e);
+  if (p == e || !isDigit(*p)) {
+    return (p == e || *p == ';' || *p == 'B' || *p == 'E') ? 0 : -1;
+  }
+
+  uint64_t t;
+  uint32_t id;
+  int ch, digits;
+  if (!seconds(p, e, t)) return -1;
+  skipSpaces(p, e);
+  if (!channel(p, e, ch)) return -1;
+  skipSpaces(p, e);
+  if (!hexNumber(p, e, id, digits)) return -1;
+  if (p < e && *p == 'x') {
+    id |= ID_EXTENDED;
+    p++;
+  } else if (digits > 3) {
+    id |= ID_EXTENDED;
+  }
+  skipSpaces(p, e);
+  if (e - p < 2 || (p[0] != 'R' && p[0] != 'T') || p[1] != 'x') return -1;
+  const bool tx = (p[0] == 'T');
+  p += 2;
+  skipSpaces(p, e);
+  if (p == e || *p != 'd') return -1;
+  p++;
+  skipSpaces(p, e);
+  if (p == e || !isDigit(*p) || *p > '8') return -1;
+  const uint8_t dlc = (uint8_t)(*p++ - '0');
+
+  uint64_t data = 0;
+  for (uint8_t i = 0; i < dlc; i++) {
+    skipSpaces(p, e);
+    uint8_t b;
+    if (e - p < 2 || !hexByte(p, b)) return -1;
+    data |= (uint64_t)b << (8 * i);
+    p += 2;
+  }
+
+  push(out, t, id, canSource(ch, tx), dlc, data);
+  return 1;
+}
+
+// "2025-09-04 04:14:06.068613,1756955646.068614,can1,0x70A,0,1,7f"
+// t_us gets the absolute epoch time; readTextColumns rebases it.
+int parseCsvLine(const char *p, const char *e, FrameColumns &out) {
+  if (p == e) return 0;
+  if (!isDigit(*p)) return (*p == 't') ? 0 : -1;   // "ts_iso,..." header row
+
+  const char *comma = (const char *)memchr(p, ',', (size_t)(e - p));
+  if (!comma) return -1;
+  p = comma + 1;
+
+  uint64_t t;
+  uint32_t id;
+  int ch, digits;
+  if (!seconds(p, e, t) || p == e || *p++ != ',') return -1;
+  if (!channel(p, e, ch) || p == e || *p++ != ',') return -1;
+  if (e - p >= 2 && p[0] == '0' && (p[1] == 'x' || p[1] == 'X')) p += 2;
+  if (!hexNumber(p, e, id, digits) || p == e || *p++ != ',') return -1;
+  if (e - p < 2 || (p[0] != '0' && p[0] != '1') || p[1] != ',') return -1;
+  if (p[0] == '1') id |= ID_EXTENDED;
+  p += 2;
+  if (e - p < 2 || !isDigit(p[0]) || p[0] > '8' || p[1] != ',') return -1;
+  const uint8_t dlc = (uint8_t)(p[0] - '0');
+  p += 2;
+
+  if (e - p < 2 * dlc) return -1;
+  uint64_t data = 0;
+  for (uint8_t i = 0; i < dlc; i++, p += 2) {
+    uint8_t b;
+    if (!hexByte(p, b)) return -1;
+    data |= (uint64_t)b << (8 * i);
+  }
+
+  push(out, t, id, canSource(ch, false), dlc, data);
+  return 1;
+}
+
+void parseSlice(const char *p, const char *end, TextFormat format, uint64_t baseOffset,
+                FrameColumns &out, TextParseStats &st) {
+  // ~50 bytes per .trc line, ~62 per CSV line
+  out.reserve((size_t)(end - p) / (format == TextFormat::Trc ? 45 : 55) + 16);
+  const char *sliceBegin = p;
+
+  while (p < end) {
+    const char *eol = (const char *)memchr(p, '\n', (size_t)(end - p));
+    if (!eol) eol = end;
+    const char *e = (eol > p && eol[-1] == '\r') ? eol - 1 : eol;
+
+    int r = (format == TextFormat::Trc) ? parseTrcLine(p, e, out) : parseCsvLine(p, e, out);
+    if (r != 0) st.lines++;
+    if (r < 0 && st.bad_lines++ == 0) st.first_bad_offset = baseOffset + (uint64_t)(p - sliceBegin);
+    p = eol + 1;
+  }
+}
+
+// "; StartTime = 2025-09-05 00:31:51" from the .trc header, as epoch us
+uint64_t trcStartTime(const char *p, const char *end) {
+  while (p < end && (*p == ';' || *p == 'B' || *p == ' ')) {
+    const char *eol = (const char *)memchr(p, '\n', (size_t)(end - p));
+    if (!eol) eol = end;
+
+    char line[96];
+    size_t n = (size_t)(eol - p) < sizeof(line) - 1 ? (size_t)(eol - p) : sizeof(line) - 1;
+    memcpy(line, p, n);
+    line[n] = '\0';
+
+    struct tm tm = {};
+    if (sscanf(line, "; StartTime = %d-%d-%d %d:%d:%d", &tm.tm_year, &tm.tm_mon, &tm.tm_mday,
+               &tm.tm_hour, &tm.tm_min, &tm.tm_sec) == 6) {
+      tm.tm_year -= 1900;
+      tm.tm_mon -= 1;
+      tm.tm_isdst = -1;
+      return (uint64_t)mktime(&tm) * 1000000ULL;
+    }
+    p = eol + 1;
+  }
+  return 0;
+}
+
+} // namespace
+
+// -------------------- Entry points --------------------
+void parseTextColumns(const char *begin, const char *end, TextFormat format, FrameColumns &out,
+                      TextParseStats &stats, unsigned threads) {
+  constexpr size_t MIN_SLICE_BYTES = 4 << 20;
+
+  out = FrameColumns();
+  stats = TextParseStats();
+  stats.bytes = (uint64_t)(end - begin);
+
+  if (threads == 0) threads = std::thread::hardware_concurrency();
+  size_t maxThreads = (size_t)(end - begin) / MIN_SLICE_BYTES + 1;
+  if (threads > maxThreads) threads = (unsigned)maxThreads;
+  if (threads == 0) threads = 1;
+  stats.threads = threads;
+
+  // Slice boundaries move forward to the start of the next line
+  std::vector<const char *> cuts(threads + 1, end);
+  cuts[0] = begin;
+  for (unsigned i = 1; i < threads; i++) {
+    const char *c = begin + (size_t)(end - begin) * i / threads;
+    if (c < cuts[i - 1]) c = cuts[i - 1];
+    const char *nl = (const char *)memchr(c, '\n', (size_t)(end - c));
+    cuts[i] = nl ? nl + 1 : end;
+  }
+
+  std::vector<FrameColumns> parts(threads);
+  std::vector<TextParseStats> partStats(threads);
+  auto work = [&](unsigned i) {
+    parseSlice(cuts[i], cuts[i + 1], format, (uint64_t)(cuts[i] - begin), parts[i], partStats[i]);
+  };
+
+  if (threads == 1) {
+    work(0);
+  } else {
+    std::vector<std::thread> pool;
+    for (unsigned i = 0; i < threads; i++) pool.emplace_back(work, i);
+    for (auto &t : pool) t.join();
+  }
+
+  size_t total = 0;
+  for (const auto &p : parts) total += p.size();
+  out.reserve(total);
+  for (unsigned i = 0; i < threads; i++) {
+    out.append(parts[i]);
+    stats.lines += partStats[i].lines;
+    if (partStats[i].bad_lines && !stats.bad_lines) stats.first_bad_offset = partStats[i].first_bad_offset;
+    stats.bad_lines += partStats[i].bad_lines;
+  }
+
+  if (format == TextFormat::Trc) {
+    out.start_epoch_us = trcStartTime(begin, end);
+  } else if (out.size() > 0) {
+    // CSV carries absolute times; make them relative to the first frame
+    out.start_epoch_us = out.t_us[0];
+    for (uint64_t &t : out.t_us) t = (t >= out.start_epoch_us) ? t - out.start_epoch_us : 0;
+  }
+}
+
+bool readTextColumns(const std::string &path, TextFormat format, FrameColumns &out,
+                     std::string &err, unsigned threads, TextParseStats *stats) {
+  MappedFile file;
+  if (!file.open(path, err)) return false;
+
+  TextParseStats local;
+  TextParseStats &st = stats ? *stats : local;
+  parseTextColumns(file.data(), file.data() + file.size(), format, out, st, threads);
+  return true;
+}
+
+} // namespace canlog
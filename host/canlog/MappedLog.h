@@ -0,0 +1,68 @@
+#pragma once
+// Fast reader for the .trc and CSV recordings (layouts in TextLog.h).
+//
+// The file is mmapped and scanned in place: no per-line allocation, no
+// stdio, no floating point. Frames land in a columnar FrameColumns. Large
+// files are split at line boundaries and parsed on several threads, each into
+// its own columns, which are then concatenated in order.
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include "CanFrame.h"
+
+namespace canlog {
+
+// Read-only mapping of a whole file
+class MappedFile {
+public:
+  MappedFile() = default;
+  MappedFile(const MappedFile &) = delete;
+  MappedFile &operator=(const MappedFile &) = delete;
+  ~MappedFile();
+
+  bool open(const std::string &path, std::string &err);
+  const char *data() const { return data_; }
+  size_t size() const { return size_; }
+
+private:
+  const char *data_ = nullptr;
+  size_t size_ = 0;
+};
+
+struct FrameColumns {
+  uint64_t start_epoch_us = 0;   // as Log::start_epoch_us
+  std::vector<uint64_t> t_us;
+  std::vector<uint32_t> id;
+  std::vector<uint8_t>  source;
+  std::vector<uint8_t>  dlc;
+  std::vector<uint64_t> data;    // payload bytes, data[0] in the low byte
+
+  size_t size() const { return t_us.size(); }
+  void reserve(size_t n);
+  void append(const FrameColumns &other);
+  Frame frame(size_t i) const;
+  void toLog(Log &log) const;
+};
+
+enum class TextFormat { Trc, Csv };
+
+struct TextParseStats {
+  uint64_t bytes = 0;
+  uint64_t lines = 0;            // frame lines, good or bad
+  uint64_t bad_lines = 0;
+  uint64_t first_bad_offset = 0; // byte offset of the first bad line
+  unsigned threads = 0;
+};
+
+// Parses a whole recording. threads = 0 picks one per core (one for files
+// under a few MB). Malformed frame lines are skipped and counted.
+bool readTextColumns(const std::string &path, TextFormat format, FrameColumns &out,
+                     std::string &err, unsigned threads = 0, TextParseStats *stats = nullptr);
+
+// Parses an in-memory buffer; the same scanner readTextColumns runs per slice.
+void parseTextColumns(const char *begin, const char *end, TextFormat format, FrameColumns &out,
+                      TextParseStats &stats, unsigned threads = 0);
+
+} // namespace canlog
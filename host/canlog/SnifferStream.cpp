@@ -0,0 +1,103 @@
+#include "SnifferStream.h"
+#include <cstring>
+
+namespace canlog {
+
+using sniffer::PacketHeader;
+using sniffer::SnifferFrame;
+
+static bool headerValid(const PacketHeader &hdr) {
+  return hdr.magic == sniffer::PACKET_MAGIC &&
+         hdr.header_check == sniffer::fletcher16((const uint8_t *)&hdr, offsetof(PacketHeader, header_check)) &&
+         hdr.length <= sniffer::MAX_PACKET_FRAMES * sizeof(SnifferFrame);
+}
+
+void SnifferDecoder::feed(const uint8_t *data, size_t n, Log &log) {
+  stats_.bytes += n;
+  buf_.insert(buf_.end(), data, data + n);
+
+  size_t pos = 0;
+  while (buf_.size() - pos >= sizeof(PacketHeader)) {
+    PacketHeader hdr;
+    memcpy(&hdr, &buf_[pos], sizeof(hdr));
+    if (!headerValid(hdr)) {
+      pos++;
+      stats_.skipped_bytes++;
+      continue;
+    }
+    if (buf_.size() - pos < sizeof(hdr) + hdr.length) break;   // wait for the rest
+
+    const uint8_t *payload = &buf_[pos + sizeof(hdr)];
+    if (hdr.checksum != sniffer::fletcher16(payload, hdr.length)) {
+      stats_.bad_packets++;
+      pos++;
+      continue;
+    }
+    onPacket(hdr, payload, log);
+    pos += sizeof(hdr) + hdr.length;
+  }
+  buf_.erase(buf_.begin(), buf_.begin() + pos);
+}
+
+void SnifferDecoder::onPacket(const PacketHeader &hdr, const uint8_t *payload, Log &log) {
+  stats_.packets++;
+  if (haveSeq_ && hdr.seq != nextSeq_) stats_.lost_packets += hdr.seq - nextSeq_;
+  haveSeq_ = true;
+  nextSeq_ = hdr.seq + 1;
+
+  if (hdr.type == sniffer::PACKET_STATS) {
+    if (hdr.length == sizeof(sniffer::SnifferStats)) {
+      memcpy(&stats_.device, payload, sizeof(stats_.device));
+      stats_.have_device = true;
+    }
+    return;
+  }
+  if (hdr.type != sniffer::PACKET_FRAMES) return;
+
+  for (size_t off = 0; off + sizeof(SnifferFrame) <= hdr.length; off += sizeof(SnifferFrame)) {
+    SnifferFrame sf;
+    memcpy(&sf, payload + off, sizeof(sf));
+    if (sf.bus < 1 || sf.bus > 3) continue;
+
+    if (!haveTime_) {
+      haveTime_ = true;
+      first_ = prev_ = sf.t_us;
+    }
+    if (sf.t_us < prev_) {
+      if (prev_ - sf.t_us > 0x80000000UL) {
+        base_ += 1ULL << 32;   // micros() wrapped
+      } else {
+        stats_.out_of_order++;
+        sf.t_us = prev_;       // keep the log sorted
+      }
+    }
+    prev_ = sf.t_us;
+
+    Frame f = {};
+    f.t_us = base_ + sf.t_us - first_;
+    f.id = sf.id | ((sf.flags & sniffer::FRAME_EXTENDED) ? ID_EXTENDED : 0);
+    f.source = canSource(sf.bus, false);
+    f.dlc = sf.dlc > 8 ? 8 : sf.dlc;
+    memcpy(f.data, sf.data, sizeof(f.data));
+    log.frames.push_back(f);
+    stats_.frames++;
+  }
+}
+
+void appendSnifferPacket(std::vector<uint8_t> &out, uint8_t type, uint32_t seq, const void *payload,
+                         size_t len) {
+  PacketHeader hdr;
+  hdr.magic = sniffer::PACKET_MAGIC;
+  hdr.type = type;
+  hdr.reserved = 0;
+  hdr.length = (uint16_t)len;
+  hdr.seq = seq;
+  hdr.checksum = sniffer::fletcher16((const uint8_t *)payload, len);
+  hdr.header_check = sniffer::fletcher16((const uint8_t *)&hdr, offsetof(PacketHeader, header_check));
+
+  const uint8_t *h = (const uint8_t *)&hdr;
+  out.insert(out.end(), h, h + sizeof(hdr));
+  out.insert(out.end(), (const uint8_t *)payload, (const uint8_t *)payload + len);
+}
+
+} // namespace canlog
@@ -0,0 +1,51 @@
+#pragma once
+// Decoder for the sniffer sketch's binary USB stream
+// (teensy/sketch_sep14a/SnifferProtocol.h).
+
+#include <stddef.h>
+#include <vector>
+#include "CanFrame.h"
+#include "SnifferProtocol.h"
+
+namespace canlog {
+
+struct SnifferDecodeStats {
+  uint64_t bytes = 0;
+  uint64_t packets = 0;
+  uint64_t frames = 0;
+  uint64_t bad_packets = 0;     // checksum or length failures
+  uint64_t skipped_bytes = 0;   // bytes discarded while looking for sync
+  uint64_t lost_packets = 0;    // gaps in the packet seq
+  uint64_t out_of_order = 0;    // frames stamped before the one preceding them
+  bool     have_device = false;
+  sniffer::SnifferStats device = {};   // latest PACKET_STATS from the sketch
+};
+
+// Incremental: feed() takes the stream in arbitrary pieces and appends each
+// complete frame to the log as CANn_RX, with t_us unwrapped to 64 bits and
+// rebased to the first frame. The sketch merges its buses in stamp order, so
+// the log stays sorted; out_of_order counts any frame that breaks that.
+// Anything before the first packet (the text banner, leftover text-mode
+// lines) is skipped.
+class SnifferDecoder {
+public:
+  void feed(const uint8_t *data, size_t n, Log &log);
+  const SnifferDecodeStats &stats() const { return stats_; }
+
+private:
+  void onPacket(const sniffer::PacketHeader &hdr, const uint8_t *payload, Log &log);
+
+  std::vector<uint8_t> buf_;
+  SnifferDecodeStats stats_;
+  bool haveSeq_ = false;
+  uint32_t nextSeq_ = 0;
+  bool haveTime_ = false;
+  uint32_t first_ = 0, prev_ = 0;
+  uint64_t base_ = 0;
+};
+
+// Appends one packet to out, as the sketch sends it.
+void appendSnifferPacket(std::vector<uint8_t> &out, uint8_t type, uint32_t seq, const void *payload,
+                         size_t len);
+
+} // namespace canlog
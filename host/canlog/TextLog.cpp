@@ -0,0 +1,121 @@
+#include "TextLog.h"
+#include "MappedLog.h"
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+
+namespace canlog {
+
+namespace {
+
+void formatWallClock(uint64_t epoch_us, char *out, size_t cap) {
+  time_t secs = (time_t)(epoch_us / 1000000ULL);
+  struct tm tm;
+  localtime_r(&secs, &tm);
+  size_t n = strftime(out, cap, "%Y-%m-%d %H:%M:%S", &tm);
+  snprintf(out + n, cap - n, ".%06u", (unsigned)(epoch_us % 1000000ULL));
+}
+
+bool readMapped(const std::string &path, TextFormat format, Log &log, std::string &err) {
+  FrameColumns cols;
+  TextParseStats stats;
+  if (!readTextColumns(path, format, cols, err, 0, &stats)) return false;
+  if (stats.bad_lines) {
+    err = path + ": " + std::to_string(stats.bad_lines) + " malformed line(s), first at byte " +
+          std::to_string(stats.first_bad_offset);
+    return false;
+  }
+  cols.toLog(log);
+  return true;
+}
+
+} // namespace
+
+// -------------------- .trc --------------------
+bool readTrc(const std::string &path, Log &log, std::string &err) {
+  return readMapped(path, TextFormat::Trc, log, err);
+}
+
+size_t formatTrcLine(const Frame &f, char *out, size_t cap) {
+  char id[12];
+  if (f.id & ID_EXTENDED) snprintf(id, sizeof(id), "%08X", (unsigned)(f.id & ~ID_EXTENDED));
+  else snprintf(id, sizeof(id), "%03X", (unsigned)f.id);
+
+  // Same layout as record_raw_can_trc.py: f"{offset:9.6f} can1 {id} Rx d {dlc}  {data}"
+  size_t n = snprintf(out, cap, "%2llu.%06u can%d %s %s d %u  ",
+                      (unsigned long long)(f.t_us / 1000000ULL), (unsigned)(f.t_us % 1000000ULL),
+                      canChannel(f.source), id, isTx(f.source) ? "Tx" : "Rx", (unsigned)f.dlc);
+  for (uint8_t i = 0; i < f.dlc && i < 8; i++) {
+    n += snprintf(out + n, cap - n, i ? " %02X" : "%02X", f.data[i]);
+  }
+  return n;
+}
+
+bool writeTrc(const std::string &path, const Log &log, std::string &err) {
+  FILE *out = fopen(path.c_str(), "w");
+  if (!out) {
+    err = "cannot create " + path;
+    return false;
+  }
+
+  char start[40];
+  formatWallClock(log.start_epoch_us, start, sizeof(start));
+  start[19] = '\0';   // StartTime has whole seconds only
+  fprintf(out, "; Version = 1.1\n; Creator = cblog\n; StartTime = %s\n"
+               "; Columns = TimeOffset Channel ID Dir DLC Data\nBegin Triggerblock\n", start);
+
+  char line[96];
+  for (const Frame &f : log.frames) {
+    if (!isCanSource(f.source)) continue;
+    formatTrcLine(f, line, sizeof(line));
+    fprintf(out, "%s\n", line);
+  }
+
+  if (fclose(out) != 0) {
+    err = "write failed: " + path;
+    return false;
+  }
+  return true;
+}
+
+// -------------------- .csv --------------------
+bool readCsv(const std::string &path, Log &log, std::string &err) {
+  return readMapped(path, TextFormat::Csv, log, err);
+}
+
+size_t formatCsvLine(const Frame &f, uint64_t start_epoch_us, char *out, size_t cap) {
+  const uint64_t epoch = start_epoch_us + f.t_us;
+  const bool ext = (f.id & ID_EXTENDED) != 0;
+  char iso[40];
+  formatWallClock(epoch, iso, sizeof(iso));
+
+  size_t n = snprintf(out, cap, ext ? "%s,%llu.%06u,can%d,0x%08X,1,%u," : "%s,%llu.%06u,can%d,0x%03X,0,%u,",
+                      iso, (unsigned long long)(epoch / 1000000ULL), (unsigned)(epoch % 1000000ULL),
+                      canChannel(f.source), (unsigned)(f.id & ~ID_EXTENDED), (unsigned)f.dlc);
+  for (uint8_t i = 0; i < f.dlc && i < 8; i++) n += snprintf(out + n, cap - n, "%02x", f.data[i]);
+  return n;
+}
+
+bool writeCsv(const std::string &path, const Log &log, std::string &err) {
+  FILE *out = fopen(path.c_str(), "w");
+  if (!out) {
+    err = "cannot create " + path;
+    return false;
+  }
+
+  fprintf(out, "ts_iso,ts_epoch,channel,arbitration_id_hex,is_extended,dlc,data_hex\n");
+  char line[128];
+  for (const Frame &f : log.frames) {
+    if (!isCanSource(f.source)) continue;
+    formatCsvLine(f, log.start_epoch_us, line, sizeof(line));
+    fprintf(out, "%s\n", line);
+  }
+
+  if (fclose(out) != 0) {
+    err = "write failed: " + path;
+    return false;
+  }
+  return true;
+}
+
+} // namespace canlog
@@ -0,0 +1,29 @@
+#pragma once
+// Readers and writers for the text recordings made by helper/record_raw_can*.py:
+//
+//   .trc  Vector ASCII trace v1.1, one frame per line:
+//           " 5.809869 can1 08A Rx d 8  00 00 00 00 00 00 00 00"
+//         StartTime in the header gives the wall clock of offset 0.
+//   .csv  ts_iso,ts_epoch,channel,arbitration_id_hex,is_extended,dlc,data_hex
+//         (header row optional):
+//           "2025-09-04 04:14:06.068613,1756955646.068614,can1,0x70A,0,1,7f"
+//
+// Wall clock times are local time, as the recorders write them. Only CAN
+// frames have a text form; writers skip BMS and state records. The readers
+// use the mmapped scanner in MappedLog.h and reject files with bad lines.
+
+#include "CanFrame.h"
+
+namespace canlog {
+
+bool readTrc(const std::string &path, Log &log, std::string &err);
+bool writeTrc(const std::string &path, const Log &log, std::string &err);
+
+bool readCsv(const std::string &path, Log &log, std::string &err);
+bool writeCsv(const std::string &path, const Log &log, std::string &err);
+
+// Single-line formatters, also used for query output
+size_t formatTrcLine(const Frame &f, char *out, size_t cap);
+size_t formatCsvLine(const Frame &f, uint64_t start_epoch_us, char *out, size_t cap);
+
+} // namespace canlog
@@ -0,0 +1,188 @@
+// CAN log converter and query tool for .cbl containers (host/canlog/ChunkedLog.h).
+//
+//   cblog convert IN OUT [--chunk N]
+//       Formats by extension: .trc, .csv, .cbl, and .bin (controller SD
+//       card files, written compressed like the CAN logger).
+//   cblog info FILE.cbl [--verify]
+//   cblog query FILE.cbl [--from SEC] [--to SEC] [--id HEX[,HEX...]] [--csv]
+//       Prints matching frames in .trc (default) or .csv line format, and
+//       the number of chunks and bytes read to stderr.
+
+#include <cctype>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include "ChunkedLog.h"
+#include "DeviceLog.h"
+#include "TextLog.h"
+
+using namespace canlog;
+
+namespace {
+
+enum class Format { Unknown, Trc, Csv, Cbl, Device };
+
+Format formatOf(const std::string &path) {
+  size_t dot = path.rfind('.');
+  if (dot == std::string::npos) return Format::Unknown;
+  std::string ext = path.substr(dot + 1);
+  for (char &c : ext) c = (char)tolower((unsigned char)c);
+  if (ext == "trc") return Format::Trc;
+  if (ext == "csv") return Format::Csv;
+  if (ext == "cbl") return Format::Cbl;
+  if (ext == "bin") return Format::Device;
+  return Format::Unknown;
+}
+
+const char *sourceName(uint8_t source) {
+  switch ((Source)source) {
+    case Source::BMS_RX:  return "bms_rx";
+    case Source::BMS_TX:  return "bms_tx";
+    case Source::DROPPED: return "dropped";
+    case Source::STATE:   return "state";
+    case Source::TRIGGER: return "trigger";
+    default:              return "unknown";
+  }
+}
+
+uint64_t secondsToUs(const char *s) {
+  return (uint64_t)(strtod(s, nullptr) * 1e6 + 0.5);
+}
+
+void usage() {
+  fprintf(stderr,
+          "usage: cblog convert IN OUT [--chunk N]\n"
+          "       cblog info FILE.cbl [--verify]\n"
+          "       cblog query FILE.cbl [--from SEC] [--to SEC] [--id HEX[,HEX...]] [--csv]\n");
+}
+
+int fail(const std::string &err) {
+  fprintf(stderr, "cblog: %s\n", err.c_str());
+  return 1;
+}
+
+int cmdConvert(int argc, char **argv) {
+  if (argc < 2) { usage(); return 2; }
+  const std::string in = argv[0], out = argv[1];
+  uint32_t chunk = CBL_DEFAULT_CHUNK_FRAMES;
+  for (int i = 2; i < argc; i++) {
+    if (!strcmp(argv[i], "--chunk") && i + 1 < argc) chunk = (uint32_t)strtoul(argv[++i], nullptr, 10);
+    else { usage(); return 2; }
+  }
+
+  Log log;
+  std::string err;
+  bool ok = false;
+  switch (formatOf(in)) {
+    case Format::Trc:    ok = readTrc(in, log, err); break;
+    case Format::Csv:    ok = readCsv(in, log, err); break;
+    case Format::Cbl:    ok = readCbl(in, log, err); break;
+    case Format::Device: ok = readDeviceLog(in, log, err); break;
+    default:             err = "unknown input format: " + in; break;
+  }
+  if (!ok) return fail(err);
+
+  switch (formatOf(out)) {
+    case Format::Trc: ok = writeTrc(out, log, err); break;
+    case Format::Csv: ok = writeCsv(out, log, err); break;
+    case Format::Cbl: ok = writeCbl(out, log, err, chunk); break;
+    case Format::Device: ok = writeDeviceLog(out, log, err); break;
+    default:          err = "unsupported output format: " + out; break;
+  }
+  if (!ok) return fail(err);
+
+  fprintf(stderr, "%s -> %s: %zu frames\n", in.c_str(), out.c_str(), log.frames.size());
+  return 0;
+}
+
+int cmdInfo(int argc, char **argv) {
+  if (argc < 1) { usage(); return 2; }
+  bool verify = (argc > 1 && !strcmp(argv[1], "--verify"));
+
+  CblReader r;
+  std::string err;
+  if (!r.open(argv[0], err)) return fail(err);
+
+  const auto &index = r.index();
+  uint64_t first = index.empty() ? 0 : index.front().t_first_us;
+  uint64_t last = index.empty() ? 0 : index.back().t_last_us;
+  printf("frames: %llu in %zu chunks of up to %u\n", (unsigned long long)r.frameCount(), index.size(),
+         r.header().chunk_frames);
+  printf("span:   %.6f .. %.6f s\n", first / 1e6, last / 1e6);
+  if (r.header().start_epoch_us) printf("start:  %.6f (epoch)\n", r.header().start_epoch_us / 1e6);
+
+  printf("%-6s %14s %14s %8s %6s\n", "chunk", "t_first", "t_last", "frames", "ids");
+  for (size_t i = 0; i < index.size(); i++) {
+    printf("%-6zu %14.6f %14.6f %8u %6u\n", i, index[i].t_first_us / 1e6, index[i].t_last_us / 1e6,
+           index[i].frame_count, index[i].id_count);
+  }
+
+  if (verify) {
+    if (!r.verify(err)) return fail(err);
+    printf("verify: all chunk CRCs ok\n");
+  }
+  return 0;
+}
+
+int cmdQuery(int argc, char **argv) {
+  if (argc < 1) { usage(); return 2; }
+
+  CblQuery q;
+  bool csv = false;
+  for (int i = 1; i < argc; i++) {
+    if (!strcmp(argv[i], "--from") && i + 1 < argc) q.t_from_us = secondsToUs(argv[++i]);
+    else if (!strcmp(argv[i], "--to") && i + 1 < argc) q.t_to_us = secondsToUs(argv[++i]);
+    else if (!strcmp(argv[i], "--id") && i + 1 < argc) {
+      for (char *p = argv[++i]; *p; ) {
+        uint32_t id = (uint32_t)strtoul(p, &p, 16);
+        q.ids.push_back(id > 0x7FF ? (id | ID_EXTENDED) : id);
+        if (*p == ',') p++;
+        else if (*p) { usage(); return 2; }
+      }
+    }
+    else if (!strcmp(argv[i], "--csv")) csv = true;
+    else { usage(); return 2; }
+  }
+
+  CblReader r;
+  std::string err;
+  if (!r.open(argv[0], err)) return fail(err);
+
+  const uint64_t epoch = r.header().start_epoch_us;
+  char line[160];
+  uint64_t matched = 0;
+  CblQueryStats stats;
+  bool ok = r.query(q, [&](const Frame &f) {
+    matched++;
+    if (!isCanSource(f.source)) {
+      if (csv) return;   // the CSV layout has no place for non-CAN records
+      int n = snprintf(line, sizeof(line), "%2llu.%06u %s %X d %u  ", (unsigned long long)(f.t_us / 1000000ULL),
+                       (unsigned)(f.t_us % 1000000ULL), sourceName(f.source), (unsigned)f.id, (unsigned)f.dlc);
+      for (uint8_t i = 0; i < f.dlc; i++) n += snprintf(line + n, sizeof(line) - n, i ? " %02X" : "%02X", f.data[i]);
+    } else if (csv) {
+      formatCsvLine(f, epoch, line, sizeof(line));
+    } else {
+      formatTrcLine(f, line, sizeof(line));
+    }
+    puts(line);
+  }, &stats, err);
+  if (!ok) return fail(err);
+
+  fprintf(stderr, "%llu frames matched; read %u of %u chunks, %llu frames, %llu bytes\n",
+          (unsigned long long)matched, stats.chunks_read, stats.chunks_total,
+          (unsigned long long)stats.frames_read, (unsigned long long)stats.bytes_read);
+  return 0;
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+  if (argc < 2) { usage(); return 2; }
+  const char *cmd = argv[1];
+  if (!strcmp(cmd, "convert")) return cmdConvert(argc - 2, argv + 2);
+  if (!strcmp(cmd, "info")) return cmdInfo(argc - 2, argv + 2);
+  if (!strcmp(cmd, "query")) return cmdQuery(argc - 2, argv + 2);
+  usage();
+  return 2;
+}
@@ -0,0 +1,73 @@
+# ctest script: the recordings in extra/ through cblog and back, so through
+# the .cbl writer, reader and index and the mmapped .trc/.csv scanner.
+#
+#   .trc -> .cbl (several chunks) -> .trc  the original, but for Creator
+#   .trc -> .cbl again                     byte-identical container
+#   .csv -> .cbl -> .csv -> .cbl           byte-identical containers
+#   info --verify                          passes
+#   query --from/--to/--id                 the matching lines of the original
+#
+#   cmake -DCBLOG=path/to/cblog -DEXTRA=path/to/extra -DWORK=dir -P roundtrip.cmake
+
+file(REMOVE_RECURSE ${WORK})
+file(MAKE_DIRECTORY ${WORK})
+
+function(cblog)
+  execute_process(COMMAND ${CBLOG} ${ARGN} RESULT_VARIABLE rc OUTPUT_VARIABLE out ERROR_VARIABLE err)
+  if(NOT rc EQUAL 0)
+    message(FATAL_ERROR "cblog ${ARGN} failed (${rc}):\n${out}${err}")
+  endif()
+  set(CBLOG_OUT "${out}" PARENT_SCOPE)
+endfunction()
+
+function(expect_same a b)
+  execute_process(COMMAND ${CMAKE_COMMAND} -E compare_files ${a} ${b} RESULT_VARIABLE rc)
+  if(NOT rc EQUAL 0)
+    message(FATAL_ERROR "${a} and ${b} differ")
+  endif()
+endfunction()
+
+# Everything but the Creator line, which names the writer
+function(trc_body path var)
+  file(STRINGS ${path} lines)
+  list(FILTER lines EXCLUDE REGEX "^; Creator")
+  set(${var} "${lines}" PARENT_SCOPE)
+endfunction()
+
+set(trc ${EXTRA}/can1_log.trc)
+cblog(convert ${trc} ${WORK}/a.cbl --chunk 64)
+cblog(convert ${WORK}/a.cbl ${WORK}/a.trc)
+trc_body(${trc} original)
+trc_body(${WORK}/a.trc roundtrip)
+if(NOT original STREQUAL roundtrip)
+  message(FATAL_ERROR "${WORK}/a.trc does not match ${trc}")
+endif()
+cblog(convert ${WORK}/a.trc ${WORK}/b.cbl --chunk 64)
+expect_same(${WORK}/a.cbl ${WORK}/b.cbl)
+
+cblog(convert ${EXTRA}/can1_log.csv ${WORK}/c.cbl --chunk 64)
+cblog(convert ${WORK}/c.cbl ${WORK}/c.csv)
+cblog(convert ${WORK}/c.csv ${WORK}/d.cbl --chunk 64)
+expect_same(${WORK}/c.cbl ${WORK}/d.cbl)
+
+cblog(info ${WORK}/a.cbl --verify)
+if(NOT CBLOG_OUT MATCHES "verify: all chunk CRCs ok")
+  message(FATAL_ERROR "cblog info --verify did not report the CRCs:\n${CBLOG_OUT}")
+endif()
+
+set(query_args --from 10 --to 20 --id 70A,18A)
+cblog(query ${WORK}/a.cbl ${query_args})
+string(REGEX REPLACE "\n$" "" got "${CBLOG_OUT}")
+string(REPLACE "\n" ";" got "${got}")
+set(want)
+foreach(line IN LISTS original)
+  string(STRIP "${line}" line)
+  if(line MATCHES "^([0-9]+)\\.[0-9]+ can1 (70A|18A) " AND CMAKE_MATCH_1 GREATER_EQUAL 10 AND CMAKE_MATCH_1 LESS 20)
+    list(APPEND want "${line}")
+  endif()
+endforeach()
+list(LENGTH want n)
+if(n EQUAL 0 OR NOT got STREQUAL want)
+  string(JOIN " " shown ${query_args})
+  message(FATAL_ERROR "cblog query ${shown} printed\n${CBLOG_OUT}\nnot the ${n} lines of ${trc}")
+endif()
@@ -0,0 +1,219 @@
+// Micro-benchmarks for the charge controller firmware built on the host:
+// the charger (dbc), Kelly (mcdbc) and BMS decoders, and one pass of the
+// sketch's loop() on the virtual clock while a charger heartbeats and
+// streams TPDOs at it. The motor case repeats the loop with CAN2 carrying
+// Kelly frames at full 250 kbps load and reports what each one costs.
+//
+// Inputs are synthetic and fixed, so numbers are comparable across builds
+// on the same machine. Each case runs --runs times; the best run is kept.
+//
+//   cc_bench [--iters N] [--runs N] [--case dbc|mcdbc|bms|loop|motor]
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <Arduino.h>
+#include <FlexCAN_T4.h>
+#include "BmsDecoder.h"
+#include "DbcDecode.h"
+#include "MotorController_DbcDecode.h"
+
+void setup();
+void loop();
+
+namespace {
+
+struct Frame { uint32_t id; uint8_t dlc; uint8_t data[8]; };
+
+std::vector<Frame> chargerFrames(size_t n) {
+  static const uint32_t ids[] = {dbc::ID_TPDO1_0x18A, dbc::ID_TPDO2_0x28A, dbc::ID_TPDO3_0x38A,
+                                 dbc::ID_Heartbeat_0x70A, dbc::ID_RPDO1_0x20A, dbc::ID_RPDO2_0x30A,
+                                 dbc::ID_Fault_Register_0x08A, 0x123};
+  std::vector<Frame> out(n);
+  for (size_t i = 0; i < n; i++) {
+    Frame &f = out[i];
+    f.id = ids[i % (sizeof(ids) / sizeof(ids[0]))];
+    f.dlc = f.id == dbc::ID_Heartbeat_0x70A ? 1 : 8;
+    for (int b = 0; b < 8; b++) f.data[b] = (uint8_t)(i * 31 + b * 17);
+  }
+  return out;
+}
+
+std::vector<Frame> kellyFrames(size_t n) {
+  std::vector<Frame> out(n);
+  for (size_t i = 0; i < n; i++) {
+    Frame &f = out[i];
+    f.id = (i & 1) ? mcdbc::Msg2_0x0CF11F05::kCanId : mcdbc::Msg1_0x0CF11E05::kCanId;
+    f.dlc = 8;
+    for (int b = 0; b < 8; b++) f.data[b] = (uint8_t)(i * 13 + b * 29);
+  }
+  return out;
+}
+
+// A JK BMS status frame as the controller receives it: 20 cells near 4.0 V
+std::vector<uint8_t> bmsFrame() {
+  std::vector<uint8_t> d(121, 0);
+  d[0] = 0x4E; d[1] = 0x57;
+  d[4] = 800 >> 8; d[5] = 800 & 0xFF;   // 80.0 V
+  for (int i = 0; i < 20; i++) {
+    uint16_t mv = (uint16_t)(3990 + i);
+    d[6 + i * 2] = mv >> 8;
+    d[7 + i * 2] = mv & 0xFF;
+  }
+  d[74] = 87;
+  d[103] = 1; d[104] = 1; d[105] = 4;
+  d[115] = 20; d[116] = 4009 >> 8; d[117] = 4009 & 0xFF;
+  d[118] = 1;  d[119] = 3990 >> 8; d[120] = 3990 & 0xFF;
+  return d;
+}
+
+template <typename Fn>
+double bestNsPerOp(int runs, uint64_t ops, Fn &&body) {
+  double best = 0;
+  for (int r = 0; r < runs; r++) {
+    auto t0 = std::chrono::steady_clock::now();
+    body();
+    double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - t0).count() / ops;
+    if (r == 0 || ns < best) best = ns;
+  }
+  return best;
+}
+
+volatile uint32_t sink;   // keeps decoded results observable
+
+void benchDbc(uint64_t iters, int runs) {
+  std::vector<Frame> frames = chargerFrames(4096);
+  double ns = bestNsPerOp(runs, iters, [&] {
+    uint32_t acc = 0;
+    dbc::AnyMessage m;
+    for (uint64_t i = 0; i < iters; i++) {
+      const Frame &f = frames[i & 4095];
+      if (dbc::decode(f.id, f.data, f.dlc, m)) acc += (uint32_t)m.type;
+    }
+    sink = acc;
+  });
+  printf("dbc     %8.1f ns/frame  %6.1f M frames/s\n", ns, 1e3 / ns);
+}
+
+void benchMcdbc(uint64_t iters, int runs) {
+  std::vector<Frame> frames = kellyFrames(4096);
+  double ns = bestNsPerOp(runs, iters, [&] {
+    uint32_t acc = 0;
+    mcdbc::AnyMessage m;
+    for (uint64_t i = 0; i < iters; i++) {
+      const Frame &f = frames[i & 4095];
+      if (mcdbc::decode(f.id, f.data, f.dlc, m)) acc += (uint32_t)m.type;
+    }
+    sink = acc;
+  });
+  printf("mcdbc   %8.1f ns/frame  %6.1f M frames/s\n", ns, 1e3 / ns);
+}
+
+void benchBms(uint64_t iters, int runs) {
+  std::vector<uint8_t> frame = bmsFrame();
+  iters = iters / 16 + 1;   // a BMS frame is ~15x the work of a CAN frame
+  double ns = bestNsPerOp(runs, iters, [&] {
+    uint32_t acc = 0;
+    for (uint64_t i = 0; i < iters; i++) {
+      frame[74] = (uint8_t)i;
+      BmsData b = decodeBmsMessage(frame.data(), frame.size());
+      acc += b.soc_pct + b.high_cell_num;
+    }
+    sink = acc;
+  });
+  printf("bms     %8.1f ns/frame  %6.2f M frames/s\n", ns, 1e3 / ns);
+}
+
+// loop() at 1 kHz virtual; the charger heartbeats every 1 s and sends TPDO1
+// every 200 ms, so the sketch reaches RUN_CHARGING and stays there.
+// kellyPerTick Kelly frames (alternating 0x0CF11E05/0x0CF11F05) arrive on
+// CAN2 per pass on average.
+double loopNs(uint64_t iters, int runs, double kellyPerTick) {
+  Serial.onWrite = nullptr;
+  Serial2.onWrite = nullptr;
+  arduinoSetNowUs(0);
+  setup();
+
+  FlexCANShimBus *can1 = flexcanBus(CAN1);
+  FlexCANShimBus *can2 = flexcanBus(CAN2);
+  std::vector<Frame> kelly = kellyFrames(4096);
+  double kellyDue = 0;
+  uint64_t kellySent = 0;
+  uint64_t tick = 0;
+  return bestNsPerOp(runs, iters, [&] {
+    for (uint64_t i = 0; i < iters; i++, tick++) {
+      if (tick % 1000 == 0) {
+        CAN_message_t hb;
+        hb.id = dbc::ID_Heartbeat_0x70A;
+        hb.len = 1;
+        hb.buf[0] = 0x05;
+        can1->inject(hb);
+      }
+      if (tick % 200 == 0) {
+        CAN_message_t pdo;
+        pdo.id = dbc::ID_TPDO1_0x18A;
+        pdo.len = 8;
+        can1->inject(pdo);
+      }
+      for (kellyDue += kellyPerTick; kellyDue >= 1.0; kellyDue -= 1.0) {
+        const Frame &f = kelly[kellySent++ & 4095];
+        CAN_message_t msg;
+        msg.id = f.id;
+        msg.flags.extended = true;
+        memcpy(msg.buf, f.data, 8);
+        can2->inject(msg);
+      }
+      loop();
+      arduinoAdvanceUs(1000);
+    }
+  });
+}
+
+void benchLoop(uint64_t iters, int runs) {
+  double ns = loopNs(iters, runs, 0);
+  printf("loop    %8.1f ns/call   %6.2f M calls/s (%.0fx real time at 1 kHz)\n", ns, 1e3 / ns, 1e6 / ns);
+}
+
+// A full 250 kbps bus of extended 8-byte frames at worst-case stuffing (160
+// bits each) is 1562.5 frames/s, 1.5625 per 1 kHz pass
+void benchMotor(uint64_t iters, int runs) {
+  const double perTick = 250000.0 / 160 / 1000;
+  double base = loopNs(iters, runs, 0);
+  double ns = loopNs(iters, runs, perTick);
+  printf("motor   %8.1f ns/call   %6.1f ns/Kelly frame, %.2f%% of one core at full CAN2 load\n", ns,
+         (ns - base) / perTick, (ns - base) / 1e4);
+}
+
+void usage() {
+  fprintf(stderr, "usage: cc_bench [--iters N] [--runs N] [--case dbc|mcdbc|bms|loop|motor]\n");
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+  uint64_t iters = 10000000;
+  int runs = 3;
+  std::string only;
+
+  for (int i = 1; i < argc; i++) {
+    auto next = [&]() -> const char * {
+      if (i + 1 >= argc) { usage(); exit(2); }
+      return argv[++i];
+    };
+    if (!strcmp(argv[i], "--iters")) iters = strtoull(next(), nullptr, 10);
+    else if (!strcmp(argv[i], "--runs")) runs = atoi(next());
+    else if (!strcmp(argv[i], "--case")) only = next();
+    else { usage(); return 2; }
+  }
+  if (iters == 0 || runs < 1) { usage(); return 2; }
+
+  if (only.empty() || only == "dbc") benchDbc(iters, runs);
+  if (only.empty() || only == "mcdbc") benchMcdbc(iters, runs);
+  if (only.empty() || only == "bms") benchBms(iters, runs);
+  if (only.empty() || only == "loop") benchLoop(iters / 10 + 1, runs);
+  if (only.empty() || only == "motor") benchMotor(iters / 10 + 1, runs);
+  return 0;
+}
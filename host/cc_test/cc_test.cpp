@@ -0,0 +1,382 @@
+// Checks of the charge controller firmware on the host build:
+//
+//   dbc     Delta-Q frames from extra/can1_log.trc, plus a shutdown TPDO1,
+//           decoded field by field; short and unknown frames refused
+//   mcdbc   Kelly 0x0CF11E05/0x0CF11F05 frames with known contents
+//   bms     a hand-built 121-byte JK reply, and reassembly of the UART stream
+//   replay  extra/can1_log.trc through setup()/loop(): the handshake, charging
+//           RPDO1s, HBLOST 3 s after the last charger heartbeat, the safe
+//           stop, and the return to waiting once the charger is gone
+//   limits  (cc_test_limits, the firmware built with a target current above
+//           its limit) FAULTED from setup(), held through the same recording
+//           and 10 s of silence after it
+//
+// Prints each failed check with its line and exits 1 if there were any.
+//
+//   cc_test [--log FILE.trc]
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <string>
+#include <vector>
+#include <Arduino.h>
+#include <FlexCAN_T4.h>
+#include "BmsDecoder.h"
+#include "DbcDecode.h"
+#include "MotorController_DbcDecode.h"
+#include "ReplayTap.h"
+#include "SimKernel.h"
+#include "TextLog.h"
+
+void setup();
+void loop();
+
+namespace {
+
+int checks = 0;
+int failures = 0;
+
+void check(bool ok, const char *what, int line) {
+  checks++;
+  if (ok) return;
+  failures++;
+  printf("  FAIL line %d: %s\n", line, what);
+}
+
+#define CHECK(cond) check((cond), #cond, __LINE__)
+#define CHECK_NEAR(a, b, tol) check(fabs((double)(a) - (double)(b)) <= (tol), #a " == " #b, __LINE__)
+
+#ifndef CC_TEST_LIMITS
+// -------------------- Charger (dbc) --------------------
+void testDbc() {
+  dbc::AnyMessage m;
+
+  const uint8_t tpdo1[8] = {0x74, 0x13, 0x45, 0x4E, 0x70, 0x00, 0x00, 0x00};
+  CHECK(dbc::decode(0x18A, tpdo1, 8, m));
+  CHECK(m.type == dbc::AnyMessage::Type::TPDO1_18A);
+  CHECK_NEAR(m.tpdo1_18a.charging_current_A, 4980 / 256.0, 1e-6);
+  CHECK_NEAR(m.tpdo1_18a.battery_voltage_V, 20037 / 256.0, 1e-6);
+  CHECK(m.tpdo1_18a.hw_shutdown == dbc::ChargerHardwareShutdownStatus::Running);
+  CHECK(m.tpdo1_18a.derating == dbc::ChargerDeratingStatus::NotDerating);
+  CHECK(m.tpdo1_18a.ac_status == dbc::ACConnectionStatus::ACDetected);
+  CHECK(m.tpdo1_18a.charger_status == dbc::ChargerStatus::Enabled);
+  CHECK(m.tpdo1_18a.override_status == dbc::OverrideStatus::Enabled);
+  CHECK(m.tpdo1_18a.charge_indication == dbc::ChargeIndication::Inactive);
+
+  const uint8_t shutdown[8] = {0x00, 0x00, 0x45, 0x4E, 0x34, 0x14, 0x00, 0x00};
+  CHECK(dbc::decode(0x18A, shutdown, 8, m));
+  CHECK(m.tpdo1_18a.hw_shutdown == dbc::ChargerHardwareShutdownStatus::ShutDown);
+  CHECK(m.tpdo1_18a.charger_status == dbc::ChargerStatus::Enabled);
+  CHECK(m.tpdo1_18a.charge_indication == dbc::ChargeIndication::Complete);
+  CHECK(m.tpdo1_18a.charge_cycle_type == dbc::BattChargeCycleType::Charge);
+
+  const uint8_t tpdo3[8] = {0x00, 0x00, 0x00, 0x00, 0xBA, 0x07, 0xFF, 0x00};
+  CHECK(dbc::decode(0x38A, tpdo3, 8, m));
+  CHECK(m.type == dbc::AnyMessage::Type::TPDO3_38A);
+  CHECK(m.tpdo3_38a.current_error_raw == 0);
+  CHECK_NEAR(m.tpdo3_38a.ac_voltage_VAC, 123.625, 1e-6);
+  CHECK(m.tpdo3_38a.charger_soc_pct == 255);
+
+  const uint8_t tpdo2[8] = {0x06, 0x00, 0x28, 0x00, 0x00, 0x00, 0x40, 0x1F};
+  CHECK(dbc::decode(0x28A, tpdo2, 8, m));
+  CHECK_NEAR(m.tpdo2_28a.elapsed_time_s, 60, 1e-6);
+  CHECK_NEAR(m.tpdo2_28a.ah_returned_Ah, 5, 1e-6);
+  CHECK_NEAR(m.tpdo2_28a.wh_returned_Wh, 500, 1e-6);
+
+  const uint8_t nmt[8] = {0x01, 0x0A};
+  CHECK(dbc::decode(0x000, nmt, 2, m));
+  CHECK(m.nmt_start.command == dbc::NMTCommand::Start);
+  CHECK(m.nmt_start.node_id == 0x0A);
+
+  const uint8_t preop[8] = {0x7F};
+  CHECK(dbc::decode(0x70A, preop, 1, m));
+  CHECK(m.hb_70a.state == dbc::HeartbeatState::PreOperational);
+  const uint8_t oper[8] = {0x05};
+  CHECK(dbc::decode(0x701, oper, 1, m));
+  CHECK(m.hb_701.state == dbc::HeartbeatState::Operational);
+
+  // What the firmware sends while charging: 82 V, 10 A, ready
+  const uint8_t rpdo1[8] = {0x00, 0x32, 0x00, 0x00, 0x52, 0xA0, 0x00, 0x01};
+  CHECK(dbc::decode(0x20A, rpdo1, 8, m));
+  CHECK(m.rpdo1_20a.battery_soc_pct == 50);
+  CHECK_NEAR(m.rpdo1_20a.voltage_request_V, 82.0, 1e-6);
+  CHECK_NEAR(m.rpdo1_20a.current_request_A, 10.0, 1e-6);
+  CHECK(m.rpdo1_20a.battery_status == dbc::BatteryStatus::Enabled);
+
+  CHECK(!dbc::decode(0x18A, tpdo1, 7, m));
+  CHECK(!dbc::decode(0x18B, tpdo1, 8, m));
+  CHECK(m.type == dbc::AnyMessage::Type::None);
+}
+
+// -------------------- Kelly (mcdbc) --------------------
+void testMcdbc() {
+  mcdbc::AnyMessage m;
+
+  // 1000 rpm, 30.0 A, 80.0 V, over voltage + stall
+  const uint8_t msg1[8] = {0xE8, 0x03, 0x2C, 0x01, 0x20, 0x03, 0x12, 0x00};
+  CHECK(mcdbc::decode(0x0CF11E05, msg1, 8, m));
+  CHECK(m.type == mcdbc::AnyMessage::Type::Msg1_0x0CF11E05);
+  CHECK_NEAR(m.msg1.speed_rpm, 1000, 1e-6);
+  CHECK_NEAR(m.msg1.motor_current_A, 30.0, 1e-6);
+  CHECK_NEAR(m.msg1.battery_voltage_V, 80.0, 1e-6);
+  CHECK(m.msg1.err1_over_voltage && m.msg1.err4_stall);
+  CHECK(!m.msg1.err2_low_voltage && !m.msg1.err6_over_temperature);
+  CHECK(mcdbc::errorSummary(m.msg1) == "OverVoltage, Stall");
+
+  // Throttle 255 (5 V), controller 50 C, motor 50 C, forward/forward,
+  // boost + forward switch + hall A
+  const uint8_t msg2[8] = {0xFF, 0x5A, 0x50, 0x00, 0x05, 0xA1, 0x00, 0x00};
+  CHECK(mcdbc::decode(0x0CF11F05, msg2, 8, m));
+  CHECK(m.type == mcdbc::AnyMessage::Type::Msg2_0x0CF11F05);
+  CHECK_NEAR(m.msg2.throttle_V, 5.0, 1e-6);
+  CHECK_NEAR(m.msg2.controller_temp_C, 50, 1e-6);
+  CHECK_NEAR(m.msg2.motor_temp_C, 50, 1e-6);
+  CHECK(m.msg2.feedback_status == 1 && m.msg2.command_status == 1);
+  CHECK(m.msg2.boost_switch && m.msg2.forward_switch && m.msg2.hall_a);
+  CHECK(!m.msg2.foot_switch && !m.msg2.backward_switch && !m.msg2.hall_b);
+
+  CHECK(!mcdbc::decode(0x0CF11E05, msg1, 7, m));
+  CHECK(!mcdbc::decode(0x0CF11E06, msg1, 8, m));
+}
+
+// -------------------- BMS --------------------
+void put16(uint8_t *p, uint16_t v) {
+  p[0] = (uint8_t)(v >> 8);
+  p[1] = (uint8_t)v;
+}
+
+void put32(uint8_t *p, uint32_t v) {
+  put16(p, (uint16_t)(v >> 16));
+  put16(p + 2, (uint16_t)v);
+}
+
+void bmsFrame(uint8_t f[BMS_FRAME_LEN]) {
+  memset(f, 0, BMS_FRAME_LEN);
+  f[0] = 0x4E;
+  f[1] = 0x57;
+  put16(&f[4], 800);                        // 80.0 V
+  for (int i = 0; i < 20; i++) put16(&f[6 + i * 2], (uint16_t)(4000 + i));
+  put16(&f[72], 105);                       // 10.5 A
+  f[74] = 57;
+  put32(&f[75], 40000000);                  // 40 Ah
+  put32(&f[79], 22800000);                  // 22.8 Ah
+  put32(&f[83], 1500000);                   // 1.5 Ah
+  put16(&f[91], 25);
+  put16(&f[93], 27);
+  for (int i = 0; i < 4; i++) put16(&f[95 + i * 2], (uint16_t)(20 + i));
+  f[103] = 1;
+  f[104] = 2;
+  f[105] = 4;
+  f[115] = 20;
+  put16(&f[116], 4019);
+  f[118] = 1;
+  put16(&f[119], 4000);
+}
+
+void testBms() {
+  uint8_t f[BMS_FRAME_LEN];
+  bmsFrame(f);
+  const BmsData b = decodeBmsMessage(f, sizeof(f));
+  CHECK_NEAR(b.pack_voltage_V, 80.0, 1e-4);
+  CHECK_NEAR(b.pack_current_A, 10.5, 1e-4);
+  CHECK(b.soc_pct == 57);
+  CHECK(b.cell_voltages.size() == 20);
+  if (b.cell_voltages.size() == 20) {
+    CHECK_NEAR(b.cell_voltages[0], 4.000, 1e-6);
+    CHECK_NEAR(b.cell_voltages[19], 4.019, 1e-6);
+  }
+  CHECK_NEAR(b.physical_capacity_Ah, 40.0, 1e-4);
+  CHECK_NEAR(b.remaining_capacity_Ah, 22.8, 1e-4);
+  CHECK_NEAR(b.cyclic_capacity_Ah, 1.5, 1e-4);
+  CHECK_NEAR(b.mos_temperature_C, 25, 1e-6);
+  CHECK_NEAR(b.balance_temperature_C, 27, 1e-6);
+  CHECK(b.external_temperatures.size() == 4 && b.external_temperatures[3] == 23);
+  CHECK(b.charge_mos_status_code == 1 && b.charge_mos_status_txt == "Open");
+  CHECK(b.discharge_mos_status_txt == "Under-voltage of the single cell");
+  CHECK(b.balance_status_txt == "Auto Balance");
+  CHECK(b.high_cell_num == 20);
+  CHECK_NEAR(b.high_cell_voltage, 4.019, 1e-6);
+  CHECK(b.low_cell_num == 1);
+  CHECK_NEAR(b.low_cell_voltage, 4.000, 1e-6);
+
+  // Too short: nothing decoded
+  const BmsData shortFrame = decodeBmsMessage(f, BMS_FRAME_LEN - 1);
+  CHECK(shortFrame.cell_voltages.empty() && shortFrame.pack_voltage_V == 0);
+
+  // Stream: a frame and a bit arrive; the bit stays for the next one
+  BmsRxBuffer rx;
+  bool appended = true;
+  for (size_t i = 0; i < BMS_FRAME_LEN; i++) appended &= bmsRxAppend(rx, f[i]);
+  for (size_t i = 0; i < 10; i++) appended &= bmsRxAppend(rx, f[i]);
+  CHECK(appended);
+  const uint8_t *frame = bmsRxFrame(rx);
+  CHECK(frame != nullptr && !memcmp(frame, f, BMS_FRAME_LEN));
+  bmsRxConsume(rx);
+  CHECK(rx.len == 10 && !memcmp(rx.data, f, 10));
+  CHECK(bmsRxFrame(rx) == nullptr);
+
+  // A full buffer is emptied to resync
+  while (rx.len < sizeof(rx.data)) bmsRxAppend(rx, 0);
+  CHECK(!bmsRxAppend(rx, 0));
+  CHECK(rx.len == 0);
+}
+
+#endif
+
+// -------------------- Replay --------------------
+struct StateChange {
+  uint64_t t_us;
+  std::string to;
+  std::string reason;
+};
+
+// What the firmware did with a recording fed to CAN1
+struct Session {
+  std::vector<StateChange> states;
+  uint64_t lastChargerHb = 0;
+  int rpdo1 = 0;
+  int chargingRpdo = 0;    // sent in RUN_CHARGING with a current request
+  int stopRpdo = 0;        // zero current
+  uint64_t lastStopRpdo = 0;
+};
+
+bool runLog(const std::string &path, uint64_t tailUs, Session &s) {
+  canlog::Log log;
+  std::string err;
+  if (!canlog::readTrc(path, log, err)) {
+    check(false, err.c_str(), __LINE__);
+    return false;
+  }
+  std::vector<canlog::Frame> stream;
+  for (const canlog::Frame &f : log.frames) {
+    if (f.source != (uint8_t)canlog::Source::CAN1_RX) continue;
+    stream.push_back(f);
+    if (f.id == 0x70A) s.lastChargerHb = f.t_us;
+  }
+  CHECK(!stream.empty() && s.lastChargerHb > 0);
+  if (stream.empty()) return false;
+
+  replayTimeline.out = nullptr;
+  replayTimeline.onState = [&](uint8_t, uint8_t to, const char *reason) {
+    s.states.push_back({arduinoNowUs(), replayStateName(to), reason});
+  };
+  flexcanBus(CAN1)->onWrite = [&](const CAN_message_t &msg) {
+    dbc::AnyMessage m;
+    if (msg.id != 0x20A || !dbc::decode(msg.id, msg.buf, msg.len, m)) return;
+    s.rpdo1++;
+    const bool charging = !s.states.empty() && s.states.back().to == "RUN_CHARGING";
+    if (charging && m.rpdo1_20a.current_request_A > 0) s.chargingRpdo++;
+    if (m.rpdo1_20a.current_request_A == 0) {
+      s.stopRpdo++;
+      s.lastStopRpdo = arduinoNowUs();
+    }
+  };
+
+  arduinoSetNowUs(0);
+  setup();
+  sim::Kernel kernel(loop);
+  size_t next = 0;
+  std::function<void()> feed = [&]() {
+    for (; next < stream.size() && stream[next].t_us <= arduinoNowUs(); next++) {
+      const canlog::Frame &f = stream[next];
+      CAN_message_t msg;
+      msg.id = f.id & ~canlog::ID_EXTENDED;
+      msg.flags.extended = (f.id & canlog::ID_EXTENDED) != 0;
+      msg.len = f.dlc;
+      memcpy(msg.buf, f.data, sizeof(msg.buf));
+      flexcanBus(CAN1)->inject(msg);
+    }
+    if (next < stream.size()) kernel.at(stream[next].t_us, feed);
+  };
+  kernel.at(stream.front().t_us, feed);
+  kernel.runUntil(stream.back().t_us + tailUs);
+  replayTimeline.onState = nullptr;
+  flexcanBus(CAN1)->onWrite = nullptr;
+  return true;
+}
+
+#ifndef CC_TEST_LIMITS
+void testReplay(const std::string &path) {
+  Session s;
+  if (!runLog(path, 10000000, s)) return;
+  const std::vector<StateChange> &states = s.states;
+
+  const char *const expected[][2] = {
+    {"SEND_NMT_START", "HB"},
+    {"SEND_RPDO1_NOT_READY", "NMT"},
+    {"RUN_CHARGING", "RPDO1"},
+    {"STOPPING", "HBLOST"},
+    {"FAULTED", "STOP"},
+    {"WAIT_FOR_CHARGER_HEARTBEAT", "UNPLUG"},
+  };
+  const size_t n = sizeof(expected) / sizeof(expected[0]);
+  CHECK(states.size() == n);
+  for (size_t i = 0; i < n && i < states.size(); i++) {
+    const std::string what = "state " + std::to_string(i) + " " + states[i].to + " (" + states[i].reason +
+                             ") is " + expected[i][0] + " (" + expected[i][1] + ")";
+    check(states[i].to == expected[i][0] && states[i].reason == expected[i][1], what.c_str(), __LINE__);
+  }
+  if (states.size() == n) {
+    // Heartbeat timeout is > 3000 ms; the loop sees it on the next pass
+    const int64_t hbLost = (int64_t)(states[3].t_us - s.lastChargerHb);
+    CHECK(hbLost > 3000000 && hbLost <= 3010000);
+    CHECK(states[4].t_us - states[3].t_us <= 50000);
+    CHECK(states[5].t_us - s.lastChargerHb >= 5000000);
+    CHECK(s.stopRpdo == 2 && s.lastStopRpdo >= states[3].t_us);
+  }
+  // One RPDO1 every 250 ms from the start of charging to the stop
+  CHECK(s.chargingRpdo > 100);
+}
+#else
+// Built with a target above MAX_ALLOWED_*: setup() latches FAULTED and
+// nothing, not the charger's heartbeats nor its silence after them, clears it
+void testLimits(const std::string &path) {
+  Session s;
+  if (!runLog(path, 10000000, s)) return;
+  CHECK(s.states.size() == 1);
+  if (!s.states.empty()) {
+    CHECK(s.states[0].t_us == 0);
+    CHECK(s.states[0].to == "FAULTED" && s.states[0].reason == "LIMITS");
+  }
+  CHECK(arduinoNowUs() >= s.lastChargerHb + 2 * 5000000);
+  CHECK(s.rpdo1 == 0);
+}
+#endif
+
+void usage() {
+  fprintf(stderr, "usage: cc_test [--log FILE.trc]\n");
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+  std::string logPath = CC_TEST_DEFAULT_LOG;
+  for (int i = 1; i < argc; i++) {
+    if (!strcmp(argv[i], "--log") && i + 1 < argc) logPath = argv[++i];
+    else { usage(); return 2; }
+  }
+
+  const struct {
+    const char *name;
+    std::function<void()> run;
+  } tests[] = {
+#ifndef CC_TEST_LIMITS
+    {"dbc", testDbc},
+    {"mcdbc", testMcdbc},
+    {"bms", testBms},
+    {"replay", [&]() { testReplay(logPath); }},
+#else
+    {"limits", [&]() { testLimits(logPath); }},
+#endif
+  };
+  for (const auto &t : tests) {
+    const int before = failures;
+    t.run();
+    printf("%-7s %s\n", t.name, failures == before ? "ok" : "FAIL");
+  }
+  printf("%d checks, %d failed\n", checks, failures);
+  return failures ? 1 : 0;
+}
@@ -0,0 +1,172 @@
+// Runs the charge controller firmware (teensy/charge_controller) in real time
+// against SocketCAN interfaces, so it can be pointed at deltaq_emu on a vcan,
+// at a real charger through a USB-CAN adapter, or at both sides of a replay.
+// --bms connects Serial1 to a tty: bms_emu's PTY or a USB-serial adapter on
+// the real pack.
+//
+// The virtual clock follows CLOCK_MONOTONIC from start-up. Between passes the
+// process sleeps in poll() until a frame arrives or the firmware's next
+// deadline hint is due (at most 100 ms), so it idles at ~0% CPU. The
+// firmware's USB serial output goes to stdout and its timeline (state changes
+// and, with --frames, every TX frame) to stderr.
+//
+//   cc_vcan --can1 IFACE [--can2 IFACE] [--bms TTY] [--frames]
+//
+//   sudo ip link add dev vcan0 type vcan && sudo ip link set vcan0 up
+//   deltaq_emu vcan0 & bms_emu --link /tmp/bms & cc_vcan --can1 vcan0 --bms /tmp/bms
+
+#include <poll.h>
+#include <signal.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <Arduino.h>
+#include <FlexCAN_T4.h>
+#include "Pty.h"
+#include "ReplayTap.h"
+#include "SocketCan.h"
+
+void setup();
+void loop();
+
+using namespace emu;
+
+namespace {
+
+volatile bool stopRequested = false;
+
+void onSignal(int) {
+  stopRequested = true;
+}
+
+// Bridges one FlexCAN controller to one socket
+struct Port {
+  SocketCan can;
+  FlexCANShimBus *bus = nullptr;
+  uint64_t rx = 0;
+
+  bool attach(const std::string &iface, CAN_DEV_TABLE dev) {
+    std::string err;
+    bus = flexcanBus(dev);
+    if (!bus) {
+      fprintf(stderr, "cc_vcan: the firmware does not use CAN%d\n", (int)dev + 1);
+      return false;
+    }
+    if (!can.open(iface, err)) {
+      fprintf(stderr, "cc_vcan: %s\n", err.c_str());
+      return false;
+    }
+    bus->onWrite = [this](const CAN_message_t &msg) {
+      can.write(makeFrame(msg.id | (msg.flags.extended ? canlog::ID_EXTENDED : 0), msg.len, msg.buf));
+    };
+    return true;
+  }
+
+  void drain() {
+    canlog::Frame f;
+    while (can.read(f)) {
+      CAN_message_t msg;
+      msg.id = f.id & ~canlog::ID_EXTENDED;
+      msg.flags.extended = (f.id & canlog::ID_EXTENDED) != 0;
+      msg.len = f.dlc;
+      memcpy(msg.buf, f.data, sizeof(msg.buf));
+      bus->inject(msg);
+      rx++;
+    }
+  }
+};
+
+void usage() {
+  fprintf(stderr, "usage: cc_vcan --can1 IFACE [--can2 IFACE] [--bms TTY] [--frames]\n");
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+  std::string can1, can2, bmsPath;
+  bool frames = false;
+
+  for (int i = 1; i < argc; i++) {
+    auto next = [&]() -> const char * {
+      if (i + 1 >= argc) { usage(); exit(2); }
+      return argv[++i];
+    };
+    if (!strcmp(argv[i], "--can1")) can1 = next();
+    else if (!strcmp(argv[i], "--can2")) can2 = next();
+    else if (!strcmp(argv[i], "--bms")) bmsPath = next();
+    else if (!strcmp(argv[i], "--frames")) frames = true;
+    else { usage(); return 2; }
+  }
+  if (can1.empty()) { usage(); return 2; }
+
+  Port ports[2];
+  int nports = 0;
+  if (!ports[nports++].attach(can1, CAN1)) return 1;
+  if (!can2.empty() && !ports[nports++].attach(can2, CAN2)) return 1;
+
+  int bmsFd = -1;
+  uint64_t bmsRx = 0;
+  if (!bmsPath.empty()) {
+    std::string err;
+    if ((bmsFd = openTty(bmsPath, 115200, err)) < 0) {
+      fprintf(stderr, "cc_vcan: %s\n", err.c_str());
+      return 1;
+    }
+    Serial1.onWrite = [bmsFd](const uint8_t *d, size_t n) {
+      if (write(bmsFd, d, n) != (ssize_t)n) fprintf(stderr, "cc_vcan: BMS write failed\n");
+    };
+  }
+
+  Serial.onWrite = [](const uint8_t *d, size_t n) {
+    fwrite(d, 1, n, stdout);
+    fflush(stdout);
+  };
+  replayTimeline.out = stderr;
+  replayTimeline.frames = frames;
+  signal(SIGINT, onSignal);
+  signal(SIGTERM, onSignal);
+
+  const uint64_t t0 = monotonicUs();
+  arduinoSetNowUs(0);
+  setup();
+
+  uint64_t passes = 0;
+  while (!stopRequested) {
+    // delay() inside loop() may have run the virtual clock ahead of real time
+    const uint64_t real = monotonicUs() - t0;
+    if (real > arduinoNowUs()) arduinoSetNowUs(real);
+    else if (arduinoNowUs() > real) usleep((useconds_t)(arduinoNowUs() - real));
+
+    for (int p = 0; p < nports; p++) ports[p].drain();
+    if (bmsFd >= 0) {
+      uint8_t buf[256];
+      ssize_t n;
+      while ((n = read(bmsFd, buf, sizeof(buf))) > 0) {
+        Serial1.inject(buf, (size_t)n);
+        bmsRx += (uint64_t)n;
+      }
+    }
+    loop();
+    passes++;
+
+    const uint64_t wake = arduinoTakeWakeUs();
+    const uint64_t now = arduinoNowUs();
+    const uint64_t wait_us = std::min<uint64_t>(wake > now ? wake - now : 0, 100000);
+    if (wait_us == 0) continue;
+
+    struct pollfd fds[3];
+    nfds_t nfds = 0;
+    for (int p = 0; p < nports; p++) fds[nfds++] = {ports[p].can.fd(), POLLIN, 0};
+    if (bmsFd >= 0) fds[nfds++] = {bmsFd, POLLIN, 0};
+    poll(fds, nfds, (int)((wait_us + 999) / 1000));
+  }
+
+  fprintf(stderr, "cc_vcan: %.1f s, %llu loop passes, %llu frames in, %llu BMS bytes in, %llu state changes\n",
+          (monotonicUs() - t0) / 1e6, (unsigned long long)passes, (unsigned long long)(ports[0].rx + ports[1].rx),
+          (unsigned long long)bmsRx, (unsigned long long)replayTimeline.states);
+  if (bmsFd >= 0) close(bmsFd);
+  return 0;
+}
@@ -0,0 +1,201 @@
+// A whole charge session in virtual time: the charge controller firmware
+// (teensy/charge_controller) on the sim kernel, with the Delta-Q emulator
+// (emu/DeltaQCharger.h) on CAN1 charging a modelled 20s pack and the BMS
+// emulator (emu/BmsEmulator.h) on Serial1 reporting on it. Hours of charging
+// take well under a second and runs are deterministic (the BMS line noise
+// is seeded).
+//
+// Prints firmware state changes as they happen and a status line every
+// --every seconds; faults are injected with --fault NAME@SEC[+SEC]: charger
+// faults as in deltaq_emu, plus bmsov (the highest cell reads 4.30 V) and
+// bmssilent (the BMS stops answering). --serial captures the firmware's USB
+// output.
+//
+// --kelly-load puts Kelly motor controller traffic (emu/KellyController.h)
+// on CAN2 at that fraction of the 250 kbps bus, to check that a loaded
+// motor bus leaves the charging timeline alone: diff the output against a
+// run without it.
+//
+//   charge_sim [--hours H] [--soc PCT] [--capacity AH] [--every SEC]
+//              [--fault NAME@SEC[+SEC]]... [--serial FILE] [--tick-us N]
+//              [--no-bms] [--imbalance MV] [--bms-latency MS] [--bms-jitter MS]
+//              [--bms-drop RATE] [--bms-corrupt RATE] [--seed N]
+//              [--kelly-load FRACTION] [--kelly-profile CSV]
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+#include <Arduino.h>
+#include <FlexCAN_T4.h>
+#include "BatteryPack.h"
+#include "BmsEmulator.h"
+#include "DeltaQCharger.h"
+#include "KellyController.h"
+#include "ReplayTap.h"
+#include "SimAttach.h"
+#include "SimKernel.h"
+
+void setup();
+void loop();
+
+using namespace emu;
+
+namespace {
+
+void usage() {
+  fprintf(stderr,
+          "usage: charge_sim [--hours H] [--soc PCT] [--capacity AH] [--every SEC]\n"
+          "                  [--fault NAME@SEC[+SEC]]... [--serial FILE] [--tick-us N]\n"
+          "                  [--no-bms] [--imbalance MV] [--bms-latency MS] [--bms-jitter MS]\n"
+          "                  [--bms-drop RATE] [--bms-corrupt RATE] [--seed N]\n"
+          "                  [--kelly-load FRACTION] [--kelly-profile CSV]\n");
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+  double hours = 4, everyS = 600;
+  BatteryPackConfig packConfig;
+  BmsConfig bmsConfig;
+  sim::KernelConfig kernelConfig;
+  std::string serialPath, kellyProfile;
+  float kellyLoad = 0;
+  bool withBms = true;
+  struct Fault { std::string name; double at, hold; };
+  std::vector<Fault> faults;
+
+  for (int i = 1; i < argc; i++) {
+    auto next = [&]() -> const char * {
+      if (i + 1 >= argc) { usage(); exit(2); }
+      return argv[++i];
+    };
+    if (!strcmp(argv[i], "--hours")) hours = atof(next());
+    else if (!strcmp(argv[i], "--soc")) packConfig.soc = (float)atof(next()) / 100.0f;
+    else if (!strcmp(argv[i], "--capacity")) packConfig.capacity_Ah = (float)atof(next());
+    else if (!strcmp(argv[i], "--every")) everyS = atof(next());
+    else if (!strcmp(argv[i], "--serial")) serialPath = next();
+    else if (!strcmp(argv[i], "--tick-us")) kernelConfig.tickUs = strtoull(next(), nullptr, 10);
+    else if (!strcmp(argv[i], "--no-bms")) withBms = false;
+    else if (!strcmp(argv[i], "--imbalance")) bmsConfig.imbalance_V = (float)atof(next()) / 1000.0f;
+    else if (!strcmp(argv[i], "--bms-latency")) bmsConfig.latency_ms = (uint32_t)atoi(next());
+    else if (!strcmp(argv[i], "--bms-jitter")) bmsConfig.jitter_ms = (uint32_t)atoi(next());
+    else if (!strcmp(argv[i], "--bms-drop")) bmsConfig.drop_rate = (float)atof(next());
+    else if (!strcmp(argv[i], "--bms-corrupt")) bmsConfig.corrupt_rate = (float)atof(next());
+    else if (!strcmp(argv[i], "--seed")) bmsConfig.seed = (uint32_t)strtoul(next(), nullptr, 10);
+    else if (!strcmp(argv[i], "--kelly-load")) kellyLoad = (float)atof(next());
+    else if (!strcmp(argv[i], "--kelly-profile")) kellyProfile = next();
+    else if (!strcmp(argv[i], "--fault")) {
+      char name[16];
+      Fault f = {"", 0, 0};
+      ChargerFault unused;
+      if (sscanf(next(), "%15[a-z]@%lf+%lf", name, &f.at, &f.hold) < 2 ||
+          !(parseChargerFault(name, unused) || !strcmp(name, "bmsov") || !strcmp(name, "bmssilent"))) {
+        usage();
+        return 2;
+      }
+      f.name = name;
+      faults.push_back(f);
+    }
+    else { usage(); return 2; }
+  }
+  if (hours <= 0 || everyS <= 0) { usage(); return 2; }
+
+  FILE *serialOut = nullptr;
+  if (!serialPath.empty() && !(serialOut = fopen(serialPath.c_str(), "w"))) {
+    fprintf(stderr, "charge_sim: cannot create %s\n", serialPath.c_str());
+    return 1;
+  }
+  if (serialOut) Serial.onWrite = [&](const uint8_t *d, size_t n) { fwrite(d, 1, n, serialOut); };
+  replayTimeline.out = stdout;
+  replayTimeline.frames = false;
+
+  arduinoSetNowUs(0);
+  setup();
+
+  sim::Kernel kernel(loop, kernelConfig);
+  BatteryPack pack(packConfig);
+  DeltaQCharger charger(&pack);
+  SimAttachment link(kernel, *flexcanBus(CAN1), charger);
+  BmsEmulator bms(&pack, bmsConfig);
+  std::unique_ptr<SerialAttachment> bmsLink;
+  if (withBms) bmsLink.reset(new SerialAttachment(kernel, Serial1, bms));
+
+  DriveProfile profile = DriveProfile::urban();
+  std::string err;
+  if (!kellyProfile.empty() && !profile.load(kellyProfile, err)) {
+    fprintf(stderr, "charge_sim: %s\n", err.c_str());
+    return 1;
+  }
+  KellyConfig kellyConfig;
+  kellyConfig.msg1_hz = kellyConfig.msg2_hz = kellyRateForLoad(kellyLoad, 250000);
+  KellyController kelly(profile, kellyConfig);
+  std::unique_ptr<SimAttachment> kellyLink;
+  if (kellyLoad > 0) kellyLink.reset(new SimAttachment(kernel, *flexcanBus(CAN2), kelly));
+
+  // bmsov pushes the cell the BMS already reports highest over the cutoffs
+  auto highCell = [&]() {
+    int high = 0;
+    for (int i = 1; i < packConfig.cells; i++)
+      if (bms.cellVoltage(i) > bms.cellVoltage(high)) high = i;
+    return high;
+  };
+  auto setFault = [&](const std::string &name, bool on) {
+    ChargerFault fault;
+    if (name == "bmsov") {
+      const int cell = highCell();
+      bms.setCellBias(cell, 0.0f);
+      if (on) bms.setCellBias(cell, 4.30f - bms.cellVoltage(cell));
+    }
+    else if (name == "bmssilent") bms.setSilent(on);
+    else if (!on) charger.clearFaults(kernel.now());
+    else if (parseChargerFault(name.c_str(), fault)) charger.inject(fault, kernel.now());
+    link.poke();
+    replayTimelineLine("fault", on ? name.c_str() : (name + " cleared").c_str());
+  };
+  for (const Fault &f : faults) {
+    kernel.at((uint64_t)(f.at * 1e6), [&, f]() { setFault(f.name, true); });
+    if (f.hold > 0) kernel.at((uint64_t)((f.at + f.hold) * 1e6), [&, f]() { setFault(f.name, false); });
+  }
+
+  kernel.every(0, (uint64_t)(everyS * 1e6), [&]() {
+    const ChargerState &s = charger.state();
+    char text[200];
+    int n = snprintf(text, sizeof(text), "%-26s %6.2f A %6.2f V  soc %5.1f%%  %4.1f C  %6.2f Ah",
+                     replayStateName(replayTimeline.state), s.current_A, s.voltage_V, pack.soc() * 100.0, s.temp_C,
+                     s.ah);
+    if (withBms) n += snprintf(text + n, sizeof(text) - n, "  cell %.3f V  bms %4.1f C", bms.cellVoltage(highCell()),
+                               bms.temperature());
+    snprintf(text + n, sizeof(text) - n, "%s%s", s.derating ? " derating" : "", s.complete ? " complete" : "");
+    replayTimelineLine("status", text);
+    return true;
+  });
+
+  const uint64_t endUs = (uint64_t)(hours * 3600e6);
+  auto wall0 = std::chrono::steady_clock::now();
+  kernel.runUntil(endUs);
+  double wall = std::chrono::duration<double>(std::chrono::steady_clock::now() - wall0).count();
+  if (serialOut) fclose(serialOut);
+
+  const sim::KernelStats &ks = kernel.stats();
+  fprintf(stderr,
+          "charge_sim: %.2f h virtual in %.3f s (%.0fx), %llu loop passes, %llu events; "
+          "%llu frames to firmware, %llu from; %.2f Ah delivered, soc %.1f%%\n",
+          hours, wall, wall > 0 ? endUs / 1e6 / wall : 0.0, (unsigned long long)ks.passes,
+          (unsigned long long)ks.events, (unsigned long long)link.framesToFirmware(),
+          (unsigned long long)link.framesFromFirmware(), charger.state().ah, pack.soc() * 100.0);
+  if (kellyLink) {
+    fprintf(stderr, "charge_sim: Kelly %llu frames on CAN2 (%.0f/s)\n", (unsigned long long)kelly.framesSent(),
+            kelly.framesSent() / (endUs / 1e6));
+  }
+  if (withBms) {
+    const BmsStats &bs = bms.stats();
+    fprintf(stderr, "charge_sim: BMS %llu requests, %llu replies, %llu bytes dropped, %llu corrupted\n",
+            (unsigned long long)bs.requests, (unsigned long long)bs.replies, (unsigned long long)bs.bytes_dropped,
+            (unsigned long long)bs.bytes_corrupted);
+  }
+  return 0;
+}
@@ -0,0 +1,167 @@
+// Delta-Q ICL1500 charger emulator on a SocketCAN interface (emu/DeltaQCharger.h),
+// charging a modelled 20s pack. Point cc_vcan, main_charging.py or anything
+// else that talks to the charger at the same interface.
+//
+// Faults are injected on a schedule (--fault NAME@SEC, optionally +SEC to
+// clear again) or typed on stdin while running: "fault NAME", "clear",
+// "status". Fault names: hw, ac, temp, silent, emcy.
+//
+//   deltaq_emu IFACE [--soc PCT] [--capacity AH] [--max-current A] [--ramp A_PER_S]
+//              [--hb-ms N] [--tpdo1-ms N] [--tpdo2-ms N] [--tpdo3-ms N]
+//              [--fault NAME@SEC[+SEC]]... [--status SEC]
+
+#include <poll.h>
+#include <signal.h>
+#include <unistd.h>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+#include "BatteryPack.h"
+#include "DeltaQCharger.h"
+#include "SocketCan.h"
+
+using namespace emu;
+
+namespace {
+
+volatile bool stopRequested = false;
+
+void onSignal(int) {
+  stopRequested = true;
+}
+
+struct ScheduledFault {
+  ChargerFault fault;
+  uint64_t at_us;
+  uint64_t clear_us;   // 0 = stays
+  bool fired = false;
+  bool cleared = false;
+};
+
+bool parseFaultSpec(const char *spec, ScheduledFault &out) {
+  char name[16];
+  double at = 0, hold = 0;
+  int n = sscanf(spec, "%15[a-z]@%lf+%lf", name, &at, &hold);
+  if (n < 2 || !parseChargerFault(name, out.fault)) return false;
+  out.at_us = (uint64_t)(at * 1e6);
+  out.clear_us = n == 3 ? out.at_us + (uint64_t)(hold * 1e6) : 0;
+  return true;
+}
+
+void printStatus(const DeltaQCharger &charger, const BatteryPack &pack, double t) {
+  const ChargerState &s = charger.state();
+  printf("%9.1f s  %s%s%s  %6.2f A (req %5.2f) %6.2f V (lim %5.2f)  soc %5.1f%%  %4.1f C  %.2f Ah%s%s%s  err=%08X\n", t,
+         s.operational ? "OP" : "PRE", s.override_on ? " REMOTE" : "", s.battery_ready ? " READY" : "", s.current_A,
+         s.request_A, s.voltage_V, s.limit_V, pack.soc() * 100.0, s.temp_C, s.ah, s.derating ? " DERATE" : "",
+         s.complete ? " COMPLETE" : "", s.hw_shutdown ? " HWSHDN" : "", (unsigned)s.error_code);
+  fflush(stdout);
+}
+
+void usage() {
+  fprintf(stderr,
+          "usage: deltaq_emu IFACE [--soc PCT] [--capacity AH] [--max-current A] [--ramp A_PER_S]\n"
+          "                  [--hb-ms N] [--tpdo1-ms N] [--tpdo2-ms N] [--tpdo3-ms N]\n"
+          "                  [--fault NAME@SEC[+SEC]]... [--status SEC]\n");
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+  std::string iface;
+  BatteryPackConfig packConfig;
+  DeltaQConfig config;
+  std::vector<ScheduledFault> faults;
+  double statusS = 5;
+
+  for (int i = 1; i < argc; i++) {
+    auto next = [&]() -> const char * {
+      if (i + 1 >= argc) { usage(); exit(2); }
+      return argv[++i];
+    };
+    if (!strcmp(argv[i], "--soc")) packConfig.soc = (float)atof(next()) / 100.0f;
+    else if (!strcmp(argv[i], "--capacity")) packConfig.capacity_Ah = (float)atof(next());
+    else if (!strcmp(argv[i], "--max-current")) config.max_current_A = (float)atof(next());
+    else if (!strcmp(argv[i], "--ramp")) config.ramp_A_per_s = (float)atof(next());
+    else if (!strcmp(argv[i], "--hb-ms")) config.heartbeat_ms = (uint32_t)atoi(next());
+    else if (!strcmp(argv[i], "--tpdo1-ms")) config.tpdo1_ms = (uint32_t)atoi(next());
+    else if (!strcmp(argv[i], "--tpdo2-ms")) config.tpdo2_ms = (uint32_t)atoi(next());
+    else if (!strcmp(argv[i], "--tpdo3-ms")) config.tpdo3_ms = (uint32_t)atoi(next());
+    else if (!strcmp(argv[i], "--status")) statusS = atof(next());
+    else if (!strcmp(argv[i], "--fault")) {
+      ScheduledFault f;
+      if (!parseFaultSpec(next(), f)) { usage(); return 2; }
+      faults.push_back(f);
+    }
+    else if (argv[i][0] == '-') { usage(); return 2; }
+    else iface = argv[i];
+  }
+  if (iface.empty() || config.heartbeat_ms == 0 || config.tpdo1_ms == 0 || config.tpdo2_ms == 0 ||
+      config.tpdo3_ms == 0) {
+    usage();
+    return 2;
+  }
+
+  SocketCan can;
+  std::string err;
+  if (!can.open(iface, err)) {
+    fprintf(stderr, "deltaq_emu: %s\n", err.c_str());
+    return 1;
+  }
+
+  BatteryPack pack(packConfig);
+  DeltaQCharger charger(&pack, config);
+  signal(SIGINT, onSignal);
+  signal(SIGTERM, onSignal);
+
+  const uint64_t t0 = monotonicUs();
+  uint64_t nextStatus = t0;
+  std::string line;
+  fprintf(stderr, "deltaq_emu: charger node 0x%02X on %s, pack %.0f Ah at %.0f%%\n", config.node_id, iface.c_str(),
+          packConfig.capacity_Ah, pack.soc() * 100.0);
+
+  runOnSocket(can, charger, &stopRequested, [&](uint64_t now) {
+    for (ScheduledFault &f : faults) {
+      if (!f.fired && now - t0 >= f.at_us) {
+        f.fired = true;
+        charger.inject(f.fault, now);
+        fprintf(stderr, "deltaq_emu: fault %s\n", chargerFaultName(f.fault));
+      }
+      if (f.fired && f.clear_us && !f.cleared && now - t0 >= f.clear_us) {
+        f.cleared = true;
+        charger.clearFaults(now);
+        fprintf(stderr, "deltaq_emu: faults cleared\n");
+      }
+    }
+
+    // Commands on stdin, one per line
+    struct pollfd p = {STDIN_FILENO, POLLIN, 0};
+    char buf[256];
+    ssize_t n;
+    while (poll(&p, 1, 0) > 0 && (p.revents & POLLIN) && (n = read(STDIN_FILENO, buf, sizeof(buf))) > 0) {
+      line.append(buf, (size_t)n);
+      size_t eol;
+      while ((eol = line.find('\n')) != std::string::npos) {
+        std::string cmd = line.substr(0, eol);
+        line.erase(0, eol + 1);
+        ChargerFault fault;
+        if (cmd.rfind("fault ", 0) == 0 && parseChargerFault(cmd.c_str() + 6, fault)) charger.inject(fault, now);
+        else if (cmd == "clear") charger.clearFaults(now);
+        else if (cmd == "status") printStatus(charger, pack, (now - t0) / 1e6);
+        else if (!cmd.empty()) fprintf(stderr, "deltaq_emu: commands: fault hw|ac|temp|silent|emcy, clear, status\n");
+      }
+    }
+
+    if (statusS > 0 && now >= nextStatus) {
+      printStatus(charger, pack, (now - t0) / 1e6);
+      nextStatus = now + (uint64_t)(statusS * 1e6);
+    }
+  });
+
+  const ChargerState &s = charger.state();
+  fprintf(stderr, "deltaq_emu: %llu frames sent (%llu dropped), %llu received, %llu SDO requests\n",
+          (unsigned long long)s.frames_sent, (unsigned long long)can.dropped(),
+          (unsigned long long)s.frames_received, (unsigned long long)s.sdo_requests);
+  return 0;
+}
@@ -0,0 +1,248 @@
+// Host-side run of the dash display renderer (teensy/display/DisplayRender.cpp)
+// against the TFT_eSPI framebuffer shim.
+//
+// Plays a fixed scenario (boot, main page updates, HUD, cell page) and, per
+// frame, reports how many draw calls and pixels reached the panel and the
+// sprites. Frames can be dumped as PPM and checked against golden CRC-32s
+// of those PPMs, and the whole scenario can be timed and checked against
+// pixel budgets. The golden list is display_sim/golden.txt; after an
+// intended change to the renderer, look at the frames with --out and
+// regenerate it with --write-golden.
+//
+//   display_sim [--out DIR] [--golden FILE] [--write-golden FILE] [--bench N]
+//               [--max-panel-px N] [--max-frame-px N]
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <string>
+#include <vector>
+#include "ChunkedLog.h"
+#include "DisplayRender.h"
+
+namespace {
+
+struct Frame {
+  const char *name;
+  void (*apply)(int step);
+  int steps;
+};
+
+void setMain(int i) {
+  mph = 3.1f * i;
+  voltage = 80.4f - 0.05f * i;
+  current = 20.0f + i;
+  power = voltage * current;
+  soc = 80.0f - i / 4.0f;
+  rpm = mph * 28.0f;
+  Btemp = 31.0f + i / 10.0f;
+  Mtemp = 40.0f + i / 5.0f;
+}
+
+void setCells(int i) {
+  cellCount = NUM_CELLS;
+  for (int c = 0; c < NUM_CELLS; c++) {
+    cellMv[c] = (uint16_t)(3900 + c * 2 + i * 3);
+  }
+  cellMv[7] = (uint16_t)(3900 + 14 + i * 9);  // one cell running away
+}
+
+void setHud(int i) {
+  static const char *base[HUD_FIELD_COUNT] = {"2fps", "r4.1ms", "p38us", "180B/s", "2l/s", "E0/0", "age120ms"};
+  for (int f = 0; f < HUD_FIELD_COUNT; f++) snprintf(hudText[f], sizeof(hudText[f]), "%s", base[f]);
+  snprintf(hudText[6], sizeof(hudText[6]), "age%ums", (unsigned)(uint16_t)(120 + 250 * i));
+}
+
+const Frame kScenario[] = {
+  {"boot",       [](int) { setMain(0); hudEnabled = false; displayBegin(); updateDisplay(); }, 1},
+  {"main",       [](int i) { setMain(i + 1); updateDisplay(); }, 20},
+  {"main_same",  [](int) { updateDisplay(); }, 1},
+  {"hud_on",     [](int) { setHud(0); setHudEnabled(true); }, 1},
+  {"hud_tick",   [](int i) { setHud(i + 1); updateHud(false); }, 3},
+  {"cells_page", [](int) { setCells(0); showPage(PAGE_CELLS); }, 1},
+  {"cells",      [](int i) { setCells(i + 1); updateCellBars(); }, 15},
+  {"main_again", [](int) { showPage(PAGE_MAIN); }, 1},
+  {"hud_off",    [](int) { setHudEnabled(false); }, 1},
+};
+
+struct FrameResult {
+  std::string name;
+  TftStats stats;
+  double ns = 0;
+};
+
+// The panel as a binary PPM (RGB565 widened to 8 bits per channel)
+std::vector<uint8_t> encodePpm() {
+  char header[32];
+  const int n = snprintf(header, sizeof(header), "P6\n%d %d\n255\n", tft.width(), tft.height());
+  std::vector<uint8_t> out(header, header + n);
+  out.reserve(out.size() + tft.pixels().size() * 3);
+  for (uint16_t c : tft.pixels()) {
+    out.push_back((uint8_t)(((c >> 11) & 0x1F) * 255 / 31));
+    out.push_back((uint8_t)(((c >> 5) & 0x3F) * 255 / 63));
+    out.push_back((uint8_t)((c & 0x1F) * 255 / 31));
+  }
+  return out;
+}
+
+bool writeFile(const std::string &path, const std::vector<uint8_t> &data) {
+  FILE *f = fopen(path.c_str(), "wb");
+  if (!f) return false;
+  const bool ok = fwrite(data.data(), 1, data.size(), f) == data.size();
+  return (fclose(f) == 0) && ok;
+}
+
+// "frame_nnn crc" lines; '#' starts a comment
+bool readGolden(const std::string &path, std::map<std::string, uint32_t> &out) {
+  FILE *f = fopen(path.c_str(), "r");
+  if (!f) return false;
+  char line[128], name[32];
+  unsigned long crc;
+  while (fgets(line, sizeof(line), f)) {
+    if (line[0] != '#' && sscanf(line, "%31s %lx", name, &crc) == 2) out[name] = (uint32_t)crc;
+  }
+  fclose(f);
+  return true;
+}
+
+// Runs the scenario once. Per-frame callback gets the frame index once the
+// frame has been drawn.
+template <typename OnFrame>
+std::vector<FrameResult> runScenario(OnFrame onFrame) {
+  std::vector<FrameResult> results;
+  for (const Frame &fr : kScenario) {
+    for (int i = 0; i < fr.steps; i++) {
+      tftStats = TftStats();
+      auto t0 = std::chrono::steady_clock::now();
+      fr.apply(i);
+      auto t1 = std::chrono::steady_clock::now();
+
+      FrameResult r;
+      r.name = (fr.steps > 1) ? std::string(fr.name) + "_" + std::to_string(i) : fr.name;
+      r.stats = tftStats;
+      r.ns = std::chrono::duration<double, std::nano>(t1 - t0).count();
+      results.push_back(r);
+      onFrame(results.size() - 1, results.back());
+    }
+  }
+  return results;
+}
+
+void usage() {
+  fprintf(stderr,
+          "usage: display_sim [--out DIR] [--golden FILE] [--write-golden FILE] [--bench N]\n"
+          "                   [--max-panel-px N] [--max-frame-px N]\n");
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+  std::string outDir, goldenPath, writeGoldenPath;
+  int benchRuns = 0;
+  uint64_t maxPanelPx = 0, maxFramePx = 0;
+
+  for (int i = 1; i < argc; i++) {
+    auto next = [&]() -> const char * {
+      if (i + 1 >= argc) { usage(); exit(2); }
+      return argv[++i];
+    };
+    if (!strcmp(argv[i], "--out")) outDir = next();
+    else if (!strcmp(argv[i], "--golden")) goldenPath = next();
+    else if (!strcmp(argv[i], "--write-golden")) writeGoldenPath = next();
+    else if (!strcmp(argv[i], "--bench")) benchRuns = atoi(next());
+    else if (!strcmp(argv[i], "--max-panel-px")) maxPanelPx = strtoull(next(), nullptr, 10);
+    else if (!strcmp(argv[i], "--max-frame-px")) maxFramePx = strtoull(next(), nullptr, 10);
+    else { usage(); return 2; }
+  }
+
+  int failures = 0;
+  std::map<std::string, uint32_t> golden;
+  if (!goldenPath.empty() && !readGolden(goldenPath, golden)) {
+    fprintf(stderr, "cannot read %s\n", goldenPath.c_str());
+    return 1;
+  }
+  std::vector<std::pair<std::string, uint32_t>> crcs;
+  const bool wantPpm = !outDir.empty() || !goldenPath.empty() || !writeGoldenPath.empty();
+  char name[32];
+
+  auto results = runScenario([&](size_t idx, const FrameResult &) {
+    if (!wantPpm) return;
+    const std::vector<uint8_t> ppm = encodePpm();
+    snprintf(name, sizeof(name), "frame_%03zu.ppm", idx);
+    if (!outDir.empty() && !writeFile(outDir + "/" + name, ppm)) {
+      fprintf(stderr, "cannot write %s/%s\n", outDir.c_str(), name);
+      failures++;
+    }
+    snprintf(name, sizeof(name), "frame_%03zu", idx);
+    const uint32_t crc = canlog::crc32(ppm.data(), ppm.size());
+    crcs.emplace_back(name, crc);
+    if (!goldenPath.empty()) {
+      auto g = golden.find(name);
+      if (g == golden.end()) {
+        fprintf(stderr, "missing golden %s\n", name);
+        failures++;
+      } else if (g->second != crc) {
+        fprintf(stderr, "golden mismatch: %s (crc %08x, golden %08x)\n", name, crc, g->second);
+        failures++;
+      }
+    }
+  });
+
+  if (!writeGoldenPath.empty()) {
+    FILE *f = fopen(writeGoldenPath.c_str(), "w");
+    if (f) {
+      fprintf(f, "# display_sim scenario: CRC-32 of each frame as a binary PPM\n");
+      for (const auto &c : crcs) fprintf(f, "%s %08x\n", c.first.c_str(), c.second);
+    }
+    if (!f || fclose(f) != 0) {
+      fprintf(stderr, "cannot write %s\n", writeGoldenPath.c_str());
+      failures++;
+    }
+  }
+
+  uint64_t panelPx = 0, spritePx = 0;
+  uint32_t panelOps = 0, spriteOps = 0;
+  printf("%-4s %-14s %10s %10s %10s %10s\n", "#", "frame", "panel_ops", "panel_px", "spr_ops", "spr_px");
+  for (size_t i = 0; i < results.size(); i++) {
+    const TftStats &s = results[i].stats;
+    printf("%-4zu %-14s %10u %10llu %10u %10llu\n", i, results[i].name.c_str(),
+           s.panelOps, (unsigned long long)s.panelPixels, s.spriteOps, (unsigned long long)s.spritePixels);
+    panelOps += s.panelOps;
+    panelPx += s.panelPixels;
+    spriteOps += s.spriteOps;
+    spritePx += s.spritePixels;
+
+    // Page switches legitimately repaint the screen; budgets apply to updates
+    bool pageSwitch = (results[i].name == "boot" || results[i].name.find("_page") != std::string::npos ||
+                       results[i].name == "main_again");
+    if (maxFramePx && !pageSwitch && s.panelPixels > maxFramePx) {
+      fprintf(stderr, "frame %s pushed %llu px (budget %llu)\n", results[i].name.c_str(),
+              (unsigned long long)s.panelPixels, (unsigned long long)maxFramePx);
+      failures++;
+    }
+  }
+  printf("total: %zu frames, %u panel ops, %llu panel px, %u sprite ops, %llu sprite px\n",
+         results.size(), panelOps, (unsigned long long)panelPx, spriteOps, (unsigned long long)spritePx);
+
+  if (maxPanelPx && panelPx > maxPanelPx) {
+    fprintf(stderr, "scenario pushed %llu panel px (budget %llu)\n",
+            (unsigned long long)panelPx, (unsigned long long)maxPanelPx);
+    failures++;
+  }
+
+  if (benchRuns > 0) {
+    std::vector<double> ns(results.size(), 0.0);
+    for (int run = 0; run < benchRuns; run++) {
+      auto r = runScenario([](size_t, const FrameResult &) {});
+      for (size_t i = 0; i < r.size(); i++) ns[i] += r[i].ns;
+    }
+    double total = 0;
+    for (double v : ns) total += v;
+    printf("bench: %d runs, %.1f us/scenario, %.2f us/frame mean\n", benchRuns,
+           total / benchRuns / 1000.0, total / benchRuns / results.size() / 1000.0);
+  }
+
+  return failures ? 1 : 0;
+}
@@ -0,0 +1,29 @@
+#include "BatteryPack.h"
+#include <algorithm>
+
+namespace emu {
+
+BatteryPack::BatteryPack(BatteryPackConfig config) : config_(config), soc_(std::clamp(config.soc, 0.0f, 1.0f)) {}
+
+void BatteryPack::flow(float current_A, float dt_s) {
+  current_A_ = current_A;
+  soc_ = std::clamp(soc_ + current_A * dt_s / (config_.capacity_Ah * 3600.0f), 0.0f, 1.0f);
+}
+
+float BatteryPack::openCircuitV() const {
+  return cellOcv(soc_) * config_.cells;
+}
+
+// NMC cell, rested, room temperature
+float BatteryPack::cellOcv(float soc) {
+  static const float kSoc[] = {0.00f, 0.05f, 0.10f, 0.20f, 0.40f, 0.60f, 0.80f, 0.90f, 1.00f};
+  static const float kV[]   = {3.00f, 3.35f, 3.45f, 3.55f, 3.68f, 3.82f, 3.97f, 4.06f, 4.20f};
+  const int n = sizeof(kSoc) / sizeof(kSoc[0]);
+  soc = std::clamp(soc, 0.0f, 1.0f);
+  int i = 1;
+  while (i < n - 1 && soc > kSoc[i]) i++;
+  const float f = (soc - kSoc[i - 1]) / (kSoc[i] - kSoc[i - 1]);
+  return kV[i - 1] + f * (kV[i] - kV[i - 1]);
+}
+
+} // namespace emu
@@ -0,0 +1,40 @@
+#pragma once
+// Lumped model of the 20s Li-ion pack the charger and BMS emulators share:
+// state of charge from coulomb counting, open-circuit voltage from a
+// per-cell curve, and one series resistance.
+
+#include <stdint.h>
+
+namespace emu {
+
+struct BatteryPackConfig {
+  int   cells = 20;
+  float capacity_Ah = 40.0f;
+  float resistance_ohm = 0.08f;    // whole pack
+  float soc = 0.30f;               // initial, 0..1
+};
+
+class BatteryPack {
+public:
+  explicit BatteryPack(BatteryPackConfig config = BatteryPackConfig());
+
+  // Positive current charges
+  void flow(float current_A, float dt_s);
+
+  float soc() const { return soc_; }
+  float current() const { return current_A_; }   // as of the last flow()
+  float openCircuitV() const;
+  float terminalV(float current_A) const { return openCircuitV() + current_A * config_.resistance_ohm; }
+  float cellOpenCircuitV() const { return openCircuitV() / config_.cells; }
+  const BatteryPackConfig &config() const { return config_; }
+
+  // Open-circuit voltage of one cell at a state of charge (0..1)
+  static float cellOcv(float soc);
+
+private:
+  BatteryPackConfig config_;
+  float soc_;
+  float current_A_ = 0;
+};
+
+} // namespace emu
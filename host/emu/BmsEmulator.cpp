@@ -0,0 +1,182 @@
+#include "BmsEmulator.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace emu {
+
+namespace {
+
+const uint8_t kRequest[BMS_REQUEST_LEN] = {0x5A, 0x5A, 0x00, 0x00, 0x00, 0x00};
+// After a mismatch with n+1 bytes matched, the longest tail of those bytes
+// that is again a start of kRequest (KMP failure function): 5A 5A 5A keeps
+// the last two
+const uint8_t kRequestFallback[BMS_REQUEST_LEN] = {0, 1, 0, 0, 0, 0};
+
+// Cell voltage at which the BMS opens the charge MOS itself
+constexpr float kCellOvervoltageV = 4.25f;
+
+void putU16(uint8_t *d, float v) {
+  const uint16_t raw = (uint16_t)std::clamp(lroundf(v), 0L, 0xFFFFL);
+  d[0] = (uint8_t)(raw >> 8);
+  d[1] = (uint8_t)raw;
+}
+
+void putU32(uint8_t *d, double v) {
+  const uint32_t raw = (uint32_t)std::clamp(llround(v), 0LL, 0xFFFFFFFFLL);
+  d[0] = (uint8_t)(raw >> 24);
+  d[1] = (uint8_t)(raw >> 16);
+  d[2] = (uint8_t)(raw >> 8);
+  d[3] = (uint8_t)raw;
+}
+
+} // namespace
+
+BmsEmulator::BmsEmulator(BatteryPack *pack, BmsConfig config)
+    : pack_(pack), config_(config), temp_C_(config.ambient_C), cycle_Ah_(config.cycle_Ah), rng_(config.seed) {
+  const int cells = pack_->config().cells;
+  offset_V_.resize(cells);
+  bias_V_.assign(cells, 0.0f);
+  for (int i = 0; i < cells; i++)
+    offset_V_[i] = cells > 1 ? config_.imbalance_V * ((float)i / (cells - 1) - 0.5f) : 0.0f;
+  std::shuffle(offset_V_.begin(), offset_V_.end(), rng_);
+}
+
+void BmsEmulator::advance(uint64_t now_us) {
+  if (!started_) {
+    started_ = true;
+    last_us_ = now_us;
+  }
+  if (now_us <= last_us_) return;
+  const float dt = (now_us - last_us_) / 1e6f;
+  last_us_ = now_us;
+
+  const float current = pack_->current();
+  cycle_Ah_ += fabsf(current) * dt / 3600.0f;
+  const float target = config_.ambient_C + config_.heating_C_per_A2 * current * current;
+  temp_C_ += (target - temp_C_) * (1.0f - expf(-dt / config_.thermal_tau_s));
+}
+
+float BmsEmulator::cellVoltage(int cell) const {
+  const BatteryPackConfig &pc = pack_->config();
+  return BatteryPack::cellOcv(pack_->soc()) + pack_->current() * pc.resistance_ohm / pc.cells + offset_V_[cell] +
+         bias_V_[cell];
+}
+
+void BmsEmulator::setCellBias(int cell, float bias_V) {
+  if (cell >= 0 && cell < (int)bias_V_.size()) bias_V_[cell] = bias_V;
+}
+
+// -------------------- Frame --------------------
+void BmsEmulator::encode(uint8_t f[BMS_REPLY_LEN]) {
+  memset(f, 0, BMS_REPLY_LEN);
+  const int cells = std::min<int>(pack_->config().cells, 20);   // the frame carries 20
+  const float capacity = pack_->config().capacity_Ah;
+  const float current = std::max(pack_->current(), 0.0f);        // the field is unsigned
+
+  // JK start of frame; the decoder does not check it
+  f[0] = 0x4E;
+  f[1] = 0x57;
+
+  float pack_V = 0, high_V = 0, low_V = 1e9f;
+  int high = 0, low = 0;
+  for (int i = 0; i < cells; i++) {
+    const float v = cellVoltage(i);
+    putU16(&f[6 + i * 2], v * 1000.0f);
+    pack_V += v;
+    if (v > high_V) { high_V = v; high = i; }
+    if (v < low_V) { low_V = v; low = i; }
+  }
+  putU16(&f[4], pack_V * 10.0f);
+
+  putU16(&f[72], current * 10.0f);
+  f[74] = (uint8_t)lroundf(pack_->soc() * 100.0f);
+  putU32(&f[75], capacity * 1e6);
+  putU32(&f[79], pack_->soc() * capacity * 1e6);
+  putU32(&f[83], cycle_Ah_ * 1e6);
+
+  // Whole degrees; the MOSFETs run a little warmer than the cells
+  const float t = std::max(temp_C_, 0.0f);
+  putU16(&f[91], t + 3.0f);
+  putU16(&f[93], t + 1.0f);
+  for (int i = 0; i < 4; i++) putU16(&f[95 + i * 2], t - 0.5f * i);
+
+  f[103] = high_V >= kCellOvervoltageV ? 2 : 1;   // charge MOS: overvoltage / open
+  f[104] = 1;                                     // discharge MOS open
+  f[105] = current > 0 && high_V - low_V > 0.010f ? 4 : 0;   // auto balance while charging
+
+  f[115] = (uint8_t)(high + 1);
+  putU16(&f[116], high_V * 1000.0f);
+  f[118] = (uint8_t)(low + 1);
+  putU16(&f[119], low_V * 1000.0f);
+}
+
+// -------------------- Line --------------------
+void BmsEmulator::receive(const uint8_t *data, size_t n, uint64_t now_us) {
+  advance(now_us);
+  for (size_t i = 0; i < n; i++) {
+    const uint8_t b = data[i];
+    while (request_len_ > 0 && b != kRequest[request_len_]) {
+      const size_t keep = kRequestFallback[request_len_ - 1];
+      stats_.ignored += request_len_ - keep;
+      request_len_ = keep;
+    }
+    if (b != kRequest[request_len_]) {
+      stats_.ignored++;
+      continue;
+    }
+    if (++request_len_ < BMS_REQUEST_LEN) continue;
+
+    request_len_ = 0;
+    stats_.requests++;
+    if (silent_) continue;
+
+    Reply r;
+    r.at_us = now_us + config_.latency_ms * 1000ULL;
+    if (config_.jitter_ms) r.at_us += std::uniform_int_distribution<uint64_t>(0, config_.jitter_ms * 1000ULL)(rng_);
+    if (!replies_.empty()) {
+      // One line: a reply cannot start before the previous one has gone out
+      const Reply &last = replies_.back();
+      r.at_us = std::max(r.at_us, last.at_us + (last.bytes.size() - last.sent) * byteUs());
+    }
+
+    uint8_t frame[BMS_REPLY_LEN];
+    encode(frame);
+    std::uniform_real_distribution<float> u(0.0f, 1.0f);
+    for (uint8_t byte : frame) {
+      if (config_.drop_rate > 0 && u(rng_) < config_.drop_rate) {
+        stats_.bytes_dropped++;
+        continue;
+      }
+      if (config_.corrupt_rate > 0 && u(rng_) < config_.corrupt_rate) {
+        byte ^= (uint8_t)(1u << std::uniform_int_distribution<int>(0, 7)(rng_));
+        stats_.bytes_corrupted++;
+      }
+      r.bytes.push_back(byte);
+    }
+    replies_.push_back(std::move(r));
+  }
+}
+
+uint64_t BmsEmulator::service(uint64_t now_us, const ByteSink &out) {
+  advance(now_us);
+  uint8_t chunk[BMS_REPLY_LEN];
+  while (!replies_.empty()) {
+    Reply &r = replies_.front();
+    size_t n = 0;
+    while (r.sent < r.bytes.size() && r.at_us <= now_us) {
+      chunk[n++] = r.bytes[r.sent++];
+      r.at_us += byteUs();
+    }
+    if (n) {
+      out(chunk, n);
+      stats_.bytes_sent += n;
+    }
+    if (r.sent < r.bytes.size()) return r.at_us;
+    replies_.pop_front();
+    stats_.replies++;
+  }
+  return UINT64_MAX;
+}
+
+} // namespace emu
@@ -0,0 +1,96 @@
+#pragma once
+// The pack's BMS on its TTL UART as the charge controller polls it: every
+// request (5A 5A 00 00 00 00) is answered with one 121-byte status frame in
+// the layout BmsDecoder.cpp reads, synthesized from a BatteryPack.
+//
+// Cells sit at the pack's open-circuit voltage plus their share of the IR
+// drop, spread by a fixed per-cell imbalance; temperatures drift toward
+// ambient plus I^2 heating. Replies leave after a configurable latency and
+// are paced at the line's baud rate; bytes can be dropped or corrupted at
+// random (seeded, so sim runs repeat) to stress the controller's parser.
+
+#include <stdint.h>
+#include <deque>
+#include <random>
+#include <vector>
+#include "BatteryPack.h"
+#include "SerialNode.h"
+
+namespace emu {
+
+constexpr size_t BMS_REQUEST_LEN = 6;
+constexpr size_t BMS_REPLY_LEN = 121;
+
+struct BmsConfig {
+  float imbalance_V = 0.010f;         // max - min cell voltage, spread over the cells
+  float ambient_C = 25.0f;
+  float heating_C_per_A2 = 0.05f;     // steady-state rise over ambient per A^2
+  float thermal_tau_s = 600.0f;
+  float cycle_Ah = 0.0f;              // cyclic capacity reported at start
+
+  uint32_t baud = 115200;
+  uint32_t latency_ms = 15;           // request to first reply byte
+  uint32_t jitter_ms = 0;             // plus uniform 0..jitter_ms
+  float drop_rate = 0.0f;             // per reply byte
+  float corrupt_rate = 0.0f;          // per reply byte, one bit flipped
+  uint32_t seed = 1;
+};
+
+struct BmsStats {
+  uint64_t requests = 0;
+  uint64_t replies = 0;
+  uint64_t bytes_sent = 0;
+  uint64_t bytes_dropped = 0;
+  uint64_t bytes_corrupted = 0;
+  uint64_t ignored = 0;               // request bytes that did not parse
+};
+
+class BmsEmulator : public SerialNode {
+public:
+  explicit BmsEmulator(BatteryPack *pack, BmsConfig config = BmsConfig());
+
+  void receive(const uint8_t *data, size_t n, uint64_t now_us) override;
+  uint64_t service(uint64_t now_us, const ByteSink &out) override;
+
+  // Builds the frame the BMS would send at this moment
+  void encode(uint8_t frame[BMS_REPLY_LEN]);
+
+  // Adds bias_V to one cell's reading (0-based), e.g. to push it over the
+  // controller's cutoff; 0 clears it
+  void setCellBias(int cell, float bias_V);
+  // Stops answering requests (cable off, BMS asleep)
+  void setSilent(bool silent) { silent_ = silent; }
+  bool silent() const { return silent_; }
+
+  float cellVoltage(int cell) const;
+  float temperature() const { return temp_C_; }
+  BmsConfig &config() { return config_; }
+  const BmsStats &stats() const { return stats_; }
+
+private:
+  struct Reply {
+    uint64_t at_us;                   // time the next byte leaves
+    std::vector<uint8_t> bytes;
+    size_t sent = 0;
+  };
+
+  void advance(uint64_t now_us);
+  uint64_t byteUs() const { return 10000000ULL / config_.baud; }
+
+  BatteryPack *pack_;
+  BmsConfig config_;
+  BmsStats stats_;
+  std::vector<float> offset_V_;       // imbalance, fixed
+  std::vector<float> bias_V_;         // injected
+  float temp_C_;
+  float cycle_Ah_;
+  uint64_t last_us_ = 0;
+  bool started_ = false;
+  bool silent_ = false;
+
+  size_t request_len_ = 0;            // request bytes matched so far
+  std::deque<Reply> replies_;
+  std::mt19937 rng_;
+};
+
+} // namespace emu
@@ -0,0 +1,36 @@
+#pragma once
+// An emulated device on a CAN bus (charger, motor controller, ...).
+//
+// Nodes never read a clock: every call carries the current time, so the
+// same node runs in real time on a SocketCAN interface (SocketCan.h) or in
+// virtual time next to the firmware on the sim kernel (SimAttach.h).
+
+#include <stdint.h>
+#include <functional>
+#include "CanFrame.h"
+
+namespace emu {
+
+using FrameSink = std::function<void(const canlog::Frame &f)>;
+
+class CanNode {
+public:
+  virtual ~CanNode() = default;
+
+  // A frame another node put on the bus
+  virtual void receive(const canlog::Frame &f, uint64_t now_us) {}
+
+  // Sends whatever is due at now_us through out and returns when it next
+  // wants to be called (UINT64_MAX: only after the next receive())
+  virtual uint64_t service(uint64_t now_us, const FrameSink &out) = 0;
+};
+
+inline canlog::Frame makeFrame(uint32_t id, uint8_t dlc, const uint8_t *data = nullptr) {
+  canlog::Frame f = {};
+  f.id = id;
+  f.dlc = dlc;
+  if (data) for (uint8_t i = 0; i < dlc && i < 8; i++) f.data[i] = data[i];
+  return f;
+}
+
+} // namespace emu
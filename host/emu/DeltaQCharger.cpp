@@ -0,0 +1,362 @@
+#include "DeltaQCharger.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include "DbcDecode.h"
+
+namespace emu {
+
+namespace {
+
+constexpr uint32_t NMT_ID = 0x000;
+constexpr uint32_t EMCY_BASE = 0x080;
+constexpr uint32_t TPDO1_BASE = 0x180;
+constexpr uint32_t TPDO2_BASE = 0x280;
+constexpr uint32_t TPDO3_BASE = 0x380;
+constexpr uint32_t RPDO1_BASE = 0x200;
+constexpr uint32_t SDO_RX_BASE = 0x600;
+constexpr uint32_t SDO_TX_BASE = 0x580;
+constexpr uint32_t HEARTBEAT_BASE = 0x700;
+constexpr uint32_t BATTERY_HB_ID = HEARTBEAT_BASE + 0x01;
+
+constexpr uint8_t HB_PREOPERATIONAL = 0x7F;
+constexpr uint8_t HB_OPERATIONAL = 0x05;
+
+// Current_Error / EMCY codes (docs/delta_q.dbc, Error_Codes)
+constexpr uint32_t ERR_HEARTBEAT_LOST = 545292592u;   // E-0-3-2
+constexpr uint32_t ERR_OUTPUT_STAGE = 29380608u;      // F-0-0-1
+
+// SDO abort codes (CiA 301)
+constexpr uint32_t SDO_ABORT_NO_OBJECT = 0x06020000;
+constexpr uint32_t SDO_ABORT_DEVICE_STATE = 0x08000022;
+constexpr uint32_t SDO_ABORT_COMMAND = 0x05040001;
+
+void putU16(uint8_t *p, uint32_t v) {
+  p[0] = (uint8_t)v;
+  p[1] = (uint8_t)(v >> 8);
+}
+
+void putU32(uint8_t *p, uint32_t v) {
+  putU16(p, v);
+  putU16(p + 2, v >> 16);
+}
+
+uint32_t clampRaw(float v, float scale, uint32_t max) {
+  const float raw = std::round(v * scale);
+  return raw <= 0 ? 0 : raw >= (float)max ? max : (uint32_t)raw;
+}
+
+} // namespace
+
+DeltaQCharger::DeltaQCharger(BatteryPack *pack, DeltaQConfig config) : pack_(pack), config_(config) {
+  s_.limit_V = config_.max_voltage_V;
+  s_.temp_C = config_.ambient_C;
+}
+
+// -------------------- Model --------------------
+float DeltaQCharger::targetCurrent() const {
+  if (!s_.operational || !s_.override_on || !s_.battery_ready || !s_.ac_present || s_.hw_shutdown ||
+      s_.complete || s_.request_A <= 0) {
+    return 0;
+  }
+
+  float i = std::min(s_.request_A, config_.max_current_A);
+  if (s_.voltage_V > 1.0f) i = std::min(i, config_.max_power_W / s_.voltage_V);
+  if (s_.temp_C > config_.derate_start_C) {
+    const float f = 1.0f - (s_.temp_C - config_.derate_start_C) / (config_.derate_end_C - config_.derate_start_C);
+    i = std::min(i, config_.max_current_A * std::max(f, 0.0f));
+  }
+  if (pack_) {
+    // CV: no more than the pack resistance lets through at the limit
+    const float cv = (s_.limit_V - pack_->openCircuitV()) / pack_->config().resistance_ohm;
+    i = std::min(i, std::max(cv, 0.0f));
+  }
+  return i;
+}
+
+void DeltaQCharger::advance(uint64_t now_us) {
+  if (!started_) {
+    started_ = true;
+    last_us_ = now_us;
+    next_hb_us_ = now_us + config_.heartbeat_ms * 1000ULL;
+  }
+  if (now_us < last_us_) now_us = last_us_;
+  const float dt = (now_us - last_us_) / 1e6f;
+  last_us_ = now_us;
+
+  if (s_.override_on && battery_hb_seen_ && now_us - battery_hb_us_ > config_.battery_hb_timeout_ms * 1000ULL) {
+    s_.override_on = false;
+    s_.battery_ready = false;
+    if (s_.operational && s_.error_code == 0) {
+      s_.error_code = ERR_HEARTBEAT_LOST;
+      sendEmcy(s_.error_code);
+    }
+  }
+
+  if (dt <= 0) return;
+
+  const float target = targetCurrent();
+  if (target < s_.current_A) {
+    s_.current_A = target;   // output stages drop at once
+  } else {
+    s_.current_A = std::min(target, s_.current_A + config_.ramp_A_per_s * dt);
+  }
+
+  const bool cv = pack_ && target > 0 && target < std::min(s_.request_A, config_.max_current_A) - 0.01f;
+  if (cv && s_.current_A < config_.complete_A && s_.elapsed_s > 60.0f) {
+    s_.complete = true;
+    s_.current_A = 0;
+  }
+
+  s_.charging = s_.current_A > 0;
+  s_.derating = s_.temp_C > config_.derate_start_C;
+  if (pack_) {
+    pack_->flow(s_.current_A, dt);
+    s_.voltage_V = pack_->terminalV(s_.current_A);
+  }
+  if (s_.charging) {
+    s_.elapsed_s += dt;
+    s_.ah += s_.current_A * dt / 3600.0f;
+    s_.wh += s_.current_A * s_.voltage_V * dt / 3600.0f;
+  }
+
+  const float loss_W = s_.current_A * s_.voltage_V * (1.0f / config_.efficiency - 1.0f);
+  const float settle = config_.ambient_C + loss_W * config_.thermal_C_per_W;
+  s_.temp_C += (settle - s_.temp_C) * std::min(dt / config_.thermal_tau_s, 1.0f);
+}
+
+// -------------------- Bus --------------------
+void DeltaQCharger::send(uint32_t id, uint8_t dlc, const uint8_t *data) {
+  if (s_.silent) return;
+  pending_.push_back(makeFrame(id, dlc, data));
+}
+
+void DeltaQCharger::sendEmcy(uint32_t code) {
+  uint8_t d[8] = {};
+  putU32(d, code);
+  send(EMCY_BASE + config_.node_id, 8, d);
+}
+
+void DeltaQCharger::tpdo1() {
+  uint8_t d[8] = {};
+  putU16(&d[0], clampRaw(s_.current_A, 256.0f, 0xFFFF));
+  putU16(&d[2], clampRaw(s_.voltage_V, 256.0f, 0xFFFF));
+  d[4] = (uint8_t)((s_.hw_shutdown ? 1 << 2 : 0) | (s_.derating ? 1 << 3 : 0) | (s_.ac_present ? 1 << 4 : 0) |
+                   (s_.ac_present && !s_.hw_shutdown ? 1 << 5 : 0) | (s_.override_on ? 1 << 6 : 0));
+
+  dbc::ChargeIndication ind = dbc::ChargeIndication::Inactive;
+  if (s_.complete) {
+    ind = dbc::ChargeIndication::Complete;
+  } else if (s_.charging) {
+    const float soc = pack_ ? pack_->soc() : 0.5f;
+    ind = targetCurrent() < std::min(s_.request_A, config_.max_current_A) - 0.01f ? dbc::ChargeIndication::Finishing
+          : soc < 0.8f                                                             ? dbc::ChargeIndication::LessThan80
+                                                                                   : dbc::ChargeIndication::MoreThan80;
+  }
+  const uint8_t cycle = (s_.charging || s_.complete) ? (uint8_t)dbc::BattChargeCycleType::Charge : 0;
+  d[5] = (uint8_t)((uint8_t)ind | cycle << 4);
+  send(TPDO1_BASE + config_.node_id, 8, d);
+}
+
+void DeltaQCharger::tpdo2() {
+  uint8_t d[8] = {};
+  putU16(&d[0], clampRaw(s_.elapsed_s, 0.1f, 0xFFFF));
+  putU32(&d[2], clampRaw(s_.ah, 8.0f, 0xFFFFFFFF));
+  putU16(&d[6], clampRaw(s_.wh, 16.0f, 0xFFFF));
+  send(TPDO2_BASE + config_.node_id, 8, d);
+}
+
+void DeltaQCharger::tpdo3() {
+  uint8_t d[8] = {};
+  putU32(&d[0], s_.error_code);
+  putU16(&d[4], s_.ac_present ? clampRaw(config_.ac_voltage_V, 16.0f, 0xFFFF) : 0);
+  d[6] = 0xFF;   // charger SOC unknown in remote mode
+  send(TPDO3_BASE + config_.node_id, 8, d);
+}
+
+void DeltaQCharger::handleSdo(const canlog::Frame &f) {
+  s_.sdo_requests++;
+  const uint8_t cs = f.data[0];
+  const uint16_t index = (uint16_t)(f.data[1] | f.data[2] << 8);
+  const uint8_t sub = f.data[3];
+  const uint32_t value = (uint32_t)f.data[4] | (uint32_t)f.data[5] << 8 | (uint32_t)f.data[6] << 16 |
+                         (uint32_t)f.data[7] << 24;
+
+  uint8_t d[8] = {0, f.data[1], f.data[2], sub, 0, 0, 0, 0};
+  auto abort = [&](uint32_t code) {
+    d[0] = 0x80;
+    putU32(&d[4], code);
+    send(SDO_TX_BASE + config_.node_id, 8, d);
+  };
+
+  const bool download = (cs & 0xE0) == 0x20;
+  const bool upload = (cs & 0xE0) == 0x40;
+  if (!download && !upload) return abort(SDO_ABORT_COMMAND);
+
+  if (download) {
+    switch (index) {
+      case 0x6000:
+        if (!s_.override_on) return abort(SDO_ABORT_DEVICE_STATE);
+        s_.battery_ready = (value & 0x01) != 0;
+        break;
+      case 0x6070: s_.request_A = (value & 0xFFFF) / 16.0f; break;
+      case 0x2271: s_.limit_V = value / 256.0f; break;
+      default: return abort(SDO_ABORT_NO_OBJECT);
+    }
+    d[0] = 0x60;
+  } else {
+    uint32_t v;
+    uint8_t size;
+    switch (index) {
+      case 0x6000: v = s_.battery_ready ? 1 : 0; size = 1; break;
+      case 0x6070: v = clampRaw(s_.request_A, 16.0f, 0xFFFF); size = 2; break;
+      case 0x2271: v = clampRaw(s_.limit_V, 256.0f, 0xFFFFFFFF); size = 4; break;
+      default: return abort(SDO_ABORT_NO_OBJECT);
+    }
+    d[0] = (uint8_t)(0x43 | (4 - size) << 2);
+    putU32(&d[4], v);
+  }
+  send(SDO_TX_BASE + config_.node_id, 8, d);
+}
+
+void DeltaQCharger::receive(const canlog::Frame &f, uint64_t now_us) {
+  advance(now_us);
+  s_.frames_received++;
+  const uint32_t id = f.id;
+
+  if (id == NMT_ID && f.dlc >= 2) {
+    if (f.data[0] == 0x01 && (f.data[1] == config_.node_id || f.data[1] == 0) && !s_.operational) {
+      s_.operational = true;
+      next_tpdo1_us_ = now_us + config_.tpdo1_ms * 1000ULL;
+      next_tpdo2_us_ = now_us + config_.tpdo2_ms * 1000ULL;
+      next_tpdo3_us_ = now_us + config_.tpdo3_ms * 1000ULL;
+    }
+    return;
+  }
+
+  if (id == BATTERY_HB_ID && f.dlc >= 1) {
+    if (!s_.override_on && !s_.silent) {
+      // The bench charger reports an empty EMCY (error reset) as remote
+      // mode comes up, and clears the heartbeat-lost error
+      if (s_.error_code == ERR_HEARTBEAT_LOST) s_.error_code = 0;
+      sendEmcy(s_.error_code);
+    }
+    s_.override_on = true;
+    battery_hb_seen_ = true;
+    battery_hb_us_ = now_us;
+    return;
+  }
+
+  if (id == SDO_RX_BASE + config_.node_id && f.dlc == 8) {
+    handleSdo(f);
+    return;
+  }
+
+  if (id == RPDO1_BASE + config_.node_id && s_.operational) {
+    dbc::AnyMessage m;
+    if (dbc::decode(id, f.data, f.dlc, m) && m.type == dbc::AnyMessage::Type::RPDO1_20A) {
+      const bool ready = m.rpdo1_20a.battery_status == dbc::BatteryStatus::Enabled;
+      if (!s_.override_on) return;   // remote mode only
+      if (ready && !s_.battery_ready) s_.complete = false;   // a new cycle
+      s_.battery_ready = ready;
+      s_.request_A = m.rpdo1_20a.current_request_A;
+      if (m.rpdo1_20a.voltage_request_V > 0) s_.limit_V = std::min(m.rpdo1_20a.voltage_request_V, config_.max_voltage_V);
+    }
+  }
+}
+
+uint64_t DeltaQCharger::service(uint64_t now_us, const FrameSink &out) {
+  advance(now_us);
+
+  if (now_us >= next_hb_us_) {
+    const uint8_t state = s_.operational ? HB_OPERATIONAL : HB_PREOPERATIONAL;
+    send(HEARTBEAT_BASE + config_.node_id, 1, &state);
+    next_hb_us_ += config_.heartbeat_ms * 1000ULL;
+  }
+  if (now_us >= next_tpdo2_us_) {
+    tpdo2();
+    next_tpdo2_us_ += config_.tpdo2_ms * 1000ULL;
+  }
+  if (now_us >= next_tpdo3_us_) {
+    tpdo3();
+    next_tpdo3_us_ += config_.tpdo3_ms * 1000ULL;
+  }
+  if (now_us >= next_tpdo1_us_) {
+    tpdo1();
+    next_tpdo1_us_ += config_.tpdo1_ms * 1000ULL;
+  }
+
+  for (canlog::Frame &f : pending_) {
+    f.t_us = now_us;
+    out(f);
+    s_.frames_sent++;
+  }
+  pending_.clear();
+
+  uint64_t next = std::min({next_hb_us_, next_tpdo1_us_, next_tpdo2_us_, next_tpdo3_us_});
+  // Catch a heartbeat timeout when it happens, not at the next TPDO
+  if (s_.override_on) next = std::min<uint64_t>(next, battery_hb_us_ + config_.battery_hb_timeout_ms * 1000ULL + 1);
+  return next;
+}
+
+// -------------------- Faults --------------------
+void DeltaQCharger::inject(ChargerFault fault, uint64_t now_us) {
+  advance(now_us);
+  switch (fault) {
+    case ChargerFault::HwShutdown:
+      s_.hw_shutdown = true;
+      s_.error_code = ERR_OUTPUT_STAGE;
+      sendEmcy(s_.error_code);
+      break;
+    case ChargerFault::AcLoss:
+      s_.ac_present = false;
+      break;
+    case ChargerFault::OverTemp:
+      s_.temp_C = config_.derate_end_C;
+      break;
+    case ChargerFault::Silent:
+      pending_.clear();
+      s_.silent = true;
+      break;
+    case ChargerFault::Emcy:
+      sendEmcy(s_.emcy_code);
+      break;
+  }
+  // Output stages cut at once, not at the next model step
+  s_.current_A = std::min(s_.current_A, targetCurrent());
+  s_.charging = s_.current_A > 0;
+}
+
+void DeltaQCharger::clearFaults(uint64_t now_us) {
+  advance(now_us);
+  s_.hw_shutdown = false;
+  s_.ac_present = true;
+  s_.silent = false;
+  s_.temp_C = std::min(s_.temp_C, config_.ambient_C);
+  s_.error_code = 0;
+  sendEmcy(0);
+}
+
+const char *chargerFaultName(ChargerFault fault) {
+  switch (fault) {
+    case ChargerFault::HwShutdown: return "hw";
+    case ChargerFault::AcLoss:     return "ac";
+    case ChargerFault::OverTemp:   return "temp";
+    case ChargerFault::Silent:     return "silent";
+    case ChargerFault::Emcy:       return "emcy";
+  }
+  return "?";
+}
+
+bool parseChargerFault(const char *name, ChargerFault &fault) {
+  for (ChargerFault f : {ChargerFault::HwShutdown, ChargerFault::AcLoss, ChargerFault::OverTemp,
+                         ChargerFault::Silent, ChargerFault::Emcy}) {
+    if (!strcmp(name, chargerFaultName(f))) {
+      fault = f;
+      return true;
+    }
+  }
+  return false;
+}
+
+} // namespace emu
@@ -0,0 +1,128 @@
+#pragma once
+// Delta-Q ICL1500-85 as observed on the bench (docs/notes.txt):
+//
+//   - boots pre-operational, sending heartbeat 0x70A = 7F once a second
+//   - NMT start (0x000: 01 0A) makes it operational: heartbeat 05, TPDO1
+//     (0x18A) every 200 ms, TPDO2/3 (0x28A/0x38A) every second
+//   - the battery heartbeat 0x701 turns the override (remote mode) on; when
+//     it stops for battery_hb_timeout_ms the override drops, output stops
+//     and E-0-3-2 is raised
+//   - SDO (0x60A -> 0x58A) expedited downloads and uploads of 0x6000
+//     (battery status, only while the heartbeat is present), 0x6070
+//     (current request, A x 16) and 0x2271 (voltage limit, V x 256)
+//   - RPDO1 (0x20A) carries SOC, voltage and current requests and battery
+//     status, decoded with the firmware's own dbc::decode
+//
+// Output current ramps toward the request, limited by rated current and
+// power, a CC/CV taper against the voltage limit and thermal derating, and
+// flows into the BatteryPack. Faults can be injected at any time.
+
+#include <stdint.h>
+#include <vector>
+#include "BatteryPack.h"
+#include "CanNode.h"
+
+namespace emu {
+
+struct DeltaQConfig {
+  uint8_t  node_id = 0x0A;
+  uint32_t heartbeat_ms = 1000;
+  uint32_t tpdo1_ms = 200;
+  uint32_t tpdo2_ms = 1000;
+  uint32_t tpdo3_ms = 1000;
+  uint32_t battery_hb_timeout_ms = 3000;
+
+  float max_current_A = 19.5f;
+  float max_power_W = 1500.0f;
+  float max_voltage_V = 85.0f;        // voltage limit until one is requested
+  float ramp_A_per_s = 4.0f;
+  float complete_A = 0.5f;            // CV current at which the cycle completes
+  float ac_voltage_V = 123.5f;
+
+  // Heat sink: first-order toward ambient + losses * C/W
+  float ambient_C = 25.0f;
+  float efficiency = 0.92f;
+  float thermal_C_per_W = 0.35f;
+  float thermal_tau_s = 300.0f;
+  float derate_start_C = 60.0f;       // output falls linearly to 0 at derate_end_C
+  float derate_end_C = 85.0f;
+};
+
+enum class ChargerFault : uint8_t {
+  HwShutdown,   // TPDO1 hardware shutdown bit, output off, EMCY F-0-0-1
+  AcLoss,       // AC connection status off, output off
+  OverTemp,     // heat sink jumps to derate_end_C and cools from there
+  Silent,       // stops transmitting anything (unplugged / bus-off)
+  Emcy,         // one EMCY frame with ChargerState::emcy_code, nothing else
+};
+
+struct ChargerState {
+  bool     operational = false;
+  bool     override_on = false;       // battery heartbeat present
+  bool     battery_ready = false;
+  bool     charging = false;
+  bool     complete = false;
+  bool     derating = false;
+  bool     hw_shutdown = false;
+  bool     ac_present = true;
+  bool     silent = false;
+  float    current_A = 0;
+  float    voltage_V = 0;
+  float    request_A = 0;
+  float    limit_V = 0;
+  float    temp_C = 0;
+  float    ah = 0;
+  float    wh = 0;
+  float    elapsed_s = 0;
+  uint32_t error_code = 0;            // TPDO3 Current_Error / last EMCY
+  uint32_t emcy_code = 0x1C05000;     // sent by ChargerFault::Emcy
+  uint64_t frames_sent = 0;
+  uint64_t frames_received = 0;
+  uint64_t sdo_requests = 0;
+};
+
+class DeltaQCharger : public CanNode {
+public:
+  explicit DeltaQCharger(BatteryPack *pack = nullptr, DeltaQConfig config = DeltaQConfig());
+
+  void receive(const canlog::Frame &f, uint64_t now_us) override;
+  uint64_t service(uint64_t now_us, const FrameSink &out) override;
+
+  void inject(ChargerFault fault, uint64_t now_us);
+  void clearFaults(uint64_t now_us);
+
+  const ChargerState &state() const { return s_; }
+  const DeltaQConfig &config() const { return config_; }
+
+private:
+  void advance(uint64_t now_us);
+  void handleSdo(const canlog::Frame &f);
+  void send(uint32_t id, uint8_t dlc, const uint8_t *data);
+  void sendEmcy(uint32_t code);
+  void tpdo1();
+  void tpdo2();
+  void tpdo3();
+  float targetCurrent() const;
+
+  BatteryPack *pack_;
+  DeltaQConfig config_;
+  ChargerState s_;
+
+  uint64_t last_us_ = 0;
+  uint64_t battery_hb_us_ = 0;
+  bool     battery_hb_seen_ = false;
+  uint64_t next_hb_us_ = 0;
+  uint64_t next_tpdo1_us_ = UINT64_MAX;
+  uint64_t next_tpdo2_us_ = UINT64_MAX;
+  uint64_t next_tpdo3_us_ = UINT64_MAX;
+
+  // Replies and EMCYs queued by receive()/inject() go out on the next
+  // service(), which transports call right after receive()
+  std::vector<canlog::Frame> pending_;
+  bool started_ = false;
+};
+
+const char *chargerFaultName(ChargerFault fault);
+bool parseChargerFault(const char *name, ChargerFault &fault);
+
+} // namespace emu
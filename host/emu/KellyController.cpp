@@ -0,0 +1,184 @@
+#include "KellyController.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cctype>
+
+namespace emu {
+
+namespace {
+
+uint8_t clampU8(float v) {
+  return (uint8_t)std::clamp(lroundf(v), 0L, 255L);
+}
+
+uint16_t clampU16(float v) {
+  return (uint16_t)std::clamp(lroundf(v), 0L, 0xFFFFL);
+}
+
+void putU16le(uint8_t *d, uint16_t v) {
+  d[0] = (uint8_t)v;
+  d[1] = (uint8_t)(v >> 8);
+}
+
+} // namespace
+
+// -------------------- Profile --------------------
+DriveProfile DriveProfile::urban() {
+  DriveProfile p;
+  //              t     rpm   A      V     thr   ctrl  motor
+  p.points_ = {{  0.0f,    0,   0.0f, 82.0f, 0.0f, 30.0f, 32.0f, 0},
+               {  2.0f,    0,   0.0f, 82.0f, 0.0f, 30.0f, 32.0f, 0},
+               { 10.0f, 3000, 120.0f, 72.4f, 3.8f, 34.0f, 38.0f, 0},
+               { 12.0f, 3200,  45.0f, 78.4f, 2.2f, 35.0f, 40.0f, 0},
+               { 40.0f, 3200,  40.0f, 78.8f, 2.1f, 38.0f, 45.0f, 0},
+               { 48.0f, 5200, 160.0f, 69.2f, 4.6f, 42.0f, 50.0f, 0},
+               { 70.0f, 5200,  65.0f, 76.8f, 2.8f, 45.0f, 55.0f, 0},
+               { 80.0f,    0,   0.0f, 81.5f, 0.0f, 44.0f, 54.0f, 0},
+               {120.0f,    0,   0.0f, 81.5f, 0.0f, 30.0f, 32.0f, 0}};
+  return p;
+}
+
+bool DriveProfile::load(const std::string &path, std::string &err) {
+  FILE *f = fopen(path.c_str(), "r");
+  if (!f) {
+    err = "cannot open " + path;
+    return false;
+  }
+  points_.clear();
+  char line[256];
+  int lineNo = 0;
+  while (fgets(line, sizeof(line), f)) {
+    lineNo++;
+    const char *s = line;
+    while (*s == ' ' || *s == '\t') s++;
+    if (*s == '#' || *s == '\n' || *s == '\r' || *s == '\0' || isalpha((unsigned char)*s)) continue;
+
+    DrivePoint p;
+    float *fields[] = {&p.t_s, &p.rpm, &p.current_A, &p.voltage_V, &p.throttle_V, &p.ctrl_temp_C, &p.motor_temp_C};
+    char *end = (char *)s;
+    int n = 0;
+    for (float *field : fields) {
+      const char *start = end;
+      *field = strtof(start, &end);
+      if (end == start) break;
+      n++;
+      if (*end == ',') end++;
+    }
+    if (n == 7 && *end && *end != '\n' && *end != '\r') p.errors = (uint16_t)strtoul(end, &end, 0);
+    if (n < 2 || (!points_.empty() && p.t_s <= points_.back().t_s) || (points_.empty() && p.t_s != 0)) {
+      fclose(f);
+      err = path + ":" + std::to_string(lineNo) + ": expected t_s,rpm[,...] with times rising from 0";
+      return false;
+    }
+    points_.push_back(p);
+  }
+  fclose(f);
+  if (points_.size() < 2) {
+    err = path + ": a profile needs at least two points";
+    return false;
+  }
+  return true;
+}
+
+DrivePoint DriveProfile::at(double t_s) const {
+  if (points_.empty()) return DrivePoint();
+  if (points_.size() == 1 || duration() <= 0) return points_.front();
+  t_s = fmod(t_s, duration());
+
+  size_t i = 1;
+  while (i < points_.size() - 1 && t_s >= points_[i].t_s) i++;
+  const DrivePoint &a = points_[i - 1], &b = points_[i];
+  const float f = (float)((t_s - a.t_s) / (b.t_s - a.t_s));
+  auto lerp = [f](float x, float y) { return x + f * (y - x); };
+
+  DrivePoint p;
+  p.t_s = (float)t_s;
+  p.rpm = lerp(a.rpm, b.rpm);
+  p.current_A = lerp(a.current_A, b.current_A);
+  p.voltage_V = lerp(a.voltage_V, b.voltage_V);
+  p.throttle_V = lerp(a.throttle_V, b.throttle_V);
+  p.ctrl_temp_C = lerp(a.ctrl_temp_C, b.ctrl_temp_C);
+  p.motor_temp_C = lerp(a.motor_temp_C, b.motor_temp_C);
+  p.errors = a.errors;
+  return p;
+}
+
+// -------------------- Bus load --------------------
+uint32_t canFrameBits(bool extended, uint8_t dlc) {
+  const uint32_t n = 8u * std::min<uint8_t>(dlc, 8);
+  // Frame without stuffing plus 3 bits interframe space, and one stuff bit
+  // per four bits of the stuffed region (SOF through CRC) at worst
+  return extended ? 67 + n + (54 + n - 1) / 4 : 47 + n + (34 + n - 1) / 4;
+}
+
+float kellyRateForLoad(float load, uint32_t bitrate) {
+  return load * bitrate / canFrameBits(true, 8) / 2.0f;
+}
+
+// -------------------- Node --------------------
+KellyController::KellyController(DriveProfile profile, KellyConfig config) : profile_(std::move(profile)) {
+  s1_.period_us = config.msg1_hz > 0 ? 1e6 / config.msg1_hz : 0;
+  s2_.period_us = config.msg2_hz > 0 ? 1e6 / config.msg2_hz : 0;
+}
+
+bool KellyController::due(Stream &s, uint64_t now_us) {
+  if (s.period_us <= 0 || s.next_us > now_us) return false;
+  s.n++;
+  s.next_us = start_us_ + (uint64_t)llround(s.n * s.period_us);
+  if (s.next_us + 100000 < now_us) {
+    // Far behind (a stalled process); pick the schedule up from now
+    late_++;
+    start_us_ = now_us;
+    s1_.n = s2_.n = 0;
+    s1_.next_us = s1_.period_us > 0 ? now_us : UINT64_MAX;
+    s2_.next_us = s2_.period_us > 0 ? now_us : UINT64_MAX;
+  }
+  return true;
+}
+
+uint64_t KellyController::service(uint64_t now_us, const FrameSink &out) {
+  if (!started_) {
+    started_ = true;
+    start_us_ = now_us;
+    s1_.next_us = s1_.period_us > 0 ? now_us : UINT64_MAX;
+    s2_.next_us = s2_.period_us > 0 ? now_us : UINT64_MAX;
+  }
+
+  // Send in time order so interleaving stays right when several are due
+  while (true) {
+    Stream &s = s1_.next_us <= s2_.next_us ? s1_ : s2_;
+    const uint64_t at = s.next_us;
+    if (!due(s, now_us)) break;
+    last_ = profile_.at((at - start_us_) / 1e6);
+    canlog::Frame f = &s == &s1_ ? msg1(last_) : msg2(last_);
+    f.t_us = at;
+    out(f);
+    sent_++;
+  }
+  return std::min(s1_.next_us, s2_.next_us);
+}
+
+canlog::Frame KellyController::msg1(const DrivePoint &p) const {
+  uint8_t d[8];
+  putU16le(&d[0], clampU16(p.rpm));
+  putU16le(&d[2], clampU16(p.current_A * 10.0f));
+  putU16le(&d[4], clampU16(p.voltage_V * 10.0f));
+  putU16le(&d[6], p.errors);
+  return makeFrame(0x0CF11E05 | canlog::ID_EXTENDED, 8, d);
+}
+
+canlog::Frame KellyController::msg2(const DrivePoint &p) const {
+  const bool moving = p.rpm > 0.5f;
+  const bool throttle = p.throttle_V > 0.2f;
+  uint8_t d[8] = {0};
+  d[0] = clampU8(p.throttle_V * 255.0f / 5.0f);
+  d[1] = clampU8(p.ctrl_temp_C + 40.0f);
+  d[2] = clampU8(p.motor_temp_C + 30.0f);
+  d[4] = (uint8_t)((moving ? 1 : 0) | ((throttle ? 1 : 0) << 2));   // feedback / command: forward
+  d[5] = (uint8_t)((1 << 5) | ((throttle ? 1 : 0) << 6) | (moving ? 0x05 : 0));   // forward, foot, halls
+  return makeFrame(0x0CF11F05 | canlog::ID_EXTENDED, 8, d);
+}
+
+} // namespace emu
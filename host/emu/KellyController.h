@@ -0,0 +1,94 @@
+#pragma once
+// Kelly motor controller traffic for CAN2: the two broadcast frames
+// onMotorCanRx() decodes (MotorController_DbcTypes.h), filled from a drive
+// cycle and sent at configurable rates, up to the whole bus.
+//
+//   0x0CF11E05  rpm, motor current (A x 10), battery voltage (V x 10), error bits
+//   0x0CF11F05  throttle (0-5 V as 0-255), controller temp (+40), motor temp
+//               (+30), controller status, switch inputs
+//
+// A DriveProfile is a list of points interpolated linearly (error bits hold
+// until the next point) and repeated end to end. Profiles come from CSV:
+//
+//   t_s,rpm,current_A,voltage_V,throttle_V,ctrl_temp_C,motor_temp_C,errors
+//
+// one point per line, times increasing from 0; trailing columns may be
+// left off and errors takes 0x... hex. Lines starting with # or a letter
+// are skipped.
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include "CanNode.h"
+
+namespace emu {
+
+struct DrivePoint {
+  float t_s = 0;
+  float rpm = 0;
+  float current_A = 0;
+  float voltage_V = 80.0f;
+  float throttle_V = 0;
+  float ctrl_temp_C = 30.0f;
+  float motor_temp_C = 30.0f;
+  uint16_t errors = 0;
+};
+
+class DriveProfile {
+public:
+  // A two-minute urban cycle: pull away, cruise, a harder pull, brake, wait
+  static DriveProfile urban();
+  bool load(const std::string &path, std::string &err);
+
+  DrivePoint at(double t_s) const;
+  double duration() const { return points_.empty() ? 0 : points_.back().t_s; }
+
+private:
+  std::vector<DrivePoint> points_;
+};
+
+struct KellyConfig {
+  float msg1_hz = 20.0f;
+  float msg2_hz = 20.0f;
+};
+
+// Bits one frame takes on the wire, worst-case bit stuffing and the
+// interframe space included (extended, 8 bytes: 160)
+uint32_t canFrameBits(bool extended, uint8_t dlc);
+
+// Per-message rate that fills `load` (0..1) of a bus at bitrate with the
+// two Kelly frames in equal parts
+float kellyRateForLoad(float load, uint32_t bitrate);
+
+class KellyController : public CanNode {
+public:
+  KellyController(DriveProfile profile, KellyConfig config = KellyConfig());
+
+  uint64_t service(uint64_t now_us, const FrameSink &out) override;
+
+  const DrivePoint &last() const { return last_; }
+  uint64_t framesSent() const { return sent_; }
+  uint64_t late() const { return late_; }   // schedule slips of more than 100 ms
+
+private:
+  canlog::Frame msg1(const DrivePoint &p) const;
+  canlog::Frame msg2(const DrivePoint &p) const;
+
+  // Send times are start + n / rate, so odd rates do not drift
+  struct Stream {
+    double period_us;
+    uint64_t n = 0;
+    uint64_t next_us = UINT64_MAX;
+  };
+  bool due(Stream &s, uint64_t now_us);
+
+  DriveProfile profile_;
+  Stream s1_, s2_;
+  uint64_t start_us_ = 0;
+  bool started_ = false;
+  DrivePoint last_;
+  uint64_t sent_ = 0;
+  uint64_t late_ = 0;
+};
+
+} // namespace emu
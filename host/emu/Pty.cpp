@@ -0,0 +1,135 @@
+#include "Pty.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <stdlib.h>
+#include <string.h>
+#include <termios.h>
+#include <unistd.h>
+#include <algorithm>
+#include "SocketCan.h"
+
+namespace emu {
+
+namespace {
+
+bool makeRaw(int fd, speed_t speed) {
+  struct termios tio;
+  if (tcgetattr(fd, &tio) < 0) return false;
+  cfmakeraw(&tio);
+  tio.c_cflag |= CLOCAL | CREAD;
+  tio.c_cc[VMIN] = 0;
+  tio.c_cc[VTIME] = 0;
+  cfsetispeed(&tio, speed);
+  cfsetospeed(&tio, speed);
+  return tcsetattr(fd, TCSANOW, &tio) == 0;
+}
+
+speed_t baudConstant(uint32_t baud) {
+  switch (baud) {
+    case 9600: return B9600;
+    case 19200: return B19200;
+    case 38400: return B38400;
+    case 57600: return B57600;
+    case 230400: return B230400;
+    case 460800: return B460800;
+    case 921600: return B921600;
+    default: return B115200;
+  }
+}
+
+} // namespace
+
+Pty::~Pty() {
+  close();
+}
+
+bool Pty::open(std::string &err, const std::string &link) {
+  close();
+  master_ = posix_openpt(O_RDWR | O_NOCTTY);
+  if (master_ < 0 || grantpt(master_) < 0 || unlockpt(master_) < 0) {
+    err = std::string("posix_openpt: ") + strerror(errno);
+    close();
+    return false;
+  }
+  path_ = ptsname(master_);
+  slave_ = ::open(path_.c_str(), O_RDWR | O_NOCTTY);
+  if (slave_ < 0 || !makeRaw(slave_, B115200)) {
+    err = path_ + ": " + strerror(errno);
+    close();
+    return false;
+  }
+  fcntl(master_, F_SETFL, fcntl(master_, F_GETFL) | O_NONBLOCK);
+
+  if (!link.empty()) {
+    unlink(link.c_str());
+    if (symlink(path_.c_str(), link.c_str()) < 0) {
+      err = link + ": " + strerror(errno);
+      close();
+      return false;
+    }
+    link_ = link;
+  }
+  return true;
+}
+
+void Pty::close() {
+  if (!link_.empty()) unlink(link_.c_str());
+  if (slave_ >= 0) ::close(slave_);
+  if (master_ >= 0) ::close(master_);
+  master_ = slave_ = -1;
+  link_.clear();
+}
+
+ssize_t Pty::read(uint8_t *data, size_t n) {
+  return master_ < 0 ? -1 : ::read(master_, data, n);
+}
+
+bool Pty::write(const uint8_t *data, size_t n) {
+  while (n > 0) {
+    const ssize_t w = ::write(master_, data, n);
+    if (w < 0 && errno == EAGAIN) {
+      struct pollfd p = {master_, POLLOUT, 0};
+      poll(&p, 1, 100);
+      continue;
+    }
+    if (w <= 0) return false;
+    data += w;
+    n -= (size_t)w;
+  }
+  return true;
+}
+
+int openTty(const std::string &path, uint32_t baud, std::string &err) {
+  const int fd = ::open(path.c_str(), O_RDWR | O_NOCTTY | O_NONBLOCK);
+  if (fd < 0 || !makeRaw(fd, baudConstant(baud))) {
+    err = path + ": " + strerror(errno);
+    if (fd >= 0) ::close(fd);
+    return -1;
+  }
+  return fd;
+}
+
+bool runOnPty(Pty &pty, SerialNode &node, volatile bool *stop,
+              const std::function<void(uint64_t now_us)> &idle) {
+  const ByteSink out = [&](const uint8_t *data, size_t n) { pty.write(data, n); };
+  uint64_t due = node.service(monotonicUs(), out);
+
+  while (!*stop) {
+    const uint64_t now = monotonicUs();
+    const uint64_t wait_us = due > now ? due - now : 0;
+    struct pollfd p = {pty.fd(), POLLIN, 0};
+    const int r = poll(&p, 1, (int)std::min<uint64_t>((wait_us + 999) / 1000, 100));
+    if (r < 0 && errno != EINTR) return false;
+
+    uint8_t buf[256];
+    ssize_t n;
+    while ((n = pty.read(buf, sizeof(buf))) > 0) node.receive(buf, (size_t)n, monotonicUs());
+    const uint64_t t = monotonicUs();
+    if (idle) idle(t);
+    due = node.service(t, out);
+  }
+  return true;
+}
+
+} // namespace emu
@@ -0,0 +1,47 @@
+#pragma once
+// Serial lines for the emulators and cc_vcan (Linux): a pseudo-terminal the
+// BMS emulator listens on, and raw access to a tty (the PTY's other end, or
+// a USB-serial adapter wired to the real pack).
+
+#include <stddef.h>
+#include <stdint.h>
+#include <functional>
+#include <string>
+#include <sys/types.h>
+#include "SerialNode.h"
+
+namespace emu {
+
+class Pty {
+public:
+  Pty() = default;
+  ~Pty();
+  Pty(const Pty &) = delete;
+  Pty &operator=(const Pty &) = delete;
+
+  // Creates the pair in raw mode; link, if given, becomes a symlink to the
+  // tty so clients can use a fixed path
+  bool open(std::string &err, const std::string &link = "");
+  void close();
+  int fd() const { return master_; }
+  const std::string &path() const { return path_; }
+
+  // Non-blocking; <= 0 when nothing is waiting
+  ssize_t read(uint8_t *data, size_t n);
+  bool write(const uint8_t *data, size_t n);
+
+private:
+  int master_ = -1;
+  int slave_ = -1;      // held open so the master never sees a hangup
+  std::string path_;
+  std::string link_;
+};
+
+// Opens a tty raw, non-blocking, 8N1 at baud; -1 with err set on failure
+int openTty(const std::string &path, uint32_t baud, std::string &err);
+
+// Runs node on the PTY in real time until *stop is set, like runOnSocket()
+bool runOnPty(Pty &pty, SerialNode &node, volatile bool *stop,
+              const std::function<void(uint64_t now_us)> &idle = nullptr);
+
+} // namespace emu
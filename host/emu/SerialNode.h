@@ -0,0 +1,26 @@
+#pragma once
+// An emulated device on a serial line (the BMS on the controller's Serial1).
+// Same contract as CanNode: the current time comes with every call, so the
+// node runs on a PTY in real time (Pty.h) or on the sim kernel (SimAttach.h).
+
+#include <stddef.h>
+#include <stdint.h>
+#include <functional>
+
+namespace emu {
+
+using ByteSink = std::function<void(const uint8_t *data, size_t n)>;
+
+class SerialNode {
+public:
+  virtual ~SerialNode() = default;
+
+  // Bytes the other end wrote
+  virtual void receive(const uint8_t *data, size_t n, uint64_t now_us) {}
+
+  // Writes whatever is due at now_us through out and returns when it next
+  // wants to be called (UINT64_MAX: only after the next receive())
+  virtual uint64_t service(uint64_t now_us, const ByteSink &out) = 0;
+};
+
+} // namespace emu
@@ -0,0 +1,80 @@
+#include "SimAttach.h"
+#include <Arduino.h>
+#include <cstring>
+
+namespace emu {
+
+SimAttachment::SimAttachment(sim::Kernel &kernel, FlexCANShimBus &bus, CanNode &node)
+    : kernel_(kernel), bus_(bus), node_(node) {
+  sink_ = [this](const canlog::Frame &f) {
+    CAN_message_t msg;
+    msg.id = f.id & ~canlog::ID_EXTENDED;
+    msg.flags.extended = (f.id & canlog::ID_EXTENDED) != 0;
+    msg.len = f.dlc;
+    memcpy(msg.buf, f.data, sizeof(msg.buf));
+    bus_.inject(msg);
+    to_firmware_++;
+  };
+
+  auto previous = bus_.onWrite;
+  bus_.onWrite = [this, previous](const CAN_message_t &msg) {
+    if (previous) previous(msg);
+    canlog::Frame f = makeFrame(msg.id | (msg.flags.extended ? canlog::ID_EXTENDED : 0), msg.len, msg.buf);
+    f.t_us = arduinoNowUs();
+    from_firmware_++;
+    node_.receive(f, f.t_us);
+    poke();
+  };
+
+  kernel_.at(kernel_.now(), [this]() { wake(); });
+}
+
+void SimAttachment::poke() {
+  // receive() runs inside loop(); replies are sent as soon as it returns
+  kernel_.at(kernel_.now(), [this]() { wake(); });
+}
+
+void SimAttachment::wake() {
+  const uint64_t now = kernel_.now();
+  if (now >= scheduled_) scheduled_ = UINT64_MAX;
+  const uint64_t next = node_.service(now, sink_);
+  if (next != UINT64_MAX && next < scheduled_) {
+    scheduled_ = next;
+    kernel_.at(next, [this]() { wake(); });
+  }
+}
+
+// -------------------- Serial --------------------
+SerialAttachment::SerialAttachment(sim::Kernel &kernel, HardwareSerial &port, SerialNode &node)
+    : kernel_(kernel), port_(port), node_(node) {
+  sink_ = [this](const uint8_t *data, size_t n) {
+    port_.inject(data, n);
+    to_firmware_ += n;
+  };
+
+  auto previous = port_.onWrite;
+  port_.onWrite = [this, previous](const uint8_t *data, size_t n) {
+    if (previous) previous(data, n);
+    from_firmware_ += n;
+    node_.receive(data, n, arduinoNowUs());
+    poke();
+  };
+
+  kernel_.at(kernel_.now(), [this]() { wake(); });
+}
+
+void SerialAttachment::poke() {
+  kernel_.at(kernel_.now(), [this]() { wake(); });
+}
+
+void SerialAttachment::wake() {
+  const uint64_t now = kernel_.now();
+  if (now >= scheduled_) scheduled_ = UINT64_MAX;
+  const uint64_t next = node_.service(now, sink_);
+  if (next != UINT64_MAX && next < scheduled_) {
+    scheduled_ = next;
+    kernel_.at(next, [this]() { wake(); });
+  }
+}
+
+} // namespace emu
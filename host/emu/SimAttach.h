@@ -0,0 +1,62 @@
+#pragma once
+// Puts an emulated node on the bus of one of the firmware's FlexCAN
+// controllers, in virtual time on the sim kernel: frames the node sends
+// land in the controller's RX queue, frames the firmware writes reach the
+// node's receive() at the moment of the write. Several nodes can share a
+// controller. SerialAttachment does the same for a node on one of the
+// firmware's serial ports.
+
+#include <stdint.h>
+#include <FlexCAN_T4.h>
+#include <Arduino.h>
+#include "CanNode.h"
+#include "SerialNode.h"
+#include "SimKernel.h"
+
+namespace emu {
+
+class SimAttachment {
+public:
+  SimAttachment(sim::Kernel &kernel, FlexCANShimBus &bus, CanNode &node);
+
+  // Call after changing the node from outside (faults, settings) so that
+  // anything it now wants to send goes out at the current time
+  void poke();
+
+  uint64_t framesToFirmware() const { return to_firmware_; }
+  uint64_t framesFromFirmware() const { return from_firmware_; }
+
+private:
+  void wake();
+
+  sim::Kernel &kernel_;
+  FlexCANShimBus &bus_;
+  CanNode &node_;
+  FrameSink sink_;
+  uint64_t scheduled_ = UINT64_MAX;
+  uint64_t to_firmware_ = 0;
+  uint64_t from_firmware_ = 0;
+};
+
+class SerialAttachment {
+public:
+  SerialAttachment(sim::Kernel &kernel, HardwareSerial &port, SerialNode &node);
+
+  void poke();
+
+  uint64_t bytesToFirmware() const { return to_firmware_; }
+  uint64_t bytesFromFirmware() const { return from_firmware_; }
+
+private:
+  void wake();
+
+  sim::Kernel &kernel_;
+  HardwareSerial &port_;
+  SerialNode &node_;
+  ByteSink sink_;
+  uint64_t scheduled_ = UINT64_MAX;
+  uint64_t to_firmware_ = 0;
+  uint64_t from_firmware_ = 0;
+};
+
+} // namespace emu
@@ -0,0 +1,114 @@
+#include "SocketCan.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <linux/can.h>
+#include <linux/can/raw.h>
+#include <net/if.h>
+#include <poll.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+#include <algorithm>
+
+namespace emu {
+
+SocketCan::~SocketCan() {
+  close();
+}
+
+bool SocketCan::open(const std::string &iface, std::string &err) {
+  close();
+  fd_ = socket(PF_CAN, SOCK_RAW, CAN_RAW);
+  if (fd_ < 0) {
+    err = std::string("socket(PF_CAN): ") + strerror(errno);
+    return false;
+  }
+
+  struct ifreq ifr;
+  memset(&ifr, 0, sizeof(ifr));
+  snprintf(ifr.ifr_name, sizeof(ifr.ifr_name), "%s", iface.c_str());
+  if (ioctl(fd_, SIOCGIFINDEX, &ifr) < 0) {
+    err = iface + ": " + strerror(errno);
+    close();
+    return false;
+  }
+
+  struct sockaddr_can addr;
+  memset(&addr, 0, sizeof(addr));
+  addr.can_family = AF_CAN;
+  addr.can_ifindex = ifr.ifr_ifindex;
+  if (bind(fd_, (struct sockaddr *)&addr, sizeof(addr)) < 0) {
+    err = iface + ": bind: " + strerror(errno);
+    close();
+    return false;
+  }
+
+  fcntl(fd_, F_SETFL, fcntl(fd_, F_GETFL) | O_NONBLOCK);
+  return true;
+}
+
+void SocketCan::close() {
+  if (fd_ >= 0) ::close(fd_);
+  fd_ = -1;
+}
+
+bool SocketCan::read(canlog::Frame &f) {
+  struct can_frame cf;
+  if (fd_ < 0 || ::read(fd_, &cf, sizeof(cf)) != (ssize_t)sizeof(cf)) return false;
+  if (cf.can_id & (CAN_RTR_FLAG | CAN_ERR_FLAG)) return read(f);   // not data, try the next one
+
+  f = {};
+  f.t_us = monotonicUs();
+  f.id = (cf.can_id & CAN_EFF_FLAG) ? (cf.can_id & CAN_EFF_MASK) | canlog::ID_EXTENDED : cf.can_id & CAN_SFF_MASK;
+  f.dlc = std::min<uint8_t>(cf.can_dlc, 8);
+  memcpy(f.data, cf.data, f.dlc);
+  return true;
+}
+
+bool SocketCan::write(const canlog::Frame &f) {
+  struct can_frame cf;
+  memset(&cf, 0, sizeof(cf));
+  cf.can_id = (f.id & canlog::ID_EXTENDED) ? (f.id & CAN_EFF_MASK) | CAN_EFF_FLAG : f.id & CAN_SFF_MASK;
+  cf.can_dlc = std::min<uint8_t>(f.dlc, 8);
+  memcpy(cf.data, f.data, cf.can_dlc);
+  if (fd_ < 0 || ::write(fd_, &cf, sizeof(cf)) != (ssize_t)sizeof(cf)) {
+    dropped_++;
+    return false;
+  }
+  return true;
+}
+
+uint64_t monotonicUs() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000ULL + (uint64_t)ts.tv_nsec / 1000;
+}
+
+bool runOnSocket(SocketCan &can, CanNode &node, volatile bool *stop,
+                 const std::function<void(uint64_t now_us)> &idle) {
+  const FrameSink out = [&](const canlog::Frame &f) { can.write(f); };
+  uint64_t due = node.service(monotonicUs(), out);
+
+  while (!*stop) {
+    const uint64_t now = monotonicUs();
+    const uint64_t wait_us = due > now ? due - now : 0;
+    struct pollfd p = {can.fd(), POLLIN, 0};
+    // Wake at least every 100 ms so idle() and *stop are looked at
+    const int r = poll(&p, 1, (int)std::min<uint64_t>((wait_us + 999) / 1000, 100));
+    if (r < 0 && errno != EINTR) return false;
+
+    canlog::Frame f;
+    while (can.read(f)) {
+      node.receive(f, f.t_us);
+      node.service(f.t_us, out);   // replies go out right away
+    }
+    const uint64_t t = monotonicUs();
+    if (idle) idle(t);
+    due = node.service(t, out);
+  }
+  return true;
+}
+
+} // namespace emu
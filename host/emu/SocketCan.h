@@ -0,0 +1,46 @@
+#pragma once
+// Raw SocketCAN access for the emulators and cc_vcan (Linux; vcan or a real
+// adapter):
+//
+//   sudo modprobe vcan
+//   sudo ip link add dev vcan0 type vcan && sudo ip link set vcan0 up
+
+#include <stdint.h>
+#include <string>
+#include "CanFrame.h"
+#include "CanNode.h"
+
+namespace emu {
+
+class SocketCan {
+public:
+  SocketCan() = default;
+  ~SocketCan();
+  SocketCan(const SocketCan &) = delete;
+  SocketCan &operator=(const SocketCan &) = delete;
+
+  bool open(const std::string &iface, std::string &err);
+  void close();
+  int fd() const { return fd_; }
+
+  // Non-blocking; false when nothing is waiting (or on error)
+  bool read(canlog::Frame &f);
+  // false when the TX queue is full, counted in dropped()
+  bool write(const canlog::Frame &f);
+  uint64_t dropped() const { return dropped_; }
+
+private:
+  int fd_ = -1;
+  uint64_t dropped_ = 0;
+};
+
+// Microseconds on CLOCK_MONOTONIC
+uint64_t monotonicUs();
+
+// Runs node on iface in real time until *stop is set (by a signal handler):
+// frames from the bus go to receive(), service() is called when due.
+// idle, if set, runs on every wakeup with the current time.
+bool runOnSocket(SocketCan &can, CanNode &node, volatile bool *stop,
+                 const std::function<void(uint64_t now_us)> &idle = nullptr);
+
+} // namespace emu
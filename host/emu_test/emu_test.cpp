@@ -0,0 +1,73 @@
+// Checks of the BMS emulator's request matcher (emu/BmsEmulator.h): byte
+// sequences that start like a request but are not one must not hide a real
+// request that overlaps them (5A 5A 5A 00 00 00 00 is one request after one
+// stray byte). Each case is fed in one piece and a byte at a time, and its
+// requests and ignored bytes are counted.
+//
+// Prints each failed check with its line and exits 1 if there were any.
+//
+//   emu_test
+
+#include <algorithm>
+#include <cstdio>
+#include <vector>
+#include "BatteryPack.h"
+#include "BmsEmulator.h"
+
+using namespace emu;
+
+namespace {
+
+int checks = 0;
+int failures = 0;
+
+void check(bool ok, const char *what, int line) {
+  checks++;
+  if (ok) return;
+  failures++;
+  printf("  FAIL line %d: %s\n", line, what);
+}
+
+#define CHECK(cond) check((cond), #cond, __LINE__)
+
+struct Case {
+  const char *name;
+  std::vector<uint8_t> bytes;
+  uint64_t requests;
+  uint64_t ignored;
+};
+
+const Case kCases[] = {
+  {"plain",       {0x5A, 0x5A, 0x00, 0x00, 0x00, 0x00}, 1, 0},
+  {"back2back",   {0x5A, 0x5A, 0x00, 0x00, 0x00, 0x00, 0x5A, 0x5A, 0x00, 0x00, 0x00, 0x00}, 2, 0},
+  {"extra5a",     {0x5A, 0x5A, 0x5A, 0x00, 0x00, 0x00, 0x00}, 1, 1},
+  {"run5a",       {0x5A, 0x00, 0x5A, 0x5A, 0x5A, 0x5A, 0x00, 0x00, 0x00, 0x00}, 1, 4},
+  {"restart",     {0x5A, 0x5A, 0x00, 0x5A, 0x5A, 0x00, 0x00, 0x00, 0x00}, 1, 3},
+  {"late",        {0x5A, 0x5A, 0x00, 0x00, 0x00, 0x5A, 0x5A, 0x00, 0x00, 0x00, 0x00}, 1, 5},
+  {"noise",       {0x00, 0xFF, 0x5A, 0x01, 0x5A, 0x5A, 0x00, 0x00, 0x00, 0x00}, 1, 4},
+};
+
+BmsStats feed(const std::vector<uint8_t> &bytes, size_t piece) {
+  BatteryPack pack;
+  BmsEmulator bms(&pack);
+  for (size_t i = 0; i < bytes.size(); i += piece) {
+    bms.receive(&bytes[i], std::min(piece, bytes.size() - i), 1000);
+  }
+  return bms.stats();
+}
+
+} // namespace
+
+int main() {
+  for (const Case &c : kCases) {
+    const int before = failures;
+    for (size_t piece : {c.bytes.size(), (size_t)1}) {
+      const BmsStats s = feed(c.bytes, piece);
+      CHECK(s.requests == c.requests);
+      CHECK(s.ignored == c.ignored);
+    }
+    printf("%-10s %s\n", c.name, failures == before ? "ok" : "FAIL");
+  }
+  printf("%d checks, %d failed\n", checks, failures);
+  return failures ? 1 : 0;
+}
@@ -0,0 +1,146 @@
+// Decoder for the charge controller's event journal
+// (teensy/charge_controller/EventJournalFormat.h, EVTnnnnn.BIN on the card).
+//
+// Prints one line per event, seconds since boot, the event name and its
+// arguments in units; --csv prints the raw fields instead. Reading stops at
+// the first empty record or seq break, as EventJournalFormat.h describes.
+//
+//   evtlog FILE [FILE...] [--csv]
+
+#include <cstdio>
+#include <cstring>
+#include "EventJournalFormat.h"
+
+using namespace evtlog;
+
+namespace {
+
+// Same order as ChargerControlState in charge_controller.ino
+const char *const kStateNames[] = {
+  "WAIT_FOR_CHARGER_HEARTBEAT", "SEND_INITIAL_HEARTBEAT", "SEND_NMT_START",
+  "SEND_RPDO1_NOT_READY", "RUN_CHARGING", "STOPPING", "FAULTED",
+};
+
+const char *stateName(int32_t s) {
+  return s >= 0 && s < (int32_t)(sizeof(kStateNames) / sizeof(kStateNames[0])) ? kStateNames[s] : "?";
+}
+
+void describe(const EventRecord &r, const char *tag, char *out, size_t cap) {
+  const int32_t *a = r.arg;
+  switch ((EventId)r.id) {
+    case EventId::Boot:
+      snprintf(out, cap, "CAN1 %ld bps, CAN2 %ld bps", (long)a[0], (long)a[1]);
+      break;
+    case EventId::StateChange:
+      snprintf(out, cap, "%s -> %s (%s)", stateName(a[0]), stateName(a[1]), tag);
+      break;
+    case EventId::ChargerHeartbeat:
+    case EventId::NmtStartSent:
+      snprintf(out, cap, "node 0x%02lX", (unsigned long)a[0]);
+      break;
+    case EventId::SafeStopSent:
+      snprintf(out, cap, "%.3f V, 0 A", a[0] / 1000.0);
+      break;
+    case EventId::ChargerFault:
+      snprintf(out, cap, "charger at %.3f V %.3f A", a[0] / 1000.0, a[1] / 1000.0);
+      break;
+    case EventId::HeartbeatLost:
+      snprintf(out, cap, "last heartbeat %ld ms ago", (long)a[0]);
+      break;
+    case EventId::BmsStop:
+      snprintf(out, cap, "%s: pack %.3f V, cell %ld at %.3f V", tag, a[0] / 1000.0, (long)a[2], a[1] / 1000.0);
+      break;
+    case EventId::BmsOverflow:
+      snprintf(out, cap, "%ld bytes discarded", (long)a[0]);
+      break;
+    case EventId::ChargerEmcy: {
+      const uint32_t lo = (uint32_t)a[0], hi = (uint32_t)a[1];
+      snprintf(out, cap, "%02X %02X %02X %02X %02X %02X %02X %02X", lo & 0xFF, (lo >> 8) & 0xFF,
+               (lo >> 16) & 0xFF, lo >> 24, hi & 0xFF, (hi >> 8) & 0xFF, (hi >> 16) & 0xFF, hi >> 24);
+      break;
+    }
+    case EventId::LimitsExceeded:
+      snprintf(out, cap, "target %.3f V %.3f A", a[0] / 1000.0, a[1] / 1000.0);
+      break;
+    case EventId::LogDropped:
+      snprintf(out, cap, "%ld records", (long)a[0]);
+      break;
+    case EventId::BlackBoxCapture:
+      snprintf(out, cap, "capture %ld (%s), %ld records", (long)a[1], tag, (long)a[0]);
+      break;
+    default:
+      snprintf(out, cap, "%ld %ld %ld %ld %s", (long)a[0], (long)a[1], (long)a[2], (long)a[3], tag);
+      break;
+  }
+}
+
+bool dump(const char *path, bool csv) {
+  FILE *in = fopen(path, "rb");
+  if (!in) {
+    fprintf(stderr, "evtlog: cannot open %s\n", path);
+    return false;
+  }
+
+  JournalHeader hdr;
+  if (fread(&hdr, sizeof(hdr), 1, in) != 1 || memcmp(hdr.magic, JOURNAL_MAGIC, sizeof(hdr.magic)) != 0) {
+    fprintf(stderr, "evtlog: %s: not an event journal\n", path);
+    fclose(in);
+    return false;
+  }
+  if (hdr.version != JOURNAL_VERSION || hdr.record_size != sizeof(EventRecord)) {
+    fprintf(stderr, "evtlog: %s: unsupported version %u\n", path, hdr.version);
+    fclose(in);
+    return false;
+  }
+
+  if (!csv) printf("# %s: EVT%05lu, opened at %.3f s\n", path, (unsigned long)hdr.file_index, hdr.start_ms / 1000.0);
+
+  EventRecord r;
+  uint32_t count = 0;
+  uint16_t expect = 0;
+  char tag[sizeof(r.tag) + 1];
+  char text[160];
+  while (fread(&r, sizeof(r), 1, in) == 1 && r.id != (uint16_t)EventId::None) {
+    if (count > 0 && r.seq != expect) break;
+    expect = (uint16_t)(r.seq + 1);
+    count++;
+
+    memset(tag, 0, sizeof(tag));
+    memcpy(tag, r.tag, sizeof(r.tag));
+    if (csv) {
+      printf("%lu,%u,%s,%ld,%ld,%ld,%ld,%s\n", (unsigned long)r.t_ms, r.seq, eventName(r.id), (long)r.arg[0],
+             (long)r.arg[1], (long)r.arg[2], (long)r.arg[3], tag);
+    } else {
+      describe(r, tag, text, sizeof(text));
+      printf("%12.3f  %-14s %s\n", r.t_ms / 1000.0, eventName(r.id), text);
+    }
+  }
+  fclose(in);
+
+  fprintf(stderr, "evtlog: %s: %u events\n", path, count);
+  return true;
+}
+
+void usage() {
+  fprintf(stderr, "usage: evtlog FILE [FILE...] [--csv]\n");
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+  bool csv = false;
+  int files = 0;
+  for (int i = 1; i < argc; i++) {
+    if (!strcmp(argv[i], "--csv")) csv = true;
+    else if (argv[i][0] == '-') { usage(); return 2; }
+    else files++;
+  }
+  if (files == 0) { usage(); return 2; }
+
+  if (csv) printf("t_ms,seq,event,arg0,arg1,arg2,arg3,tag\n");
+  bool ok = true;
+  for (int i = 1; i < argc; i++) {
+    if (argv[i][0] != '-') ok = dump(argv[i], csv) && ok;
+  }
+  return ok ? 0 : 1;
+}
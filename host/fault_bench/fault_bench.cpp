@@ -0,0 +1,231 @@
+// Fault-to-safe-stop latency of the charge controller firmware, measured on
+// the emulated charger and BMS (emu/) on the sim kernel.
+//
+// Each trial starts a fresh firmware (one forked child per trial, so no
+// state leaks between them), charges until a random moment between 5 and 7
+// s, injects one fault and records two latencies from that moment:
+//
+//   detect  the firmware enters STOPPING
+//   stop    the first zero-current RPDO1 (0x20A) leaves on CAN1
+//
+// Fault classes: hw (the charger's TPDO1 hardware shutdown bit), bmsov (the
+// BMS starts reporting a cell at 4.30 V) and hblost (the charger goes
+// silent). The random onset puts each fault at every phase of the charger's
+// TPDO, the BMS poll and the heartbeat. Latencies are in virtual time, so
+// they come from the protocol periods and the loop's scheduling; --tick-us
+// sets the loop pass granularity.
+//
+// Prints p50/p99/max per class and exits 1 if any max is over its budget
+// (defaults: hw 250 ms, bmsov 1100 ms, hblost 3100 ms for both; override
+// with --budget CLASS:DETECT_MS[:STOP_MS]) or a trial never stopped.
+//
+//   fault_bench [--trials N] [--class hw|bmsov|hblost]... [--budget CLASS:MS[:MS]]...
+//               [--seed N] [--tick-us N] [--csv FILE]
+
+#include <sys/wait.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+#include <Arduino.h>
+#include <FlexCAN_T4.h>
+#include "BatteryPack.h"
+#include "BmsEmulator.h"
+#include "DeltaQCharger.h"
+#include "ReplayTap.h"
+#include "SimAttach.h"
+#include "SimKernel.h"
+
+void setup();
+void loop();
+
+using namespace emu;
+
+namespace {
+
+struct FaultClass {
+  const char *name;
+  double detect_budget_ms;
+  double stop_budget_ms;
+};
+
+FaultClass classes[] = {
+  {"hw",     250,  250},
+  {"bmsov",  1100, 1100},
+  {"hblost", 3100, 3100},
+};
+
+constexpr uint64_t TRIAL_TIMEOUT_US = 10000000;   // after the fault
+
+struct TrialResult {
+  int64_t detect_us = -1;   // -1: did not happen
+  int64_t stop_us = -1;
+};
+
+// Runs in the forked child: one fresh firmware, one fault at onset_us
+TrialResult runTrial(const char *fault, uint64_t onset_us, uint64_t tick_us) {
+  TrialResult res;
+  replayTimeline.out = nullptr;
+  arduinoSetNowUs(0);
+  setup();
+
+  sim::KernelConfig kc;
+  kc.tickUs = tick_us;
+  sim::Kernel kernel(loop, kc);
+  BatteryPack pack;
+  DeltaQCharger charger(&pack);
+  BmsEmulator bms(&pack);
+
+  bool injected = false;
+  replayTimeline.onState = [&](uint8_t, uint8_t to, const char *) {
+    if (injected && res.detect_us < 0 && !strcmp(replayStateName(to), "STOPPING"))
+      res.detect_us = (int64_t)(arduinoNowUs() - onset_us);
+  };
+  flexcanBus(CAN1)->onWrite = [&](const CAN_message_t &msg) {
+    if (injected && res.stop_us < 0 && msg.id == 0x20A && msg.len == 8 && msg.buf[5] == 0 && msg.buf[6] == 0)
+      res.stop_us = (int64_t)(arduinoNowUs() - onset_us);
+  };
+  SimAttachment canLink(kernel, *flexcanBus(CAN1), charger);
+  SerialAttachment bmsLink(kernel, Serial1, bms);
+
+  kernel.at(onset_us, [&]() {
+    injected = true;
+    if (!strcmp(fault, "hw")) charger.inject(ChargerFault::HwShutdown, kernel.now());
+    else if (!strcmp(fault, "hblost")) charger.inject(ChargerFault::Silent, kernel.now());
+    else if (!strcmp(fault, "bmsov")) {
+      int high = 0;
+      for (int i = 1; i < pack.config().cells; i++)
+        if (bms.cellVoltage(i) > bms.cellVoltage(high)) high = i;
+      bms.setCellBias(high, 4.30f - bms.cellVoltage(high));
+    }
+    canLink.poke();
+    bmsLink.poke();
+  });
+
+  // Stop as soon as both are in rather than running out the timeout
+  const uint64_t end = onset_us + TRIAL_TIMEOUT_US;
+  while (kernel.now() < end && (res.detect_us < 0 || res.stop_us < 0))
+    kernel.runUntil(std::min(end, kernel.now() + 100000));
+  return res;
+}
+
+TrialResult forkTrial(const char *fault, uint64_t onset_us, uint64_t tick_us) {
+  int fds[2];
+  TrialResult res;
+  if (pipe(fds) < 0) return res;
+  fflush(stdout);
+  pid_t pid = fork();
+  if (pid == 0) {
+    close(fds[0]);
+    res = runTrial(fault, onset_us, tick_us);
+    ssize_t w = write(fds[1], &res, sizeof(res));
+    _exit(w == (ssize_t)sizeof(res) ? 0 : 1);
+  }
+  close(fds[1]);
+  if (pid < 0 || read(fds[0], &res, sizeof(res)) != (ssize_t)sizeof(res)) res = TrialResult();
+  close(fds[0]);
+  if (pid > 0) waitpid(pid, nullptr, 0);
+  return res;
+}
+
+double percentile(std::vector<int64_t> v, double p) {
+  if (v.empty()) return NAN;
+  std::sort(v.begin(), v.end());
+  const size_t i = (size_t)std::min<double>(v.size() - 1, ceil(p * v.size()) - 1);
+  return v[i] / 1000.0;
+}
+
+FaultClass *findClass(const char *name) {
+  for (FaultClass &c : classes)
+    if (!strcmp(c.name, name)) return &c;
+  return nullptr;
+}
+
+void usage() {
+  fprintf(stderr,
+          "usage: fault_bench [--trials N] [--class hw|bmsov|hblost]... [--budget CLASS:MS[:MS]]...\n"
+          "                   [--seed N] [--tick-us N] [--csv FILE]\n");
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+  int trials = 200;
+  uint32_t seed = 1;
+  uint64_t tickUs = 1000;
+  std::string csvPath;
+  std::vector<FaultClass *> selected;
+
+  for (int i = 1; i < argc; i++) {
+    auto next = [&]() -> const char * {
+      if (i + 1 >= argc) { usage(); exit(2); }
+      return argv[++i];
+    };
+    if (!strcmp(argv[i], "--trials")) trials = atoi(next());
+    else if (!strcmp(argv[i], "--seed")) seed = (uint32_t)strtoul(next(), nullptr, 10);
+    else if (!strcmp(argv[i], "--tick-us")) tickUs = strtoull(next(), nullptr, 10);
+    else if (!strcmp(argv[i], "--csv")) csvPath = next();
+    else if (!strcmp(argv[i], "--class")) {
+      FaultClass *c = findClass(next());
+      if (!c) { usage(); return 2; }
+      selected.push_back(c);
+    }
+    else if (!strcmp(argv[i], "--budget")) {
+      char name[16];
+      double detect = 0, stop = -1;
+      FaultClass *c;
+      if (sscanf(next(), "%15[a-z]:%lf:%lf", name, &detect, &stop) < 2 || !(c = findClass(name))) {
+        usage();
+        return 2;
+      }
+      c->detect_budget_ms = detect;
+      c->stop_budget_ms = stop >= 0 ? stop : detect;
+    }
+    else { usage(); return 2; }
+  }
+  if (trials < 1 || tickUs == 0) { usage(); return 2; }
+  if (selected.empty())
+    for (FaultClass &c : classes) selected.push_back(&c);
+
+  FILE *csv = nullptr;
+  if (!csvPath.empty()) {
+    if (!(csv = fopen(csvPath.c_str(), "w"))) {
+      fprintf(stderr, "fault_bench: cannot create %s\n", csvPath.c_str());
+      return 1;
+    }
+    fprintf(csv, "class,trial,onset_us,detect_us,stop_us\n");
+  }
+
+  printf("%-7s %6s  %27s  %27s\n", "", "", "detect ms (p50/p99/max)", "stop frame ms (p50/p99/max)");
+  bool pass = true;
+  std::mt19937 rng(seed);
+  for (FaultClass *c : selected) {
+    std::vector<int64_t> detect, stop;
+    int missed = 0;
+    for (int t = 0; t < trials; t++) {
+      const uint64_t onset = 5000000 + std::uniform_int_distribution<uint64_t>(0, 2000000)(rng);
+      const TrialResult r = forkTrial(c->name, onset, tickUs);
+      if (r.detect_us < 0 || r.stop_us < 0) missed++;
+      if (r.detect_us >= 0) detect.push_back(r.detect_us);
+      if (r.stop_us >= 0) stop.push_back(r.stop_us);
+      if (csv) fprintf(csv, "%s,%d,%llu,%lld,%lld\n", c->name, t, (unsigned long long)onset,
+                       (long long)r.detect_us, (long long)r.stop_us);
+    }
+
+    const double detectMax = percentile(detect, 1.0), stopMax = percentile(stop, 1.0);
+    const bool ok = missed == 0 && detectMax <= c->detect_budget_ms && stopMax <= c->stop_budget_ms;
+    pass = pass && ok;
+    printf("%-7s %6d  %8.1f %8.1f %9.1f  %8.1f %8.1f %9.1f  %s (budget %.0f/%.0f ms)%s\n", c->name, trials,
+           percentile(detect, 0.5), percentile(detect, 0.99), detectMax, percentile(stop, 0.5),
+           percentile(stop, 0.99), stopMax, ok ? "ok  " : "FAIL", c->detect_budget_ms, c->stop_budget_ms,
+           missed ? (" " + std::to_string(missed) + " trials never stopped").c_str() : "");
+    fflush(stdout);
+  }
+  if (csv) fclose(csv);
+  return pass ? 0 : 1;
+}
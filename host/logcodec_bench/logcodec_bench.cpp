@@ -0,0 +1,260 @@
+// Compression ratio and speed of the on-device log codec
+// (teensy/charge_controller/CanLogCodec.h).
+//
+// Without a file, synthesizes --seconds of traffic. --load bike (default) is
+// the controller's: charger PDOs and heartbeats on CAN1, the two Kelly
+// broadcasts on CAN2 at 50 ms, and the BMS reply every second, with timing
+// jitter and slowly moving signals. --load full is both buses saturated
+// (~6.7k frames/s) by 300 ids with random dlcs, payloads mixing counters and
+// noise, and the odd long gap, to reach every prefix class, overflow the key
+// dictionary and cross many block boundaries. With a log (any format cblog
+// reads), encodes its frames instead.
+//
+// Every run decodes the blocks again and checks the records are
+// byte-identical to the input; the first also decodes a snapshot of the open
+// block every 97 records. Exits 1 on any difference.
+//
+//   logcodec_bench [--seconds N] [--runs N] [--load bike|full] [LOG]
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+#include "CanLogCodec.h"
+#include "ChunkedLog.h"
+#include "DeviceLog.h"
+#include "TextLog.h"
+
+using namespace canlog;
+
+namespace {
+
+bool loadLog(const std::string &path, Log &log, std::string &err) {
+  std::string ext = path.substr(path.rfind('.') == std::string::npos ? path.size() : path.rfind('.') + 1);
+  for (char &c : ext) c = (char)tolower((unsigned char)c);
+  if (ext == "trc") return readTrc(path, log, err);
+  if (ext == "csv") return readCsv(path, log, err);
+  if (ext == "cbl") return readCbl(path, log, err);
+  if (ext == "bin") return readDeviceLog(path, log, err);
+  err = "unknown log format: " + path;
+  return false;
+}
+
+std::vector<Record> synthesize(uint32_t seconds) {
+  struct Stream { uint8_t source; uint32_t id; uint8_t dlc; uint32_t period_us; uint32_t next_us; };
+  std::vector<Stream> streams = {
+    {(uint8_t)Source::CAN1_RX, 0x18A, 8, 200000, 1000},  {(uint8_t)Source::CAN1_RX, 0x28A, 8, 1000000, 2000},
+    {(uint8_t)Source::CAN1_RX, 0x38A, 8, 1000000, 3000}, {(uint8_t)Source::CAN1_RX, 0x70A, 1, 1000000, 4000},
+    {(uint8_t)Source::CAN1_TX, 0x20A, 8, 250000, 5000},  {(uint8_t)Source::CAN1_TX, 0x30A, 8, 250000, 6000},
+    {(uint8_t)Source::CAN1_TX, 0x701, 1, 100000, 7000},
+    {(uint8_t)Source::CAN2_RX, 0x0CF11E05 | ID_EXTENDED, 8, 50000, 8000},
+    {(uint8_t)Source::CAN2_RX, 0x0CF11F05 | ID_EXTENDED, 8, 50000, 9000},
+    {(uint8_t)Source::BMS_TX, 0, 6, 1000000, 10000},
+  };
+
+  std::vector<Record> out;
+  uint32_t rng = 12345;
+  auto jitter = [&]() { rng = rng * 1103515245 + 12345; return (rng >> 16) % 400; };
+  const uint64_t end = (uint64_t)seconds * 1000000;
+
+  for (;;) {
+    Stream *s = &*std::min_element(streams.begin(), streams.end(),
+                                   [](const Stream &a, const Stream &b) { return a.next_us < b.next_us; });
+    if (s->next_us >= end) break;
+    const uint32_t t = s->next_us;
+    const uint32_t n = t / s->period_us;
+
+    Record r = {};
+    r.t_us = t;
+    r.id = s->id;
+    r.source = s->source;
+    r.dlc = s->dlc;
+    // Slow signals: a voltage/current/temperature/rpm creeping with n
+    r.data[0] = (uint8_t)(n / 7);
+    r.data[1] = 0x0C;
+    r.data[2] = (uint8_t)(0x80 + (n / 31) % 4);
+    r.data[4] = (uint8_t)((n / 200) & 0xFF);
+    r.data[6] = s->id == 0x701 ? 0x05 : 0x00;
+    out.push_back(r);
+
+    if (s->source == (uint8_t)Source::BMS_TX) {
+      // The 121-byte reply follows ~20 ms later as 16 chunks
+      for (uint32_t off = 0; off < 121; off += 8) {
+        Record b = {};
+        b.t_us = t + 20000;
+        b.id = off;
+        b.source = (uint8_t)Source::BMS_RX;
+        b.dlc = (uint8_t)std::min<uint32_t>(8, 121 - off);
+        for (int i = 0; i < b.dlc; i++) b.data[i] = (uint8_t)(off + i < 8 ? 0x4E + i : (off * 3 + i + n / 10));
+        out.push_back(b);
+      }
+    }
+    s->next_us += s->period_us + jitter() - 200;
+  }
+
+  std::stable_sort(out.begin(), out.end(), [](const Record &a, const Record &b) { return a.t_us < b.t_us; });
+  for (size_t i = 0; i < out.size(); i++) out[i].seq = (uint16_t)i;
+  return out;
+}
+
+std::vector<Record> synthesizeFullLoad(uint32_t seconds) {
+  std::vector<Record> out;
+  uint32_t rng = 777;
+  auto rand32 = [&]() { rng ^= rng << 13; rng ^= rng >> 17; rng ^= rng << 5; return rng; };
+  const uint64_t end = (uint64_t)seconds * 1000000;
+  uint64_t t = 0;
+  for (uint32_t n = 0; t < end; n++) {
+    const uint32_t key = rand32() % 300;
+    Record r = {};
+    r.t_us = (uint32_t)t;
+    r.source = (uint8_t)(key & 1 ? Source::CAN2_RX : Source::CAN1_RX);
+    r.id = key < 200 ? 0x100 + key : (0x18FF0000 + key) | ID_EXTENDED;
+    r.dlc = (uint8_t)(key % 9);
+    r.seq = (uint16_t)n;
+    switch (rand32() % 4) {
+      case 0: break;                                           // unchanged
+      case 1: r.data[2] = (uint8_t)(n >> 4); break;            // slow counter
+      case 2: r.data[7] = (uint8_t)rand32(); r.data[0] = (uint8_t)key; break;
+      default: for (uint8_t &b : r.data) b = (uint8_t)rand32(); break;
+    }
+    out.push_back(r);
+    // ~150 us apart, now and then a gap that needs the wide time classes
+    const uint32_t roll = rand32() % 20000;
+    t += roll == 0 ? 600000 + rand32() % 1000000 : roll < 4 ? 70000 + rand32() % 200000 : 100 + rand32() % 100;
+  }
+  return out;
+}
+
+// Decodes a snapshot of the open block every 97 records and compares it with
+// what went into the block so far
+bool checkSnapshots(const std::vector<Record> &records) {
+  std::vector<uint8_t> block(CODEC_BLOCK_BYTES), copy(CODEC_BLOCK_BYTES);
+  std::vector<Record> decoded(CODEC_MAX_BLOCK_RECORDS);
+  BlockEncoder encoder;
+  encoder.begin(block.data());
+  size_t first = 0;
+  for (size_t i = 0; i < records.size(); i++) {
+    if (!encoder.add(records[i])) {
+      encoder.begin(block.data());
+      first = i;
+      encoder.add(records[i]);
+    }
+    if (i % 97 != 0) continue;
+    const size_t used = encoder.snapshot();
+    copy.assign(block.begin(), block.begin() + used);
+    copy.resize(CODEC_BLOCK_BYTES, 0xA5);   // whatever the card held past the data
+    const int n = decodeBlock(copy.data(), decoded.data());
+    if (n != (int)(i + 1 - first) ||
+        memcmp(decoded.data(), &records[first], n * sizeof(Record)) != 0) {
+      return false;
+    }
+  }
+  return true;
+}
+
+void usage() {
+  fprintf(stderr, "usage: logcodec_bench [--seconds N] [--runs N] [--load bike|full] [LOG]\n");
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+  uint32_t seconds = 3600;
+  int runs = 5;
+  std::string path, load = "bike";
+
+  for (int i = 1; i < argc; i++) {
+    auto next = [&]() -> const char * {
+      if (i + 1 >= argc) { usage(); exit(2); }
+      return argv[++i];
+    };
+    if (!strcmp(argv[i], "--seconds")) seconds = (uint32_t)strtoul(next(), nullptr, 10);
+    else if (!strcmp(argv[i], "--runs")) runs = atoi(next());
+    else if (!strcmp(argv[i], "--load")) load = next();
+    else if (argv[i][0] == '-') { usage(); return 2; }
+    else path = argv[i];
+  }
+
+  std::vector<Record> records;
+  if (!path.empty()) {
+    Log log;
+    std::string err;
+    if (!loadLog(path, log, err)) {
+      fprintf(stderr, "logcodec_bench: %s\n", err.c_str());
+      return 1;
+    }
+    for (size_t i = 0; i < log.frames.size(); i++) {
+      const Frame &f = log.frames[i];
+      Record r = {};
+      r.t_us = (uint32_t)f.t_us;
+      r.id = f.id;
+      r.source = f.source;
+      r.dlc = f.dlc;
+      r.seq = (uint16_t)i;
+      memcpy(r.data, f.data, sizeof(r.data));
+      records.push_back(r);
+    }
+  } else if (load == "bike") {
+    records = synthesize(seconds);
+  } else if (load == "full") {
+    records = synthesizeFullLoad(seconds);
+  } else {
+    usage();
+    return 2;
+  }
+  if (records.empty()) {
+    fprintf(stderr, "logcodec_bench: no records\n");
+    return 1;
+  }
+
+  std::vector<uint8_t> blocks;
+  double bestEncode = 1e30, bestDecode = 1e30;
+  for (int run = 0; run < runs; run++) {
+    blocks.assign(CODEC_BLOCK_BYTES, 0);
+    BlockEncoder encoder;
+    auto t0 = std::chrono::steady_clock::now();
+    encoder.begin(blocks.data());
+    for (const Record &r : records) {
+      if (encoder.add(r)) continue;
+      encoder.finish();
+      blocks.resize(blocks.size() + CODEC_BLOCK_BYTES);
+      encoder.begin(&blocks[blocks.size() - CODEC_BLOCK_BYTES]);
+      encoder.add(r);
+    }
+    encoder.finish();
+    bestEncode = std::min(bestEncode, std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count());
+
+    std::vector<Record> decoded(CODEC_MAX_BLOCK_RECORDS);
+    size_t at = 0;
+    bool match = true;
+    t0 = std::chrono::steady_clock::now();
+    for (size_t off = 0; off < blocks.size(); off += CODEC_BLOCK_BYTES) {
+      int n = decodeBlock(&blocks[off], decoded.data());
+      if (n < 0 || at + n > records.size()) { match = false; break; }
+      match = match && !memcmp(&records[at], decoded.data(), n * sizeof(Record));
+      at += n;
+    }
+    bestDecode = std::min(bestDecode, std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count());
+    if (!match || at != records.size()) {
+      fprintf(stderr, "logcodec_bench: decoded blocks do not match the input\n");
+      return 1;
+    }
+  }
+  if (!checkSnapshots(records)) {
+    fprintf(stderr, "logcodec_bench: a snapshot of the open block does not match the input\n");
+    return 1;
+  }
+
+  const double raw = (double)records.size() * sizeof(Record);
+  printf("%s: %zu records, %.1f s\n", path.empty() ? "synthetic" : path.c_str(), records.size(),
+         (records.back().t_us - records.front().t_us) / 1e6);
+  printf("raw        %10.0f bytes  %5.2f B/record\n", raw, (double)sizeof(Record));
+  printf("compressed %10zu bytes  %5.2f B/record  %zu blocks  ratio %.1fx\n", blocks.size(),
+         (double)blocks.size() / records.size(), blocks.size() / CODEC_BLOCK_BYTES, raw / blocks.size());
+  printf("encode     %8.1f ns/record\n", bestEncode * 1e9 / records.size());
+  printf("decode     %8.1f ns/record\n", bestDecode * 1e9 / records.size());
+  return 0;
+}
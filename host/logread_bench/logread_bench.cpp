@@ -0,0 +1,126 @@
+// Throughput benchmark for the mmapped .trc/.csv scanner (canlog/MappedLog.h).
+//
+// Without a file, synthesizes a recording of --mb megabytes in memory in the
+// layout the python recorders write (charger PDOs, heartbeats and Kelly
+// extended frames) and parses it with 1..--threads threads. With --trc or
+// --csv, maps and parses that file instead (page cache warm after run 1).
+//
+//   logread_bench [--mb N] [--format trc|csv] [--threads N] [--runs N]
+//                 [--trc FILE | --csv FILE]
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+#include "MappedLog.h"
+#include "TextLog.h"
+
+using namespace canlog;
+
+namespace {
+
+std::string synthesize(TextFormat format, size_t bytes) {
+  struct Pattern { uint32_t id; bool ext; uint8_t dlc; uint32_t period_us; };
+  static const Pattern patterns[] = {
+    {0x18A, false, 8, 200000}, {0x28A, false, 8, 1000000}, {0x38A, false, 8, 1000000},
+    {0x20A, false, 8, 250000}, {0x30A, false, 8, 250000},  {0x701, false, 1, 100000},
+    {0x70A, false, 1, 1000000}, {0x0CF11E05, true, 8, 50000}, {0x0CF11F05, true, 8, 50000},
+  };
+
+  std::string out;
+  out.reserve(bytes + 256);
+  if (format == TextFormat::Trc) {
+    out += "; Version = 1.1\n; Creator = logread_bench\n; StartTime = 2025-09-05 00:31:51\n"
+           "; Columns = TimeOffset Channel ID Dir DLC Data\nBegin Triggerblock\n";
+  }
+
+  Frame f = {};
+  uint64_t t = 0;
+  uint32_t n = 0;
+  char line[160];
+  while (out.size() < bytes) {
+    const Pattern &p = patterns[n % (sizeof(patterns) / sizeof(patterns[0]))];
+    t += 5000 + (n * 7919) % 2000;
+    f.t_us = t;
+    f.id = p.id | (p.ext ? ID_EXTENDED : 0);
+    f.source = canSource(p.ext ? 2 : 1, false);
+    f.dlc = p.dlc;
+    for (int b = 0; b < 8; b++) f.data[b] = (uint8_t)(n * 31 + b * 17);
+
+    size_t len = (format == TextFormat::Trc) ? formatTrcLine(f, line, sizeof(line))
+                                             : formatCsvLine(f, 1756955646068614ULL, line, sizeof(line));
+    out.append(line, len);
+    out += '\n';
+    n++;
+  }
+  return out;
+}
+
+void usage() {
+  fprintf(stderr, "usage: logread_bench [--mb N] [--format trc|csv] [--threads N] [--runs N]\n"
+                  "                     [--trc FILE | --csv FILE]\n");
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+  size_t mb = 256;
+  unsigned maxThreads = std::thread::hardware_concurrency();
+  int runs = 3;
+  std::string path;
+  TextFormat format = TextFormat::Trc;
+
+  for (int i = 1; i < argc; i++) {
+    auto next = [&]() -> const char * {
+      if (i + 1 >= argc) { usage(); exit(2); }
+      return argv[++i];
+    };
+    if (!strcmp(argv[i], "--mb")) mb = strtoul(next(), nullptr, 10);
+    else if (!strcmp(argv[i], "--format")) format = strcmp(next(), "csv") ? TextFormat::Trc : TextFormat::Csv;
+    else if (!strcmp(argv[i], "--threads")) maxThreads = (unsigned)atoi(next());
+    else if (!strcmp(argv[i], "--runs")) runs = atoi(next());
+    else if (!strcmp(argv[i], "--trc")) { path = next(); format = TextFormat::Trc; }
+    else if (!strcmp(argv[i], "--csv")) { path = next(); format = TextFormat::Csv; }
+    else { usage(); return 2; }
+  }
+  if (maxThreads == 0) maxThreads = 1;
+
+  MappedFile file;
+  std::string synth;
+  const char *begin, *end;
+  std::string err;
+  if (!path.empty()) {
+    if (!file.open(path, err)) {
+      fprintf(stderr, "%s\n", err.c_str());
+      return 1;
+    }
+    begin = file.data();
+    end = begin + file.size();
+  } else {
+    synth = synthesize(format, mb << 20);
+    begin = synth.data();
+    end = begin + synth.size();
+  }
+
+  printf("%s: %.1f MB %s\n", path.empty() ? "synthetic" : path.c_str(), (end - begin) / 1048576.0,
+         format == TextFormat::Trc ? "trc" : "csv");
+  printf("%-8s %10s %12s %12s %8s\n", "threads", "frames", "MB/s", "Mframes/s", "bad");
+
+  for (unsigned t = 1; t <= maxThreads; t *= 2) {
+    double best = 1e30;
+    FrameColumns cols;
+    TextParseStats stats;
+    for (int r = 0; r < runs; r++) {
+      auto t0 = std::chrono::steady_clock::now();
+      parseTextColumns(begin, end, format, cols, stats, t);
+      double s = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+      if (s < best) best = s;
+    }
+    printf("%-8u %10zu %12.1f %12.2f %8llu\n", stats.threads, cols.size(), stats.bytes / 1048576.0 / best,
+           cols.size() / 1e6 / best, (unsigned long long)stats.bad_lines);
+    if (t * 2 > maxThreads && t != maxThreads) t = maxThreads / 2;   // always end on maxThreads
+  }
+  return 0;
+}
@@ -0,0 +1,418 @@
+// Performance regression suite for the firmware's decoders and parsers, fed
+// with recorded or modelled traffic rather than cc_bench's synthetic frames:
+//
+//   dbc            dbc::decode over the charger recording (--log, default
+//                  extra/can1_log.csv)
+//   mcdbc          mcdbc::decode over Kelly frames from the urban drive cycle
+//                  (emu/KellyController.h; there is no CAN2 recording)
+//   bms_decode     decodeBmsMessage over BMS replies through a charge
+//                  (emu/BmsEmulator.h)
+//   bms_stream     the same replies as a UART byte stream through
+//                  bmsRxAppend/bmsRxFrame/bmsRxConsume and the decoder, in
+//                  64-byte reads
+//   telem_encode   telemetryEncodeMain/Cells from those readings
+//   display_parse  the display's line handling (trim, stripLineChecksum,
+//                  parseData/parseCells) on the encoded lines
+//
+// Each case runs --runs times and keeps the best ns per op (a frame or a
+// line). A fixed calibration loop runs right before each of those runs, and
+// the case is also reported as "rel": the median over the runs of its ns per
+// op divided by the calibration loop's ns per iteration. Clock speed, turbo
+// and a loaded host scale both halves of a pair, so rel carries from one
+// run, and one machine, to the next where raw ns do not.
+//
+// --json writes the results; --baseline compares rel against a previous
+// --json file and exits 1 if a case is slower than its baseline by more
+// than the tolerance stored with it (--tolerance when the results are
+// written, default 0.25 = 25%). A different CPU family can still move rel a
+// little; regenerate the baseline if it does, not the tolerance.
+//
+//   perf_suite [--log FILE] [--runs N] [--scale N] [--case NAME]... [--json FILE]
+//              [--baseline FILE] [--tolerance F]
+//
+//   perf_suite --baseline host/perf_suite/baseline.json
+//   perf_suite --json host/perf_suite/baseline.json      (accept new numbers)
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <string>
+#include <vector>
+#include <Arduino.h>
+#include "BatteryPack.h"
+#include "BmsDecoder.h"
+#include "BmsEmulator.h"
+#include "DbcDecode.h"
+#include "KellyController.h"
+#include "MotorController_DbcDecode.h"
+#include "TelemetryEncode.h"
+#include "TelemetryParse.h"
+#include "TextLog.h"
+
+using namespace emu;
+
+namespace {
+
+struct Result {
+  std::string name;
+  double ns = 0;
+  double rel = 0;     // ns over the calibration loop's ns per iteration
+  uint64_t ops = 0;   // per run
+  double tolerance = 0;
+};
+
+struct Baseline {
+  double rel;
+  double tolerance;
+};
+
+template <typename Fn>
+double bestNsPerOp(int runs, uint64_t ops, Fn &&body) {
+  double best = 0;
+  for (int r = 0; r < runs; r++) {
+    auto t0 = std::chrono::steady_clock::now();
+    body();
+    double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - t0).count() / ops;
+    if (r == 0 || ns < best) best = ns;
+  }
+  return best;
+}
+
+volatile uint32_t sink;   // keeps decoded results observable
+
+// -------------------- Calibration --------------------
+// Table lookups, multiplies and data-dependent branches over a 4 KB table,
+// roughly the mix the decoders are made of
+constexpr uint32_t CALIBRATION_ITERS = 1u << 18;
+
+double calibrationNs() {
+  static uint32_t table[1024];
+  for (uint32_t i = 0; i < 1024; i++) table[i] = i * 2654435761u;
+  return bestNsPerOp(1, CALIBRATION_ITERS, [&] {
+    uint32_t x = 0x12345678, acc = 0;
+    for (uint32_t i = 0; i < CALIBRATION_ITERS; i++) {
+      x ^= x << 13;
+      x ^= x >> 17;
+      x ^= x << 5;
+      const uint32_t v = table[x & 1023];
+      acc += (v & 1) ? v * 3 : v >> 2;
+    }
+    sink = acc;
+  });
+}
+
+// -------------------- Inputs --------------------
+struct Inputs {
+  std::vector<canlog::Frame> charger;
+  std::vector<canlog::Frame> kelly;
+  std::vector<uint8_t> bmsStream;     // back-to-back 121-byte replies
+  std::vector<TelemetryReading> readings;
+  std::vector<std::vector<float>> cells;
+  std::vector<std::string> lines;     // as the display's UART sees them, up to '\n'
+};
+
+bool loadInputs(const std::string &logPath, Inputs &in, std::string &err) {
+  canlog::Log log;
+  if (!canlog::readCsv(logPath, log, err)) return false;
+  for (const canlog::Frame &f : log.frames)
+    if (canlog::isCanSource(f.source)) in.charger.push_back(f);
+  if (in.charger.empty()) {
+    err = logPath + ": no CAN frames";
+    return false;
+  }
+
+  // Two minutes of the urban cycle at the Kelly's default 20 Hz per message
+  KellyController kelly(DriveProfile::urban());
+  for (uint64_t t = 0; t < 120000000; t += 10000)
+    kelly.service(t, [&](const canlog::Frame &f) { in.kelly.push_back(f); });
+
+  // A 20 A charge from 60%, one reply a second for ten minutes
+  BatteryPackConfig pc;
+  pc.soc = 0.6f;
+  BatteryPack pack(pc);
+  BmsEmulator bms(&pack);
+  const DriveProfile drive = DriveProfile::urban();
+  uint8_t frame[BMS_REPLY_LEN];
+  for (int s = 0; s < 600; s++) {
+    pack.flow(20.0f, 1.0f);
+    bms.encode(frame);
+    in.bmsStream.insert(in.bmsStream.end(), frame, frame + BMS_REPLY_LEN);
+
+    const BmsData b = decodeBmsMessage(frame, BMS_REPLY_LEN);
+    const DrivePoint p = drive.at(s);
+    TelemetryReading r;
+    r.rpm = p.rpm;
+    r.voltage = p.voltage_V;
+    r.current = p.current_A;
+    r.power = r.voltage * r.current;
+    r.soc = b.soc_pct;
+    r.btemp = b.mos_temperature_C;
+    r.mtemp = p.motor_temp_C;
+    r.mph = p.rpm / 10.0f * 1.884f * 0.0372823f;   // the sketch's rpmToMph()
+    in.readings.push_back(r);
+    in.cells.push_back(b.cell_voltages);
+  }
+
+  char line[160];
+  for (size_t i = 0; i < in.readings.size(); i++) {
+    size_t n = telemetryEncodeMain(line, sizeof(line), in.readings[i]);
+    in.lines.emplace_back(line, n - 1);
+    n = telemetryEncodeCells(line, sizeof(line), in.cells[i].data(), in.cells[i].size());
+    in.lines.emplace_back(line, n - 1);
+  }
+  return true;
+}
+
+// -------------------- Cases --------------------
+// Each returns ns per op; ops is set to the ops in one run
+using CaseFn = double (*)(const Inputs &, int runs, int scale, uint64_t &ops);
+
+double caseDbc(const Inputs &in, int runs, int scale, uint64_t &ops) {
+  const int reps = 500 * scale;
+  ops = (uint64_t)reps * in.charger.size();
+  return bestNsPerOp(runs, ops, [&] {
+    uint32_t acc = 0;
+    dbc::AnyMessage m;
+    for (int r = 0; r < reps; r++)
+      for (const canlog::Frame &f : in.charger)
+        if (dbc::decode(f.id & ~canlog::ID_EXTENDED, f.data, f.dlc, m)) acc += (uint32_t)m.type;
+    sink = acc;
+  });
+}
+
+double caseMcdbc(const Inputs &in, int runs, int scale, uint64_t &ops) {
+  const int reps = 125 * scale;
+  ops = (uint64_t)reps * in.kelly.size();
+  return bestNsPerOp(runs, ops, [&] {
+    uint32_t acc = 0;
+    mcdbc::AnyMessage m;
+    for (int r = 0; r < reps; r++)
+      for (const canlog::Frame &f : in.kelly)
+        if (mcdbc::decode(f.id & ~canlog::ID_EXTENDED, f.data, f.dlc, m)) acc += (uint32_t)m.type;
+    sink = acc;
+  });
+}
+
+double caseBmsDecode(const Inputs &in, int runs, int scale, uint64_t &ops) {
+  const int reps = 25 * scale;
+  const size_t frames = in.bmsStream.size() / BMS_FRAME_LEN;
+  ops = (uint64_t)reps * frames;
+  return bestNsPerOp(runs, ops, [&] {
+    uint32_t acc = 0;
+    for (int r = 0; r < reps; r++)
+      for (size_t i = 0; i < frames; i++) {
+        BmsData b = decodeBmsMessage(&in.bmsStream[i * BMS_FRAME_LEN], BMS_FRAME_LEN);
+        acc += b.soc_pct + b.high_cell_num;
+      }
+    sink = acc;
+  });
+}
+
+double caseBmsStream(const Inputs &in, int runs, int scale, uint64_t &ops) {
+  const int reps = 25 * scale;
+  ops = (uint64_t)reps * (in.bmsStream.size() / BMS_FRAME_LEN);
+  return bestNsPerOp(runs, ops, [&] {
+    uint32_t acc = 0;
+    BmsRxBuffer rx;
+    for (int r = 0; r < reps; r++)
+      for (size_t i = 0; i < in.bmsStream.size(); i += 64) {
+        const size_t end = std::min(in.bmsStream.size(), i + 64);
+        for (size_t j = i; j < end; j++) bmsRxAppend(rx, in.bmsStream[j]);
+        while (const uint8_t *frame = bmsRxFrame(rx)) {
+          BmsData b = decodeBmsMessage(frame, BMS_FRAME_LEN);
+          acc += b.soc_pct;
+          bmsRxConsume(rx);
+        }
+      }
+    sink = acc;
+  });
+}
+
+double caseTelemEncode(const Inputs &in, int runs, int scale, uint64_t &ops) {
+  const int reps = 50 * scale;
+  ops = (uint64_t)reps * in.readings.size() * 2;
+  return bestNsPerOp(runs, ops, [&] {
+    uint32_t acc = 0;
+    char line[160];
+    for (int r = 0; r < reps; r++)
+      for (size_t i = 0; i < in.readings.size(); i++) {
+        acc += (uint32_t)telemetryEncodeMain(line, sizeof(line), in.readings[i]);
+        acc += (uint32_t)telemetryEncodeCells(line, sizeof(line), in.cells[i].data(), in.cells[i].size());
+      }
+    sink = acc;
+  });
+}
+
+// What display.ino's handleLine() does before drawing
+double caseDisplayParse(const Inputs &in, int runs, int scale, uint64_t &ops) {
+  const int reps = 25 * scale;
+  ops = (uint64_t)reps * in.lines.size();
+  return bestNsPerOp(runs, ops, [&] {
+    uint32_t acc = 0;
+    for (int r = 0; r < reps; r++)
+      for (const std::string &l : in.lines) {
+        String line(l);
+        line.trim();
+        if (!stripLineChecksum(line)) continue;
+        acc += line.startsWith("C,") ? parseCells(line) : parseData(line);
+      }
+    sink = acc;
+  });
+}
+
+struct Case {
+  const char *name;
+  CaseFn fn;
+};
+
+const Case kCases[] = {
+  {"dbc",           caseDbc},
+  {"mcdbc",         caseMcdbc},
+  {"bms_decode",    caseBmsDecode},
+  {"bms_stream",    caseBmsStream},
+  {"telem_encode",  caseTelemEncode},
+  {"display_parse", caseDisplayParse},
+};
+
+// -------------------- Results files --------------------
+// One case per line, so the reader below can stay a line scanner:
+//   "dbc": {"ns_per_op": 12.345, "rel": 3.456, "ops": 2774000, "tolerance": 0.25},
+bool writeJson(const std::string &path, const std::vector<Result> &results) {
+  FILE *f = fopen(path.c_str(), "w");
+  if (!f) return false;
+  fprintf(f, "{\n  \"suite\": \"perf_suite\",\n  \"cases\": {\n");
+  for (size_t i = 0; i < results.size(); i++) {
+    const Result &r = results[i];
+    fprintf(f, "    \"%s\": {\"ns_per_op\": %.3f, \"rel\": %.4f, \"ops\": %llu, \"tolerance\": %.2f}%s\n",
+            r.name.c_str(), r.ns, r.rel, (unsigned long long)r.ops, r.tolerance, i + 1 < results.size() ? "," : "");
+  }
+  fprintf(f, "  }\n}\n");
+  return fclose(f) == 0;
+}
+
+bool readBaseline(const std::string &path, std::map<std::string, Baseline> &out, std::string &err) {
+  FILE *f = fopen(path.c_str(), "r");
+  if (!f) {
+    err = "cannot open " + path;
+    return false;
+  }
+  char line[512];
+  while (fgets(line, sizeof(line), f)) {
+    char name[64];
+    const char *rel = strstr(line, "\"rel\":");
+    const char *tol = strstr(line, "\"tolerance\":");
+    if (sscanf(line, " \"%63[^\"]\": {", name) != 1 || !strstr(line, "\"ns_per_op\":")) continue;
+    if (!rel) {
+      err = path + ": " + name + " has no \"rel\", regenerate it with --json";
+      fclose(f);
+      return false;
+    }
+    Baseline b;
+    b.rel = atof(rel + 6);
+    b.tolerance = tol ? atof(tol + 12) : 0.25;
+    out[name] = b;
+  }
+  fclose(f);
+  if (out.empty()) {
+    err = path + ": no cases";
+    return false;
+  }
+  return true;
+}
+
+void usage() {
+  fprintf(stderr,
+          "usage: perf_suite [--log FILE] [--runs N] [--scale N] [--case NAME]... [--json FILE]\n"
+          "                  [--baseline FILE] [--tolerance F]\n");
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+  std::string logPath = PERF_SUITE_DEFAULT_LOG, jsonPath, baselinePath;
+  int runs = 20, scale = 1;
+  double tolerance = 0.25;
+  std::vector<std::string> only;
+
+  for (int i = 1; i < argc; i++) {
+    auto next = [&]() -> const char * {
+      if (i + 1 >= argc) { usage(); exit(2); }
+      return argv[++i];
+    };
+    if (!strcmp(argv[i], "--log")) logPath = next();
+    else if (!strcmp(argv[i], "--runs")) runs = atoi(next());
+    else if (!strcmp(argv[i], "--scale")) scale = atoi(next());
+    else if (!strcmp(argv[i], "--case")) only.push_back(next());
+    else if (!strcmp(argv[i], "--json")) jsonPath = next();
+    else if (!strcmp(argv[i], "--baseline")) baselinePath = next();
+    else if (!strcmp(argv[i], "--tolerance")) tolerance = atof(next());
+    else { usage(); return 2; }
+  }
+  if (runs < 1 || scale < 1 || tolerance < 0) { usage(); return 2; }
+  for (const std::string &name : only) {
+    bool known = false;
+    for (const Case &c : kCases) known = known || name == c.name;
+    if (!known) { usage(); return 2; }
+  }
+
+  std::string err;
+  std::map<std::string, Baseline> baseline;
+  if (!baselinePath.empty() && !readBaseline(baselinePath, baseline, err)) {
+    fprintf(stderr, "perf_suite: %s\n", err.c_str());
+    return 1;
+  }
+
+  Inputs in;
+  if (!loadInputs(logPath, in, err)) {
+    fprintf(stderr, "perf_suite: %s\n", err.c_str());
+    return 1;
+  }
+
+  bool pass = true;
+  std::vector<Result> results;
+  printf("%-14s %10s %8s %12s %10s %8s\n", "case", "ns/op", "rel", "ops/run", "baseline", "change");
+  for (const Case &c : kCases) {
+    if (!only.empty()) {
+      bool selected = false;
+      for (const std::string &name : only) selected = selected || name == c.name;
+      if (!selected) continue;
+    }
+    Result r;
+    r.name = c.name;
+    std::vector<double> rel;
+    for (int k = 0; k < runs; k++) {
+      const double cal = calibrationNs();
+      const double ns = c.fn(in, 1, scale, r.ops);
+      r.ns = (k == 0) ? ns : std::min(r.ns, ns);
+      rel.push_back(ns / cal);
+    }
+    std::nth_element(rel.begin(), rel.begin() + rel.size() / 2, rel.end());
+    r.rel = rel[rel.size() / 2];
+    r.tolerance = tolerance;
+
+    auto b = baseline.find(c.name);
+    if (b == baseline.end()) {
+      printf("%-14s %10.2f %8.3f %12llu %10s\n", c.name, r.ns, r.rel, (unsigned long long)r.ops,
+             baselinePath.empty() ? "" : "none");
+    } else {
+      const double change = r.rel / b->second.rel - 1.0;
+      const bool ok = change <= b->second.tolerance;
+      pass = pass && ok;
+      r.tolerance = b->second.tolerance;
+      printf("%-14s %10.2f %8.3f %12llu %10.3f %+7.1f%%  %s\n", c.name, r.ns, r.rel, (unsigned long long)r.ops,
+             b->second.rel, change * 100.0, ok ? "ok" : "SLOWER");
+    }
+    fflush(stdout);
+    results.push_back(r);
+  }
+
+  if (!jsonPath.empty() && !writeJson(jsonPath, results)) {
+    fprintf(stderr, "perf_suite: cannot write %s\n", jsonPath.c_str());
+    return 1;
+  }
+  if (!pass) fprintf(stderr, "perf_suite: slower than the baseline beyond its tolerance\n");
+  return pass ? 0 : 1;
+}
@@ -0,0 +1,104 @@
+#include "ReplayTap.h"
+#include "BlackBox.h"
+#include "CanLogger.h"
+
+ReplayTimeline replayTimeline;
+
+namespace {
+
+CanLogStats stats;
+
+// Same order as ChargerControlState in charge_controller.ino
+const char *const kStateNames[] = {
+  "WAIT_FOR_CHARGER_HEARTBEAT", "SEND_INITIAL_HEARTBEAT", "SEND_NMT_START",
+  "SEND_RPDO1_NOT_READY", "RUN_CHARGING", "STOPPING", "FAULTED",
+};
+
+void push(canlog::Record &r) {
+  r.t_us = micros();
+  blackBoxPush(r);
+  stats.records++;
+}
+
+size_t hexBytes(char *out, size_t cap, const uint8_t *data, size_t n) {
+  size_t len = 0;
+  for (size_t i = 0; i < n && len < cap; i++) len += snprintf(out + len, cap - len, i ? " %02X" : "%02X", data[i]);
+  return len;
+}
+
+} // namespace
+
+const char *replayStateName(uint8_t s) {
+  return s < sizeof(kStateNames) / sizeof(kStateNames[0]) ? kStateNames[s] : "?";
+}
+
+void replayTimelineLine(const char *kind, const char *text) {
+  if (!replayTimeline.out) return;
+  const uint64_t now = arduinoNowUs();
+  fprintf(replayTimeline.out, "%6llu.%06u %-6s %s\n", (unsigned long long)(now / 1000000ULL),
+          (unsigned)(now % 1000000ULL), kind, text);
+}
+
+bool canLogBegin(uint32_t, uint32_t) {
+  stats.active = true;
+  return true;
+}
+
+void canLogFrame(canlog::Source src, const CAN_message_t &msg) {
+  canlog::Record r = {};
+  r.id = msg.id | (msg.flags.extended ? canlog::ID_EXTENDED : 0);
+  r.source = (uint8_t)src;
+  r.dlc = msg.len > 8 ? 8 : msg.len;
+  memcpy(r.data, msg.buf, 8);
+  push(r);
+
+  if (src != canlog::Source::CAN1_TX && src != canlog::Source::CAN2_TX && src != canlog::Source::CAN3_TX) return;
+  replayTimeline.tx++;
+  if (!replayTimeline.frames) return;
+  char text[80];
+  int ch = ((int)src + 1) / 2;
+  size_t n = snprintf(text, sizeof(text), msg.flags.extended ? "can%d %08X %u  " : "can%d %03X %u  ",
+                      ch, (unsigned)msg.id, (unsigned)r.dlc);
+  hexBytes(text + n, sizeof(text) - n, msg.buf, r.dlc);
+  replayTimelineLine("tx", text);
+}
+
+void canLogBytes(canlog::Source src, const uint8_t *data, size_t len) {
+  for (size_t off = 0; off < len; off += 8) {
+    canlog::Record r = {};
+    r.id = off;
+    r.source = (uint8_t)src;
+    r.dlc = (len - off < 8) ? (uint8_t)(len - off) : 8;
+    memcpy(r.data, data + off, r.dlc);
+    push(r);
+  }
+
+  if (src != canlog::Source::BMS_TX) return;
+  replayTimeline.bms_tx++;
+  if (!replayTimeline.frames) return;
+  char text[80];
+  hexBytes(text, sizeof(text), data, len);
+  replayTimelineLine("bms_tx", text);
+}
+
+void canLogState(uint8_t from, uint8_t to, const char *reason) {
+  canlog::Record r = {};
+  r.source = (uint8_t)canlog::Source::STATE;
+  r.dlc = 8;
+  r.data[0] = from;
+  r.data[1] = to;
+  memcpy(&r.data[2], reason, strnlen(reason, 6));   // zero padded, not terminated
+  push(r);
+
+  replayTimeline.states++;
+  replayTimeline.state = to;
+  char text[96];
+  snprintf(text, sizeof(text), "%s -> %s (%s)", replayStateName(from), replayStateName(to), reason);
+  replayTimelineLine("state", text);
+  if (replayTimeline.onState) replayTimeline.onState(from, to, reason);
+}
+
+void canLogService() {}
+void canLogEnd() { stats.active = false; }
+const CanLogStats &canLogStats() { return stats; }
+SdFs *canLogCard() { return nullptr; }
@@ -0,0 +1,32 @@
+#pragma once
+// Replay build of the CanLogger.h API. Instead of writing to an SD card it
+// turns what the firmware logs into timeline lines:
+//
+//   <t_s> tx     can1 20A 8  00 4C 01 00 52 A0 00 01
+//   <t_s> bms_tx 5A 5A 00 00 00 00
+//   <t_s> state  SEND_RPDO1_NOT_READY -> RUN_CHARGING (RPDO1)
+//
+// Every record is still offered to the black box, as the real logger does.
+
+#include <stdint.h>
+#include <stdio.h>
+#include <functional>
+
+struct ReplayTimeline {
+  FILE *out = nullptr;        // nullptr = count only
+  bool frames = true;         // false: state lines only, frames just counted
+  uint8_t state = 0;          // ChargerControlState last entered
+  uint64_t tx = 0;
+  uint64_t bms_tx = 0;
+  uint64_t states = 0;
+  uint64_t telemetry = 0;
+  // Called on every state change, at the virtual time it happens
+  std::function<void(uint8_t from, uint8_t to, const char *reason)> onState;
+};
+
+extern ReplayTimeline replayTimeline;
+
+// Writes "<t_s> <kind> <text>" at the current virtual time
+void replayTimelineLine(const char *kind, const char *text);
+
+const char *replayStateName(uint8_t state);
@@ -0,0 +1,3 @@
+// The charge controller sketch compiled as plain C++ against the host shims.
+// The sketch defines its functions before use, so no prototypes are needed.
+#include "charge_controller.ino"
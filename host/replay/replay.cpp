@@ -0,0 +1,191 @@
+// Replays recorded CAN and BMS traffic through the charge controller firmware
+// (teensy/charge_controller) on a virtual clock and prints what it did.
+//
+// Inputs are any format cblog reads (.trc, .csv, .cbl, controller .bin). RX
+// frames go to the matching FlexCAN controller and BMS_RX bytes to Serial1,
+// each at its recorded time; TX records in the input are skipped, since the
+// firmware produces its own. Inputs are merged by time, each starting at
+// virtual t = 0 plus --offset.
+//
+// loop() runs on the sim::Kernel (sim/SimKernel.h): passes are --tick-us of
+// virtual time apart (default 1 ms), but only when an input frame is due or
+// a firmware deadline hint says a timer is about to fire, so idle stretches
+// cost nothing. --fixed-step runs a pass every tick instead, as the replay
+// did before the kernel; both give the same timeline. After the last input
+// frame the run continues for --tail seconds so timeouts fire.
+//
+// The timeline (state changes, CAN TX frames, BMS requests and, with
+// --telemetry, display lines) goes to stdout or --out, and is deterministic
+// for a given build and input, so it can be diffed across builds.
+//
+//   replay LOG [LOG...] [--out FILE] [--serial FILE] [--telemetry]
+//          [--tick-us N] [--fixed-step] [--tail SEC] [--offset SEC] [--until SEC]
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <string>
+#include <vector>
+#include <Arduino.h>
+#include <FlexCAN_T4.h>
+#include "ChunkedLog.h"
+#include "DeviceLog.h"
+#include "ReplayTap.h"
+#include "SimKernel.h"
+#include "TextLog.h"
+
+void setup();
+void loop();
+
+using namespace canlog;
+
+namespace {
+
+bool loadLog(const std::string &path, Log &log, std::string &err) {
+  std::string ext = path.substr(path.rfind('.') == std::string::npos ? path.size() : path.rfind('.') + 1);
+  for (char &c : ext) c = (char)tolower((unsigned char)c);
+  if (ext == "trc") return readTrc(path, log, err);
+  if (ext == "csv") return readCsv(path, log, err);
+  if (ext == "cbl") return readCbl(path, log, err);
+  if (ext == "bin") return readDeviceLog(path, log, err);
+  err = "unknown log format: " + path;
+  return false;
+}
+
+bool isReplayed(uint8_t source) {
+  return source == (uint8_t)Source::CAN1_RX || source == (uint8_t)Source::CAN2_RX ||
+         source == (uint8_t)Source::CAN3_RX || source == (uint8_t)Source::BMS_RX;
+}
+
+void deliver(const Frame &f) {
+  if (f.source == (uint8_t)Source::BMS_RX) {
+    Serial1.inject(f.data, f.dlc);
+    return;
+  }
+
+  FlexCANShimBus *bus = flexcanBus((CAN_DEV_TABLE)(canChannel(f.source) - 1));
+  if (!bus) return;   // the firmware does not use that controller
+
+  CAN_message_t msg;
+  msg.id = f.id & ~ID_EXTENDED;
+  msg.flags.extended = (f.id & ID_EXTENDED) != 0;
+  msg.len = f.dlc;
+  memcpy(msg.buf, f.data, sizeof(msg.buf));
+  bus->inject(msg);
+}
+
+FILE *openOut(const std::string &path) {
+  if (path.empty()) return stdout;
+  FILE *f = fopen(path.c_str(), "w");
+  if (!f) {
+    fprintf(stderr, "replay: cannot create %s\n", path.c_str());
+    exit(1);
+  }
+  return f;
+}
+
+void usage() {
+  fprintf(stderr,
+          "usage: replay LOG [LOG...] [--out FILE] [--serial FILE] [--telemetry]\n"
+          "              [--tick-us N] [--fixed-step] [--tail SEC] [--offset SEC] [--until SEC]\n");
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+  std::vector<std::string> inputs;
+  std::string outPath, serialPath;
+  bool telemetry = false, fixedStep = false;
+  uint64_t tickUs = 1000, tailUs = 5000000, offsetUs = 0, untilUs = UINT64_MAX;
+
+  for (int i = 1; i < argc; i++) {
+    auto next = [&]() -> const char * {
+      if (i + 1 >= argc) { usage(); exit(2); }
+      return argv[++i];
+    };
+    auto seconds = [](const char *s) { return (uint64_t)(strtod(s, nullptr) * 1e6 + 0.5); };
+    if (!strcmp(argv[i], "--out")) outPath = next();
+    else if (!strcmp(argv[i], "--serial")) serialPath = next();
+    else if (!strcmp(argv[i], "--telemetry")) telemetry = true;
+    else if (!strcmp(argv[i], "--tick-us")) tickUs = strtoull(next(), nullptr, 10);
+    else if (!strcmp(argv[i], "--fixed-step")) fixedStep = true;
+    else if (!strcmp(argv[i], "--tail")) tailUs = seconds(next());
+    else if (!strcmp(argv[i], "--offset")) offsetUs = seconds(next());
+    else if (!strcmp(argv[i], "--until")) untilUs = seconds(next());
+    else if (argv[i][0] == '-') { usage(); return 2; }
+    else inputs.push_back(argv[i]);
+  }
+  if (inputs.empty() || tickUs == 0) { usage(); return 2; }
+
+  // Merge all RX traffic into one time-ordered stream
+  std::vector<Frame> stream;
+  for (const std::string &path : inputs) {
+    Log log;
+    std::string err;
+    if (!loadLog(path, log, err)) {
+      fprintf(stderr, "replay: %s\n", err.c_str());
+      return 1;
+    }
+    for (Frame f : log.frames) {
+      if (!isReplayed(f.source)) continue;
+      f.t_us += offsetUs;
+      stream.push_back(f);
+    }
+  }
+  std::stable_sort(stream.begin(), stream.end(), [](const Frame &a, const Frame &b) { return a.t_us < b.t_us; });
+
+  const uint64_t endUs = std::min(untilUs, (stream.empty() ? 0 : stream.back().t_us) + tailUs);
+
+  replayTimeline.out = openOut(outPath);
+  FILE *serialOut = serialPath.empty() ? nullptr : openOut(serialPath);
+  if (serialOut) Serial.onWrite = [&](const uint8_t *d, size_t n) { fwrite(d, 1, n, serialOut); };
+
+  std::string telemetryLine;
+  if (telemetry) {
+    Serial2.onWrite = [&](const uint8_t *d, size_t n) {
+      for (size_t i = 0; i < n; i++) {
+        if (d[i] == '\n') {
+          replayTimeline.telemetry++;
+          replayTimelineLine("tel", telemetryLine.c_str());
+          telemetryLine.clear();
+        } else if (d[i] != '\r') {
+          telemetryLine += (char)d[i];
+        }
+      }
+    };
+  }
+
+  auto wall0 = std::chrono::steady_clock::now();
+  arduinoSetNowUs(0);
+  setup();
+
+  sim::KernelConfig config;
+  config.tickUs = tickUs;
+  if (fixedStep) config.maxStepUs = tickUs;
+  sim::Kernel kernel(loop, config);
+
+  // One pending event at a time: deliver what is due, schedule the next frame
+  size_t next = 0;
+  std::function<void()> feed = [&]() {
+    while (next < stream.size() && stream[next].t_us <= arduinoNowUs()) deliver(stream[next++]);
+    if (next < stream.size()) kernel.at(stream[next].t_us, feed);
+  };
+  if (!stream.empty()) kernel.at(stream.front().t_us, feed);
+  kernel.runUntil(endUs);
+  const uint64_t loops = kernel.stats().passes;
+
+  double wall = std::chrono::duration<double>(std::chrono::steady_clock::now() - wall0).count();
+  if (replayTimeline.out != stdout) fclose(replayTimeline.out);
+  if (serialOut) fclose(serialOut);
+
+  fprintf(stderr,
+          "replay: %.1f s virtual in %.2f s (%.0fx), %llu loops, %zu frames in; "
+          "%llu tx, %llu bms requests, %llu state changes, %llu telemetry lines\n",
+          endUs / 1e6, wall, wall > 0 ? endUs / 1e6 / wall : 0.0, (unsigned long long)loops, next,
+          (unsigned long long)replayTimeline.tx, (unsigned long long)replayTimeline.bms_tx,
+          (unsigned long long)replayTimeline.states, (unsigned long long)replayTimeline.telemetry);
+  return 0;
+}
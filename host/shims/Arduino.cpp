@@ -0,0 +1,92 @@
+#include "Arduino.h"
+#include <stdarg.h>
+#include <chrono>
+
+// -------------------- Virtual clock --------------------
+static uint64_t nowUs = 0;
+
+uint64_t arduinoNowUs() { return nowUs; }
+void arduinoSetNowUs(uint64_t us) { nowUs = us; }
+void arduinoAdvanceUs(uint64_t us) { nowUs += us; }
+
+uint32_t millis() { return (uint32_t)(nowUs / 1000); }
+uint32_t micros() { return (uint32_t)nowUs; }
+void delay(uint32_t ms) { nowUs += (uint64_t)ms * 1000; }
+void delayMicroseconds(uint32_t us) { nowUs += us; }
+
+static uint64_t wakeUs = UINT64_MAX;
+
+void arduinoWakeAtMs(uint32_t at_ms) {
+  const int32_t ahead = (int32_t)(at_ms - millis());
+  const uint64_t us = ahead <= 0 ? nowUs : (nowUs / 1000 + (uint64_t)ahead) * 1000;
+  if (us < wakeUs) wakeUs = us;
+}
+
+uint64_t arduinoTakeWakeUs() {
+  uint64_t us = wakeUs;
+  wakeUs = UINT64_MAX;
+  return us;
+}
+
+// -------------------- Cycle counter --------------------
+uint32_t arduinoCycleCount() {
+  static const auto t0 = std::chrono::steady_clock::now();
+  const auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - t0).count();
+  return (uint32_t)((uint64_t)ns * (F_CPU_ACTUAL / 1000000) / 1000);
+}
+
+// -------------------- Memory --------------------
+extern "C" {
+uint8_t external_psram_size = 0;
+}
+
+void *extmem_malloc(size_t size) {
+  return external_psram_size ? malloc(size) : nullptr;
+}
+
+void extmem_free(void *ptr) {
+  free(ptr);
+}
+
+// -------------------- String --------------------
+std::string String::fmt(double v, int decimals) {
+  char buf[48];
+  snprintf(buf, sizeof(buf), "%.*f", decimals, v);
+  return buf;
+}
+
+void String::trim() {
+  size_t b = s_.find_first_not_of(" \t\r\n");
+  size_t e = s_.find_last_not_of(" \t\r\n");
+  s_ = (b == std::string::npos) ? std::string() : s_.substr(b, e - b + 1);
+}
+
+// -------------------- Serial --------------------
+HardwareSerial Serial("Serial");
+HardwareSerial Serial1("Serial1");
+HardwareSerial Serial2("Serial2");
+HardwareSerial Serial3("Serial3");
+
+int HardwareSerial::read() {
+  if (rx_.empty()) return -1;
+  uint8_t b = rx_.front();
+  rx_.pop_front();
+  return b;
+}
+
+size_t HardwareSerial::write(const uint8_t *data, size_t n) {
+  if (onWrite) onWrite(data, n);
+  return n;
+}
+
+int HardwareSerial::printf(const char *fmt, ...) {
+  char buf[512];
+  va_list ap;
+  va_start(ap, fmt);
+  int n = vsnprintf(buf, sizeof(buf), fmt, ap);
+  va_end(ap);
+  if (n < 0) return n;
+  if ((size_t)n >= sizeof(buf)) n = sizeof(buf) - 1;
+  write((const uint8_t *)buf, (size_t)n);
+  return n;
+}
@@ -0,0 +1,209 @@
+#pragma once
+// Host stand-in for the Teensy/Arduino core, covering what the charge
+// controller sketch uses.
+//
+// Time is virtual: millis()/micros() read a 64-bit microsecond counter that
+// only moves when the host harness calls arduinoAdvanceUs() (or the sketch
+// calls delay()). micros() wraps at 32 bits like the real one.
+//
+// Code can also say when it next has work (deadline hints), so a harness can
+// jump the clock straight there instead of stepping it: every elapsedMillis
+// comparison hints the moment it turns true (and restarting one asks for
+// another pass so the new deadline gets hinted), and DeadlineHint.h in the
+// firmware covers plain millis() arithmetic. ARDUINO_HOST_SHIM marks builds
+// against these shims.
+//
+// Serial ports keep an RX queue the harness fills with inject() and hand
+// every written byte to an optional onWrite sink.
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <deque>
+#include <functional>
+#include <string>
+
+#define DMAMEM
+#define EXTMEM
+#define FLASHMEM
+#define PROGMEM
+
+#define ARDUINO_HOST_SHIM 1
+
+// -------------------- Virtual clock --------------------
+uint64_t arduinoNowUs();
+void arduinoSetNowUs(uint64_t us);
+void arduinoAdvanceUs(uint64_t us);
+
+// Deadline hints: at_ms is a millis() value; one at or before now means
+// "run again as soon as possible". arduinoTakeWakeUs() returns the earliest
+// hint since the last call as an absolute arduinoNowUs() time (UINT64_MAX if
+// none) and clears it.
+void arduinoWakeAtMs(uint32_t at_ms);
+uint64_t arduinoTakeWakeUs();
+
+uint32_t millis();
+uint32_t micros();
+void delay(uint32_t ms);
+void delayMicroseconds(uint32_t us);
+inline void yield() {}
+
+// Both count in 32 bits as on the Teensy (unsigned long is 64-bit here), so
+// they wrap with millis()/micros() the same way
+class elapsedMillis {
+public:
+  elapsedMillis() : ms_(millis()) {}
+  elapsedMillis(unsigned long val) : ms_(millis() - (uint32_t)val) {}
+  operator unsigned long() const { return (uint32_t)(millis() - ms_); }
+  // A restarted timer is compared on the next pass, which then hints it
+  elapsedMillis &operator=(unsigned long val) {
+    ms_ = millis() - (uint32_t)val;
+    arduinoWakeAtMs(millis());
+    return *this;
+  }
+
+  // `timer >= period` and friends hint when the comparison changes
+  template <typename T> friend bool operator>=(const elapsedMillis &t, T v) {
+    arduinoWakeAtMs((uint32_t)(t.ms_ + v));
+    return (unsigned long)t >= (unsigned long)(uint32_t)v;
+  }
+  template <typename T> friend bool operator>(const elapsedMillis &t, T v) {
+    arduinoWakeAtMs((uint32_t)(t.ms_ + v + 1));
+    return (unsigned long)t > (unsigned long)(uint32_t)v;
+  }
+  template <typename T> friend bool operator<(const elapsedMillis &t, T v) { return !(t >= v); }
+  template <typename T> friend bool operator<=(const elapsedMillis &t, T v) { return !(t > v); }
+
+private:
+  uint32_t ms_;
+};
+
+class elapsedMicros {
+public:
+  elapsedMicros() : us_(micros()) {}
+  elapsedMicros(unsigned long val) : us_(micros() - (uint32_t)val) {}
+  operator unsigned long() const { return (uint32_t)(micros() - us_); }
+  elapsedMicros &operator=(unsigned long val) { us_ = micros() - (uint32_t)val; return *this; }
+
+private:
+  uint32_t us_;
+};
+
+// -------------------- Cycle counter --------------------
+// Stand-in for the Cortex-M7 DWT cycle counter: host time since start-up at
+// F_CPU_ACTUAL, wrapping at 32 bits like the real one. Counts are the host's,
+// not the Teensy's; they are there so profiled builds run.
+#define F_CPU_ACTUAL 600000000
+uint32_t arduinoCycleCount();
+#define ARM_DWT_CYCCNT (arduinoCycleCount())
+
+// -------------------- Memory --------------------
+extern "C" uint8_t external_psram_size;   // MB; 0 on the host unless a harness sets it
+void *extmem_malloc(size_t size);
+void extmem_free(void *ptr);
+
+// -------------------- String --------------------
+class String {
+public:
+  String() = default;
+  String(const char *s) : s_(s ? s : "") {}
+  String(const std::string &s) : s_(s) {}
+  String(char c) : s_(1, c) {}
+  String(int v) : s_(std::to_string(v)) {}
+  String(unsigned v) : s_(std::to_string(v)) {}
+  String(long v) : s_(std::to_string(v)) {}
+  String(unsigned long v) : s_(std::to_string(v)) {}
+  String(float v, int decimals = 2) : s_(fmt(v, decimals)) {}
+  String(double v, int decimals = 2) : s_(fmt(v, decimals)) {}
+
+  const char *c_str() const { return s_.c_str(); }
+  unsigned length() const { return (unsigned)s_.size(); }
+  char operator[](unsigned i) const { return i < s_.size() ? s_[i] : '\0'; }
+  char charAt(unsigned i) const { return (*this)[i]; }
+
+  String &operator+=(const String &o) { s_ += o.s_; return *this; }
+  String &operator+=(const char *o) { s_ += o; return *this; }
+  String &operator+=(char c) { s_ += c; return *this; }
+  friend String operator+(String a, const String &b) { return a += b; }
+  friend String operator+(String a, const char *b) { return a += b; }
+  friend String operator+(const char *a, const String &b) { return String(a) += b; }
+  bool operator==(const String &o) const { return s_ == o.s_; }
+  bool operator==(const char *o) const { return s_ == o; }
+  bool operator!=(const String &o) const { return s_ != o.s_; }
+
+  int indexOf(char c, unsigned from = 0) const {
+    size_t p = s_.find(c, from);
+    return p == std::string::npos ? -1 : (int)p;
+  }
+  int lastIndexOf(char c) const {
+    size_t p = s_.rfind(c);
+    return p == std::string::npos ? -1 : (int)p;
+  }
+  String substring(unsigned from) const { return from < s_.size() ? String(s_.substr(from)) : String(); }
+  String substring(unsigned from, unsigned to) const {
+    return (from < to && from < s_.size()) ? String(s_.substr(from, to - from)) : String();
+  }
+  bool startsWith(const char *p) const { return s_.compare(0, strlen(p), p) == 0; }
+  void trim();
+  void remove(unsigned index, unsigned count = (unsigned)-1) { if (index < s_.size()) s_.erase(index, count); }
+  long toInt() const { return strtol(s_.c_str(), nullptr, 10); }
+  float toFloat() const { return strtof(s_.c_str(), nullptr); }
+
+private:
+  static std::string fmt(double v, int decimals);
+  std::string s_;
+};
+
+// -------------------- Serial --------------------
+class HardwareSerial {
+public:
+  explicit HardwareSerial(const char *name) : name_(name) {}
+
+  void begin(unsigned long baud) { baud_ = baud; }
+  void end() {}
+  operator bool() const { return true; }
+
+  int available() const { return (int)rx_.size(); }
+  int read();
+  int peek() const { return rx_.empty() ? -1 : rx_.front(); }
+  void flush() {}
+
+  size_t write(uint8_t b) { return write(&b, 1); }
+  size_t write(const uint8_t *data, size_t n);
+  size_t write(const char *s) { return write((const uint8_t *)s, strlen(s)); }
+
+  size_t print(const char *s) { return write(s); }
+  size_t print(const String &s) { return write(s.c_str()); }
+  size_t print(char c) { return write((uint8_t)c); }
+  size_t print(int v) { return printf("%d", v); }
+  size_t print(unsigned v) { return printf("%u", v); }
+  size_t print(long v) { return printf("%ld", v); }
+  size_t print(unsigned long v) { return printf("%lu", v); }
+  size_t print(double v, int decimals = 2) { return printf("%.*f", decimals, v); }
+  size_t println() { return write("\r\n"); }
+  template <typename T> size_t println(const T &v) { return print(v) + println(); }
+
+  // unsigned long is 64-bit here and 32-bit on the Teensy, so the sketch
+  // casts to (unsigned long) for %lu; the attribute catches any that do not
+  int printf(const char *fmt, ...) __attribute__((format(printf, 2, 3)));
+
+  // Host side
+  const char *name() const { return name_; }
+  unsigned long baud() const { return baud_; }
+  void inject(const uint8_t *data, size_t n) { rx_.insert(rx_.end(), data, data + n); }
+  void inject(const char *s) { inject((const uint8_t *)s, strlen(s)); }
+  std::function<void(const uint8_t *data, size_t n)> onWrite;   // unset = discard
+
+private:
+  const char *name_;
+  unsigned long baud_ = 0;
+  std::deque<uint8_t> rx_;
+};
+
+extern HardwareSerial Serial;    // USB
+extern HardwareSerial Serial1;
+extern HardwareSerial Serial2;
+extern HardwareSerial Serial3;
@@ -0,0 +1,32 @@
+#include "FlexCAN_T4.h"
+
+static FlexCANShimBus *buses[3] = {nullptr, nullptr, nullptr};
+
+FlexCANShimBus::FlexCANShimBus(CAN_DEV_TABLE dev) : dev_(dev) {
+  buses[dev] = this;
+}
+
+FlexCANShimBus::~FlexCANShimBus() {
+  if (buses[dev_] == this) buses[dev_] = nullptr;
+}
+
+uint32_t FlexCANShimBus::events() {
+  uint32_t n = 0;
+  while (!rx_.empty()) {
+    CAN_message_t msg = rx_.front();
+    rx_.pop_front();
+    msg.bus = (uint8_t)(dev_ + 1);
+    if (handler_) handler_(msg);
+    n++;
+  }
+  return n;
+}
+
+int FlexCANShimBus::write(const CAN_message_t &msg) {
+  if (onWrite) onWrite(msg);
+  return 1;
+}
+
+FlexCANShimBus *flexcanBus(CAN_DEV_TABLE dev) {
+  return buses[dev];
+}
@@ -0,0 +1,76 @@
+#pragma once
+// Host stand-in for FlexCAN_T4, covering what the charge controller uses.
+//
+// Each controller keeps an RX queue that the harness fills with inject();
+// events() hands queued frames to the onReceive callback in order, as the
+// real library does from loop(). write() passes frames to an optional
+// onWrite sink and always succeeds.
+
+#include <stdint.h>
+#include <string.h>
+#include <deque>
+#include <functional>
+
+enum CAN_DEV_TABLE { CAN1 = 0, CAN2 = 1, CAN3 = 2 };
+enum FLEXCAN_RXQUEUE_TABLE { RX_SIZE_2 = 2, RX_SIZE_4 = 4, RX_SIZE_8 = 8, RX_SIZE_16 = 16, RX_SIZE_32 = 32,
+                             RX_SIZE_64 = 64, RX_SIZE_128 = 128, RX_SIZE_256 = 256, RX_SIZE_512 = 512,
+                             RX_SIZE_1024 = 1024 };
+enum FLEXCAN_TXQUEUE_TABLE { TX_SIZE_2 = 2, TX_SIZE_4 = 4, TX_SIZE_8 = 8, TX_SIZE_16 = 16, TX_SIZE_32 = 32,
+                             TX_SIZE_64 = 64, TX_SIZE_128 = 128, TX_SIZE_256 = 256, TX_SIZE_512 = 512,
+                             TX_SIZE_1024 = 1024 };
+
+typedef struct CAN_message_t {
+  uint32_t id = 0;
+  uint16_t timestamp = 0;
+  uint8_t idhit = 0;
+  struct {
+    bool extended = 0;
+    bool remote = 0;
+    bool overrun = 0;
+    bool reserved = 0;
+  } flags;
+  uint8_t len = 8;
+  uint8_t buf[8] = {0};
+  int8_t mb = 0;
+  uint8_t bus = 0;
+  bool seq = 0;
+} CAN_message_t;
+
+typedef void (*_MB_ptr)(const CAN_message_t &msg);
+
+class FlexCANShimBus {
+public:
+  explicit FlexCANShimBus(CAN_DEV_TABLE dev);
+  ~FlexCANShimBus();
+
+  void begin() {}
+  void setBaudRate(uint32_t baud) { baud_ = baud; }
+  void onReceive(_MB_ptr handler) { handler_ = handler; }
+  void enableMBInterrupts() {}
+  void enableFIFO(bool = true) {}
+  void enableFIFOInterrupt(bool = true) {}
+  uint32_t events();
+  int write(const CAN_message_t &msg);
+
+  // Host side
+  CAN_DEV_TABLE dev() const { return dev_; }
+  uint32_t baud() const { return baud_; }
+  void inject(const CAN_message_t &msg) { rx_.push_back(msg); }
+  size_t pending() const { return rx_.size(); }   // frames waiting for events()
+  std::function<void(const CAN_message_t &msg)> onWrite;   // unset = discard
+
+private:
+  CAN_DEV_TABLE dev_;
+  uint32_t baud_ = 0;
+  _MB_ptr handler_ = nullptr;
+  std::deque<CAN_message_t> rx_;
+};
+
+// The instance the sketch declared for a controller, or nullptr
+FlexCANShimBus *flexcanBus(CAN_DEV_TABLE dev);
+
+template <CAN_DEV_TABLE _bus, FLEXCAN_RXQUEUE_TABLE _rxSize = RX_SIZE_16, FLEXCAN_TXQUEUE_TABLE _txSize = TX_SIZE_16>
+class FlexCAN_T4 : public FlexCANShimBus {
+public:
+  FlexCAN_T4() : FlexCANShimBus(_bus) {}
+};
@@ -0,0 +1,32 @@
+#pragma once
+// Host stand-in for SdFat: a card that is never present. begin() fails and
+// files never open, so firmware takes its no-card paths.
+
+#include <stdint.h>
+#include <stddef.h>
+#include <fcntl.h>
+
+#define FIFO_SDIO 0
+#define DMA_SDIO 1
+
+struct SdioConfig {
+  explicit SdioConfig(int) {}
+};
+
+class FsFile {
+public:
+  bool open(const char *, int) { return false; }
+  size_t write(const void *, size_t) { return 0; }
+  bool seekSet(uint64_t) { return false; }
+  bool sync() { return false; }
+  bool preAllocate(uint64_t) { return false; }
+  bool truncate() { return false; }
+  bool close() { return true; }
+  operator bool() const { return false; }
+};
+
+class SdFs {
+public:
+  bool begin(SdioConfig) { return false; }
+  bool exists(const char *) { return false; }
+};
@@ -0,0 +1,258 @@
+#include "TFT_eSPI.h"
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+
+// Approximate metrics of the TFT_eSPI GFX free fonts used by the display
+const GFXfont FreeSans9pt7b      = {"FreeSans9pt7b", 22, 13, 10};
+const GFXfont FreeSans12pt7b     = {"FreeSans12pt7b", 29, 17, 13};
+const GFXfont FreeSansBold24pt7b = {"FreeSansBold24pt7b", 56, 35, 27};
+
+TftStats tftStats;
+
+// ---------------------------------------------------------------------------
+// TFT_eSPI
+// ---------------------------------------------------------------------------
+
+TFT_eSPI::TFT_eSPI(int16_t w, int16_t h) : _width(w), _height(h) {}
+
+void TFT_eSPI::init() {
+  _px.assign((size_t)_width * _height, 0);
+}
+
+void TFT_eSPI::setRotation(uint8_t r) {
+  int16_t portraitW = std::min(_width, _height);
+  int16_t portraitH = std::max(_width, _height);
+  _width = (r & 1) ? portraitH : portraitW;
+  _height = (r & 1) ? portraitW : portraitH;
+  _px.assign((size_t)_width * _height, 0);
+}
+
+uint16_t TFT_eSPI::toSurface(uint32_t c) const {
+  switch (_depth) {
+    case 1:  return c ? 1 : 0;
+    case 8:  return (uint16_t)(((c >> 8) & 0xE0) | ((c >> 6) & 0x1C) | ((c >> 3) & 0x03));  // RGB332
+    default: return (uint16_t)c;
+  }
+}
+
+void TFT_eSPI::writeRect(int32_t x, int32_t y, int32_t w, int32_t h, uint32_t color) {
+  int32_t x0 = std::max<int32_t>(x, 0), y0 = std::max<int32_t>(y, 0);
+  int32_t x1 = std::min<int32_t>(x + w, _width), y1 = std::min<int32_t>(y + h, _height);
+  if (x0 >= x1 || y0 >= y1 || _px.empty()) return;
+
+  uint16_t v = toSurface(color);
+  for (int32_t row = y0; row < y1; row++) {
+    std::fill(_px.begin() + (size_t)row * _width + x0, _px.begin() + (size_t)row * _width + x1, v);
+  }
+
+  uint64_t n = (uint64_t)(x1 - x0) * (y1 - y0);
+  if (_isSprite) {
+    tftStats.spriteOps++;
+    tftStats.spritePixels += n;
+  } else {
+    tftStats.panelOps++;
+    tftStats.panelPixels += n;
+  }
+}
+
+void TFT_eSPI::fillScreen(uint32_t color) { writeRect(0, 0, _width, _height, color); }
+void TFT_eSPI::fillRect(int32_t x, int32_t y, int32_t w, int32_t h, uint32_t color) { writeRect(x, y, w, h, color); }
+void TFT_eSPI::drawPixel(int32_t x, int32_t y, uint32_t color) { writeRect(x, y, 1, 1, color); }
+
+void TFT_eSPI::setTextColor(uint16_t color) {
+  _fg = _bg = color;
+  _fillBg = false;
+}
+
+void TFT_eSPI::setTextColor(uint16_t fg, uint16_t bg, bool) {
+  _fg = fg;
+  _bg = bg;
+  _fillBg = (fg != bg);
+}
+
+void TFT_eSPI::setTextFont(uint8_t font) {
+  _font = font;
+  _freeFont = nullptr;
+}
+
+void TFT_eSPI::setFreeFont(const GFXfont *font) {
+  _freeFont = font;
+  if (!font) _font = 1;
+}
+
+int16_t TFT_eSPI::advance() const {
+  if (_freeFont) return _freeFont->xAdvance;
+  return (_font == 2) ? 8 : 6;
+}
+
+int16_t TFT_eSPI::ascent() const {
+  if (_freeFont) return _freeFont->ascent;
+  return (_font == 2) ? 12 : 7;
+}
+
+int16_t TFT_eSPI::fontHeight() const {
+  if (_freeFont) return _freeFont->yAdvance;
+  return (_font == 2) ? 16 : 8;
+}
+
+int16_t TFT_eSPI::textWidth(const char *s) const {
+  return (int16_t)(strlen(s) * advance());
+}
+
+// One box per visible character, sized by a rough glyph class
+void TFT_eSPI::drawGlyphs(const char *s, int32_t left, int32_t baseline) {
+  const int16_t adv = advance(), asc = ascent();
+  const int16_t w = std::max<int16_t>(adv - std::max<int16_t>(adv / 5, 1), 1);
+
+  for (; *s; s++, left += adv) {
+    char c = *s;
+    if (c == ' ') continue;
+
+    if (c == '.' || c == ',') {
+      int16_t dot = std::max<int16_t>(asc / 6, 1);
+      writeRect(left + (w - dot) / 2, baseline - dot, dot, dot, _fg);
+    } else if (c == '-') {
+      writeRect(left, baseline - asc / 2, w, std::max<int16_t>(asc / 8, 1), _fg);
+    } else if (c >= 'a' && c <= 'z' && !strchr("bdfhklt", c)) {
+      int16_t h = asc * 3 / 4;
+      int16_t desc = strchr("gjpqy", c) ? asc / 4 : 0;
+      writeRect(left, baseline - h, w, h + desc, _fg);
+    } else {
+      writeRect(left, baseline - asc, w, asc, _fg);
+    }
+  }
+}
+
+size_t TFT_eSPI::print(const char *s) {
+  const int16_t width = textWidth(s);
+  int32_t baseline = _cursorY;
+
+  // GLCD-style fonts position by the top of the cell and paint their
+  // background; free fonts position by the baseline and do not.
+  if (!_freeFont) {
+    if (_fillBg) writeRect(_cursorX, _cursorY, width, fontHeight(), _bg);
+    baseline = _cursorY + ascent();
+  }
+  drawGlyphs(s, _cursorX, baseline);
+  _cursorX += width;
+  return strlen(s);
+}
+
+size_t TFT_eSPI::print(long n) {
+  char buf[24];
+  snprintf(buf, sizeof(buf), "%ld", n);
+  return print(buf);
+}
+
+size_t TFT_eSPI::printf(const char *fmt, ...) {
+  char buf[128];
+  va_list ap;
+  va_start(ap, fmt);
+  vsnprintf(buf, sizeof(buf), fmt, ap);
+  va_end(ap);
+  return print(buf);
+}
+
+int16_t TFT_eSPI::drawString(const char *s, int32_t x, int32_t y) {
+  const int16_t w = textWidth(s);
+  const int16_t h = fontHeight();
+  const int16_t boxW = std::max<int16_t>(w, _padding);
+
+  int32_t left = x, boxLeft = x, top = y;
+  switch (_datum % 3) {
+    case 1: left = x - w / 2; boxLeft = x - boxW / 2; break;
+    case 2: left = x - w;     boxLeft = x - boxW;     break;
+  }
+  if (_datum >= BL_DATUM) top = y - h;
+  else if (_datum >= ML_DATUM) top = y - h / 2;
+
+  if (_fillBg) {
+    if (!_freeFont) {
+      writeRect(boxLeft, top, boxW, h, _bg);
+    } else if (boxW > w) {
+      // Free fonts only clear the padding beyond the text
+      writeRect(boxLeft, top, left - boxLeft, h, _bg);
+      writeRect(left + w, top, boxLeft + boxW - (left + w), h, _bg);
+    }
+  }
+
+  drawGlyphs(s, left, top + ascent());
+  return w;
+}
+
+int16_t TFT_eSPI::drawNumber(long n, int32_t x, int32_t y) {
+  char buf[24];
+  snprintf(buf, sizeof(buf), "%ld", n);
+  return drawString(buf, x, y);
+}
+
+// ---------------------------------------------------------------------------
+// TFT_eSprite
+// ---------------------------------------------------------------------------
+
+TFT_eSprite::TFT_eSprite(TFT_eSPI *parent) : TFT_eSPI(0, 0), _parent(parent) {
+  _isSprite = true;
+  _depth = 16;
+}
+
+void *TFT_eSprite::createSprite(int16_t w, int16_t h, uint8_t) {
+  _width = w;
+  _height = h;
+  _px.assign((size_t)w * h, 0);
+  _created = true;
+  return _px.data();
+}
+
+void TFT_eSprite::deleteSprite() {
+  _px.clear();
+  _width = _height = 0;
+  _created = false;
+}
+
+void TFT_eSprite::fillSprite(uint32_t color) { writeRect(0, 0, _width, _height, color); }
+
+uint16_t TFT_eSprite::toPanel(uint16_t v) const {
+  switch (_depth) {
+    case 1:
+      return v ? _bitmapFg : _bitmapBg;
+    case 8: {
+      uint16_t r = (v >> 5) & 0x07, g = (v >> 2) & 0x07, b = v & 0x03;
+      return (uint16_t)(((r * 31 / 7) << 11) | ((g * 63 / 7) << 5) | (b * 31 / 3));
+    }
+    default:
+      return v;
+  }
+}
+
+void TFT_eSprite::pushSprite(int32_t x, int32_t y) {
+  pushSprite(x, y, 0, 0, _width, _height);
+}
+
+void TFT_eSprite::pushSprite(int32_t tx, int32_t ty, int32_t sx, int32_t sy, int32_t sw, int32_t sh) {
+  if (!_created || !_parent || _parent->_px.empty()) return;
+
+  uint64_t n = 0;
+  for (int32_t row = 0; row < sh; row++) {
+    int32_t srcY = sy + row, dstY = ty + row;
+    if (srcY < 0 || srcY >= _height || dstY < 0 || dstY >= _parent->_height) continue;
+
+    for (int32_t col = 0; col < sw; col++) {
+      int32_t srcX = sx + col, dstX = tx + col;
+      if (srcX < 0 || srcX >= _width || dstX < 0 || dstX >= _parent->_width) continue;
+
+      uint16_t c = toPanel(_px[(size_t)srcY * _width + srcX]);
+      _parent->_px[(size_t)dstY * _parent->_width + dstX] = _parent->toSurface(c);
+      n++;
+    }
+  }
+
+  if (_parent->_isSprite) {
+    tftStats.spriteOps++;
+    tftStats.spritePixels += n;
+  } else {
+    tftStats.panelOps++;
+    tftStats.panelPixels += n;
+  }
+}
@@ -0,0 +1,137 @@
+#pragma once
+// Host stand-in for the TFT_eSPI library, covering the subset the dash
+// display uses. The "panel" is an in-memory RGB565 framebuffer and every draw
+// call is counted, so layout can be checked as images and render cost as
+// numbers (tftStats) without an ESP32.
+//
+// There is no glyph data on the host: text is drawn as one solid box per
+// character using approximate font metrics. That keeps text extents, padding
+// and overdraw realistic, which is what layout and cost checks need.
+
+#include <stdint.h>
+#include <stddef.h>
+#include <vector>
+
+// Metrics-only replacement for Adafruit GFX fonts
+struct GFXfont {
+  const char *name;
+  uint8_t yAdvance;   // line height
+  uint8_t ascent;     // capital height above the baseline
+  uint8_t xAdvance;   // mean glyph advance
+};
+
+extern const GFXfont FreeSans9pt7b;
+extern const GFXfont FreeSans12pt7b;
+extern const GFXfont FreeSansBold24pt7b;
+
+#define TFT_BLACK   0x0000
+#define TFT_BLUE    0x001F
+#define TFT_RED     0xF800
+#define TFT_GREEN   0x07E0
+#define TFT_CYAN    0x07FF
+#define TFT_YELLOW  0xFFE0
+#define TFT_ORANGE  0xFDA0
+#define TFT_WHITE   0xFFFF
+
+#define TL_DATUM 0
+#define TC_DATUM 1
+#define TR_DATUM 2
+#define ML_DATUM 3
+#define MC_DATUM 4
+#define MR_DATUM 5
+#define BL_DATUM 6
+#define BC_DATUM 7
+#define BR_DATUM 8
+
+// Draw cost counters. "panel" is what would go over SPI to the TFT, "sprite"
+// is rendering into sprite RAM.
+struct TftStats {
+  uint32_t panelOps = 0;
+  uint64_t panelPixels = 0;
+  uint32_t spriteOps = 0;
+  uint64_t spritePixels = 0;
+};
+extern TftStats tftStats;
+
+class TFT_eSPI {
+public:
+  TFT_eSPI(int16_t w = 240, int16_t h = 320);
+  virtual ~TFT_eSPI() = default;
+
+  void init();
+  void setRotation(uint8_t r);
+  int16_t width() const { return _width; }
+  int16_t height() const { return _height; }
+
+  void fillScreen(uint32_t color);
+  void fillRect(int32_t x, int32_t y, int32_t w, int32_t h, uint32_t color);
+  void drawPixel(int32_t x, int32_t y, uint32_t color);
+
+  void setTextColor(uint16_t color);
+  void setTextColor(uint16_t fg, uint16_t bg, bool bgfill = false);
+  void setTextFont(uint8_t font);
+  void setFreeFont(const GFXfont *font);
+  void setTextDatum(uint8_t datum) { _datum = datum; }
+  void setTextPadding(uint16_t px) { _padding = px; }
+  void setCursor(int16_t x, int16_t y) { _cursorX = x; _cursorY = y; }
+
+  size_t print(const char *s);
+  size_t print(long n);
+  size_t printf(const char *fmt, ...) __attribute__((format(printf, 2, 3)));
+  int16_t drawString(const char *s, int32_t x, int32_t y);
+  int16_t drawNumber(long n, int32_t x, int32_t y);
+  int16_t textWidth(const char *s) const;
+  int16_t fontHeight() const;
+
+  // Host only: raw RGB565 pixels (row-major, width() x height())
+  const std::vector<uint16_t> &pixels() const { return _px; }
+
+protected:
+  friend class TFT_eSprite;
+
+  bool _isSprite = false;
+  uint8_t _depth = 16;
+  int16_t _width, _height;
+  std::vector<uint16_t> _px;   // 1-bit: 0/1, 8-bit: RGB332, 16-bit: RGB565
+
+  // Clipped rectangle fill in surface units; all drawing ends up here
+  void writeRect(int32_t x, int32_t y, int32_t w, int32_t h, uint32_t color);
+  uint16_t toSurface(uint32_t rgb565) const;
+
+private:
+  uint8_t _font = 1;
+  const GFXfont *_freeFont = nullptr;
+  uint16_t _fg = TFT_WHITE, _bg = TFT_BLACK;
+  bool _fillBg = false;
+  uint8_t _datum = TL_DATUM;
+  uint16_t _padding = 0;
+  int16_t _cursorX = 0, _cursorY = 0;
+
+  int16_t advance() const;
+  int16_t ascent() const;
+  void drawGlyphs(const char *s, int32_t left, int32_t baseline);
+};
+
+class TFT_eSprite : public TFT_eSPI {
+public:
+  explicit TFT_eSprite(TFT_eSPI *parent);
+
+  void setColorDepth(int8_t bits) { _depth = bits; }
+  void *createSprite(int16_t w, int16_t h, uint8_t frames = 1);
+  void deleteSprite();
+  void setBitmapColor(uint16_t fg, uint16_t bg) { _bitmapFg = fg; _bitmapBg = bg; }
+  void fillSprite(uint32_t color);
+
+  void pushSprite(int32_t x, int32_t y);
+  void pushSprite(int32_t tx, int32_t ty, int32_t sx, int32_t sy, int32_t sw, int32_t sh);
+
+  // Host only: sprite RAM as the ESP32 would allocate it
+  size_t memoryBytes() const { return ((size_t)_width * _height * _depth + 7) / 8; }
+
+private:
+  TFT_eSPI *_parent;
+  uint16_t _bitmapFg = TFT_WHITE, _bitmapBg = TFT_BLACK;
+  bool _created = false;
+
+  uint16_t toPanel(uint16_t v) const;
+};
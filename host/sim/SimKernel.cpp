@@ -0,0 +1,64 @@
+#include "SimKernel.h"
+#include <Arduino.h>
+#include <algorithm>
+#include <memory>
+
+namespace sim {
+
+Kernel::Kernel(void (*loop)(), KernelConfig config) : loop_(loop), config_(config) {
+  if (config_.tickUs == 0) config_.tickUs = 1;
+  if (config_.maxStepUs < config_.tickUs) config_.maxStepUs = config_.tickUs;
+}
+
+uint64_t Kernel::now() const {
+  return arduinoNowUs();
+}
+
+void Kernel::at(uint64_t t_us, Action fn) {
+  queue_.push(Event{std::max(t_us, now()), order_++, std::move(fn)});
+}
+
+void Kernel::every(uint64_t first_us, uint64_t period_us, std::function<bool()> fn) {
+  // Only the queued event owns the action; the action refers back to itself
+  // weakly, so it is freed once fn returns false or the queue is dropped
+  auto self = std::make_shared<std::function<void()>>();
+  std::weak_ptr<std::function<void()>> weak = self;
+  *self = [this, period_us, fn, weak]() {
+    if (!fn()) return;
+    if (auto next = weak.lock()) after(period_us, [next]() { (*next)(); });
+  };
+  at(first_us, [self]() { (*self)(); });
+}
+
+void Kernel::runUntil(uint64_t end_us) {
+  while (now() < end_us) {
+    while (!queue_.empty() && queue_.top().t_us <= now()) {
+      Action fn = std::move(const_cast<Event &>(queue_.top()).fn);
+      queue_.pop();
+      fn();
+      stats_.events++;
+    }
+
+    arduinoTakeWakeUs();   // hints from outside loop() do not count
+    loop_();
+    stats_.passes++;
+
+    // The next pass is a whole number of ticks after this one returned
+    // (loop() may have moved the clock itself with delay())
+    const uint64_t base = now();
+    const uint64_t wake = arduinoTakeWakeUs();
+    uint64_t next = std::min(wake, nextEventUs());
+    if (next > base + config_.maxStepUs) {
+      next = base + config_.maxStepUs;
+      stats_.capped++;
+    } else if (wake < nextEventUs() && wake > base) {
+      stats_.hinted++;
+    }
+    next = std::min(next, end_us);
+
+    const uint64_t ticks = next > base ? (next - base + config_.tickUs - 1) / config_.tickUs : 1;
+    arduinoSetNowUs(base + ticks * config_.tickUs);
+  }
+}
+
+} // namespace sim
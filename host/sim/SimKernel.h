@@ -0,0 +1,73 @@
+#pragma once
+// Discrete-event kernel for firmware built against the host shims.
+//
+// Instead of stepping the virtual clock a tick at a time, the kernel runs
+// loop() and then jumps straight to whichever comes first: the earliest
+// deadline hint loop() left behind (see shims/Arduino.h), the next scheduled
+// event, or maxStepUs past now. Events are host actions (inject a CAN frame,
+// feed BMS bytes, flip a fault) and run, in time then scheduling order,
+// right before the loop() pass that first sees them.
+//
+// tickUs is the shortest virtual time between two loop() passes and stands
+// in for the cost of one pass. Events falling between passes are delivered
+// at the next one, so results match a fixed tickUs stepper for the same
+// inputs, without the passes in which nothing could happen. Runs are
+// deterministic: no wall clock or threads are involved.
+
+#include <stdint.h>
+#include <functional>
+#include <queue>
+#include <vector>
+
+namespace sim {
+
+using Action = std::function<void()>;
+
+struct KernelConfig {
+  uint64_t tickUs = 1000;           // minimum spacing of loop() passes
+  uint64_t maxStepUs = 60000000;    // safety net for waits nothing hinted
+};
+
+struct KernelStats {
+  uint64_t passes = 0;        // loop() calls
+  uint64_t events = 0;        // actions run
+  uint64_t hinted = 0;        // jumps to a deadline hint
+  uint64_t capped = 0;        // jumps cut short by maxStepUs
+};
+
+class Kernel {
+public:
+  explicit Kernel(void (*loop)(), KernelConfig config = KernelConfig());
+
+  // Schedules fn at absolute virtual time t_us (clamped to now)
+  void at(uint64_t t_us, Action fn);
+  void after(uint64_t delay_us, Action fn) { at(now() + delay_us, std::move(fn)); }
+  // fn at first_us, then every period_us for as long as it returns true
+  void every(uint64_t first_us, uint64_t period_us, std::function<bool()> fn);
+
+  // Runs loop() passes and events until virtual time reaches end_us
+  void runUntil(uint64_t end_us);
+  void runFor(uint64_t us) { runUntil(now() + us); }
+
+  uint64_t now() const;
+  bool pending() const { return !queue_.empty(); }
+  uint64_t nextEventUs() const { return queue_.empty() ? UINT64_MAX : queue_.top().t_us; }
+  const KernelConfig &config() const { return config_; }
+  const KernelStats &stats() const { return stats_; }
+
+private:
+  struct Event {
+    uint64_t t_us;
+    uint64_t order;
+    Action fn;
+    bool operator>(const Event &o) const { return t_us != o.t_us ? t_us > o.t_us : order > o.order; }
+  };
+
+  void (*loop_)();
+  KernelConfig config_;
+  KernelStats stats_;
+  uint64_t order_ = 0;
+  std::priority_queue<Event, std::vector<Event>, std::greater<Event>> queue_;
+};
+
+} // namespace sim
@@ -0,0 +1,177 @@
+// Records the CAN sniffer sketch's binary USB stream
+// (teensy/sketch_sep14a/SnifferProtocol.h): CAN1..CAN3 merged on the
+// sketch's micros() clock, written as can1..can3 frames of one log.
+//
+// Given a serial device, puts it in raw mode and sends 'b' to switch the
+// sketch to binary packets; given a regular file (a raw capture, e.g. from
+// `cat /dev/ttyACM0 > x.raw`), decodes it. Stops at EOF, after --seconds, or
+// on Ctrl-C, then writes everything received to --out (.trc, .csv, .cbl or
+// .bin). With --live, frames are also printed as .trc lines as they arrive.
+// Link and device drop counters go to stderr once a second.
+//
+//   sniffer_dump PORT|FILE [--out FILE] [--seconds N] [--live]
+
+#include <cerrno>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <fcntl.h>
+#include <poll.h>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+#include "ChunkedLog.h"
+#include "DeviceLog.h"
+#include "SnifferStream.h"
+#include "TextLog.h"
+
+using namespace canlog;
+
+namespace {
+
+volatile sig_atomic_t stopRequested = 0;
+
+uint64_t nowUs(clockid_t clock) {
+  timespec ts;
+  clock_gettime(clock, &ts);
+  return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+bool setRaw(int fd) {
+  termios tio;
+  if (tcgetattr(fd, &tio) != 0) return false;
+  cfmakeraw(&tio);
+  tio.c_cc[VMIN] = 0;
+  tio.c_cc[VTIME] = 0;
+  return tcsetattr(fd, TCSANOW, &tio) == 0 && tcflush(fd, TCIFLUSH) == 0;
+}
+
+bool writeLog(const std::string &path, const Log &log, std::string &err) {
+  std::string ext = path.substr(path.rfind('.') == std::string::npos ? path.size() : path.rfind('.') + 1);
+  for (char &c : ext) c = (char)tolower((unsigned char)c);
+  if (ext == "trc") return writeTrc(path, log, err);
+  if (ext == "csv") return writeCsv(path, log, err);
+  if (ext == "cbl") return writeCbl(path, log, err);
+  if (ext == "bin") return writeDeviceLog(path, log, err);
+  err = "unknown log format: " + path;
+  return false;
+}
+
+void printStats(const SnifferDecodeStats &s, size_t frames) {
+  fprintf(stderr, "sniffer_dump: %zu frames, %llu packets, %.1f KB; lost %llu packets, %llu bad, %llu bytes skipped",
+          frames, (unsigned long long)s.packets, s.bytes / 1024.0, (unsigned long long)s.lost_packets,
+          (unsigned long long)s.bad_packets, (unsigned long long)s.skipped_bytes);
+  if (s.out_of_order) fprintf(stderr, ", %llu out of order", (unsigned long long)s.out_of_order);
+  if (s.have_device) {
+    fprintf(stderr, "; device: %lu frames (can1 %lu, can2 %lu, can3 %lu), %lu ring drops, ring peak %u/%u, %lu usb waits",
+            (unsigned long)s.device.frames, (unsigned long)s.device.bus_frames[0],
+            (unsigned long)s.device.bus_frames[1], (unsigned long)s.device.bus_frames[2],
+            (unsigned long)s.device.ring_drops, s.device.ring_peak, s.device.ring_size,
+            (unsigned long)s.device.usb_waits);
+  }
+  fprintf(stderr, "\n");
+}
+
+void usage() {
+  fprintf(stderr, "usage: sniffer_dump PORT|FILE [--out FILE] [--seconds N] [--live]\n");
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+  std::string input, outPath;
+  double seconds = 0;
+  bool live = false;
+
+  for (int i = 1; i < argc; i++) {
+    auto next = [&]() -> const char * {
+      if (i + 1 >= argc) { usage(); exit(2); }
+      return argv[++i];
+    };
+    if (!strcmp(argv[i], "--out")) outPath = next();
+    else if (!strcmp(argv[i], "--seconds")) seconds = strtod(next(), nullptr);
+    else if (!strcmp(argv[i], "--live")) live = true;
+    else if (argv[i][0] == '-') { usage(); return 2; }
+    else input = argv[i];
+  }
+  if (input.empty()) { usage(); return 2; }
+
+  int fd = open(input.c_str(), O_RDWR | O_NOCTTY);
+  if (fd < 0) fd = open(input.c_str(), O_RDONLY);
+  if (fd < 0) {
+    fprintf(stderr, "sniffer_dump: cannot open %s\n", input.c_str());
+    return 1;
+  }
+
+  const bool tty = isatty(fd);
+  if (tty) {
+    if (!setRaw(fd)) {
+      fprintf(stderr, "sniffer_dump: cannot configure %s\n", input.c_str());
+      return 1;
+    }
+    const char cmd = sniffer::CMD_BINARY;
+    if (write(fd, &cmd, 1) != 1) {
+      fprintf(stderr, "sniffer_dump: cannot write to %s\n", input.c_str());
+      return 1;
+    }
+  }
+  signal(SIGINT, [](int) { stopRequested = 1; });
+
+  Log log;
+  log.start_epoch_us = tty ? nowUs(CLOCK_REALTIME) : 0;
+  SnifferDecoder decoder;
+  const uint64_t t0 = nowUs(CLOCK_MONOTONIC);
+  uint64_t lastReport = t0;
+  uint8_t buf[65536];
+  char line[160];
+
+  while (!stopRequested) {
+    const uint64_t now = nowUs(CLOCK_MONOTONIC);
+    if (seconds > 0 && now - t0 >= seconds * 1e6) break;
+    if (tty && now - lastReport >= 1000000) {
+      lastReport = now;
+      printStats(decoder.stats(), log.frames.size());
+    }
+
+    if (tty) {
+      pollfd p = {fd, POLLIN, 0};
+      if (poll(&p, 1, 100) <= 0) continue;
+      if (!(p.revents & POLLIN)) break;   // unplugged
+    }
+    const ssize_t n = read(fd, buf, sizeof(buf));
+    if (n < 0 && errno == EINTR) continue;
+    if (n <= 0) {
+      if (tty && n == 0) continue;
+      break;
+    }
+
+    const size_t before = log.frames.size();
+    decoder.feed(buf, (size_t)n, log);
+    if (live) {
+      for (size_t i = before; i < log.frames.size(); i++) {
+        size_t len = formatTrcLine(log.frames[i], line, sizeof(line));
+        fwrite(line, 1, len, stdout);
+        fputc('\n', stdout);
+      }
+    }
+  }
+
+  if (tty) {
+    const char cmd = sniffer::CMD_TEXT;
+    if (write(fd, &cmd, 1) != 1) {}   // best effort, the sketch may be gone
+  }
+  close(fd);
+  printStats(decoder.stats(), log.frames.size());
+
+  if (!outPath.empty()) {
+    std::string err;
+    if (!writeLog(outPath, log, err)) {
+      fprintf(stderr, "sniffer_dump: %s\n", err.c_str());
+      return 1;
+    }
+    fprintf(stderr, "sniffer_dump: wrote %s\n", outPath.c_str());
+  }
+  return 0;
+}
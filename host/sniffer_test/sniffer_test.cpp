@@ -0,0 +1,154 @@
+// Checks of SnifferDecoder (canlog/SnifferStream.h) on a stream built with
+// appendSnifferPacket(): a text banner before the first packet, a stats
+// packet, micros() wrapping between two packets, a dropped packet, a packet
+// with a corrupted payload byte, a frame stamped before its predecessor, and
+// an unknown bus. The stream is fed whole, a byte at a time and in uneven
+// pieces; every way must give the same frames and counters.
+//
+// Prints each failed check with its line and exits 1 if there were any.
+//
+//   sniffer_test
+
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+#include "SnifferStream.h"
+
+using namespace canlog;
+
+namespace {
+
+int checks = 0;
+int failures = 0;
+
+void check(bool ok, const char *what, int line) {
+  checks++;
+  if (ok) return;
+  failures++;
+  printf("  FAIL line %d: %s\n", line, what);
+}
+
+#define CHECK(cond) check((cond), #cond, __LINE__)
+
+sniffer::SnifferFrame frame(uint32_t t_us, uint8_t bus, uint32_t id, uint8_t dlc, uint8_t flags = 0) {
+  sniffer::SnifferFrame f = {};
+  f.t_us = t_us;
+  f.bus = bus;
+  f.id = id;
+  f.dlc = dlc;
+  f.flags = flags;
+  for (int i = 0; i < 8; i++) f.data[i] = (uint8_t)(id + i);
+  return f;
+}
+
+void appendFrames(std::vector<uint8_t> &out, uint32_t seq, const std::vector<sniffer::SnifferFrame> &frames) {
+  appendSnifferPacket(out, sniffer::PACKET_FRAMES, seq, frames.data(), frames.size() * sizeof(frames[0]));
+}
+
+std::vector<uint8_t> buildStream() {
+  const std::string banner = "CAN sniffer, binary mode\r\n";
+  std::vector<uint8_t> s(banner.begin(), banner.end());
+
+  appendFrames(s, 0, {frame(0xFFFFF000, 1, 0x70A, 1),
+                      frame(0xFFFFF800, 2, 0x0CF11E05, 8, sniffer::FRAME_EXTENDED)});
+
+  sniffer::SnifferStats st = {};
+  st.frames = 1234;
+  st.ring_drops = 5;
+  appendSnifferPacket(s, sniffer::PACKET_STATS, 1, &st, sizeof(st));
+
+  // micros() wraps between these two packets
+  appendFrames(s, 2, {frame(0x00000100, 1, 0x18A, 8), frame(0x00000200, 3, 0x123, 12)});
+
+  // Packet 3 never arrives; packet 4 has a payload byte flipped
+  std::vector<uint8_t> bad;
+  appendFrames(bad, 4, {frame(0x00000300, 1, 0x28A, 8)});
+  bad[sizeof(sniffer::PacketHeader) + 9] ^= 0x40;
+  s.insert(s.end(), bad.begin(), bad.end());
+
+  // A frame stamped before the previous one, and one from a bus that does
+  // not exist
+  appendFrames(s, 5, {frame(0x00000150, 2, 0x38A, 8), frame(0x00000400, 0, 0x001, 8),
+                      frame(0x00000500, 1, 0x70A, 1)});
+  return s;
+}
+
+struct Decoded {
+  Log log;
+  SnifferDecodeStats stats;
+};
+
+Decoded decode(const std::vector<uint8_t> &stream, const std::vector<size_t> &pieces) {
+  Decoded d;
+  SnifferDecoder dec;
+  size_t at = 0;
+  for (size_t i = 0; at < stream.size(); i++) {
+    const size_t n = std::min(pieces[i % pieces.size()], stream.size() - at);
+    dec.feed(&stream[at], n, d.log);
+    at += n;
+  }
+  d.stats = dec.stats();
+  return d;
+}
+
+void checkDecoded(const Decoded &d) {
+  const SnifferDecodeStats &s = d.stats;
+  CHECK(s.packets == 4);
+  CHECK(s.frames == 6);
+  CHECK(s.bad_packets == 1);
+  CHECK(s.lost_packets == 2);          // 3 dropped, 4 corrupted
+  CHECK(s.out_of_order == 1);
+  CHECK(s.skipped_bytes >= strlen("CAN sniffer, binary mode\r\n"));
+  CHECK(s.have_device && s.device.frames == 1234 && s.device.ring_drops == 5);
+
+  const std::vector<Frame> &f = d.log.frames;
+  CHECK(f.size() == 6);
+  if (f.size() != 6) return;
+  // Rebased to the first frame, unwrapped across 2^32
+  CHECK(f[0].t_us == 0 && f[0].id == 0x70A && f[0].source == (uint8_t)Source::CAN1_RX && f[0].dlc == 1);
+  CHECK(f[1].t_us == 0x800 && f[1].id == (0x0CF11E05 | ID_EXTENDED) && f[1].source == (uint8_t)Source::CAN2_RX);
+  CHECK(f[2].t_us == 0x1100 && f[2].id == 0x18A);
+  CHECK(f[3].t_us == 0x1200 && f[3].source == (uint8_t)Source::CAN3_RX && f[3].dlc == 8);
+  // Stamped before f[3]: held at its time to keep the log sorted
+  CHECK(f[4].t_us == 0x1200 && f[4].id == 0x38A);
+  CHECK(f[5].t_us == 0x1500 && f[5].id == 0x70A);
+  for (const Frame &x : f) {
+    CHECK(x.data[0] == (uint8_t)(x.id & ~ID_EXTENDED) && x.data[7] == (uint8_t)((x.id & ~ID_EXTENDED) + 7));
+  }
+}
+
+bool sameFrames(const Log &a, const Log &b) {
+  return a.frames.size() == b.frames.size() &&
+         !memcmp(a.frames.data(), b.frames.data(), a.frames.size() * sizeof(Frame));
+}
+
+} // namespace
+
+int main() {
+  const std::vector<uint8_t> stream = buildStream();
+
+  const struct {
+    const char *name;
+    std::vector<size_t> pieces;
+  } feeds[] = {
+    {"whole", {stream.size()}},
+    {"bytes", {1}},
+    {"uneven", {7, 1, 15, 16, 17, 3, 64}},
+  };
+  Decoded whole;
+  for (const auto &feed : feeds) {
+    const int before = failures;
+    const Decoded d = decode(stream, feed.pieces);
+    checkDecoded(d);
+    if (feed.pieces.size() == 1 && feed.pieces[0] == stream.size()) {
+      whole = d;
+    } else {
+      CHECK(sameFrames(d.log, whole.log));
+      CHECK(d.stats.skipped_bytes == whole.stats.skipped_bytes && d.stats.bytes == whole.stats.bytes);
+    }
+    printf("%-7s %s\n", feed.name, failures == before ? "ok" : "FAIL");
+  }
+  printf("%d checks, %d failed\n", checks, failures);
+  return failures ? 1 : 0;
+}
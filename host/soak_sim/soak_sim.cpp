@@ -0,0 +1,493 @@
+// Long-duration soak of the charge controller firmware in virtual time:
+// weeks of days made of rides (Kelly traffic on CAN2 from the urban drive
+// cycle, the pack discharging), rests and charge sessions (a Delta-Q
+// emulator plugged into CAN1, powered up fresh at every plug-in and gone at
+// unplug), with the BMS emulator on Serial1 throughout and random faults
+// injected into a fraction of the sessions. One firmware boot for the whole
+// run, as on a bike whose controller stays powered.
+//
+// The virtual clock starts so that millis() wraps 20 minutes into charge
+// session --wrap-session, at a sub-second phase drawn from --seed, with the
+// charging timers running (0: boot at millis() 0 as the Teensy does; micros()
+// wraps every 71.6 minutes regardless). That session gets no fault.
+//
+// Every --window hours it prints one line of statistics and, with --csv,
+// writes the same as a row:
+//
+//   heap      MemoryMonitor's heap used, arena and holes (the host process's
+//             heap, harness included)
+//   queues    the deepest CAN1/CAN2 RX queue and Serial1 (BMS) RX buffer
+//             seen before a loop() pass
+//   loop      mean and max host time of one loop() pass
+//   periods   BMS poll, cell telemetry line and battery heartbeat (0x701)
+//             intervals: how far any strayed from nominal, in ms ("-": not
+//             sent that window); this is where elapsedMillis drift or a
+//             wrap bug shows
+//
+// At the end each series after --warmup is checked for an upward trend:
+// the median of its last third against the median of its first third. A
+// rise beyond the series' floor and relative allowance is flagged, as is a
+// series with no value in either third, any window with a period more than
+// 10 ms off, and any charge session in which the firmware never reached
+// RUN_CHARGING; then the run exits 1.
+//
+//   soak_sim [--days D] [--window H] [--warmup H] [--wrap-session N] [--fault-rate P]
+//            [--seed N] [--tick-us N] [--csv FILE] [--serial FILE]
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+#include <Arduino.h>
+#include <FlexCAN_T4.h>
+#include "BatteryPack.h"
+#include "BmsEmulator.h"
+#include "DeltaQCharger.h"
+#include "KellyController.h"
+#include "MemoryMonitor.h"
+#include "ReplayTap.h"
+#include "SimAttach.h"
+#include "SimKernel.h"
+
+void setup();
+void loop();
+
+using namespace emu;
+
+namespace {
+
+constexpr uint64_t HOUR_US = 3600000000ULL;
+constexpr uint64_t WRAP_INTO_SESSION_US = 20 * 60000000ULL;
+
+// One day of the plan: ride, rest, charge, rest
+struct Day {
+  uint64_t ride, rest1, charge, rest2;
+  bool fault;
+};
+
+// A node that is only on the bus while switched on; every switch-on powers
+// up a fresh one, as a charger plugged into the mains or a motor controller
+// keyed on would
+class SwitchedNode : public CanNode {
+public:
+  explicit SwitchedNode(std::function<std::unique_ptr<CanNode>()> make) : make_(std::move(make)) {}
+
+  void on() { if (!node_) node_ = make_(); }
+  void off() { node_.reset(); }
+  CanNode *node() const { return node_.get(); }
+
+  void receive(const canlog::Frame &f, uint64_t now_us) override {
+    if (node_) node_->receive(f, now_us);
+  }
+  uint64_t service(uint64_t now_us, const FrameSink &out) override {
+    return node_ ? node_->service(now_us, out) : UINT64_MAX;
+  }
+
+private:
+  std::function<std::unique_ptr<CanNode>()> make_;
+  std::unique_ptr<CanNode> node_;
+};
+
+// Intervals of a periodic output against its nominal period
+struct Period {
+  const char *name;
+  double nominal_ms;
+  uint64_t last_us = 0;
+  uint64_t count = 0;       // intervals this window
+  double max_dev_ms = 0;
+
+  void seen(uint64_t now_us) {
+    // A gap of more than 3 periods is the output being off, not drift
+    if (last_us && now_us - last_us < (uint64_t)(3 * nominal_ms * 1000)) {
+      max_dev_ms = std::max(max_dev_ms, fabs((now_us - last_us) / 1000.0 - nominal_ms));
+      count++;
+    }
+    last_us = now_us;
+  }
+  // NAN: not seen this window (the battery heartbeat stops outside a session)
+  double deviation() const { return count ? max_dev_ms : NAN; }
+};
+
+Period bmsPoll = {"bms_poll", 1000};
+Period cellLine = {"cell_line", 2000};
+Period batteryHb = {"battery_hb", 1000};
+
+// Per-window loop() figures, gathered by soakLoop()
+struct LoopWindow {
+  uint64_t passes = 0;
+  double ns_total = 0;
+  double ns_max = 0;
+  size_t q_can1 = 0;
+  size_t q_can2 = 0;
+  size_t q_bms = 0;
+};
+LoopWindow win;
+uint32_t lastMillis = 0;
+uint64_t wraps = 0;
+
+void soakLoop() {
+  win.q_can1 = std::max(win.q_can1, flexcanBus(CAN1)->pending());
+  win.q_can2 = std::max(win.q_can2, flexcanBus(CAN2)->pending());
+  win.q_bms = std::max(win.q_bms, (size_t)Serial1.available());
+  if (millis() < lastMillis) {
+    wraps++;
+    replayTimelineLine("clock", "millis() wrapped");
+  }
+  lastMillis = millis();
+
+  auto t0 = std::chrono::steady_clock::now();
+  loop();
+  const double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - t0).count();
+  win.passes++;
+  win.ns_total += ns;
+  win.ns_max = std::max(win.ns_max, ns);
+}
+
+// One value per window; rises beyond max(floor, rel * start) are flagged,
+// and so is any window over limit (0: none), warm-up included
+struct Series {
+  const char *name;
+  double floor;
+  double rel;
+  double limit;
+  std::vector<double> v;
+};
+
+// Of the windows that had a value; NAN if none did
+double median(std::vector<double> v) {
+  v.erase(std::remove_if(v.begin(), v.end(), [](double x) { return std::isnan(x); }), v.end());
+  std::sort(v.begin(), v.end());
+  return v.empty() ? NAN : v[v.size() / 2];
+}
+
+// "-" for a period not seen in the window
+const char *formatDeviation(char *buf, size_t n, double ms) {
+  if (std::isnan(ms)) snprintf(buf, n, "-");
+  else snprintf(buf, n, "%.1f", ms);
+  return buf;
+}
+
+void usage() {
+  fprintf(stderr,
+          "usage: soak_sim [--days D] [--window H] [--warmup H] [--wrap-session N] [--fault-rate P]\n"
+          "                [--seed N] [--tick-us N] [--csv FILE] [--serial FILE]\n");
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+  double days = 21, windowH = 6, warmupH = 24, faultRate = 0.3;
+  uint32_t seed = 1;
+  unsigned wrapSession = 2;
+  sim::KernelConfig kernelConfig;
+  std::string csvPath, serialPath;
+
+  for (int i = 1; i < argc; i++) {
+    auto next = [&]() -> const char * {
+      if (i + 1 >= argc) { usage(); exit(2); }
+      return argv[++i];
+    };
+    if (!strcmp(argv[i], "--days")) days = atof(next());
+    else if (!strcmp(argv[i], "--window")) windowH = atof(next());
+    else if (!strcmp(argv[i], "--warmup")) warmupH = atof(next());
+    else if (!strcmp(argv[i], "--wrap-session")) wrapSession = (unsigned)strtoul(next(), nullptr, 10);
+    else if (!strcmp(argv[i], "--fault-rate")) faultRate = atof(next());
+    else if (!strcmp(argv[i], "--seed")) seed = (uint32_t)strtoul(next(), nullptr, 10);
+    else if (!strcmp(argv[i], "--tick-us")) kernelConfig.tickUs = strtoull(next(), nullptr, 10);
+    else if (!strcmp(argv[i], "--csv")) csvPath = next();
+    else if (!strcmp(argv[i], "--serial")) serialPath = next();
+    else { usage(); return 2; }
+  }
+  if (days <= 0 || windowH <= 0 || warmupH < 0 || kernelConfig.tickUs == 0) {
+    usage();
+    return 2;
+  }
+
+  // -------------------- Day plan --------------------
+  std::mt19937 rng(seed);
+  auto uniform = [&](double lo, double hi) { return std::uniform_real_distribution<double>(lo, hi)(rng); };
+  const uint64_t endOffsetUs = (uint64_t)(days * 24 * HOUR_US);
+  std::vector<Day> plan;
+  for (uint64_t t = 0; t < endOffsetUs;) {
+    Day d;
+    d.ride = (uint64_t)(uniform(0.5, 1.5) * HOUR_US);
+    d.rest1 = (uint64_t)(uniform(1, 4) * HOUR_US);
+    d.charge = (uint64_t)(uniform(4, 7) * HOUR_US);
+    d.rest2 = (uint64_t)(uniform(2, 8) * HOUR_US);
+    d.fault = plan.size() + 1 != wrapSession && uniform(0, 1) < faultRate;
+    plan.push_back(d);
+    t += d.ride + d.rest1 + d.charge + d.rest2;
+  }
+
+  // Boot at a random sub-second phase against the wrap, so the firmware's
+  // timers do not happen to fall due on it
+  uint64_t t0 = 0;
+  if (wrapSession) {
+    uint64_t wrapOffset = WRAP_INTO_SESSION_US + std::uniform_int_distribution<uint64_t>(0, 999999)(rng);
+    for (unsigned i = 0; i + 1 < wrapSession && i < plan.size(); i++)
+      wrapOffset += plan[i].ride + plan[i].rest1 + plan[i].charge + plan[i].rest2;
+    if (wrapSession <= plan.size()) wrapOffset += plan[wrapSession - 1].ride + plan[wrapSession - 1].rest1;
+    if (wrapSession > plan.size() || wrapOffset >= endOffsetUs || wrapOffset >= 4294967296ULL * 1000) {
+      fprintf(stderr, "soak_sim: charge session %u is past the end of the run\n", wrapSession);
+      return 2;
+    }
+    t0 = 4294967296ULL * 1000 - wrapOffset;
+  }
+
+  FILE *csv = nullptr, *serialOut = nullptr;
+  if (!csvPath.empty() && !(csv = fopen(csvPath.c_str(), "w"))) {
+    fprintf(stderr, "soak_sim: cannot create %s\n", csvPath.c_str());
+    return 1;
+  }
+  if (!serialPath.empty() && !(serialOut = fopen(serialPath.c_str(), "w"))) {
+    fprintf(stderr, "soak_sim: cannot create %s\n", serialPath.c_str());
+    return 1;
+  }
+  if (serialOut) Serial.onWrite = [&](const uint8_t *d, size_t n) { fwrite(d, 1, n, serialOut); };
+  replayTimeline.out = stdout;
+  replayTimeline.frames = false;
+
+  // The observers go on before the attachments, which chain onto them
+  Serial1.onWrite = [](const uint8_t *d, size_t n) {
+    if (n == 6 && d[0] == 0x5A && d[1] == 0x5A) bmsPoll.seen(arduinoNowUs());
+  };
+  Serial2.onWrite = [](const uint8_t *d, size_t n) {
+    if (n > 0 && d[0] == 'C') cellLine.seen(arduinoNowUs());
+  };
+
+  arduinoSetNowUs(t0);
+  lastMillis = millis();
+  setup();
+  flexcanBus(CAN1)->onWrite = [](const CAN_message_t &msg) {
+    if (msg.id == 0x701) batteryHb.seen(arduinoNowUs());
+  };
+
+  sim::Kernel kernel(soakLoop, kernelConfig);
+  BatteryPackConfig packConfig;
+  packConfig.soc = 0.8f;
+  BatteryPack pack(packConfig);
+  BmsConfig bmsConfig;
+  bmsConfig.seed = seed;
+  BmsEmulator bms(&pack, bmsConfig);
+  SerialAttachment bmsLink(kernel, Serial1, bms);
+
+  SwitchedNode charger([&]() { return std::unique_ptr<CanNode>(new DeltaQCharger(&pack)); });
+  SimAttachment chargerLink(kernel, *flexcanBus(CAN1), charger);
+  const DriveProfile drive = DriveProfile::urban();
+  SwitchedNode kelly([&]() { return std::unique_ptr<CanNode>(new KellyController(drive)); });
+  SimAttachment kellyLink(kernel, *flexcanBus(CAN2), kelly);
+
+  // Sessions, counted at unplug: did the firmware charge in this one?
+  uint64_t sessions = 0, served = 0, faultsInjected = 0;
+  bool plugged = false, servedThis = false;
+  replayTimeline.onState = [&](uint8_t, uint8_t to, const char *) {
+    if (plugged && !strcmp(replayStateName(to), "RUN_CHARGING")) servedThis = true;
+  };
+
+  // -------------------- Sessions and faults --------------------
+  bool riding = false;
+
+  auto injectFault = [&](uint64_t span_us) {
+    static const char *const kinds[] = {"hw", "ac", "temp", "emcy", "bmsov", "bmssilent", "bmscorrupt"};
+    const std::string kind = kinds[std::uniform_int_distribution<int>(0, 6)(rng)];
+    const uint64_t at = kernel.now() + (uint64_t)uniform(0, (double)span_us * 0.8);
+    const uint64_t hold = (uint64_t)uniform(10e6, 600e6);
+    faultsInjected++;
+    kernel.at(at, [&, kind]() {
+      ChargerFault fault;
+      DeltaQCharger *dq = static_cast<DeltaQCharger *>(charger.node());
+      if (kind == "bmsov") {
+        int high = 0;
+        for (int i = 1; i < packConfig.cells; i++)
+          if (bms.cellVoltage(i) > bms.cellVoltage(high)) high = i;
+        bms.setCellBias(high, 4.30f - bms.cellVoltage(high));
+      }
+      else if (kind == "bmssilent") bms.setSilent(true);
+      else if (kind == "bmscorrupt") bms.config().corrupt_rate = 0.01f;
+      else if (dq && parseChargerFault(kind.c_str(), fault)) dq->inject(fault, kernel.now());
+      else return;
+      chargerLink.poke();
+      bmsLink.poke();
+      replayTimelineLine("fault", kind.c_str());
+    });
+    kernel.at(at + hold, [&, kind]() {
+      DeltaQCharger *dq = static_cast<DeltaQCharger *>(charger.node());
+      if (kind == "bmsov") for (int i = 0; i < packConfig.cells; i++) bms.setCellBias(i, 0.0f);
+      else if (kind == "bmssilent") bms.setSilent(false);
+      else if (kind == "bmscorrupt") bms.config().corrupt_rate = 0.0f;
+      else if (dq) dq->clearFaults(kernel.now());
+      chargerLink.poke();
+      bmsLink.poke();
+    });
+  };
+
+  std::function<void(size_t)> startDay = [&](size_t index) {
+    if (index == plan.size()) return;
+    const uint64_t ride = plan[index].ride, rest1 = plan[index].rest1;
+    const uint64_t charge = plan[index].charge, rest2 = plan[index].rest2;
+    const bool fault = plan[index].fault;
+    const uint64_t start = kernel.now();
+
+    riding = true;
+    kelly.on();
+    kellyLink.poke();
+    kernel.at(start + ride, [&]() {
+      riding = false;
+      kelly.off();
+    });
+    kernel.at(start + ride + rest1, [&, charge, fault]() {
+      plugged = true;
+      servedThis = false;
+      charger.on();
+      chargerLink.poke();
+      replayTimelineLine("soak", "charger plugged in");
+      if (fault) injectFault(charge);
+    });
+    kernel.at(start + ride + rest1 + charge, [&]() {
+      charger.off();
+      plugged = false;
+      sessions++;
+      served += servedThis;
+      replayTimelineLine("soak", servedThis ? "charger unplugged" : "charger unplugged, session not served");
+    });
+    kernel.at(start + ride + rest1 + charge + rest2, [&, index]() { startDay(index + 1); });
+  };
+  kernel.at(t0, [&]() { startDay(0); });
+
+  // The ride's draw: the drive cycle's motor current out of the pack
+  kernel.every(t0, 1000000, [&]() {
+    if (riding) {
+      const KellyController *k = static_cast<const KellyController *>(kelly.node());
+      if (k) pack.flow(-std::max(0.0f, k->last().current_A), 1.0f);
+    }
+    return true;
+  });
+
+  // -------------------- Windows --------------------
+  std::vector<Series> series = {
+    {"heap_used",     1024, 0.05, 0,  {}},
+    {"heap_arena",    4096, 0.05, 0,  {}},
+    {"heap_holes",    4096, 0.25, 0,  {}},
+    {"heap_chunks",   8,    0.25, 0,  {}},
+    {"q_can1",        4,    0.50, 0,  {}},
+    {"q_can2",        4,    0.50, 0,  {}},
+    {"q_bms",         128,  0.50, 0,  {}},
+    {"loop_mean_ns",  200,  0.50, 0,  {}},
+    {"bms_poll_ms",   5,    0.50, 10, {}},
+    {"cell_line_ms",  5,    0.50, 10, {}},
+    {"battery_hb_ms", 5,    0.50, 10, {}},
+  };
+  if (csv) {
+    fprintf(csv, "day,passes");
+    for (const Series &s : series) fprintf(csv, ",%s", s.name);
+    fprintf(csv, ",loop_max_ns,state\n");
+  }
+  printf("# day      heap   arena  holes/chunks  queue c1/c2/bms  loop ns mean/max  poll/cells/hb max dev ms\n");
+
+  const uint64_t windowUs = (uint64_t)(windowH * HOUR_US);
+  const uint64_t endUs = t0 + endOffsetUs;
+  // Reserved up front: the harness shares the heap it is measuring
+  const size_t windows = (size_t)((endUs - t0) / windowUs);
+  std::vector<double> windowDays;
+  windowDays.reserve(windows);
+  for (Series &s : series) s.v.reserve(windows);
+  auto wall0 = std::chrono::steady_clock::now();
+  uint64_t passes = 0;
+
+  for (uint64_t w = t0 + windowUs; w <= endUs; w += windowUs) {
+    win = LoopWindow();
+    for (Period *p : {&bmsPoll, &cellLine, &batteryHb}) p->count = 0, p->max_dev_ms = 0;
+    kernel.runUntil(w);
+    passes += win.passes;
+
+    const MemoryStats &m = memoryStats();
+    const double day = (w - t0) / (24.0 * HOUR_US);
+    const double values[] = {
+      (double)m.heap_used, (double)m.heap_arena, (double)m.heap_holes, (double)m.heap_hole_count,
+      (double)win.q_can1, (double)win.q_can2, (double)win.q_bms,
+      win.passes ? win.ns_total / win.passes : 0.0,
+      bmsPoll.deviation(), cellLine.deviation(), batteryHb.deviation(),
+    };
+    windowDays.push_back(day);
+    for (size_t i = 0; i < series.size(); i++) series[i].v.push_back(values[i]);
+
+    char poll[16], cells[16], hb[16];
+    printf("  %6.2f %9lu %7lu %6lu/%-5lu %5zu/%zu/%-5zu %7.0f/%-8.0f %6s/%s/%s  %s\n", day,
+           (unsigned long)m.heap_used, (unsigned long)m.heap_arena, (unsigned long)m.heap_holes,
+           (unsigned long)m.heap_hole_count, win.q_can1, win.q_can2, win.q_bms, values[7], win.ns_max,
+           formatDeviation(poll, sizeof(poll), values[8]), formatDeviation(cells, sizeof(cells), values[9]),
+           formatDeviation(hb, sizeof(hb), values[10]), replayStateName(replayTimeline.state));
+    fflush(stdout);
+    if (csv) {
+      fprintf(csv, "%.4f,%llu", day, (unsigned long long)win.passes);
+      for (double v : values) {
+        if (std::isnan(v)) fprintf(csv, ",");
+        else fprintf(csv, ",%.3f", v);
+      }
+      fprintf(csv, ",%.0f,%s\n", win.ns_max, replayStateName(replayTimeline.state));
+    }
+  }
+  const double wall = std::chrono::duration<double>(std::chrono::steady_clock::now() - wall0).count();
+
+  // -------------------- Trends --------------------
+  std::vector<size_t> judged;
+  for (size_t i = 0; i < windowDays.size(); i++)
+    if (windowDays[i] * 24 > warmupH) judged.push_back(i);
+
+  bool pass = true;
+  for (const Series &s : series) {
+    if (!s.limit) continue;
+    for (size_t i = 0; i < s.v.size(); i++) {
+      if (s.v[i] > s.limit) {
+        printf("# %s %.1f at day %.2f, over the limit of %.1f\n", s.name, s.v[i], windowDays[i], s.limit);
+        pass = false;
+      }
+    }
+  }
+  printf("# trends over days %.2f..%.2f (median of the last third vs the first)\n",
+         judged.empty() ? 0.0 : windowDays[judged.front()], judged.empty() ? 0.0 : windowDays[judged.back()]);
+  if (judged.size() < 6) {
+    printf("  too few windows after the warm-up to judge trends (%zu, need 6)\n", judged.size());
+  } else {
+    const size_t third = judged.size() / 3;
+    for (const Series &s : series) {
+      std::vector<double> first, last;
+      for (size_t k = 0; k < third; k++) first.push_back(s.v[judged[k]]);
+      for (size_t k = judged.size() - third; k < judged.size(); k++) last.push_back(s.v[judged[k]]);
+      const double a = median(first), b = median(last);
+      if (std::isnan(a) || std::isnan(b)) {
+        printf("  %-14s not seen in %s third  MISSING\n", s.name, std::isnan(a) ? "the first" : "the last");
+        pass = false;
+        continue;
+      }
+      const double allowed = std::max(s.floor, s.rel * fabs(a));
+      const bool rising = b - a > allowed;
+      pass = pass && !rising;
+      printf("  %-14s %12.1f -> %12.1f  (%+.1f, allowed +%.1f)  %s\n", s.name, a, b, b - a, allowed,
+             rising ? "RISING" : "ok");
+    }
+  }
+
+  const sim::KernelStats &ks = kernel.stats();
+  printf("# %.1f days virtual in %.1f s (%.0fx), %llu loop passes, %llu events, millis() wrapped %llu times\n",
+         days, wall, wall > 0 ? days * 86400 / wall : 0.0, (unsigned long long)passes,
+         (unsigned long long)ks.events, (unsigned long long)wraps);
+  printf("# %llu charge sessions, %llu served (reached RUN_CHARGING), %llu faults injected, %llu state changes\n",
+         (unsigned long long)sessions, (unsigned long long)served, (unsigned long long)faultsInjected,
+         (unsigned long long)replayTimeline.states);
+  if (served < sessions) {
+    printf("# %llu sessions not served\n", (unsigned long long)(sessions - served));
+    pass = false;
+  }
+
+  if (csv) fclose(csv);
+  if (serialOut) fclose(serialOut);
+  return pass ? 0 : 1;
+}
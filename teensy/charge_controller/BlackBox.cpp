@@ -0,0 +1,248 @@
+#include "BlackBox.h"
+#include "CanLogger.h"
+#include "DeadlineHint.h"
+#include "EventJournal.h"
+#include <SdFat.h>
+
+// 4 MB of PSRAM holds ~210k records: about 30 s with both buses fully loaded,
+// many minutes of normal charger and Kelly traffic. Without PSRAM, a 96 KB
+// OCRAM ring still holds ~4900 records, under a minute of normal traffic, so
+// long pre windows get cut to what the ring has.
+constexpr size_t BLACKBOX_PSRAM_BYTES = 4UL << 20;
+constexpr size_t BLACKBOX_RAM_BYTES = 96UL << 10;
+constexpr uint32_t DUMP_SLICE_RECORDS = 4096 / sizeof(canlog::Record);
+constexpr uint32_t DUMP_USB_RECORDS = 16;  // per call, keeps the USB buffer from blocking
+constexpr uint32_t BLACKBOX_MAX_PRE_MS = 30UL * 60 * 1000;   // well inside the micros() wrap
+
+extern "C" uint8_t external_psram_size;   // MB, set by the Teensy startup code
+
+static DMAMEM canlog::Record fallbackRing[BLACKBOX_RAM_BYTES / sizeof(canlog::Record)];
+
+static canlog::Record *ring = nullptr;
+static uint32_t head = 0;           // next slot to write
+static uint32_t pushed = 0;         // records stored since boot
+static BlackBoxConfig config;
+static const BlackBoxIdTrigger *idTriggers = nullptr;
+static size_t idTriggerCount = 0;
+
+static uint32_t postRemaining = 0;
+static uint32_t triggerMs = 0;
+static uint32_t triggerUs = 0;
+static uint32_t triggerPushed = 0;  // `pushed` when the TRIGGER record went in
+static uint32_t rearmMs = 0;
+static bool holdoff = false;
+
+static uint32_t dumpIndex = 0;      // ring slot of the next record to dump
+static uint16_t seq = 0;
+static FsFile dumpFile;
+static bool dumpStarted = false;
+static bool dumpToCard = false;
+static BlackBoxStats stats;
+
+void blackBoxBegin() {
+  if (external_psram_size > 0) {
+    ring = (canlog::Record *)extmem_malloc(BLACKBOX_PSRAM_BYTES);
+    if (ring) {
+      stats.psram = true;
+      stats.capacity = BLACKBOX_PSRAM_BYTES / sizeof(canlog::Record);
+    }
+  }
+  if (!ring) {
+    ring = fallbackRing;
+    stats.capacity = sizeof(fallbackRing) / sizeof(fallbackRing[0]);
+  }
+
+  stats.state = BlackBoxState::Recording;
+  Serial.printf("Black box: %lu records in %s\n", (unsigned long)stats.capacity,
+                stats.psram ? "PSRAM" : "OCRAM");
+}
+
+void blackBoxConfigure(const BlackBoxConfig &c) {
+  config = c;
+  if (config.pre_ms > BLACKBOX_MAX_PRE_MS) config.pre_ms = BLACKBOX_MAX_PRE_MS;
+  if (config.post_records == 0) config.post_records = 1;
+}
+
+void blackBoxSetIdTriggers(const BlackBoxIdTrigger *table, size_t count) {
+  idTriggers = table;
+  idTriggerCount = table ? count : 0;
+}
+
+static void store(const canlog::Record &r) {
+  canlog::Record &slot = ring[head];
+  slot = r;
+  slot.seq = seq++;
+  if (++head == stats.capacity) head = 0;
+  if (stats.count < stats.capacity) stats.count++;
+  pushed++;
+
+  if (stats.state == BlackBoxState::Triggered && --postRemaining == 0) {
+    stats.state = BlackBoxState::Dumping;
+  }
+}
+
+void blackBoxPush(const canlog::Record &r) {
+  if (stats.state != BlackBoxState::Recording && stats.state != BlackBoxState::Triggered) return;
+
+  store(r);
+
+  for (size_t i = 0; i < idTriggerCount; i++) {
+    const BlackBoxIdTrigger &t = idTriggers[i];
+    if (r.source == (uint8_t)t.source && (r.id & t.id_mask) == t.id) {
+      blackBoxTrigger(BlackBoxTriggerKind::Id, t.tag);
+      break;
+    }
+  }
+}
+
+void blackBoxTrigger(BlackBoxTriggerKind kind, const char *reason) {
+  if (stats.state == BlackBoxState::Off) return;
+  if (holdoff && millis() - rearmMs >= config.holdoff_ms) holdoff = false;
+  if (stats.state != BlackBoxState::Recording || holdoff) {
+    stats.suppressed++;
+    return;
+  }
+
+  snprintf(stats.reason, sizeof(stats.reason), "%s", reason);
+  triggerMs = millis();
+  triggerUs = micros();
+  triggerPushed = pushed;
+
+  canlog::Record marker;
+  memset(&marker, 0, sizeof(marker));
+  marker.t_us = triggerUs;
+  marker.id = (uint32_t)kind;
+  marker.source = (uint8_t)canlog::Source::TRIGGER;
+  marker.dlc = 8;
+  memcpy(marker.data, reason, strnlen(reason, sizeof(marker.data)));
+  store(marker);
+
+  postRemaining = config.post_records;
+  stats.state = BlackBoxState::Triggered;
+  Serial.printf("Black box triggered (%s), capturing %lu ms before and up to %lu records / %lu ms after\n",
+                stats.reason, (unsigned long)config.pre_ms, (unsigned long)config.post_records,
+                (unsigned long)config.post_ms);
+}
+
+// -------------------- Dump --------------------
+static bool openDump() {
+  SdFs *sd = canLogCard();
+  if (!sd) return false;
+
+  char name[16];
+  uint32_t index = 1;
+  for (; index < 100000; index++) {
+    snprintf(name, sizeof(name), "BBX%05lu.BIN", (unsigned long)index);
+    if (!sd->exists(name)) break;
+  }
+  if (!dumpFile.open(name, O_RDWR | O_CREAT | O_TRUNC)) return false;
+
+  canlog::FileHeader hdr;
+  memset(&hdr, 0, sizeof(hdr));
+  memcpy(hdr.magic, canlog::FILE_MAGIC, sizeof(hdr.magic));
+  hdr.version = canlog::FORMAT_RAW;
+  hdr.record_size = sizeof(canlog::Record);
+  hdr.start_ms = millis();
+  hdr.start_us = micros();
+  hdr.file_index = index;
+  if (dumpFile.write(&hdr, sizeof(hdr)) != sizeof(hdr)) {
+    dumpFile.close();
+    return false;
+  }
+
+  Serial.printf("Black box: dumping %lu records to %s\n", (unsigned long)stats.window, name);
+  return true;
+}
+
+static void printRecordHex(const canlog::Record &r) {
+  const uint8_t *p = (const uint8_t *)&r;
+  char line[8 + 2 * sizeof(r) + 1];
+  size_t n = snprintf(line, sizeof(line), "[BBX] ");
+  for (size_t i = 0; i < sizeof(r); i++) n += snprintf(line + n, sizeof(line) - n, "%02X", p[i]);
+  Serial.println(line);
+}
+
+// Logical index (0 = oldest held record) of the first record of the pre window
+static uint32_t windowStart() {
+  const uint32_t oldest = (head + stats.capacity - stats.count) % stats.capacity;
+  const uint32_t sinceTrigger = pushed - triggerPushed;
+  if (sinceTrigger >= stats.count) return 0;   // trigger already overwritten
+
+  // Records are in time order; find the first one no older than pre_ms
+  const int32_t preUs = (int32_t)(config.pre_ms * 1000);
+  uint32_t lo = 0, hi = stats.count - sinceTrigger;
+  while (lo < hi) {
+    const uint32_t mid = lo + (hi - lo) / 2;
+    if ((int32_t)(ring[(oldest + mid) % stats.capacity].t_us - triggerUs) >= -preUs) hi = mid;
+    else lo = mid + 1;
+  }
+  return lo;
+}
+
+static void finishCapture() {
+  stats.captures++;
+  journalEvent(evtlog::EventId::BlackBoxCapture, (int32_t)stats.window, (int32_t)stats.captures, 0, 0,
+               stats.reason);
+  stats.state = BlackBoxState::Recording;
+  dumpStarted = false;
+  holdoff = config.holdoff_ms > 0;
+  rearmMs = millis();
+}
+
+void blackBoxService() {
+  if (stats.state == BlackBoxState::Triggered) {
+    if (millis() - triggerMs < config.post_ms) {
+      deadlineHint(triggerMs + config.post_ms);
+      return;
+    }
+    stats.state = BlackBoxState::Dumping;
+  }
+  if (stats.state != BlackBoxState::Dumping) return;
+  deadlineHintNow();
+
+  if (!dumpStarted) {
+    dumpStarted = true;
+    const uint32_t start = windowStart();
+    stats.window = stats.count - start;
+    stats.dumped = 0;
+    dumpIndex = (head + stats.capacity - stats.count + start) % stats.capacity;
+    dumpToCard = openDump();
+    if (!dumpToCard) {
+      Serial.printf("Black box: no SD card, dumping %lu records to USB\n", (unsigned long)stats.window);
+      Serial.printf("[BBX] begin reason=%s records=%lu\n", stats.reason, (unsigned long)stats.window);
+    }
+  }
+
+  // One contiguous run of the ring per call (never across the wrap)
+  uint32_t n = stats.window - stats.dumped;
+  uint32_t limit = dumpToCard ? DUMP_SLICE_RECORDS : DUMP_USB_RECORDS;
+  if (n > limit) n = limit;
+  if (n > stats.capacity - dumpIndex) n = stats.capacity - dumpIndex;
+
+  if (dumpToCard) {
+    size_t bytes = n * sizeof(canlog::Record);
+    if (dumpFile.write(&ring[dumpIndex], bytes) != bytes) {
+      Serial.println("Black box: SD write failed, dump aborted");
+      dumpFile.close();
+      finishCapture();
+      return;
+    }
+  } else {
+    for (uint32_t i = 0; i < n; i++) printRecordHex(ring[dumpIndex + i]);
+  }
+
+  stats.dumped += n;
+  dumpIndex += n;
+  if (dumpIndex == stats.capacity) dumpIndex = 0;
+
+  if (stats.dumped == stats.window) {
+    if (dumpToCard) dumpFile.close();
+    else Serial.println("[BBX] end");
+    Serial.printf("Black box: capture %lu complete, re-armed\n", (unsigned long)(stats.captures + 1));
+    finishCapture();
+  }
+}
+
+const BlackBoxStats &blackBoxStats() {
+  return stats;
+}
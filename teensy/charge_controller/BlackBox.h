@@ -0,0 +1,83 @@
+#pragma once
+#include <Arduino.h>
+#include "CanLogFormat.h"
+
+// In-memory black box: a ring of the most recent canlog::Records (CAN frames,
+// BMS frames, state changes) kept in external PSRAM when fitted, otherwise in
+// OCRAM. Recording is a single record copy; nothing touches the card or USB
+// until a trigger.
+//
+// Triggers come from the ID table given to blackBoxSetIdTriggers(), checked
+// against every pushed record, or from blackBoxTrigger() (signal thresholds,
+// state changes; see charge_controller.ino). A trigger puts a Source::TRIGGER
+// record in the ring and keeps recording for the post window (post_records
+// more records or post_ms, whichever comes first, so the safe stop frames are
+// captured even if the buses go quiet). The ring then freezes and
+// blackBoxService() dumps the pre window (records up to pre_ms before the
+// trigger) through the end of the post window, a slice per call, to
+// BBXnnnnn.BIN on the SD card (same layout as the CAN log), or as hex lines
+// on USB serial if there is no card.
+//
+// After the dump the box re-arms, ignoring triggers for holdoff_ms, so rare
+// events are caught for days without storing the traffic around them.
+// Triggers that arrive while a capture is in progress are counted and
+// dropped.
+//
+// All functions must be called from loop() context.
+
+constexpr uint32_t BLACKBOX_POST_RECORDS = 256;
+constexpr uint32_t BLACKBOX_POST_MS = 2000;
+
+struct BlackBoxConfig {
+  uint32_t pre_ms = 30000;          // capped by what the ring holds
+  uint32_t post_ms = BLACKBOX_POST_MS;
+  uint32_t post_records = BLACKBOX_POST_RECORDS;
+  uint32_t holdoff_ms = 10000;      // after a dump, before the next trigger counts
+};
+
+// Kind of trigger, stored as the id of the Source::TRIGGER record
+enum class BlackBoxTriggerKind : uint8_t {
+  Id = 1,       // a record matched the ID table
+  Signal = 2,   // decoded signal crossed a threshold
+  State = 3,    // controller state change
+};
+
+// Fires when (record.id & id_mask) == id on the given source
+struct BlackBoxIdTrigger {
+  canlog::Source source;
+  uint32_t id;
+  uint32_t id_mask;
+  const char *tag;    // up to 6 chars
+};
+
+enum class BlackBoxState : uint8_t {
+  Off,        // blackBoxBegin() not called yet
+  Recording,
+  Triggered,  // recording the post window
+  Dumping,
+};
+
+struct BlackBoxStats {
+  BlackBoxState state = BlackBoxState::Off;
+  bool     psram = false;     // ring lives in external PSRAM
+  uint32_t capacity = 0;      // records
+  uint32_t count = 0;         // records held
+  uint32_t window = 0;        // records in the capture being dumped
+  uint32_t dumped = 0;        // records of it written out so far
+  uint32_t captures = 0;      // captures completed since boot
+  uint32_t suppressed = 0;    // triggers ignored (capture in progress or holdoff)
+  char     reason[8] = {};    // tag of the current or last capture
+};
+
+// Allocates the ring in PSRAM, falling back to the static OCRAM ring.
+void blackBoxBegin();
+void blackBoxConfigure(const BlackBoxConfig &config);
+
+// table must stay valid; pass nullptr, 0 to clear
+void blackBoxSetIdTriggers(const BlackBoxIdTrigger *table, size_t count);
+
+void blackBoxPush(const canlog::Record &r);
+void blackBoxTrigger(BlackBoxTriggerKind kind, const char *reason);
+void blackBoxService();
+
+const BlackBoxStats &blackBoxStats();
@@ -1,4 +1,5 @@
 #include "BmsDecoder.h"
+#include <string.h>
 
 // ---------------- Helper: 16-bit and 32-bit assembly ----------------
 static inline uint16_t u16(const uint8_t *d) {
@@ -118,3 +119,24 @@ BmsData decodeBmsMessage(const uint8_t *hex_array, size_t len) {
 
   return out;
 }
+
+// ---------------- UART stream ----------------
+bool bmsRxAppend(BmsRxBuffer &rx, uint8_t c) {
+  if (rx.len >= sizeof(rx.data)) {
+    rx.len = 0;
+    return false;
+  }
+  rx.data[rx.len++] = c;
+  return true;
+}
+
+const uint8_t *bmsRxFrame(const BmsRxBuffer &rx) {
+  return rx.len >= BMS_FRAME_LEN ? rx.data : nullptr;
+}
+
+void bmsRxConsume(BmsRxBuffer &rx) {
+  if (rx.len < BMS_FRAME_LEN) return;
+  const size_t remaining = rx.len - BMS_FRAME_LEN;
+  if (remaining > 0) memmove(rx.data, rx.data + BMS_FRAME_LEN, remaining);
+  rx.len = remaining;
+}
@@ -36,3 +36,21 @@ struct BmsData {
 // Main decode function
 BmsData decodeBmsMessage(const uint8_t *bytes, size_t len);
 
+// -------------------- UART stream --------------------
+// Reassembles replies from the BMS UART. Bytes go in with bmsRxAppend();
+// while bmsRxFrame() returns a frame the caller decodes it, then drops it
+// with bmsRxConsume(). Frames are the consecutive 121-byte blocks from the
+// start of the buffer.
+constexpr size_t BMS_FRAME_LEN = 121;
+
+struct BmsRxBuffer {
+  uint8_t data[160];
+  size_t len = 0;
+};
+
+// False when the buffer was already full: it is emptied to resync and the
+// byte dropped
+bool bmsRxAppend(BmsRxBuffer &rx, uint8_t c);
+// The oldest whole frame, or nullptr
+const uint8_t *bmsRxFrame(const BmsRxBuffer &rx);
+void bmsRxConsume(BmsRxBuffer &rx);
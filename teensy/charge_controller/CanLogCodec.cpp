@@ -0,0 +1,320 @@
+#include "CanLogCodec.h"
+#include <string.h>
+
+namespace canlog {
+
+static constexpr size_t HEADER_BYTES = sizeof(CodecBlockHeader);
+static constexpr size_t STREAM_BYTES = CODEC_BLOCK_BYTES - HEADER_BYTES;
+
+// Bits needed for values 0..n (the dictionary index plus its escape value)
+static inline unsigned indexBits(unsigned n) {
+  return n ? 32 - __builtin_clz(n) : 0;
+}
+
+static inline uint32_t zigzag(int32_t v) {
+  return ((uint32_t)v << 1) ^ (uint32_t)(v >> 31);
+}
+
+static inline int32_t unzigzag(uint32_t z) {
+  return (int32_t)(z >> 1) ^ -(int32_t)(z & 1);
+}
+
+static inline uint64_t loadPayload(const uint8_t *data) {
+  uint64_t v;
+  memcpy(&v, data, sizeof(v));   // little-endian on both the Teensy and the host
+  return v;
+}
+
+// -------------------- Encoder --------------------
+void BlockEncoder::begin(uint8_t *dst) {
+  dst_ = dst;
+  out_ = dst + HEADER_BYTES;
+  pos_ = 0;
+  acc_ = 0;
+  accBits_ = 0;
+  records_ = 0;
+  keyCount_ = 0;
+}
+
+void BlockEncoder::put(uint32_t value, unsigned bits) {
+  if (!bits) return;
+  acc_ = (acc_ << bits) | (bits < 32 ? value & ((1UL << bits) - 1) : value);
+  accBits_ += bits;
+  while (accBits_ >= 8) {
+    accBits_ -= 8;
+    out_[pos_++] = (uint8_t)(acc_ >> accBits_);
+  }
+}
+
+int BlockEncoder::keyIndex(const Record &r) const {
+  for (int i = 0; i < keyCount_; i++) {
+    if (keys_[i].id == r.id && keys_[i].source == r.source) return i;
+  }
+  return -1;
+}
+
+bool BlockEncoder::add(const Record &r) {
+  if ((pos_ + 1) * 8 + CODEC_MAX_RECORD_BITS > STREAM_BYTES * 8) return false;
+  if (records_ == 0xFFFF) return false;
+
+  if (records_ == 0) {
+    tFirst_ = lastT_ = r.t_us;
+    seqFirst_ = r.seq;
+  }
+
+  int k = keyIndex(r);
+  const unsigned width = indexBits(keyCount_);
+  CodecKeyState *ks;
+
+  if (k < 0) {
+    put(keyCount_, width);
+    put(r.source, 8);
+    put(r.id, 32);
+
+    const uint32_t delta = r.t_us - lastT_;
+    if (delta < 0x10000) {
+      put(0, 1);
+      put(delta, 16);
+    } else {
+      put(1, 1);
+      put(delta, 32);
+    }
+
+    if (keyCount_ < CODEC_MAX_KEYS) {
+      ks = &keys_[keyCount_++];
+    } else {
+      ks = &keys_[CODEC_MAX_KEYS - 1];   // full: the last slot is recycled
+    }
+    ks->source = r.source;
+    ks->id = r.id;
+    ks->dlc = 0;
+    ks->lead = 0xFF;                     // no XOR window yet
+    ks->trail = 0;
+    ks->delta = 0;
+    ks->payload = 0;
+  } else {
+    ks = &keys_[k];
+    put((uint32_t)k, width);
+
+    const uint32_t delta = r.t_us - ks->t_us;
+    const uint32_t z = zigzag((int32_t)(delta - ks->delta));
+    if (z == 0) {
+      put(0, 1);
+    } else if (z < (1UL << 7)) {
+      put(0b10, 2);
+      put(z, 7);
+    } else if (z < (1UL << 9)) {
+      put(0b110, 3);
+      put(z, 9);
+    } else if (z < (1UL << 12)) {
+      put(0b1110, 4);
+      put(z, 12);
+    } else if (z < (1UL << 20)) {
+      put(0b11110, 5);
+      put(z, 20);
+    } else {
+      put(0b11111, 5);
+      put(delta, 32);
+    }
+    ks->delta = delta;
+  }
+  ks->t_us = r.t_us;
+  lastT_ = r.t_us;
+
+  const uint8_t dlc = r.dlc & 0x0F;
+  if (dlc == ks->dlc) {
+    put(0, 1);
+  } else {
+    put(1, 1);
+    put(dlc, 4);
+    ks->dlc = dlc;
+  }
+
+  const uint64_t payload = loadPayload(r.data);
+  const uint64_t x = payload ^ ks->payload;
+  if (x == 0) {
+    put(0, 1);
+  } else {
+    const unsigned lead = __builtin_clzll(x);
+    const unsigned trail = __builtin_ctzll(x);
+    unsigned len;
+    uint64_t bits;
+    if (ks->lead != 0xFF && lead >= ks->lead && trail >= ks->trail) {
+      put(0b10, 2);
+      len = 64 - ks->lead - ks->trail;
+      bits = x >> ks->trail;
+    } else {
+      len = 64 - lead - trail;
+      put(0b11, 2);
+      put(lead, 6);
+      put(len - 1, 6);
+      bits = x >> trail;
+      ks->lead = (uint8_t)lead;
+      ks->trail = (uint8_t)trail;
+    }
+    if (len > 32) {
+      put((uint32_t)(bits >> 32), len - 32);
+      put((uint32_t)bits, 32);
+    } else {
+      put((uint32_t)bits, len);
+    }
+    ks->payload = payload;
+  }
+
+  records_++;
+  return true;
+}
+
+void BlockEncoder::writeHeader(size_t bytes) {
+  CodecBlockHeader hdr;
+  hdr.magic = CODEC_BLOCK_MAGIC;
+  hdr.records = records_;
+  hdr.bytes = (uint16_t)bytes;
+  hdr.t_first_us = tFirst_;
+  hdr.seq_first = seqFirst_;
+  hdr.reserved = 0;
+  memcpy(dst_, &hdr, sizeof(hdr));
+}
+
+size_t BlockEncoder::snapshot() {
+  size_t n = pos_;
+  if (accBits_) out_[n++] = (uint8_t)(acc_ << (8 - accBits_));   // put() rewrites it in full
+  writeHeader(n);
+  return HEADER_BYTES + n;
+}
+
+void BlockEncoder::finish() {
+  if (accBits_) {
+    out_[pos_++] = (uint8_t)(acc_ << (8 - accBits_));
+    accBits_ = 0;
+  }
+  writeHeader(pos_);
+  memset(out_ + pos_, 0, STREAM_BYTES - pos_);
+}
+
+// -------------------- Decoder --------------------
+namespace {
+
+class BitReader {
+public:
+  BitReader(const uint8_t *p, size_t n) : p_(p), n_(n) {}
+
+  uint32_t get(unsigned bits) {
+    if (!bits) return 0;
+    while (accBits_ < bits) {
+      acc_ = (acc_ << 8) | (pos_ < n_ ? p_[pos_] : 0);
+      if (pos_++ >= n_) overrun_ = true;
+      accBits_ += 8;
+    }
+    accBits_ -= bits;
+    return (uint32_t)(acc_ >> accBits_) & (bits < 32 ? (1UL << bits) - 1 : 0xFFFFFFFFUL);
+  }
+
+  // Unary prefix of up to max one bits, stopping at the first zero
+  unsigned ones(unsigned max) {
+    unsigned n = 0;
+    while (n < max && get(1)) n++;
+    return n;
+  }
+
+  bool overrun() const { return overrun_; }
+
+private:
+  const uint8_t *p_;
+  size_t n_;
+  size_t pos_ = 0;
+  uint64_t acc_ = 0;
+  unsigned accBits_ = 0;
+  bool overrun_ = false;
+};
+
+} // namespace
+
+int decodeBlock(const uint8_t *block, Record *out, CodecBlockHeader *header) {
+  CodecBlockHeader hdr;
+  memcpy(&hdr, block, sizeof(hdr));
+  if (header) *header = hdr;
+  if (hdr.magic != CODEC_BLOCK_MAGIC || hdr.bytes > STREAM_BYTES || hdr.records > CODEC_MAX_BLOCK_RECORDS) {
+    return -1;
+  }
+
+  static const unsigned dodBits[] = {0, 7, 9, 12, 20};
+  CodecKeyState keys[CODEC_MAX_KEYS];
+  unsigned keyCount = 0;
+  uint32_t lastT = hdr.t_first_us;
+  BitReader in(block + HEADER_BYTES, hdr.bytes);
+
+  for (unsigned i = 0; i < hdr.records; i++) {
+    const uint32_t k = in.get(indexBits(keyCount));
+    CodecKeyState *ks;
+
+    if (k == keyCount) {
+      const uint8_t source = (uint8_t)in.get(8);
+      const uint32_t id = in.get(32);
+      const uint32_t delta = in.get(1) ? in.get(32) : in.get(16);
+
+      ks = &keys[keyCount < CODEC_MAX_KEYS ? keyCount++ : CODEC_MAX_KEYS - 1];
+      ks->source = source;
+      ks->id = id;
+      ks->dlc = 0;
+      ks->lead = 0xFF;
+      ks->trail = 0;
+      ks->delta = 0;
+      ks->payload = 0;
+      ks->t_us = lastT + delta;
+    } else if (k < keyCount) {
+      ks = &keys[k];
+      const unsigned prefix = in.ones(5);
+      uint32_t delta;
+      if (prefix == 5) {
+        delta = in.get(32);
+      } else {
+        delta = ks->delta + (uint32_t)unzigzag(in.get(dodBits[prefix]));
+      }
+      ks->delta = delta;
+      ks->t_us += delta;
+    } else {
+      return -1;
+    }
+    lastT = ks->t_us;
+
+    if (in.get(1)) ks->dlc = (uint8_t)in.get(4);
+
+    if (in.get(1)) {
+      unsigned lead, trail;
+      if (in.get(1)) {
+        lead = in.get(6);
+        const unsigned len = in.get(6) + 1;
+        if (lead + len > 64) return -1;
+        trail = 64 - lead - len;
+        ks->lead = (uint8_t)lead;
+        ks->trail = (uint8_t)trail;
+      } else {
+        if (ks->lead == 0xFF) return -1;
+        lead = ks->lead;
+        trail = ks->trail;
+      }
+      const unsigned len = 64 - lead - trail;
+      uint64_t bits;
+      if (len > 32) {
+        bits = (uint64_t)in.get(len - 32) << 32;
+        bits |= in.get(32);
+      } else {
+        bits = in.get(len);
+      }
+      ks->payload ^= bits << trail;
+    }
+    if (in.overrun()) return -1;
+
+    Record &r = out[i];
+    r.t_us = ks->t_us;
+    r.id = ks->id;
+    r.source = ks->source;
+    r.dlc = ks->dlc;
+    r.seq = (uint16_t)(hdr.seq_first + i);
+    memcpy(r.data, &ks->payload, sizeof(r.data));
+  }
+  return hdr.records;
+}
+
+} // namespace canlog
@@ -0,0 +1,96 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#include "CanLogFormat.h"
+
+// Block compressor for canlog::Records (FORMAT_COMPRESSED log files).
+//
+// Records are packed into independent CODEC_BLOCK_BYTES blocks: all state is
+// reset at each block, so a block decodes on its own. Per record:
+//
+//   key      index into the block's (source, id) dictionary, log2(size + 1)
+//            bits; the value == size escapes to a new entry: 8-bit source +
+//            32-bit id, which is then appended.
+//   time     new key: '0' + 16 or '1' + 32 bits of delta to the previous
+//            record. Known key: delta-of-delta against that key's previous
+//            delta, zigzagged: '0' (same period), '10'+7, '110'+9, '1110'+12,
+//            '11110'+20 bits, or '11111' + the raw 32-bit delta.
+//   dlc      '0' same as the key's previous dlc, else '1' + 4 bits.
+//   payload  XOR with the key's previous payload, as in Gorilla: '0' no
+//            change; '10' + the bits inside the previous leading/trailing
+//            zero window; '11' + 6-bit leading zeros + 6-bit (length - 1) +
+//            the meaningful bits.
+//
+// Sequence numbers are implicit: seq_first in the block header plus the
+// record's position.
+
+namespace canlog {
+
+constexpr size_t CODEC_BLOCK_BYTES = 4096;
+constexpr uint32_t CODEC_BLOCK_MAGIC = 0x315A4243;   // "CBZ1"
+constexpr size_t CODEC_MAX_KEYS = 255;
+constexpr size_t CODEC_MAX_RECORD_BITS = 8 + 40 + 37 + 5 + 78;
+constexpr size_t CODEC_MAX_BLOCK_RECORDS = (CODEC_BLOCK_BYTES - 16) * 8 / 4;
+
+struct CodecBlockHeader {
+  uint32_t magic;        // CODEC_BLOCK_MAGIC
+  uint16_t records;
+  uint16_t bytes;        // bitstream bytes after the header
+  uint32_t t_first_us;   // time of record 0
+  uint16_t seq_first;    // seq of record 0
+  uint16_t reserved;
+};
+static_assert(sizeof(CodecBlockHeader) == 16, "CodecBlockHeader layout");
+
+struct CodecKeyState {
+  uint8_t  source;
+  uint8_t  dlc;
+  uint8_t  lead;         // XOR window of the previous payload change
+  uint8_t  trail;
+  uint32_t id;
+  uint32_t t_us;
+  uint32_t delta;
+  uint64_t payload;
+};
+
+class BlockEncoder {
+public:
+  // Starts a block in dst (CODEC_BLOCK_BYTES long).
+  void begin(uint8_t *dst);
+
+  // Appends a record; false (nothing written) if the block is full.
+  bool add(const Record &r);
+
+  // Writes the block header for the records so far and the last partial
+  // byte, so the block decodes as it stands; add() carries on after it.
+  // Returns the bytes in use from the start of the block.
+  size_t snapshot();
+
+  // Writes the block header and zero-fills the rest of the block.
+  void finish();
+
+  uint16_t records() const { return records_; }
+
+private:
+  void put(uint32_t value, unsigned bits);
+  void writeHeader(size_t bytes);
+  int keyIndex(const Record &r) const;
+
+  uint8_t *dst_ = nullptr;
+  uint8_t *out_ = nullptr;
+  size_t   pos_ = 0;          // bytes written to the bitstream
+  uint64_t acc_ = 0;
+  unsigned accBits_ = 0;
+  uint16_t records_ = 0;
+  uint32_t lastT_ = 0;
+  uint32_t tFirst_ = 0;
+  uint16_t seqFirst_ = 0;
+  uint16_t keyCount_ = 0;
+  CodecKeyState keys_[CODEC_MAX_KEYS];
+};
+
+// Decodes one block into out (room for CODEC_MAX_BLOCK_RECORDS). Returns the
+// record count, or -1 if the block is not valid.
+int decodeBlock(const uint8_t *block, Record *out, CodecBlockHeader *header = nullptr);
+
+} // namespace canlog
@@ -0,0 +1,73 @@
+#pragma once
+#include <stdint.h>
+
+// Binary CAN log format written by CanLogger (SD card) and read by the host
+// tools in host/. Everything is little-endian.
+//
+// File layout:
+//   sector 0      FileHeader, zero padded to 512 bytes
+//   sector 1..    FORMAT_RAW: back-to-back 20-byte Records (records may
+//                 span sectors). Black box dumps use this.
+//                 FORMAT_COMPRESSED: 4 KB blocks of Records packed by
+//                 CanLogCodec.h, each decodable on its own. CAN logs use this.
+//
+// Files are preallocated, so the tail after the last real record holds
+// whatever was on the card. Readers stop at the first record (or block)
+// whose source is 0, whose block magic is wrong, or whose seq does not
+// follow the previous one.
+//
+// t_us is micros() and wraps every ~71.6 minutes. Readers unwrap it by
+// adding 2^32 whenever it steps backwards; the BMS is polled every second,
+// so consecutive records are never that far apart.
+
+namespace canlog {
+
+constexpr char FILE_MAGIC[8] = {'C', 'B', '5', '5', 'C', 'A', 'N', '1'};
+constexpr uint16_t FORMAT_RAW = 1;
+constexpr uint16_t FORMAT_COMPRESSED = 2;
+constexpr uint32_t SECTOR_SIZE = 512;
+
+enum class Source : uint8_t {
+  None    = 0,   // never written; marks the end of valid data
+  CAN1_RX = 1,
+  CAN1_TX = 2,
+  CAN2_RX = 3,
+  CAN2_TX = 4,
+  CAN3_RX = 5,
+  CAN3_TX = 6,
+  BMS_RX  = 16,  // BMS reply, 8-byte chunks; id = byte offset in the frame
+  BMS_TX  = 17,  // BMS request bytes
+  DROPPED = 32,  // id = number of records lost before this one
+  STATE   = 48,  // controller state change: data[0] = from, data[1] = to,
+                 // data[2..7] = reason tag (ASCII, zero padded)
+  TRIGGER = 49,  // black box capture trigger: id = BlackBoxTriggerKind,
+                 // data = reason tag (ASCII, zero padded)
+};
+
+constexpr uint32_t ID_EXTENDED = 0x80000000UL;  // flag bit in Record::id
+
+struct Record {
+  uint32_t t_us;
+  uint32_t id;       // CAN id | ID_EXTENDED, or source specific (see Source)
+  uint8_t  source;   // Source
+  uint8_t  dlc;      // valid bytes in data
+  uint16_t seq;      // running record counter, low 16 bits
+  uint8_t  data[8];
+};
+static_assert(sizeof(Record) == 20, "canlog::Record must stay 20 bytes");
+
+struct FileHeader {
+  char     magic[8];      // FILE_MAGIC
+  uint16_t version;       // FORMAT_RAW or FORMAT_COMPRESSED
+  uint16_t record_size;   // sizeof(Record)
+  uint32_t start_ms;      // millis() when the file was opened
+  uint32_t start_us;      // micros() at the same moment
+  uint32_t can1_baud;
+  uint32_t can2_baud;
+  uint32_t file_index;    // n in CANnnnnn.BIN
+  uint32_t block_bytes;   // FORMAT_COMPRESSED block size, 0 for FORMAT_RAW
+  uint8_t  reserved[SECTOR_SIZE - 36];
+};
+static_assert(sizeof(FileHeader) == SECTOR_SIZE, "canlog::FileHeader must fill one sector");
+
+} // namespace canlog
@@ -0,0 +1,371 @@
+#include "CanLogger.h"
+#include "BlackBox.h"
+#include "CanLogCodec.h"
+#include "EventJournal.h"
+#include <SdFat.h>
+
+// Two 32 KB buffers in OCRAM (DMAMEM), each eight compressed blocks. With
+// CAN1 and CAN2 at full load (~6.7k frames/s) and periodic traffic packing to
+// ~4 bytes per frame, one buffer covers over a second of SD latency before
+// anything is dropped.
+constexpr size_t LOG_BUFFER_BYTES = 32768;
+constexpr size_t LOG_WRITE_SLICE = 4096;            // bytes per canLogService() call
+constexpr uint64_t LOG_FILE_BYTES = 128ULL << 20;   // preallocated size of each file
+// At charging traffic rates a buffer takes minutes to fill, so what it holds
+// is also written out in place this often (see flushStep()). Each flush
+// rewrites the open block's header sector and the sector its data ended in,
+// so short intervals cost card bytes: at ~80 records/s, 2 s halves the
+// codec's ratio on the card, 10 s keeps over 80% of it.
+constexpr uint32_t LOG_FLUSH_MS = 10000;
+
+static_assert(LOG_BUFFER_BYTES % canlog::SECTOR_SIZE == 0, "log buffers must be sector multiples");
+static_assert(LOG_BUFFER_BYTES % LOG_WRITE_SLICE == 0, "write slices must tile a buffer");
+static_assert(LOG_BUFFER_BYTES % canlog::CODEC_BLOCK_BYTES == 0, "codec blocks must tile a buffer");
+static_assert(canlog::CODEC_BLOCK_BYTES % canlog::SECTOR_SIZE == 0, "codec blocks must be sector multiples");
+static_assert(canlog::CODEC_BLOCK_BYTES % LOG_WRITE_SLICE == 0, "write slices must tile a block");
+
+static DMAMEM uint8_t logBuf[2][LOG_BUFFER_BYTES] __attribute__((aligned(32)));
+
+static SdFs sd;
+static bool cardMounted = false;
+static FsFile logFile;
+static CanLogStats stats;
+
+static uint32_t can1BaudCfg = 0, can2BaudCfg = 0;
+static canlog::BlockEncoder encoder;    // fills the open block
+static uint8_t active = 0;              // buffer being filled
+static size_t block = 0;                // open block in the active buffer
+static bool pending[2] = {false, false}; // handed off, waiting to be written
+static size_t pendingOffset = 0;        // next byte of the pending buffer to write
+static uint32_t bufFileOffset[2] = {0, 0}; // where each buffer starts in the file
+static uint32_t filePos = 0;            // the file's write position
+// What of the active buffer is already on the card: every block before
+// flushedBlock, and flushedBlock up to the sector at flushedTail, as it
+// stood with flushedRecords records
+static size_t flushedBlock = 0;
+static size_t flushedTail = 0;
+static uint16_t flushedRecords = 0;
+static bool flushDue = false;
+static elapsedMillis sinceFlush;        // since the active buffer was last on the card
+static uint16_t seq = 0;
+static uint32_t unreportedDrops = 0;
+
+// -------------------- File handling --------------------
+static bool openLogFile() {
+  char name[16];
+  for (; stats.file_index < 100000; stats.file_index++) {
+    snprintf(name, sizeof(name), "CAN%05lu.BIN", (unsigned long)stats.file_index);
+    if (!sd.exists(name)) break;
+  }
+
+  if (!logFile.open(name, O_RDWR | O_CREAT | O_TRUNC)) {
+    Serial.printf("CAN log: cannot create %s\n", name);
+    return false;
+  }
+
+  // Contiguous preallocation keeps each write a plain multi-sector transfer
+  // (no FAT/bitmap updates while logging).
+  if (!logFile.preAllocate(LOG_FILE_BYTES)) {
+    Serial.printf("CAN log: preallocation of %s failed, writes may stall\n", name);
+  }
+
+  canlog::FileHeader hdr;
+  memset(&hdr, 0, sizeof(hdr));
+  memcpy(hdr.magic, canlog::FILE_MAGIC, sizeof(hdr.magic));
+  hdr.version = canlog::FORMAT_COMPRESSED;
+  hdr.record_size = sizeof(canlog::Record);
+  hdr.start_ms = millis();
+  hdr.start_us = micros();
+  hdr.can1_baud = can1BaudCfg;
+  hdr.can2_baud = can2BaudCfg;
+  hdr.file_index = stats.file_index;
+  hdr.block_bytes = canlog::CODEC_BLOCK_BYTES;
+
+  if (logFile.write(&hdr, sizeof(hdr)) != sizeof(hdr)) {
+    logFile.close();
+    return false;
+  }
+  // The directory entry only learns the cluster chain and size on sync; the
+  // bike's shutdown is a power cut, so never leave it to close
+  logFile.sync();
+  stats.bytes_written = sizeof(hdr);
+  stats.card_bytes += sizeof(hdr);
+  filePos = sizeof(hdr);
+
+  Serial.printf("CAN log: writing %s\n", name);
+  return true;
+}
+
+static void closeLogFile() {
+  logFile.seekSet(stats.bytes_written);
+  logFile.truncate();   // drop the unused preallocation
+  logFile.close();
+}
+
+static void stopLogging(const char *why) {
+  Serial.printf("CAN log: %s, logging stopped\n", why);
+  closeLogFile();
+  stats.active = false;
+}
+
+// -------------------- Buffering --------------------
+
+static uint8_t *blockAt(uint8_t buf, size_t index) {
+  return &logBuf[buf][index * canlog::CODEC_BLOCK_BYTES];
+}
+
+// Writes len bytes of buffer buf from offset off to where they belong in the
+// file. Stops logging if the card fails.
+static bool writeAt(uint8_t buf, size_t off, size_t len) {
+  const uint32_t pos = bufFileOffset[buf] + (uint32_t)off;
+  if ((pos != filePos && !logFile.seekSet(pos)) || logFile.write(&logBuf[buf][off], len) != len) {
+    stopLogging("SD write failed");
+    return false;
+  }
+  filePos = pos + (uint32_t)len;
+  if (filePos > stats.bytes_written) stats.bytes_written = filePos;
+  stats.card_bytes += len;
+  return true;
+}
+
+static void sealBlock() {
+  encoder.finish();
+  stats.blocks++;
+  stats.block_records += encoder.records();
+}
+
+// Hands the full active buffer to canLogService(), which writes it from the
+// first block not yet on the card, and starts filling the other one
+static void handOff() {
+  pending[active] = true;
+  pendingOffset = flushedBlock * canlog::CODEC_BLOCK_BYTES;
+  bufFileOffset[active ^ 1] = bufFileOffset[active] + LOG_BUFFER_BYTES;
+  active ^= 1;
+  block = 0;
+  flushedBlock = 0;
+  flushedTail = 0;
+  flushedRecords = 0;
+  flushDue = false;
+  sinceFlush = 0;
+}
+
+// Seals the open block and opens the next one, moving to the other buffer
+// after the last block. Fails (leaving the full block open) if that buffer is
+// still being written.
+static bool nextBlock() {
+  if (block + 1 == LOG_BUFFER_BYTES / canlog::CODEC_BLOCK_BYTES) {
+    if (pending[active ^ 1]) return false;
+    sealBlock();
+    handOff();
+  } else {
+    sealBlock();
+    block++;
+  }
+  encoder.begin(blockAt(active, block));
+  return true;
+}
+
+// One step of putting the active buffer on the card, at most a block and a
+// sector per call: the rest of the oldest sealed block not yet written, or
+// once they are all out, the open block's header sector and the sectors
+// from the last flush's tail to the end of its data. Returns true when the
+// buffer is on the card as it stands.
+static bool flushStep() {
+  constexpr size_t BLOCK = canlog::CODEC_BLOCK_BYTES;
+  constexpr size_t SECTOR = canlog::SECTOR_SIZE;
+  const size_t start = flushedBlock * BLOCK;
+
+  if (flushedBlock < block) {
+    // Sealed since the last step: its header and what followed the tail
+    if (!writeAt(active, flushedTail, start + BLOCK - flushedTail)) return false;
+    if (flushedTail > start && !writeAt(active, start, SECTOR)) return false;
+    flushedBlock++;
+    flushedTail = flushedBlock * BLOCK;
+    flushedRecords = 0;
+    return false;
+  }
+
+  if (encoder.records() == flushedRecords) return true;
+  const size_t used = start + encoder.snapshot();
+  const size_t end = (used + SECTOR - 1) / SECTOR * SECTOR;
+  if (!writeAt(active, flushedTail, end - flushedTail)) return false;
+  if (flushedTail > start && !writeAt(active, start, SECTOR)) return false;
+  flushedTail = used / SECTOR * SECTOR;
+  flushedRecords = encoder.records();
+  return true;
+}
+
+// Compresses r into the open block. All or nothing.
+static bool appendRecord(const canlog::Record &r) {
+  if (encoder.add(r)) return true;
+  return nextBlock() && encoder.add(r);
+}
+
+static void pushRecord(canlog::Record &r) {
+  blackBoxPush(r);
+  if (!stats.active) return;
+
+  if (unreportedDrops) {
+    canlog::Record marker;
+    memset(&marker, 0, sizeof(marker));
+    marker.t_us = r.t_us;
+    marker.id = unreportedDrops;
+    marker.source = (uint8_t)canlog::Source::DROPPED;
+    marker.seq = seq;
+    if (!appendRecord(marker)) {
+      unreportedDrops++;
+      stats.dropped++;
+      return;
+    }
+    seq++;
+    journalEvent(evtlog::EventId::LogDropped, (int32_t)unreportedDrops);
+    unreportedDrops = 0;
+  }
+
+  r.seq = seq;
+  if (!appendRecord(r)) {
+    unreportedDrops++;
+    stats.dropped++;
+    return;
+  }
+  seq++;
+  stats.records++;
+}
+
+// -------------------- Public API --------------------
+bool canLogBegin(uint32_t can1Baud, uint32_t can2Baud) {
+  can1BaudCfg = can1Baud;
+  can2BaudCfg = can2Baud;
+
+  if (!sd.begin(SdioConfig(FIFO_SDIO))) {
+    Serial.println("CAN log: no SD card, logging disabled");
+    return false;
+  }
+  cardMounted = true;
+
+  stats = CanLogStats();
+  stats.file_index = 1;
+  if (!openLogFile()) return false;
+
+  active = 0;
+  block = 0;
+  encoder.begin(blockAt(active, block));
+  pending[0] = pending[1] = false;
+  pendingOffset = 0;
+  bufFileOffset[0] = sizeof(canlog::FileHeader);
+  flushedBlock = 0;
+  flushedTail = 0;
+  flushedRecords = 0;
+  flushDue = false;
+  sinceFlush = 0;
+  stats.active = true;
+  return true;
+}
+
+void canLogFrame(canlog::Source src, const CAN_message_t &msg) {
+  canlog::Record r;
+  r.t_us = micros();
+  r.id = msg.id | (msg.flags.extended ? canlog::ID_EXTENDED : 0);
+  r.source = (uint8_t)src;
+  r.dlc = (msg.len > 8) ? 8 : msg.len;
+  memcpy(r.data, msg.buf, 8);
+  pushRecord(r);
+}
+
+void canLogBytes(canlog::Source src, const uint8_t *data, size_t len) {
+  const uint32_t now = micros();
+  for (size_t off = 0; off < len; off += 8) {
+    canlog::Record r;
+    memset(&r, 0, sizeof(r));
+    r.t_us = now;
+    r.id = off;
+    r.source = (uint8_t)src;
+    r.dlc = (len - off < 8) ? (uint8_t)(len - off) : 8;
+    memcpy(r.data, data + off, r.dlc);
+    pushRecord(r);
+  }
+}
+
+void canLogState(uint8_t from, uint8_t to, const char *reason) {
+  canlog::Record r;
+  memset(&r, 0, sizeof(r));
+  r.t_us = micros();
+  r.source = (uint8_t)canlog::Source::STATE;
+  r.dlc = 8;
+  r.data[0] = from;
+  r.data[1] = to;
+  memcpy(&r.data[2], reason, strnlen(reason, 6));   // zero padded, not terminated
+  pushRecord(r);
+}
+
+void canLogService() {
+  if (!stats.active) return;
+
+  const uint8_t idx = active ^ 1;
+  if (!pending[idx]) {
+    if (sinceFlush >= LOG_FLUSH_MS) flushDue = true;
+    if (!flushDue) return;
+    if (flushStep() && stats.active) {
+      logFile.sync();
+      flushDue = false;
+      sinceFlush = 0;
+    }
+    return;
+  }
+
+  const uint32_t t0 = micros();
+  if (!writeAt(idx, pendingOffset, LOG_WRITE_SLICE)) return;
+  const uint32_t dt = micros() - t0;
+  if (dt > stats.max_write_us) stats.max_write_us = dt;
+
+  pendingOffset += LOG_WRITE_SLICE;
+  if (pendingOffset < LOG_BUFFER_BYTES) return;
+
+  pending[idx] = false;
+  pendingOffset = 0;
+  logFile.sync();
+
+  // Start the next file once this one cannot take another full buffer
+  if (bufFileOffset[active] + LOG_BUFFER_BYTES > LOG_FILE_BYTES) {
+    closeLogFile();
+    stats.file_index++;
+    bufFileOffset[active] = sizeof(canlog::FileHeader);
+    flushedBlock = 0;
+    flushedTail = 0;
+    flushedRecords = 0;
+    if (!openLogFile()) stopLogging("cannot open next file");
+  }
+}
+
+void canLogEnd() {
+  if (!stats.active) return;
+
+  const uint8_t idx = active ^ 1;
+  if (pending[idx]) {
+    if (!writeAt(idx, pendingOffset, LOG_BUFFER_BYTES - pendingOffset)) return;
+    pending[idx] = false;
+    pendingOffset = 0;
+  }
+  size_t blocks = block;
+  if (encoder.records()) {
+    sealBlock();
+    blocks++;
+  }
+  const size_t from = flushedBlock * canlog::CODEC_BLOCK_BYTES;
+  if (blocks * canlog::CODEC_BLOCK_BYTES > from &&
+      !writeAt(active, from, blocks * canlog::CODEC_BLOCK_BYTES - from)) {
+    return;
+  }
+  block = 0;
+
+  closeLogFile();
+  stats.active = false;
+}
+
+const CanLogStats &canLogStats() {
+  return stats;
+}
+
+SdFs *canLogCard() {
+  return cardMounted ? &sd : nullptr;
+}
@@ -0,0 +1,58 @@
+#pragma once
+#include <Arduino.h>
+#include <FlexCAN_T4.h>
+#include "CanLogFormat.h"
+
+class SdFs;
+
+// Raw CAN/BMS logger to the Teensy 4.1 built-in SD slot (see CanLogFormat.h).
+//
+// Records are compressed as they are appended (CanLogCodec.h, ~3-5 bytes per
+// frame instead of 20) into 4 KB blocks in one of two RAM buffers. When a
+// buffer is full it is handed to canLogService(), which writes it to a
+// preallocated file a few sectors per call from the idle end of loop() and
+// syncs the file once it is out. Every 10 s it also writes, in place, what the
+// filling buffer has gained: whole sealed blocks, then the open block's
+// header sector and the sectors its data grew into, so a power cut loses at
+// most the last 10 s. Appending never touches the card. If both buffers are
+// full the record is dropped and counted, and a DROPPED marker goes into the
+// log once there is room again.
+//
+// Every record is also offered to the black box (BlackBox.h), whether or not
+// the card is logging.
+//
+// All functions must be called from loop() context. FlexCAN_T4 receive
+// callbacks run from events(), so logging from them is fine.
+
+struct CanLogStats {
+  bool     active = false;
+  uint32_t file_index = 0;
+  uint32_t records = 0;       // records accepted into the buffers
+  uint32_t dropped = 0;       // records lost because both buffers were full
+  uint32_t bytes_written = 0; // size of the current file so far
+  uint32_t card_bytes = 0;    // bytes sent to the card, sector rewrites included
+  uint32_t blocks = 0;        // compressed blocks sealed
+  uint32_t block_records = 0; // records in those blocks
+  uint32_t max_write_us = 0;  // slowest single write slice
+};
+
+// Mounts the card and opens the first free CANnnnnn.BIN. Returns false (and
+// leaves logging disabled) if there is no card.
+bool canLogBegin(uint32_t can1Baud, uint32_t can2Baud);
+
+void canLogFrame(canlog::Source src, const CAN_message_t &msg);
+void canLogBytes(canlog::Source src, const uint8_t *data, size_t len);
+
+// Controller state change (Source::STATE); reason is a short tag, up to 6 chars.
+void canLogState(uint8_t from, uint8_t to, const char *reason);
+
+// Writes pending data; call once per loop() after the control work.
+void canLogService();
+
+// Flushes everything buffered, trims the preallocation and closes the file.
+void canLogEnd();
+
+const CanLogStats &canLogStats();
+
+// The mounted SD card, or nullptr if there is none.
+SdFs *canLogCard();
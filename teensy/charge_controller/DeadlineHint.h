@@ -0,0 +1,17 @@
+#pragma once
+#include <Arduino.h>
+
+// Deadline hints for the host simulation kernel (host/sim). elapsedMillis
+// comparisons hint by themselves on the host; code that waits on plain
+// millis() arithmetic calls deadlineHint() with the millis() value at which
+// it next has work, so virtual time can jump straight there. On the Teensy
+// these compile to nothing.
+
+#ifdef ARDUINO_HOST_SHIM
+inline void deadlineHint(uint32_t at_ms) { arduinoWakeAtMs(at_ms); }
+#else
+inline void deadlineHint(uint32_t) {}
+#endif
+
+// Work is still pending (e.g. a dump in slices): run loop() again right away
+inline void deadlineHintNow() { deadlineHint(millis()); }
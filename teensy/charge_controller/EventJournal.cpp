@@ -0,0 +1,135 @@
+#include "EventJournal.h"
+#include "CanLogger.h"
+#include <SdFat.h>
+#include <atomic>
+
+// 256 records (8 KB) absorb bursts between journalService() calls many
+// times over; events come a few per charge session plus one per fault.
+constexpr uint32_t JOURNAL_RING = 256;   // power of two
+constexpr uint32_t RECORDS_PER_SECTOR = evtlog::JOURNAL_SECTOR_SIZE / sizeof(evtlog::EventRecord);
+static_assert((JOURNAL_RING & (JOURNAL_RING - 1)) == 0, "JOURNAL_RING must be a power of two");
+
+static evtlog::EventRecord ring[JOURNAL_RING];
+static std::atomic<uint32_t> published[JOURNAL_RING];   // index + 1 once slot is filled
+static std::atomic<uint32_t> head{0};    // next index to claim
+static std::atomic<uint32_t> tail{0};    // next index journalService() reads
+static std::atomic<uint32_t> droppedEvents{0};
+
+static FsFile journalFile;
+static evtlog::EventRecord sector[RECORDS_PER_SECTOR];
+static uint32_t sectorFill = 0;     // records in sector
+static uint32_t sectorIndex = 0;    // sector being filled, counted after the header
+static bool sectorDirty = false;
+static elapsedMillis sinceFlush;
+static JournalStats stats;
+
+// -------------------- Append (any context) --------------------
+void journalEvent(evtlog::EventId id, int32_t a0, int32_t a1, int32_t a2, int32_t a3, const char *tag) {
+  uint32_t index = head.load(std::memory_order_relaxed);
+  do {
+    if (index - tail.load(std::memory_order_acquire) >= JOURNAL_RING) {
+      droppedEvents.fetch_add(1, std::memory_order_relaxed);
+      return;
+    }
+  } while (!head.compare_exchange_weak(index, index + 1, std::memory_order_acq_rel, std::memory_order_relaxed));
+
+  evtlog::EventRecord &r = ring[index & (JOURNAL_RING - 1)];
+  r.t_ms = millis();
+  r.seq = (uint16_t)index;
+  r.id = (uint16_t)id;
+  r.arg[0] = a0;
+  r.arg[1] = a1;
+  r.arg[2] = a2;
+  r.arg[3] = a3;
+  memset(r.tag, 0, sizeof(r.tag));
+  if (tag) memcpy(r.tag, tag, strnlen(tag, sizeof(r.tag)));
+  published[index & (JOURNAL_RING - 1)].store(index + 1, std::memory_order_release);
+}
+
+// -------------------- Persistence (loop) --------------------
+void journalBegin() {
+  SdFs *sd = canLogCard();
+  if (!sd) {
+    Serial.println("Event journal: no SD card, events go to USB");
+    return;
+  }
+
+  char name[16];
+  uint32_t index = 1;
+  for (; index < 100000; index++) {
+    snprintf(name, sizeof(name), "EVT%05lu.BIN", (unsigned long)index);
+    if (!sd->exists(name)) break;
+  }
+  if (!journalFile.open(name, O_RDWR | O_CREAT | O_TRUNC)) {
+    Serial.printf("Event journal: cannot create %s, events go to USB\n", name);
+    return;
+  }
+
+  evtlog::JournalHeader hdr;
+  memset(&hdr, 0, sizeof(hdr));
+  memcpy(hdr.magic, evtlog::JOURNAL_MAGIC, sizeof(hdr.magic));
+  hdr.version = evtlog::JOURNAL_VERSION;
+  hdr.record_size = sizeof(evtlog::EventRecord);
+  hdr.start_ms = millis();
+  hdr.file_index = index;
+  if (journalFile.write(&hdr, sizeof(hdr)) != sizeof(hdr)) {
+    journalFile.close();
+    return;
+  }
+
+  stats.card = true;
+  stats.file_index = index;
+  Serial.printf("Event journal: writing %s\n", name);
+}
+
+static bool writeSector() {
+  const uint32_t offset = evtlog::JOURNAL_SECTOR_SIZE * (1 + sectorIndex);
+  if (!journalFile.seekSet(offset) || journalFile.write(sector, sizeof(sector)) != sizeof(sector)) {
+    Serial.println("Event journal: SD write failed, events go to USB");
+    journalFile.close();
+    stats.card = false;
+    return false;
+  }
+  journalFile.sync();
+  sectorDirty = false;
+  sinceFlush = 0;
+  return true;
+}
+
+static void printEvent(const evtlog::EventRecord &r) {
+  char tag[sizeof(r.tag) + 1] = {};
+  memcpy(tag, r.tag, sizeof(r.tag));
+  Serial.printf("[EVT] %lu.%03lu %s %ld %ld %ld %ld %s\n", (unsigned long)(r.t_ms / 1000),
+                (unsigned long)(r.t_ms % 1000), evtlog::eventName(r.id), (long)r.arg[0], (long)r.arg[1],
+                (long)r.arg[2], (long)r.arg[3], tag);
+}
+
+void journalService() {
+  uint32_t index = tail.load(std::memory_order_relaxed);
+  while (published[index & (JOURNAL_RING - 1)].load(std::memory_order_acquire) == index + 1) {
+    const evtlog::EventRecord &r = ring[index & (JOURNAL_RING - 1)];
+    if (stats.card) {
+      sector[sectorFill++] = r;
+      sectorDirty = true;
+      if (sectorFill == RECORDS_PER_SECTOR) {
+        if (writeSector()) {
+          sectorIndex++;
+          sectorFill = 0;
+          memset(sector, 0, sizeof(sector));
+        }
+      }
+    } else {
+      printEvent(r);
+    }
+    stats.written++;
+    tail.store(++index, std::memory_order_release);
+  }
+
+  if (stats.card && sectorDirty && sinceFlush >= JOURNAL_FLUSH_MS) writeSector();
+}
+
+const JournalStats &journalStats() {
+  stats.events = head.load(std::memory_order_relaxed);
+  stats.dropped = droppedEvents.load(std::memory_order_relaxed);
+  return stats;
+}
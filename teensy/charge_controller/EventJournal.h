@@ -0,0 +1,36 @@
+#pragma once
+#include <Arduino.h>
+#include "EventJournalFormat.h"
+
+// Event journal: fixed-size records (EventJournalFormat.h) for state changes,
+// faults and commands, persisted to EVTnnnnn.BIN on the SD card so the
+// history survives closing the USB monitor.
+//
+// journalEvent() is safe from any context, interrupts included: it claims a
+// slot in a RAM ring with a compare-and-swap on the head index, fills it and
+// publishes it, all in constant time and without disabling interrupts. If
+// the ring is full the event is dropped and counted. journalService(), from
+// loop(), moves published records into a sector buffer and rewrites that
+// sector on the card at most once per JOURNAL_FLUSH_MS (immediately when it
+// fills). Without a card, events are printed as [EVT] lines on USB instead.
+
+constexpr uint32_t JOURNAL_FLUSH_MS = 1000;
+
+struct JournalStats {
+  bool     card = false;       // persisting to the SD card
+  uint32_t file_index = 0;
+  uint32_t events = 0;         // events journaled
+  uint32_t dropped = 0;        // events lost because the ring was full
+  uint32_t written = 0;        // events handed to the card or USB
+};
+
+// Opens the first free EVTnnnnn.BIN on the card mounted by canLogBegin();
+// call after it. Events journaled earlier wait in the ring.
+void journalBegin();
+
+void journalEvent(evtlog::EventId id, int32_t a0 = 0, int32_t a1 = 0, int32_t a2 = 0, int32_t a3 = 0,
+                  const char *tag = nullptr);
+
+void journalService();
+
+const JournalStats &journalStats();
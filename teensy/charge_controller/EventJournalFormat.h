@@ -0,0 +1,78 @@
+#pragma once
+#include <stdint.h>
+
+// Binary event journal written by EventJournal (SD card, EVTnnnnn.BIN) and
+// read by host/evtlog. Everything is little-endian.
+//
+// File layout:
+//   sector 0      JournalHeader, zero padded to 512 bytes
+//   sector 1..    back-to-back 32-byte EventRecords, 16 per sector
+//
+// The last sector is rewritten in place as it fills, so its tail is zeros.
+// Readers stop at the first record whose id is 0 or whose seq does not
+// follow the previous one.
+
+namespace evtlog {
+
+constexpr char JOURNAL_MAGIC[8] = {'C', 'B', '5', '5', 'E', 'V', 'T', '1'};
+constexpr uint16_t JOURNAL_VERSION = 1;
+constexpr uint32_t JOURNAL_SECTOR_SIZE = 512;
+
+enum class EventId : uint16_t {
+  None                = 0,   // never written; marks the end of valid data
+  Boot                = 1,   // arg0 = CAN1 baud, arg1 = CAN2 baud
+  StateChange         = 2,   // arg0 = from, arg1 = to, tag = reason
+  ChargerHeartbeat    = 3,   // first charger heartbeat; arg0 = node id
+  NmtStartSent        = 4,   // arg0 = node id
+  SafeStopSent        = 5,   // arg0 = requested mV
+  ChargerFault        = 6,   // TPDO1 hw_shutdown set; arg0 = charger mV, arg1 = charger mA
+  HeartbeatLost       = 7,   // arg0 = ms since the last heartbeat
+  BmsStop             = 8,   // arg0 = pack mV, arg1 = high cell mV, arg2 = high cell number, tag = PACK/CELL
+  BmsOverflow         = 9,   // BMS RX buffer reset; arg0 = bytes discarded
+  ChargerEmcy         = 10,  // 0x08A received; arg0/arg1 = payload bytes 0-3/4-7
+  LimitsExceeded      = 11,  // arg0 = target mV, arg1 = target mA
+  SubscriptionExpired = 12,  // display stopped renewing its telemetry subscription
+  LogDropped          = 13,  // CAN log lost records; arg0 = count
+  BlackBoxCapture     = 14,  // arg0 = records in the window, arg1 = capture number, tag = reason
+};
+
+struct EventRecord {
+  uint32_t t_ms;      // millis()
+  uint16_t seq;       // running record counter, low 16 bits
+  uint16_t id;        // EventId
+  int32_t  arg[4];    // event specific, unused ones are 0
+  char     tag[8];    // short ASCII text, zero padded, not terminated
+};
+static_assert(sizeof(EventRecord) == 32, "evtlog::EventRecord must stay 32 bytes");
+
+struct JournalHeader {
+  char     magic[8];      // JOURNAL_MAGIC
+  uint16_t version;       // JOURNAL_VERSION
+  uint16_t record_size;   // sizeof(EventRecord)
+  uint32_t start_ms;      // millis() when the file was opened
+  uint32_t file_index;    // n in EVTnnnnn.BIN
+  uint8_t  reserved[JOURNAL_SECTOR_SIZE - 20];
+};
+static_assert(sizeof(JournalHeader) == JOURNAL_SECTOR_SIZE, "evtlog::JournalHeader must fill one sector");
+
+inline const char *eventName(uint16_t id) {
+  switch ((EventId)id) {
+    case EventId::Boot:                return "boot";
+    case EventId::StateChange:         return "state";
+    case EventId::ChargerHeartbeat:    return "charger_hb";
+    case EventId::NmtStartSent:        return "nmt_start";
+    case EventId::SafeStopSent:        return "safe_stop";
+    case EventId::ChargerFault:        return "charger_fault";
+    case EventId::HeartbeatLost:       return "hb_lost";
+    case EventId::BmsStop:             return "bms_stop";
+    case EventId::BmsOverflow:         return "bms_overflow";
+    case EventId::ChargerEmcy:         return "charger_emcy";
+    case EventId::LimitsExceeded:      return "limits";
+    case EventId::SubscriptionExpired: return "sub_expired";
+    case EventId::LogDropped:          return "log_dropped";
+    case EventId::BlackBoxCapture:     return "bbx_capture";
+    default:                           return "unknown";
+  }
+}
+
+} // namespace evtlog
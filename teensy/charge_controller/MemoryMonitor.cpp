@@ -0,0 +1,156 @@
+#include "MemoryMonitor.h"
+#include <malloc.h>
+#include <stdlib.h>
+#include <new>
+#include "DeadlineHint.h"
+
+static MemoryStats stats;
+static uint32_t reportMs = 0;
+static uint32_t lastReportMs = 0;
+static bool sampling = false;   // mallinfo() takes the malloc lock too
+
+#if CC_HEAP_TRAP
+uint8_t heapTrapDepth = 0;
+
+static void heapTrapHit() {
+  if (sampling) return;
+  if (!stats.trapped++) stats.first_trap_ms = millis();
+#if CC_HEAP_TRAP >= 2
+  __builtin_trap();
+#endif
+}
+#endif
+
+// -------------------- Platform --------------------
+#ifdef ARDUINO_HOST_SHIM
+
+static void paintStack() {}
+
+static void sampleStack() {}
+
+static void sampleHeap() {
+  const struct mallinfo2 mi = mallinfo2();
+  stats.heap_used = (uint32_t)mi.uordblks;
+  stats.heap_arena = (uint32_t)mi.arena;
+  stats.heap_holes = (uint32_t)mi.fordblks;
+  stats.heap_hole_count = (uint32_t)mi.ordblks;
+  stats.heap_headroom = 0;
+}
+
+#if CC_HEAP_TRAP
+void *operator new(size_t n) {
+  if (heapTrapDepth) heapTrapHit();
+  if (void *p = malloc(n ? n : 1)) return p;
+  throw std::bad_alloc();
+}
+
+void operator delete(void *p) noexcept { free(p); }
+void operator delete(void *p, size_t) noexcept { free(p); }
+#endif
+
+#else
+
+// Teensy 4.1 linker symbols: the stack grows down from _estack to the end
+// of DTCM's .bss; the heap is RAM2 from _heap_start, its break in __brkval
+extern "C" {
+extern char _ebss[];
+extern char _estack[];
+extern char _heap_end[];
+extern char *__brkval;
+}
+
+static constexpr uint32_t STACK_PAINT = 0xA5A5A5A5u;
+static constexpr uint32_t STACK_PAINT_GUARD = 256;   // below this frame, for the calls still to come
+
+static uint32_t *stackBottom() {
+  return (uint32_t *)(((uintptr_t)_ebss + 3) & ~(uintptr_t)3);
+}
+
+static void paintStack() {
+  uint32_t *p = stackBottom();
+  uint32_t *const end = (uint32_t *)((char *)__builtin_frame_address(0) - STACK_PAINT_GUARD);
+  while (p < end) *p++ = STACK_PAINT;
+  stats.stack_size = (uint32_t)(_estack - (char *)stackBottom());
+}
+
+static void sampleStack() {
+  stats.stack_used = (uint32_t)(_estack - (char *)__builtin_frame_address(0));
+  const uint32_t *p = stackBottom();
+  const uint32_t *const top = (const uint32_t *)_estack;
+  while (p < top && *p == STACK_PAINT) p++;
+  stats.stack_peak = (uint32_t)(_estack - (const char *)p);
+}
+
+static void sampleHeap() {
+  const struct mallinfo mi = mallinfo();
+  stats.heap_used = (uint32_t)mi.uordblks;
+  stats.heap_arena = (uint32_t)mi.arena;
+  stats.heap_holes = (uint32_t)mi.fordblks;
+  stats.heap_hole_count = (uint32_t)mi.ordblks;
+  stats.heap_headroom = (uint32_t)(_heap_end - __brkval);
+}
+
+#if CC_HEAP_TRAP
+// newlib takes this around every malloc, realloc and free
+extern "C" void __malloc_lock(struct _reent *) {
+  if (heapTrapDepth) heapTrapHit();
+}
+
+extern "C" void __malloc_unlock(struct _reent *) {}
+#endif
+
+#endif
+
+// -------------------- Sampling and reports --------------------
+static void sample() {
+  sampling = true;
+  sampleHeap();
+  sampling = false;
+  sampleStack();
+  if (stats.heap_used > stats.heap_peak) stats.heap_peak = stats.heap_used;
+}
+
+void memoryBegin(uint32_t report_ms) {
+  stats = MemoryStats();
+  paintStack();
+  reportMs = report_ms;
+  lastReportMs = millis();
+  sample();
+}
+
+void memorySetupDone() {
+  sample();
+  stats.setup_heap_used = stats.heap_used;
+}
+
+void memoryDump() {
+  sample();
+  Serial.printf("[MEM] heap used=%lu peak=%lu setup=%lu arena=%lu holes=%lu/%lu headroom=%lu",
+                (unsigned long)stats.heap_used, (unsigned long)stats.heap_peak,
+                (unsigned long)stats.setup_heap_used, (unsigned long)stats.heap_arena,
+                (unsigned long)stats.heap_holes, (unsigned long)stats.heap_hole_count,
+                (unsigned long)stats.heap_headroom);
+  if (stats.stack_size) {
+    Serial.printf(" stack used=%lu peak=%lu size=%lu", (unsigned long)stats.stack_used,
+                  (unsigned long)stats.stack_peak, (unsigned long)stats.stack_size);
+  }
+#if CC_HEAP_TRAP
+  Serial.printf(" trapped=%lu", (unsigned long)stats.trapped);
+  if (stats.trapped) Serial.printf(" first=%lu ms", (unsigned long)stats.first_trap_ms);
+#endif
+  Serial.println();
+}
+
+void memoryService() {
+  if (!reportMs) return;
+  if (millis() - lastReportMs >= reportMs) {
+    lastReportMs = millis();
+    memoryDump();
+  }
+  deadlineHint(lastReportMs + reportMs);
+}
+
+const MemoryStats &memoryStats() {
+  sample();
+  return stats;
+}
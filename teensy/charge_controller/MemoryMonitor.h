@@ -0,0 +1,82 @@
+#pragma once
+#include <Arduino.h>
+
+// Heap and stack high-water monitoring. The String/std::vector members of
+// BmsData and the charger messages, and the toString() helpers, allocate on
+// every decode and status print; this tracks what that does to the heap
+// over a long charge.
+//
+// Heap: used and free bytes from mallinfo(), the arena (the sbrk break, the
+// true high-water mark of the heap's footprint: newlib never gives it back),
+// the free bytes stranded in holes inside the arena and how many holes there
+// are, and the headroom left between the break and the end of RAM2. Holes
+// growing in number while used stays flat is fragmentation.
+//
+// Stack: memoryBegin() paints the unused part of the DTCM stack with a
+// pattern; the deepest word no longer holding it is the high-water mark.
+// Call it first thing in setup(), while the stack is shallow.
+//
+// memoryService() samples and prints a [MEM] line every report_ms;
+// memoryDump() does so now (USB 'm'). The heap peak is the most used of
+// those samples, so it misses short-lived temporaries; the arena does not.
+//
+// Heap trap: built with CC_HEAP_TRAP=1, heap use inside a HEAP_TRAP_SCOPE()
+// (the sketch puts one around loop(), i.e. everything after setup()) is
+// counted and reported on the [MEM] line; with CC_HEAP_TRAP=2 the first one
+// stops dead in __builtin_trap() for the debugger (the Teensy's CrashReport
+// shows the address on the next boot). On the Teensy the hook is newlib's
+// __malloc_lock, so malloc, realloc and free all count; on the host it is
+// operator new, which String and std::vector use there, so harness code
+// called back from inside loop() counts too.
+//
+// On the host the heap numbers are the whole process's (glibc mallinfo2)
+// and there is no stack painting.
+
+#ifndef CC_HEAP_TRAP
+#define CC_HEAP_TRAP 0
+#endif
+
+struct MemoryStats {
+  uint32_t heap_used = 0;       // allocated bytes, last sample
+  uint32_t heap_peak = 0;       // most allocated bytes seen by any sample
+  uint32_t heap_arena = 0;      // bytes taken from sbrk (footprint high-water)
+  uint32_t heap_holes = 0;      // free bytes inside the arena
+  uint32_t heap_hole_count = 0; // free chunks they are split into
+  uint32_t heap_headroom = 0;   // bytes sbrk can still hand out (0: unknown)
+  uint32_t stack_used = 0;      // at the last sample
+  uint32_t stack_peak = 0;      // deepest the painted stack has been
+  uint32_t stack_size = 0;      // 0: not painted
+  uint32_t setup_heap_used = 0; // heap_used when memorySetupDone() ran
+  uint32_t trapped = 0;         // heap calls inside HEAP_TRAP_SCOPE()
+  uint32_t first_trap_ms = 0;
+};
+
+#if CC_HEAP_TRAP
+
+extern uint8_t heapTrapDepth;   // open HEAP_TRAP_SCOPE()s
+
+class HeapTrapScope {
+public:
+  HeapTrapScope() { heapTrapDepth++; }
+  ~HeapTrapScope() { heapTrapDepth--; }
+  HeapTrapScope(const HeapTrapScope &) = delete;
+  HeapTrapScope &operator=(const HeapTrapScope &) = delete;
+};
+
+#define HEAP_TRAP_CONCAT2(a, b) a##b
+#define HEAP_TRAP_CONCAT(a, b) HEAP_TRAP_CONCAT2(a, b)
+#define HEAP_TRAP_SCOPE() HeapTrapScope HEAP_TRAP_CONCAT(heapTrapScope_, __LINE__)
+
+#else
+
+#define HEAP_TRAP_SCOPE() ((void)0)
+
+#endif
+
+// Paints the stack; call first in setup()
+void memoryBegin(uint32_t report_ms = 60000);
+// Records the heap setup() left behind; call last in setup()
+void memorySetupDone();
+void memoryService();
+void memoryDump();
+const MemoryStats &memoryStats();
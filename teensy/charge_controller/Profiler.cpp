@@ -0,0 +1,66 @@
+#include "Profiler.h"
+
+#if CC_PROFILE
+
+ProfileStats profileStats[(size_t)ProfileProbe::Count];
+uint32_t profileOverhead = 0;
+
+static const char *const PROBE_NAMES[(size_t)ProfileProbe::Count] = {
+  "loop", "can_drain", "decode", "motor_decode", "bms_parse", "safety", "telemetry", "logging", "status",
+};
+
+void profilerBegin() {
+#ifndef ARDUINO_HOST_SHIM
+  // The Teensy 4 core starts the counter at boot; make sure of it
+  ARM_DEMCR |= ARM_DEMCR_TRCENA;
+  ARM_DWT_CTRL |= ARM_DWT_CTRL_CYCCNTENA;
+#endif
+  // Smallest of a few empty scopes: the cost of reading the counter twice
+  profileOverhead = 0;
+  uint32_t best = UINT32_MAX;
+  for (int i = 0; i < 16; i++) {
+    const uint32_t t0 = ARM_DWT_CYCCNT;
+    const uint32_t dt = ARM_DWT_CYCCNT - t0;
+    if (dt < best) best = dt;
+  }
+  profileOverhead = best;
+  profilerReset();
+}
+
+void profilerReset() {
+  for (ProfileStats &s : profileStats) s = ProfileStats();
+}
+
+void profilerDump() {
+  const float mhz = F_CPU_ACTUAL / 1e6f;
+  Serial.printf("[PROF] %-12s %10s %8s %8s %8s %10s  cycles at %.0f MHz, overhead %lu subtracted\n", "probe",
+                "count", "min", "mean", "max", "max_us", mhz, (unsigned long)profileOverhead);
+  for (size_t p = 0; p < (size_t)ProfileProbe::Count; p++) {
+    const ProfileStats &s = profileStats[p];
+    if (!s.count) continue;
+    Serial.printf("[PROF] %-12s %10lu %8lu %8lu %8lu %10.2f\n", PROBE_NAMES[p], (unsigned long)s.count,
+                  (unsigned long)s.min, (unsigned long)(s.total / s.count), (unsigned long)s.max, s.max / mhz);
+
+    // Buckets as "<2^k:n", only the non-empty ones
+    char line[256];
+    int n = snprintf(line, sizeof(line), "[PROF] %-12s hist", PROBE_NAMES[p]);
+    for (uint8_t b = 0; b < PROFILE_BUCKETS && n < (int)sizeof(line) - 24; b++) {
+      if (!s.hist[b]) continue;
+      if (b == PROFILE_BUCKETS - 1) n += snprintf(line + n, sizeof(line) - n, " >=%lu:%lu", 1UL << (b - 1),
+                                                  (unsigned long)s.hist[b]);
+      else n += snprintf(line + n, sizeof(line) - n, " <%lu:%lu", 1UL << b, (unsigned long)s.hist[b]);
+    }
+    Serial.println(line);
+  }
+}
+
+#else
+
+void profilerBegin() {}
+void profilerReset() {}
+
+void profilerDump() {
+  Serial.println("[PROF] profiling not built in (build with CC_PROFILE=1)");
+}
+
+#endif
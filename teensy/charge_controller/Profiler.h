@@ -0,0 +1,88 @@
+#pragma once
+#include <Arduino.h>
+
+// Cycle-accurate loop profiling on the Cortex-M7 DWT cycle counter
+// (ARM_DWT_CYCCNT, one count per CPU clock). A PROFILE_SCOPE(Probe) at the
+// top of a block times it until the block exits and folds the count into
+// that probe's min/max/total and a log2 histogram: two register reads and
+// a handful of adds, no allocation, no interrupts masked.
+//
+// Off unless built with CC_PROFILE=1 (Arduino IDE: add -DCC_PROFILE=1 to
+// the build flags; host: -DCHARGE_CONTROLLER_PROFILE=ON). Disabled scopes
+// compile to nothing. profilerDump() prints [PROF] lines on USB either way,
+// saying so when profiling is not built in; the sketch calls it for 'p' on
+// USB serial and profilerReset() for 'z'.
+//
+// Probes nest and count inclusively. Call from loop() context only.
+
+#ifndef CC_PROFILE
+#define CC_PROFILE 0
+#endif
+
+enum class ProfileProbe : uint8_t {
+  Loop,         // one whole loop()
+  CanDrain,     // can1/can2 events(): RX callbacks, logging and decode
+  Decode,       // dbc::decode and the SystemState update, per CAN1 frame
+  MotorDecode,  // mcdbc::decode and the MotorState update, per CAN2 frame
+  BmsParse,     // readBmsSerial(): UART drain, frame decode
+  Safety,       // charger fault, heartbeat and BMS stop checks
+  Telemetry,    // serviceTelemetry()
+  Logging,      // journal, CAN log and black box service
+  Status,       // the periodic [STATE]/[BMS]/... prints
+  Count
+};
+
+constexpr uint8_t PROFILE_BUCKETS = 24;   // [2^(k-1), 2^k) cycles; the last one is open-ended
+
+struct ProfileStats {
+  uint32_t count = 0;
+  uint32_t min = UINT32_MAX;
+  uint32_t max = 0;
+  uint64_t total = 0;
+  uint32_t hist[PROFILE_BUCKETS] = {};
+};
+
+#if CC_PROFILE
+
+extern ProfileStats profileStats[(size_t)ProfileProbe::Count];
+extern uint32_t profileOverhead;   // cycles an empty scope measures, subtracted
+
+inline void profileRecord(ProfileProbe probe, uint32_t cycles) {
+  cycles = cycles > profileOverhead ? cycles - profileOverhead : 0;
+  ProfileStats &s = profileStats[(size_t)probe];
+  s.count++;
+  s.total += cycles;
+  if (cycles < s.min) s.min = cycles;
+  if (cycles > s.max) s.max = cycles;
+  const uint32_t bucket = cycles ? 32 - __builtin_clz(cycles) : 0;
+  s.hist[bucket < PROFILE_BUCKETS ? bucket : PROFILE_BUCKETS - 1]++;
+}
+
+class ProfileScope {
+public:
+  explicit ProfileScope(ProfileProbe probe) : probe_(probe), start_(ARM_DWT_CYCCNT) {}
+  ~ProfileScope() { profileRecord(probe_, ARM_DWT_CYCCNT - start_); }
+  ProfileScope(const ProfileScope &) = delete;
+  ProfileScope &operator=(const ProfileScope &) = delete;
+
+private:
+  ProfileProbe probe_;
+  uint32_t start_;
+};
+
+#define PROFILE_CONCAT2(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT2(a, b)
+#define PROFILE_SCOPE(probe) ProfileScope PROFILE_CONCAT(profileScope_, __LINE__)(ProfileProbe::probe)
+
+#else
+
+#define PROFILE_SCOPE(probe) ((void)0)
+
+#endif
+
+// Starts the cycle counter and measures the probe overhead; call in setup()
+void profilerBegin();
+void profilerReset();
+// One line per probe (count, min/mean/max in cycles and us), then its
+// histogram
+void profilerDump();
@@ -0,0 +1,30 @@
+#include "TelemetryEncode.h"
+#include <math.h>
+#include <stdio.h>
+
+// snprintf returns what it wanted to write; keep lengths inside the buffer
+static size_t clampLen(int n, size_t cap) {
+  if (n < 0) return 0;
+  return (size_t)n < cap ? (size_t)n : cap - 1;
+}
+
+size_t telemetryAppendChecksum(char *line, size_t n, size_t cap) {
+  uint8_t cs = 0;
+  for (size_t i = 0; i < n; i++) cs ^= (uint8_t)line[i];
+  return n + clampLen(snprintf(line + n, cap - n, "*%02X\r\n", cs), cap - n);
+}
+
+size_t telemetryEncodeMain(char *line, size_t cap, const TelemetryReading &r) {
+  const size_t n = clampLen(snprintf(line, cap, "%.2f,%.2f,%.2f,%.2f,%.1f,%.1f,%.1f,%.1f",
+                                     r.mph, r.voltage, r.current, r.power, r.soc, r.rpm, r.btemp, r.mtemp),
+                            cap);
+  return telemetryAppendChecksum(line, n, cap);
+}
+
+size_t telemetryEncodeCells(char *line, size_t cap, const float *cells_V, size_t count) {
+  size_t n = clampLen(snprintf(line, cap, "C"), cap);
+  for (size_t i = 0; i < count && n < cap - 8; i++) {
+    n += clampLen(snprintf(line + n, cap - n, ",%u", (unsigned)lroundf(cells_V[i] * 1000.0f)), cap - n);
+  }
+  return telemetryAppendChecksum(line, n, cap);
+}
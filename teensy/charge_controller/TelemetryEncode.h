@@ -0,0 +1,29 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+
+// Telemetry lines for the dash display (TELEMETRY_SERIAL). Every line ends
+// in "*HH\r\n": NMEA-style XOR of all bytes before the '*', so the display
+// can tell line noise from a real reading.
+//
+//   main   "mph,V,A,W,soc,rpm,btemp,mtemp*HH"
+//   cells  "C,<mV>,<mV>,...*HH" (one field per cell, integer millivolts)
+
+struct TelemetryReading {
+  float mph = 0;
+  float voltage = 0;
+  float current = 0;
+  float power = 0;
+  float soc = 0;
+  float rpm = 0;
+  float btemp = 0;
+  float mtemp = 0;
+};
+
+// Each writes a whole line, checksum and CRLF included, into line[cap] and
+// returns its length
+size_t telemetryEncodeMain(char *line, size_t cap, const TelemetryReading &r);
+size_t telemetryEncodeCells(char *line, size_t cap, const float *cells_V, size_t count);
+
+// Appends "*HH\r\n" to the n bytes in line; returns the new length
+size_t telemetryAppendChecksum(char *line, size_t n, size_t cap);
@@ -4,13 +4,23 @@
 #include "DbcTypes.h"
 #include "DbcDecode.h"
 #include "BmsDecoder.h"
+#include "TelemetryEncode.h"
 #include "MotorController_DbcTypes.h"
 #include "MotorController_DbcDecode.h"
+#include "CanLogger.h"
+#include "CanLogCodec.h"
+#include "BlackBox.h"
+#include "EventJournal.h"
+#include "DeadlineHint.h"
+#include "Profiler.h"
+#include "MemoryMonitor.h"
 
 
 // Use Serial1 for TTL RX/TX (pins 0=RX1, 1=TX1 on Teensy 4.1)
 #define BMS_SERIAL Serial1
 
+// Serial2 to the dash display: TX2=8 carries telemetry lines, RX2=7 receives
+// the display's channel subscriptions
 #define TELEMETRY_SERIAL Serial2
 
 // BMS request bytes
@@ -46,8 +56,17 @@ struct MotorState {
 };
 
 MotorState motorState;
-elapsedMillis telemetryTimer;
-constexpr uint32_t TELEMETRY_PERIOD_MS = 500;
+
+// Display subscriptions: the display sends "S,T:250,C:1000*HH" naming the
+// channels its current page shows and their periods. Unlisted channels are
+// not sent. Until the first subscription, or once it has not been renewed
+// for SUBSCRIPTION_TIMEOUT_MS, every channel runs at its default period.
+constexpr uint32_t SUBSCRIPTION_TIMEOUT_MS = 15000;
+constexpr uint32_t MIN_TELEMETRY_PERIOD_MS = 100;
+bool displaySubscribed = false;
+uint32_t lastSubscriptionMs = 0;
+char telemetryRxBuf[64];
+size_t telemetryRxLen = 0;
 
 // -------------------- IDs and constants --------------------
 constexpr uint8_t BATTERY_NODE_ID  = 0x01;
@@ -63,13 +82,25 @@ constexpr uint32_t RPDO1_ID        = 0x200 + CHARGER_NODE_ID;          // 0x20A
 constexpr uint32_t CAN_BAUD = 500000;
 
 constexpr uint32_t HEARTBEAT_PERIOD_MS = 1000;
+// A charger or BMS stop holds FAULTED until the charger has been silent this
+// long (unplugged), so only a fresh plug-in restarts the handshake. A LIMITS
+// fault holds until reboot.
+constexpr uint32_t REPLUG_SILENCE_MS   = 5000;
 constexpr uint32_t RPDO1_PERIOD_MS     = 250;
 constexpr uint32_t BMS_REQUEST_PERIOD_MS = 1000;
 constexpr uint32_t STATUS_PRINT_MS     = 2000;
-
-// Open-loop charging request
-constexpr float TARGET_VOLTAGE_V       = 82.0f;  // 20s * 4.10 V/cell
-constexpr float TARGET_CURRENT_A       = 10.0f;  // conservative default
+constexpr uint32_t MEMORY_REPORT_MS    = 60000;
+
+// Open-loop charging request. CC_TARGET_VOLTAGE_V/CC_TARGET_CURRENT_A
+// override it for bench builds.
+#ifndef CC_TARGET_VOLTAGE_V
+#define CC_TARGET_VOLTAGE_V 82.0f                // 20s * 4.10 V/cell
+#endif
+#ifndef CC_TARGET_CURRENT_A
+#define CC_TARGET_CURRENT_A 10.0f                // conservative default
+#endif
+constexpr float TARGET_VOLTAGE_V       = CC_TARGET_VOLTAGE_V;
+constexpr float TARGET_CURRENT_A       = CC_TARGET_CURRENT_A;
 constexpr float MAX_ALLOWED_VOLTAGE_V  = 82.0f;
 constexpr float MAX_ALLOWED_CURRENT_A  = 15.0f;
 
@@ -77,10 +108,15 @@ constexpr float MAX_ALLOWED_CURRENT_A  = 15.0f;
 constexpr float MAX_CELL_VOLTAGE_V     = 4.10f;
 constexpr float MAX_PACK_VOLTAGE_V     = 82.0f;
 
+// Black box captures (BlackBox.h): the window saved around each trigger, and
+// the signal thresholds that fire one. Entering STOPPING or FAULTED and a
+// charger EMCY (0x08A) also fire.
+constexpr uint32_t BLACKBOX_PRE_MS     = 30000;
+constexpr uint32_t BLACKBOX_HOLDOFF_MS = 10000;
+constexpr float BLACKBOX_HIGH_CELL_V   = 4.08f;  // just under the stop, to catch the run-up
+
 // BMS frame handling
-constexpr size_t BMS_FRAME_LEN = 121;
-uint8_t bmsRxBuf[160];
-size_t bmsRxLen = 0;
+BmsRxBuffer bmsRx;
 
 // -------------------- Startup / run state --------------------
 enum class ChargerControlState : uint8_t {
@@ -97,12 +133,42 @@ ChargerControlState controlState = ChargerControlState::WAIT_FOR_CHARGER_HEARTBE
 
 bool chargerHeartbeatSeen = false;
 uint32_t lastChargerHeartbeatMs = 0;
+// FAULTED came through STOPPING during a session, so an unplug clears it
+bool faultRearms = false;
 elapsedMillis hbTimer;
 elapsedMillis rpdoTimer;
 elapsedMillis stateTimer;
 elapsedMillis bmsRequestTimer;
 
+// -------------------- Black box triggers --------------------
+static const BlackBoxIdTrigger BLACKBOX_ID_TRIGGERS[] = {
+  {canlog::Source::CAN1_RX, 0x08A, 0x7FF | canlog::ID_EXTENDED, "EMCY"},
+};
+
+bool hwShutdownTriggered = false;
+bool highCellTriggered = false;
+
+// Fires a capture when cond becomes true; it has to clear before it can fire again
+static void signalTrigger(bool cond, bool &latched, const char *tag) {
+  if (cond && !latched) blackBoxTrigger(BlackBoxTriggerKind::Signal, tag);
+  latched = cond;
+}
+
 // -------------------- Helpers --------------------
+
+// All state changes go through here so they land in the CAN log and black
+// box. Entering STOPPING or FAULTED fires a black box capture.
+static void setControlState(ChargerControlState next, const char *reason) {
+  if (next == controlState) return;
+
+  canLogState((uint8_t)controlState, (uint8_t)next, reason);
+  journalEvent(evtlog::EventId::StateChange, (int32_t)controlState, (int32_t)next, 0, 0, reason);
+  if (next == ChargerControlState::STOPPING || next == ChargerControlState::FAULTED) {
+    blackBoxTrigger(BlackBoxTriggerKind::State, reason);
+  }
+  controlState = next;
+}
+
 static uint16_t encodeVoltage256(float volts) {
   if (volts < 0.0f) volts = 0.0f;
   return (uint16_t)lroundf(volts * 256.0f);
@@ -113,10 +179,21 @@ static uint16_t encodeCurrent16(float amps) {
   return (uint16_t)lroundf(amps * 16.0f);
 }
 
+// Drops everything heard from the last charger so a new session starts clean
+// (a stale TPDO1 shutdown bit would otherwise stop it at once)
+static void forgetCharger() {
+  chargerHeartbeatSeen = false;
+  sysState.tpdo1_18a.valid = false;
+  sysState.tpdo2_28a.valid = false;
+  sysState.tpdo3_38a.valid = false;
+  sysState.faultreg.valid = false;
+  sysState.hb70a.valid = false;
+}
+
 static bool chargerFaultActive() {
   if (!sysState.tpdo1_18a.valid) return false;
   const auto &d = sysState.tpdo1_18a.data;
-  return d.hw_shutdown != 0;
+  return d.hw_shutdown == dbc::ChargerHardwareShutdownStatus::ShutDown;
 }
 
 static bool bmsShouldStopCharge() {
@@ -126,12 +203,16 @@ static bool bmsShouldStopCharge() {
 
   if (b.pack_voltage_V >= MAX_PACK_VOLTAGE_V) {
     Serial.printf("BMS stop: pack voltage high: %.3f V\n", b.pack_voltage_V);
+    journalEvent(evtlog::EventId::BmsStop, lroundf(b.pack_voltage_V * 1000.0f),
+                 lroundf(b.high_cell_voltage * 1000.0f), b.high_cell_num, 0, "PACK");
     return true;
   }
 
   if (b.high_cell_voltage >= MAX_CELL_VOLTAGE_V) {
     Serial.printf("BMS stop: high cell %u at %.4f V\n",
                   b.high_cell_num, b.high_cell_voltage);
+    journalEvent(evtlog::EventId::BmsStop, lroundf(b.pack_voltage_V * 1000.0f),
+                 lroundf(b.high_cell_voltage * 1000.0f), b.high_cell_num, 0, "CELL");
     return true;
   }
 
@@ -140,11 +221,14 @@ static bool bmsShouldStopCharge() {
 
 // -------------------- CAN RX Callback --------------------
 void onRx(const CAN_message_t &msg) {
+  canLogFrame(canlog::Source::CAN1_RX, msg);
+
   if (msg.id == CHARGER_HB_ID && msg.len >= 1) {
     chargerHeartbeatSeen = true;
     lastChargerHeartbeatMs = millis();
   }
 
+  PROFILE_SCOPE(Decode);
   dbc::AnyMessage decoded;
   if (dbc::decode(msg.id, msg.buf, msg.len, decoded)) {
     switch (decoded.type) {
@@ -167,6 +251,8 @@ void onRx(const CAN_message_t &msg) {
       case dbc::AnyMessage::Type::TPDO1_18A:
         sysState.tpdo1_18a.data = decoded.tpdo1_18a;
         sysState.tpdo1_18a.valid = true;
+        signalTrigger(decoded.tpdo1_18a.hw_shutdown == dbc::ChargerHardwareShutdownStatus::ShutDown,
+                      hwShutdownTriggered, "HWSHDN");
         break;
       case dbc::AnyMessage::Type::NMT_Start:
         sysState.nmt.data = decoded.nmt_start;
@@ -175,6 +261,9 @@ void onRx(const CAN_message_t &msg) {
       case dbc::AnyMessage::Type::FaultReg_08A:
         sysState.faultreg.data = decoded.fault_reg;
         sysState.faultreg.valid = true;
+        journalEvent(evtlog::EventId::ChargerEmcy,
+                     (int32_t)(msg.buf[0] | msg.buf[1] << 8 | msg.buf[2] << 16 | (uint32_t)msg.buf[3] << 24),
+                     (int32_t)(msg.buf[4] | msg.buf[5] << 8 | msg.buf[6] << 16 | (uint32_t)msg.buf[7] << 24));
         break;
       case dbc::AnyMessage::Type::HB_701:
         sysState.hb701.data = decoded.hb_701;
@@ -191,8 +280,10 @@ void onRx(const CAN_message_t &msg) {
 }
 
 void onMotorCanRx(const CAN_message_t &msg) {
+  canLogFrame(canlog::Source::CAN2_RX, msg);
   if (!msg.flags.extended) return;
 
+  PROFILE_SCOPE(MotorDecode);
   mcdbc::AnyMessage decoded;
   if (mcdbc::decode(msg.id, msg.buf, msg.len, decoded)) {
     switch (decoded.type) {
@@ -222,7 +313,9 @@ void sendNMTStart() {
   msg.buf[0] = 0x01;
   msg.buf[1] = CHARGER_NODE_ID;
   can1.write(msg);
+  canLogFrame(canlog::Source::CAN1_TX, msg);
   Serial.println(">> Sent NMT Start to charger");
+  journalEvent(evtlog::EventId::NmtStartSent, CHARGER_NODE_ID);
 }
 
 void sendHeartbeat() {
@@ -231,6 +324,7 @@ void sendHeartbeat() {
   msg.len = 1;
   msg.buf[0] = 0x05;
   can1.write(msg);
+  canLogFrame(canlog::Source::CAN1_TX, msg);
 }
 
 void sendRPDO1(bool batteryReady, float voltageV, float currentA, uint8_t socPct = 0, uint8_t externalOverride0 = 0) {
@@ -260,6 +354,7 @@ void sendRPDO1(bool batteryReady, float voltageV, float currentA, uint8_t socPct
   msg.buf[7] = batteryReady ? 0x01 : 0x00;
 
   can1.write(msg);
+  canLogFrame(canlog::Source::CAN1_TX, msg);
 }
 
 void sendSafeStop() {
@@ -267,44 +362,42 @@ void sendSafeStop() {
   delay(20);
   sendRPDO1(false, TARGET_VOLTAGE_V, 0.0f, 0, 0);
   Serial.println(">> Sent safe stop sequence");
+  journalEvent(evtlog::EventId::SafeStopSent, lroundf(TARGET_VOLTAGE_V * 1000.0f));
 }
 
 // -------------------- BMS helpers --------------------
 void requestBmsFrame() {
   BMS_SERIAL.write(BMS_REQUEST, sizeof(BMS_REQUEST));
+  canLogBytes(canlog::Source::BMS_TX, BMS_REQUEST, sizeof(BMS_REQUEST));
   BMS_SERIAL.flush();
 }
 
 void readBmsSerial() {
+  PROFILE_SCOPE(BmsParse);
   while (BMS_SERIAL.available() > 0) {
     int c = BMS_SERIAL.read();
     if (c < 0) {
       break;
     }
 
-    if (bmsRxLen < sizeof(bmsRxBuf)) {
-      bmsRxBuf[bmsRxLen++] = (uint8_t)c;
-    } else {
+    if (!bmsRxAppend(bmsRx, (uint8_t)c)) {
       // Overflow protection: drop buffer and start over
-      bmsRxLen = 0;
+      journalEvent(evtlog::EventId::BmsOverflow, (int32_t)sizeof(bmsRx.data));
       Serial.println("BMS RX overflow, buffer reset");
       break;
     }
   }
 
-  // If at least one full frame is available, decode the most recent 121 bytes.
-  while (bmsRxLen >= BMS_FRAME_LEN) {
-    BmsData decoded = decodeBmsMessage(bmsRxBuf, BMS_FRAME_LEN);
+  // Decode every whole frame buffered, oldest first
+  while (const uint8_t *frame = bmsRxFrame(bmsRx)) {
+    canLogBytes(canlog::Source::BMS_RX, frame, BMS_FRAME_LEN);
+    BmsData decoded = decodeBmsMessage(frame, BMS_FRAME_LEN);
     sysState.bms.data = decoded;
     sysState.bms.valid = true;
     sysState.bms.last_update_ms = millis();
+    signalTrigger(decoded.high_cell_voltage >= BLACKBOX_HIGH_CELL_V, highCellTriggered, "HICELL");
 
-    // Remove the consumed frame
-    size_t remaining = bmsRxLen - BMS_FRAME_LEN;
-    if (remaining > 0) {
-      memmove(bmsRxBuf, bmsRxBuf + BMS_FRAME_LEN, remaining);
-    }
-    bmsRxLen = remaining;
+    bmsRxConsume(bmsRx);
 
     Serial.printf("[BMS] Pack=%.2f V, Current=%.2f A, SOC=%u%%, HighCell=%u:%.3f V, LowCell=%u:%.3f V\n",
                   decoded.pack_voltage_V,
@@ -332,24 +425,125 @@ float rpmToMph(float rpm) {
 void sendTelemetryLine() {
   if (!motorState.msg1.valid) return;
 
-  float rpm = motorState.msg1.data.speed_rpm;
-  float voltage = motorState.msg1.data.battery_voltage_V;
-  float current = motorState.msg1.data.motor_current_A;
+  TelemetryReading r;
+  r.rpm = motorState.msg1.data.speed_rpm;
+  r.voltage = motorState.msg1.data.battery_voltage_V;
+  r.current = motorState.msg1.data.motor_current_A;
 
   // If you want battery current instead of motor current, use BMS current instead.
-  float power = voltage * current;
+  r.power = r.voltage * r.current;
+
+  r.soc = sysState.bms.valid ? sysState.bms.data.soc_pct : 0.0f;
+  r.btemp = sysState.bms.valid ? sysState.bms.data.mos_temperature_C : 0.0f;
+  r.mtemp = motorState.msg2.valid ? motorState.msg2.data.motor_temp_C : 0.0f;
+  r.mph = rpmToMph(r.rpm);
+
+  char line[96];
+  TELEMETRY_SERIAL.write((const uint8_t *)line, telemetryEncodeMain(line, sizeof(line), r));
+}
+
+void sendCellTelemetryLine() {
+  if (!sysState.bms.valid) return;
+
+  const auto &cells = sysState.bms.data.cell_voltages;
+  char line[160];  // 20 cells * ",4200" + tag + checksum fits easily
+  TELEMETRY_SERIAL.write((const uint8_t *)line, telemetryEncodeCells(line, sizeof(line), cells.data(), cells.size()));
+}
+
+struct TelemetryChannel {
+  char tag;                    // name used in subscriptions and as the line tag
+  uint32_t default_period_ms;  // used while no display subscription is active
+  void (*send)();
+  uint32_t period_ms;          // 0 = not sent
+  elapsedMillis timer;
+};
+
+// Cell voltages change slowly; by default they go out on their own low-rate line
+TelemetryChannel telemetryChannels[] = {
+  {'T', 500,  sendTelemetryLine,     500,  {}},
+  {'C', 2000, sendCellTelemetryLine, 2000, {}},
+};
+
+void resetTelemetrySubscriptions() {
+  for (auto &ch : telemetryChannels) ch.period_ms = ch.default_period_ms;
+  displaySubscribed = false;
+}
+
+// Applies one subscription line (checksum already verified and stripped)
+void applyTelemetrySubscription(const char *line) {
+  if (line[0] != 'S' || line[1] != ',') return;
+
+  for (auto &ch : telemetryChannels) ch.period_ms = 0;
+
+  for (const char *p = line + 2; *p; ) {
+    char tag = p[0];
+    if (p[1] != ':') break;
+    uint32_t period = strtoul(p + 2, (char **)&p, 10);
 
-  float soc = sysState.bms.valid ? sysState.bms.data.soc_pct : 0.0f;
-  float btemp = sysState.bms.valid ? sysState.bms.data.mos_temperature_C : 0.0f;
-  float mtemp = motorState.msg2.valid ? motorState.msg2.data.motor_temp_C : 0.0f;
-  float mph = rpmToMph(rpm);
+    for (auto &ch : telemetryChannels) {
+      if (ch.tag == tag) {
+        ch.period_ms = (period && period < MIN_TELEMETRY_PERIOD_MS) ? MIN_TELEMETRY_PERIOD_MS : period;
+      }
+    }
+    if (*p == ',') p++;
+  }
+
+  displaySubscribed = true;
+  lastSubscriptionMs = millis();
+}
+
+void readTelemetrySubscriptions() {
+  while (TELEMETRY_SERIAL.available() > 0) {
+    int c = TELEMETRY_SERIAL.read();
+    if (c < 0) break;
+
+    if (c != '\n') {
+      if (telemetryRxLen < sizeof(telemetryRxBuf) - 1) {
+        telemetryRxBuf[telemetryRxLen++] = (char)c;
+      } else {
+        telemetryRxLen = 0;  // runaway line, resync on the next newline
+      }
+      continue;
+    }
+
+    // Complete line: strip CR, check the "*HH" XOR checksum
+    size_t n = telemetryRxLen;
+    telemetryRxLen = 0;
+    if (n > 0 && telemetryRxBuf[n - 1] == '\r') n--;
+    if (n < 3 || telemetryRxBuf[n - 3] != '*') continue;
+
+    uint8_t cs = 0;
+    for (size_t i = 0; i < n - 3; i++) cs ^= (uint8_t)telemetryRxBuf[i];
+    telemetryRxBuf[n] = '\0';
+    if (cs != (uint8_t)strtoul(&telemetryRxBuf[n - 2], nullptr, 16)) continue;
+
+    telemetryRxBuf[n - 3] = '\0';
+    applyTelemetrySubscription(telemetryRxBuf);
+  }
+
+  if (displaySubscribed && millis() - lastSubscriptionMs > SUBSCRIPTION_TIMEOUT_MS) {
+    Serial.println("Display subscription expired, sending all telemetry");
+    journalEvent(evtlog::EventId::SubscriptionExpired);
+    resetTelemetrySubscriptions();
+  } else if (displaySubscribed) {
+    deadlineHint(lastSubscriptionMs + SUBSCRIPTION_TIMEOUT_MS + 1);
+  }
+}
 
-  TELEMETRY_SERIAL.printf("%.2f,%.2f,%.2f,%.2f,%.1f,%.1f,%.1f,%.1f\r\n",
-                          mph, voltage, current, power, soc, rpm, btemp, mtemp);
+void serviceTelemetry() {
+  readTelemetrySubscriptions();
+
+  for (auto &ch : telemetryChannels) {
+    if (ch.period_ms != 0 && ch.timer >= ch.period_ms) {
+      ch.timer = 0;
+      ch.send();
+    }
+  }
 }
 
 // -------------------- Arduino Setup/Loop --------------------
 void setup() {
+  memoryBegin(MEMORY_REPORT_MS);
   Serial.begin(115200);
   BMS_SERIAL.begin(115200);
   TELEMETRY_SERIAL.begin(115200);
@@ -357,9 +551,22 @@ void setup() {
   while (!Serial && millis() < 3000) {}
   Serial.println("Teensy 4.1 Delta-Q open-loop battery simulator with BMS polling");
 
+  blackBoxBegin();
+  BlackBoxConfig bbx;
+  bbx.pre_ms = BLACKBOX_PRE_MS;
+  bbx.holdoff_ms = BLACKBOX_HOLDOFF_MS;
+  blackBoxConfigure(bbx);
+  blackBoxSetIdTriggers(BLACKBOX_ID_TRIGGERS, sizeof(BLACKBOX_ID_TRIGGERS) / sizeof(BLACKBOX_ID_TRIGGERS[0]));
+  canLogBegin(CAN_BAUD, 250000);
+  journalBegin();
+  journalEvent(evtlog::EventId::Boot, CAN_BAUD, 250000);
+  profilerBegin();
+
   if (TARGET_VOLTAGE_V > MAX_ALLOWED_VOLTAGE_V || TARGET_CURRENT_A > MAX_ALLOWED_CURRENT_A) {
     Serial.println("ERROR: Target voltage/current exceeds configured safety limits.");
-    controlState = ChargerControlState::FAULTED;
+    journalEvent(evtlog::EventId::LimitsExceeded, lroundf(TARGET_VOLTAGE_V * 1000.0f),
+                 lroundf(TARGET_CURRENT_A * 1000.0f));
+    setControlState(ChargerControlState::FAULTED, "LIMITS");
   }
 
   can1.begin();
@@ -377,14 +584,32 @@ void setup() {
   stateTimer = 0;
   bmsRequestTimer = 0;
 
-  Serial.printf("CAN baud: %lu\n", CAN_BAUD);
+  Serial.printf("CAN baud: %lu\n", (unsigned long)CAN_BAUD);
   Serial.println("Waiting for charger heartbeat 0x70A...");
+  memorySetupDone();
+}
+
+// USB commands: 'p' prints the loop profile, 'z' clears it (Profiler.h),
+// 'm' prints heap and stack use (MemoryMonitor.h)
+static void serviceUsbCommands() {
+  while (Serial.available()) {
+    const int c = Serial.read();
+    if (c == 'p') profilerDump();
+    else if (c == 'z') profilerReset();
+    else if (c == 'm') memoryDump();
+  }
 }
 
 void loop() {
-  can1.events();
-  can2.events();
+  PROFILE_SCOPE(Loop);
+  HEAP_TRAP_SCOPE();
+  {
+    PROFILE_SCOPE(CanDrain);
+    can1.events();
+    can2.events();
+  }
   readBmsSerial();
+  serviceUsbCommands();
 
   if (bmsRequestTimer >= BMS_REQUEST_PERIOD_MS) {
     bmsRequestTimer = 0;
@@ -400,19 +625,26 @@ void loop() {
   }
 
   if (controlState == ChargerControlState::RUN_CHARGING) {
+    PROFILE_SCOPE(Safety);
     if (chargerFaultActive()) {
       Serial.println("FAULT: Charger reported shutdown/fault condition.");
-      controlState = ChargerControlState::STOPPING;
+      journalEvent(evtlog::EventId::ChargerFault,
+                   lroundf(sysState.tpdo1_18a.data.battery_voltage_V * 1000.0f),
+                   lroundf(sysState.tpdo1_18a.data.charging_current_A * 1000.0f));
+      setControlState(ChargerControlState::STOPPING, "CHGFLT");
     }
 
     if (chargerHeartbeatSeen && (millis() - lastChargerHeartbeatMs > 3000)) {
       Serial.println("FAULT: Lost charger heartbeat.");
-      controlState = ChargerControlState::STOPPING;
+      journalEvent(evtlog::EventId::HeartbeatLost, (int32_t)(millis() - lastChargerHeartbeatMs));
+      setControlState(ChargerControlState::STOPPING, "HBLOST");
+    } else if (chargerHeartbeatSeen) {
+      deadlineHint(lastChargerHeartbeatMs + 3001);
     }
 
     if (bmsShouldStopCharge()) {
       Serial.println("BMS requested stop.");
-      controlState = ChargerControlState::STOPPING;
+      setControlState(ChargerControlState::STOPPING, "BMS");
     }
   }
 
@@ -420,10 +652,11 @@ void loop() {
     case ChargerControlState::WAIT_FOR_CHARGER_HEARTBEAT:
       if (chargerHeartbeatSeen) {
         Serial.println("<< Saw charger heartbeat 0x70A");
+        journalEvent(evtlog::EventId::ChargerHeartbeat, CHARGER_NODE_ID);
         sendHeartbeat();
         hbTimer = 0;
         stateTimer = 0;
-        controlState = ChargerControlState::SEND_NMT_START;
+        setControlState(ChargerControlState::SEND_NMT_START, "HB");
       }
       break;
 
@@ -431,7 +664,7 @@ void loop() {
       if (stateTimer >= 50) {
         sendNMTStart();
         stateTimer = 0;
-        controlState = ChargerControlState::SEND_RPDO1_NOT_READY;
+        setControlState(ChargerControlState::SEND_RPDO1_NOT_READY, "NMT");
       }
       break;
 
@@ -440,7 +673,7 @@ void loop() {
         sendRPDO1(false, TARGET_VOLTAGE_V, TARGET_CURRENT_A, 0, 0);
         rpdoTimer = 0;
         stateTimer = 0;
-        controlState = ChargerControlState::RUN_CHARGING;
+        setControlState(ChargerControlState::RUN_CHARGING, "RPDO1");
       }
       break;
 
@@ -460,23 +693,41 @@ void loop() {
 
     case ChargerControlState::STOPPING:
       sendSafeStop();
-      controlState = ChargerControlState::FAULTED;
+      faultRearms = chargerHeartbeatSeen;
+      setControlState(ChargerControlState::FAULTED, "STOP");
       break;
 
     case ChargerControlState::FAULTED:
+      if (!faultRearms) break;
+      if (millis() - lastChargerHeartbeatMs >= REPLUG_SILENCE_MS) {
+        Serial.println("Charger gone, waiting for the next plug-in.");
+        faultRearms = false;
+        forgetCharger();
+        setControlState(ChargerControlState::WAIT_FOR_CHARGER_HEARTBEAT, "UNPLUG");
+      } else {
+        deadlineHint(lastChargerHeartbeatMs + REPLUG_SILENCE_MS);
+      }
       break;
 
     default:
       break;
   }
 
-  if (telemetryTimer >= TELEMETRY_PERIOD_MS) {
-    telemetryTimer = 0;
-    sendTelemetryLine();
+  {
+    PROFILE_SCOPE(Telemetry);
+    serviceTelemetry();
+  }
+  {
+    PROFILE_SCOPE(Logging);
+    journalService();
+    canLogService();
+    blackBoxService();
   }
+  memoryService();
 
   static uint32_t t_last = 0;
   if (millis() - t_last > STATUS_PRINT_MS) {
+    PROFILE_SCOPE(Status);
     t_last = millis();
 
     Serial.printf("[STATE] %u, chargerHB=%s, lastHB=%lu ms ago\n",
@@ -484,6 +735,38 @@ void loop() {
                   chargerHeartbeatSeen ? "yes" : "no",
                   chargerHeartbeatSeen ? (unsigned long)(millis() - lastChargerHeartbeatMs) : 0UL);
 
+    const CanLogStats &log = canLogStats();
+    if (log.active) {
+      // ratio: the codec on sealed blocks; card: raw records over everything
+      // sent to the card, periodic flush rewrites included
+      const float ratio = log.blocks ? (log.block_records * (float)sizeof(canlog::Record)) /
+                                           (log.blocks * (float)canlog::CODEC_BLOCK_BYTES) : 0.0f;
+      const float cardRatio = log.card_bytes ? (log.records * (float)sizeof(canlog::Record)) / log.card_bytes : 0.0f;
+      Serial.printf("[LOG] file=%lu records=%lu dropped=%lu bytes=%lu ratio=%.1fx card=%.1fx maxWrite=%lu us\n",
+                    (unsigned long)log.file_index,
+                    (unsigned long)log.records,
+                    (unsigned long)log.dropped,
+                    (unsigned long)log.bytes_written,
+                    ratio,
+                    cardRatio,
+                    (unsigned long)log.max_write_us);
+    }
+
+    const JournalStats &jr = journalStats();
+    if (jr.card || jr.dropped) {
+      Serial.printf("[JRN] file=%lu events=%lu dropped=%lu\n",
+                    (unsigned long)jr.file_index, (unsigned long)jr.events, (unsigned long)jr.dropped);
+    }
+
+    const BlackBoxStats &bb = blackBoxStats();
+    if (bb.state == BlackBoxState::Dumping) {
+      Serial.printf("[BBX] reason=%s dumped=%lu/%lu\n",
+                    bb.reason, (unsigned long)bb.dumped, (unsigned long)bb.window);
+    } else if (bb.captures || bb.suppressed) {
+      Serial.printf("[BBX] captures=%lu suppressed=%lu last=%s\n",
+                    (unsigned long)bb.captures, (unsigned long)bb.suppressed, bb.reason);
+    }
+
     if (sysState.tpdo1_18a.valid) {
       auto &d = sysState.tpdo1_18a.data;
       Serial.printf("[0x18A] I=%.2f A, V=%.2f V, HW=%s, Derating=%s, AC=%s, Charger=%s, Override=%s, Indication=%s, Cycle=%s\n",
@@ -533,4 +816,5 @@ void loop() {
                     mcdbc::commandStatusToString(motorState.msg2.data.command_status).c_str());
     }
   }
+  deadlineHint(t_last + STATUS_PRINT_MS + 1);
 }
\ No newline at end of file
@@ -0,0 +1,275 @@
+#include "Free_Fonts.h"
+#include "DisplayRender.h"
+#include <stdio.h>
+#include <string.h>
+
+TFT_eSPI tft = TFT_eSPI();
+
+float mph, voltage, current, power, soc, rpm, Btemp, Mtemp;
+
+uint16_t cellMv[NUM_CELLS];
+int cellCount = 0;
+
+Page page = PAGE_MAIN;
+
+// Cell page geometry: 20 bars across the screen, growing up from CELL_BAR_BOTTOM
+constexpr int CELL_BAR_TOP = 40;
+constexpr int CELL_BAR_BOTTOM = 220;
+constexpr int CELL_BAR_PITCH = 16;          // 320 / 20
+constexpr int CELL_BAR_WIDTH = 12;
+constexpr uint16_t CELL_MV_EMPTY = 3000;    // bar height 0
+constexpr uint16_t CELL_MV_FULL = 4250;     // bar height max
+constexpr uint16_t CELL_MV_HIGH = 4150;     // drawn orange at/above this
+constexpr uint16_t CELL_IMBALANCE_MV = 20;  // highlight high/low cell above this spread
+
+// What is currently on screen per bar, so only changed pixels get redrawn
+static int16_t barHeightPx[NUM_CELLS];
+static uint16_t barColor[NUM_CELLS];
+static uint16_t shownLowMv = 0, shownHighMv = 0;
+
+bool hudEnabled = false;
+char hudText[HUD_FIELD_COUNT][12];
+
+// One HUD slot per figure; a slot is only redrawn when its text changes
+struct HudField { int16_t x; int16_t w; char shown[12]; };
+static HudField hudFields[HUD_FIELD_COUNT] = {
+  {0, 36, ""},    // frames per second
+  {36, 48, ""},   // mean render time
+  {84, 48, ""},   // mean parse time
+  {132, 48, ""},  // UART bytes per second
+  {180, 36, ""},  // telemetry lines per second
+  {216, 54, ""},  // checksum / parse errors
+  {270, 50, ""},  // telemetry age
+};
+
+// Main page layering: the labels are drawn once, straight to the TFT, by
+// drawStaticLabels(). Each dynamic value gets its own 1-bit sprite (single
+// color text, so one bit per pixel is enough) that is only re-rendered and
+// pushed when its text changes. Together these take ~3.5 KB instead of the
+// 77 KB a full-screen 8-bit sprite needed.
+constexpr int MAIN_Y = 150;   // first label/value row baseline
+constexpr int MAIN_DY = 25;   // row pitch
+
+struct Widget {
+  int16_t x, y, w, h;   // screen rect
+  int16_t baseline;     // text baseline inside the sprite
+  const GFXfont *font;
+  uint16_t color;
+  TFT_eSprite spr;
+  char shown[16];       // text currently on screen
+
+  Widget(int16_t x, int16_t y, int16_t w, int16_t h, int16_t baseline,
+         const GFXfont *font, uint16_t color)
+    : x(x), y(y), w(w), h(h), baseline(baseline), font(font), color(color), spr(&tft), shown{} {}
+};
+
+enum WidgetId : uint8_t {
+  W_MPH = 0, W_VOLTAGE, W_CURRENT, W_POWER, W_SOC, W_RPM, W_BTEMP, W_MTEMP, WIDGET_COUNT
+};
+
+// Value rows are 24 px tall with the baseline 18 px down, matching the old
+// setCursor(x, MAIN_Y + n*MAIN_DY) positions.
+static Widget widgets[WIDGET_COUNT] = {
+  {40,  34,                       280, 48, 36, &FreeSansBold24pt7b, TFT_YELLOW},  // W_MPH
+  {90,  MAIN_Y - 18,              90,  24, 18, &FreeSans12pt7b,     TFT_CYAN},    // W_VOLTAGE
+  {90,  MAIN_Y + MAIN_DY - 18,    90,  24, 18, &FreeSans12pt7b,     TFT_CYAN},    // W_CURRENT
+  {90,  MAIN_Y + 2*MAIN_DY - 18,  90,  24, 18, &FreeSans12pt7b,     TFT_CYAN},    // W_POWER
+  {90,  MAIN_Y + 3*MAIN_DY - 18,  90,  24, 18, &FreeSans12pt7b,     TFT_CYAN},    // W_SOC
+  {240, MAIN_Y - 18,              80,  24, 18, &FreeSans12pt7b,     TFT_CYAN},    // W_RPM
+  {240, MAIN_Y + MAIN_DY - 18,    80,  24, 18, &FreeSans12pt7b,     TFT_CYAN},    // W_BTEMP
+  {240, MAIN_Y + 2*MAIN_DY - 18,  80,  24, 18, &FreeSans12pt7b,     TFT_CYAN},    // W_MTEMP
+};
+
+
+void displayBegin() {
+  tft.init();
+  tft.setRotation(1);
+  tft.fillScreen(TFT_BLACK);
+
+  for (Widget &w : widgets) {
+    w.spr.setColorDepth(1);
+    w.spr.createSprite(w.w, w.h);
+    w.spr.setBitmapColor(w.color, TFT_BLACK);
+  }
+
+  page = PAGE_MAIN;
+  drawStaticLabels();
+}
+
+void showPage(Page p) {
+  page = p;
+  if (page == PAGE_CELLS) {
+    drawCellPage();
+  } else {
+    tft.fillScreen(TFT_BLACK);
+    drawStaticLabels();
+    updateDisplay();
+  }
+  if (hudEnabled) updateHud(true);
+}
+
+// -------------------- Main page --------------------
+
+// Background layer: drawn once per page switch, never touched by updates.
+// Also forgets what the value widgets show so the next update repaints them.
+void drawStaticLabels() {
+  tft.setTextColor(TFT_WHITE, TFT_BLACK);
+  tft.setFreeFont(&FreeSans9pt7b);
+
+  int y = MAIN_Y;
+  int dy = MAIN_DY;
+
+  tft.setCursor(10, y);       tft.print("Voltage:");
+  tft.setCursor(10, y+dy);    tft.print("Current:");
+  tft.setCursor(10, y+2*dy);  tft.print("Power:");
+  tft.setCursor(10, y+3*dy);  tft.print("SOC:");
+
+  tft.setCursor(180, y);      tft.print("RPM:");
+  tft.setCursor(180, y+dy);   tft.print("BT:");
+  tft.setCursor(180, y+2*dy); tft.print("MT:");
+
+  for (Widget &w : widgets) w.shown[0] = '\0';
+}
+
+// Renders `text` into the widget's sprite and pushes it, unless that text is
+// already on screen.
+static void drawWidget(Widget &w, const char *text) {
+  if (w.shown[0] != '\0' && strcmp(w.shown, text) == 0) return;
+  snprintf(w.shown, sizeof(w.shown), "%s", text);
+
+  w.spr.fillSprite(0);
+  w.spr.setTextColor(1);
+  w.spr.setFreeFont(w.font);
+  w.spr.setCursor(0, w.baseline);
+  w.spr.print(text);
+  w.spr.pushSprite(w.x, w.y);
+}
+
+void updateDisplay() {
+  char text[16];
+
+  snprintf(text, sizeof(text), "%.1f MPH", mph);           drawWidget(widgets[W_MPH], text);
+
+  snprintf(text, sizeof(text), "%.1f V", voltage);         drawWidget(widgets[W_VOLTAGE], text);
+  snprintf(text, sizeof(text), "%.1f A", current);         drawWidget(widgets[W_CURRENT], text);
+  snprintf(text, sizeof(text), "%.1f kW", power/1000.0);   drawWidget(widgets[W_POWER], text);
+  snprintf(text, sizeof(text), "%.0f %%", soc);            drawWidget(widgets[W_SOC], text);
+
+  snprintf(text, sizeof(text), "%.0f", rpm);               drawWidget(widgets[W_RPM], text);
+  snprintf(text, sizeof(text), "%.1f C", Btemp);           drawWidget(widgets[W_BTEMP], text);
+  snprintf(text, sizeof(text), "%.1f C", Mtemp);           drawWidget(widgets[W_MTEMP], text);
+}
+
+
+// -------------------- Cell page --------------------
+// Drawn straight to the TFT: only bars whose height or color moved are
+// touched, so an update is a handful of small fills.
+
+static int cellBarHeight(uint16_t mv) {
+  if (mv <= CELL_MV_EMPTY) return 0;
+  if (mv >= CELL_MV_FULL) return CELL_BAR_BOTTOM - CELL_BAR_TOP;
+  return (int32_t)(mv - CELL_MV_EMPTY) * (CELL_BAR_BOTTOM - CELL_BAR_TOP) / (CELL_MV_FULL - CELL_MV_EMPTY);
+}
+
+static uint16_t cellBarColor(uint16_t mv, uint16_t lowMv, uint16_t highMv) {
+  if (highMv - lowMv >= CELL_IMBALANCE_MV) {
+    if (mv == highMv) return TFT_RED;
+    if (mv == lowMv) return TFT_BLUE;
+  }
+  return (mv >= CELL_MV_HIGH) ? TFT_ORANGE : TFT_GREEN;
+}
+
+void drawCellPage() {
+  tft.fillScreen(TFT_BLACK);
+
+  tft.setTextColor(TFT_WHITE, TFT_BLACK);
+  tft.setTextDatum(TC_DATUM);
+  tft.setTextFont(1);
+  for (int i = 0; i < NUM_CELLS; i++) {
+    tft.drawNumber(i + 1, i * CELL_BAR_PITCH + CELL_BAR_PITCH / 2, CELL_BAR_BOTTOM + 6);
+  }
+  tft.setTextDatum(TL_DATUM);
+
+  // Force every bar and the summary to be drawn on the next update
+  for (int i = 0; i < NUM_CELLS; i++) {
+    barHeightPx[i] = 0;
+    barColor[i] = TFT_BLACK;
+  }
+  shownLowMv = shownHighMv = 0;
+
+  updateCellBars();
+}
+
+void updateCellBars() {
+  if (cellCount == 0) return;
+
+  uint16_t lowMv = 0xFFFF, highMv = 0;
+  for (int i = 0; i < cellCount; i++) {
+    if (cellMv[i] < lowMv) lowMv = cellMv[i];
+    if (cellMv[i] > highMv) highMv = cellMv[i];
+  }
+
+  for (int i = 0; i < NUM_CELLS; i++) {
+    uint16_t mv = (i < cellCount) ? cellMv[i] : 0;
+    int h = cellBarHeight(mv);
+    uint16_t color = cellBarColor(mv, lowMv, highMv);
+    int oldH = barHeightPx[i];
+    int x = i * CELL_BAR_PITCH + (CELL_BAR_PITCH - CELL_BAR_WIDTH) / 2;
+
+    if (color != barColor[i]) {
+      tft.fillRect(x, CELL_BAR_BOTTOM - h, CELL_BAR_WIDTH, h, color);  // repaint whole bar
+    } else if (h > oldH) {
+      tft.fillRect(x, CELL_BAR_BOTTOM - h, CELL_BAR_WIDTH, h - oldH, color);
+    }
+    if (h < oldH) {
+      tft.fillRect(x, CELL_BAR_BOTTOM - oldH, CELL_BAR_WIDTH, oldH - h, TFT_BLACK);
+    }
+
+    barHeightPx[i] = h;
+    barColor[i] = color;
+  }
+
+  if (lowMv != shownLowMv || highMv != shownHighMv) {
+    shownLowMv = lowMv;
+    shownHighMv = highMv;
+
+    char summary[48];
+    snprintf(summary, sizeof(summary), "Lo %.3f  Hi %.3f  d %u mV",
+             lowMv / 1000.0f, highMv / 1000.0f, (unsigned)(highMv - lowMv));
+
+    tft.setTextColor(TFT_CYAN, TFT_BLACK);
+    tft.setTextFont(2);
+    tft.setTextPadding(300);
+    tft.drawString(summary, 10, HUD_HEIGHT + 4);
+    tft.setTextPadding(0);
+  }
+}
+
+
+// -------------------- Performance HUD --------------------
+
+// Redraws only the HUD slots whose text changed (all of them when forced)
+void updateHud(bool force) {
+  tft.setTextFont(1);
+  tft.setTextDatum(TL_DATUM);
+  tft.setTextColor(TFT_GREEN, TFT_BLACK);
+
+  for (int i = 0; i < HUD_FIELD_COUNT; i++) {
+    HudField &f = hudFields[i];
+    if (!force && strcmp(f.shown, hudText[i]) == 0) continue;
+
+    strcpy(f.shown, hudText[i]);
+    tft.setTextPadding(f.w);
+    tft.drawString(f.shown, f.x, 2);
+  }
+  tft.setTextPadding(0);
+}
+
+void setHudEnabled(bool on) {
+  hudEnabled = on;
+  if (on) {
+    updateHud(true);
+  } else {
+    tft.fillRect(0, 0, 320, HUD_HEIGHT, TFT_BLACK);
+  }
+}
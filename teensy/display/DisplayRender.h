@@ -0,0 +1,38 @@
+#pragma once
+#include <stdint.h>
+#include <TFT_eSPI.h>
+
+// Everything that draws on the dash display. Kept free of UART, button and
+// loop() code so it also builds against the host TFT_eSPI shim
+// (host/display_sim) for golden-image and draw-cost checks.
+
+extern TFT_eSPI tft;
+
+// Latest telemetry, written by the line parser in display.ino
+extern float mph, voltage, current, power, soc, rpm, Btemp, Mtemp;
+
+// Per-cell voltages from the "C," telemetry line (millivolts)
+constexpr int NUM_CELLS = 20;
+extern uint16_t cellMv[NUM_CELLS];
+extern int cellCount;
+
+enum Page : uint8_t { PAGE_MAIN = 0, PAGE_CELLS, PAGE_COUNT };
+extern Page page;
+
+// Performance HUD strip across the top of the screen. hudText is filled by
+// the owner of the counters (display.ino) and drawn by updateHud().
+constexpr int HUD_HEIGHT = 12;
+constexpr int HUD_FIELD_COUNT = 7;
+extern bool hudEnabled;
+extern char hudText[HUD_FIELD_COUNT][12];
+
+// Initializes the panel and widget sprites, then draws the main page.
+void displayBegin();
+
+void showPage(Page p);
+void drawStaticLabels();
+void updateDisplay();
+void drawCellPage();
+void updateCellBars();
+void updateHud(bool force);
+void setHudEnabled(bool on);
@@ -0,0 +1,47 @@
+#include "TelemetryParse.h"
+#include "DisplayRender.h"
+
+bool stripLineChecksum(String &line) {
+  int star = line.lastIndexOf('*');
+  if (star < 0 || star != (int)line.length() - 3) return true;
+
+  uint8_t cs = 0;
+  for (int i = 0; i < star; i++) cs ^= (uint8_t)line[i];
+
+  uint8_t expected = (uint8_t)strtoul(line.c_str() + star + 1, nullptr, 16);
+  line.remove(star);
+  return cs == expected;
+}
+
+bool parseCells(String line) {
+  int n = 0, last = 2;   // skip "C,"
+  while (n < NUM_CELLS) {
+    int idx = line.indexOf(',', last);
+    cellMv[n++] = (uint16_t)((idx < 0) ? line.substring(last) : line.substring(last, idx)).toInt();
+    if (idx < 0) break;
+    last = idx + 1;
+  }
+  cellCount = n;
+  return n > 0;
+}
+
+bool parseData(String line) {
+  if (line.length() == 0) return false;
+
+  int commas = 0;
+  for (unsigned i = 0; i < line.length(); i++) {
+    if (line[i] == ',') commas++;
+  }
+  if (commas != 7) return false;
+
+  int idx = -1, last = 0;
+  mph     = line.substring(last, idx = line.indexOf(',', last)).toFloat(); last = idx+1;
+  voltage = line.substring(last, idx = line.indexOf(',', last)).toFloat(); last = idx+1;
+  current = line.substring(last, idx = line.indexOf(',', last)).toFloat(); last = idx+1;
+  power   = line.substring(last, idx = line.indexOf(',', last)).toFloat(); last = idx+1;
+  soc     = line.substring(last, idx = line.indexOf(',', last)).toFloat(); last = idx+1;
+  rpm     = line.substring(last, idx = line.indexOf(',', last)).toFloat(); last = idx+1;
+  Btemp   = line.substring(last, idx = line.indexOf(',', last)).toFloat(); last = idx+1;
+  Mtemp   = line.substring(last).toFloat();
+  return true;
+}
@@ -0,0 +1,16 @@
+#pragma once
+#include <Arduino.h>
+
+// Parsers for the controller's telemetry lines (see TelemetryEncode.h in
+// the charge controller). They write the readings DisplayRender.h draws.
+// Kept out of display.ino so they also build on the host (host/perf_suite).
+
+// Verifies and removes a trailing "*HH" XOR checksum. Lines without one are
+// accepted as-is so an older controller firmware still displays.
+bool stripLineChecksum(String &line);
+
+// "C,<mV>,<mV>,..." into cellMv/cellCount
+bool parseCells(String line);
+
+// "mph,V,A,W,soc,rpm,btemp,mtemp" into mph..Mtemp
+bool parseData(String line);
@@ -1,118 +1,192 @@
-#include "Free_Fonts.h"
 #include <TFT_eSPI.h>
 #include <SPI.h>
-
-TFT_eSPI tft = TFT_eSPI();
-TFT_eSprite spr = TFT_eSprite(&tft);  // sprite for double buffering
-
-float mph, voltage, current, power, soc, rpm, Btemp, Mtemp;
+#include "DisplayRender.h"
+#include "TelemetryParse.h"
+
+// Pages cycled with the BOOT button on IO0
+#define PAGE_BUTTON_PIN 0
+
+// Performance HUD: toggled with a long press of the BOOT button or 'h' on
+// the USB console; figures are recomputed once per HUD_PERIOD_MS
+constexpr uint32_t HUD_PERIOD_MS = 1000;
+constexpr uint32_t HUD_LONG_PRESS_MS = 800;
+
+// Counters for the current HUD window (frames/render/parse/bytes/lines) and
+// running totals (errors, last good line)
+struct PerfStats {
+  uint32_t frames = 0;
+  uint32_t renderUs = 0;
+  uint32_t parses = 0;
+  uint32_t parseUs = 0;
+  uint32_t bytes = 0;
+  uint32_t lines = 0;
+  uint32_t crcErrors = 0;
+  uint32_t parseErrors = 0;
+  uint32_t lastLineMs = 0;
+};
+PerfStats perf;
+
+// Non-blocking line assembly from the UART
+char rxBuf[200];
+size_t rxLen = 0;
+
+// Telemetry channels each page needs from the controller, as "tag:period_ms"
+// ('T' = main readings, 'C' = cell voltages). Sent back on IO27 whenever the
+// page changes and renewed every SUBSCRIPTION_RENEW_MS so a controller that
+// restarted picks it up again.
+const char *const PAGE_SUBSCRIPTIONS[PAGE_COUNT] = {
+  "T:250",   // PAGE_MAIN
+  "C:1000",  // PAGE_CELLS
+};
+constexpr uint32_t SUBSCRIPTION_RENEW_MS = 5000;
+uint32_t lastSubscriptionMs = 0;
 
 HardwareSerial SerialPort(2);  // use UART2
 
 void setup() {
   Serial.begin(115200); // USB debug still works
 
-  // UART2 on IO35 (RX), IO27 (TX, unused)
+  // UART2 on IO35 (RX, telemetry), IO27 (TX, channel subscriptions)
   SerialPort.begin(115200, SERIAL_8N1, 35, 27);
 
+  pinMode(PAGE_BUTTON_PIN, INPUT_PULLUP);
+
   pinMode(TFT_BL, OUTPUT);
   digitalWrite(TFT_BL, HIGH);
 
-  tft.init();
-  tft.setRotation(1);
-  tft.fillScreen(TFT_BLACK);
-
-  // create sprite same size as screen, 16-bit color
-  spr.setColorDepth(8);
-  spr.createSprite(320, 240);
-
-  drawStaticLabels();
+  displayBegin();
+  sendSubscription();
 }
 
 void loop() {
-  if (SerialPort.available()) {
-    String line = SerialPort.readStringUntil('\n');
-    Serial.println("RX line: " + line);   // debug to USB
-    parseData(line);
-    updateDisplay();
-  }
-}
-
-void drawStaticLabels() {
-  spr.fillSprite(TFT_BLACK);
-
-  spr.setTextColor(TFT_WHITE, TFT_BLACK);
-  spr.setFreeFont(&FreeSans9pt7b);
+  pollButton();
 
-  int y = 150;  
-  int dy = 25;
+  if (Serial.available() && Serial.read() == 'h') {
+    setHudEnabled(!hudEnabled);
+  }
 
-  spr.setCursor(10, y);       spr.print("Voltage:");
-  spr.setCursor(10, y+dy);    spr.print("Current:");
-  spr.setCursor(10, y+2*dy);  spr.print("Power:");
-  spr.setCursor(10, y+3*dy);  spr.print("SOC:");
+  while (SerialPort.available()) {
+    int c = SerialPort.read();
+    perf.bytes++;
+
+    if (c == '\n') {
+      rxBuf[rxLen] = '\0';
+      handleLine(String(rxBuf));
+      rxLen = 0;
+    } else if (rxLen < sizeof(rxBuf) - 1) {
+      rxBuf[rxLen++] = (char)c;
+    } else {
+      rxLen = 0;  // runaway line, resync on the next newline
+      perf.parseErrors++;
+    }
+  }
 
-  spr.setCursor(180, y);      spr.print("RPM:");
-  spr.setCursor(180, y+dy);   spr.print("BT:");
-  spr.setCursor(180, y+2*dy); spr.print("MT:");
+  if (millis() - lastSubscriptionMs >= SUBSCRIPTION_RENEW_MS) {
+    sendSubscription();
+  }
 
-  spr.pushSprite(0, 0); // draw initial static screen
+  static uint32_t hudWindowMs = 0;
+  if (millis() - hudWindowMs >= HUD_PERIOD_MS) {
+    formatHud(millis() - hudWindowMs);
+    hudWindowMs = millis();
+    if (hudEnabled) updateHud(false);
+  }
 }
 
+void handleLine(String line) {
+  Serial.println("RX line: " + line);   // debug to USB
 
-void updateDisplay() {
-  spr.fillSprite(TFT_BLACK);  // clear sprite
+  uint32_t t0 = micros();
+  line.trim();
+  if (!stripLineChecksum(line)) {
+    perf.crcErrors++;
+    return;
+  }
 
-  // MPH
-  spr.setTextColor(TFT_YELLOW, TFT_BLACK);
-  spr.setFreeFont(&FreeSansBold24pt7b);
-  spr.setCursor(40, 70);
-  spr.printf("%.1f MPH", mph);
+  bool isCells = line.startsWith("C,");
+  bool ok = isCells ? parseCells(line) : parseData(line);
+  perf.parseUs += micros() - t0;
+  perf.parses++;
 
-  int y = 150;
-  int dy = 25;
+  if (!ok) {
+    perf.parseErrors++;
+    return;
+  }
+  perf.lines++;
+  perf.lastLineMs = millis();
 
-  // --- Labels (white) ---
-  spr.setTextColor(TFT_WHITE, TFT_BLACK);
-  spr.setFreeFont(&FreeSans9pt7b);
+  t0 = micros();
+  if (isCells && page == PAGE_CELLS) {
+    updateCellBars();
+  } else if (!isCells && page == PAGE_MAIN) {
+    updateDisplay();
+  } else {
+    return;
+  }
+  perf.renderUs += micros() - t0;
+  perf.frames++;
+}
 
-  spr.setCursor(10, y);       spr.print("Voltage:");
-  spr.setCursor(10, y+dy);    spr.print("Current:");
-  spr.setCursor(10, y+2*dy);  spr.print("Power:");
-  spr.setCursor(10, y+3*dy);  spr.print("SOC:");
+void pollButton() {
+  static bool lastPressed = false;
+  static uint32_t lastChangeMs = 0;
+  static uint32_t pressedAtMs = 0;
 
-  spr.setCursor(180, y);      spr.print("RPM:");
-  spr.setCursor(180, y+dy);   spr.print("BT:");
-  spr.setCursor(180, y+2*dy); spr.print("MT:");
+  bool pressed = digitalRead(PAGE_BUTTON_PIN) == LOW;
+  if (pressed == lastPressed || millis() - lastChangeMs < 30) return;  // debounce
 
-  // --- Values (cyan) ---
-  spr.setTextColor(TFT_CYAN, TFT_BLACK);
-  spr.setFreeFont(&FreeSans12pt7b);
+  lastPressed = pressed;
+  lastChangeMs = millis();
+  if (pressed) {
+    pressedAtMs = millis();
+    return;
+  }
+
+  // Act on release: long press toggles the HUD, short press flips the page
+  if (millis() - pressedAtMs >= HUD_LONG_PRESS_MS) {
+    setHudEnabled(!hudEnabled);
+  } else {
+    showPage((Page)((page + 1) % PAGE_COUNT));
+    sendSubscription();
+  }
+}
 
-  spr.setCursor(90, y);       spr.printf("%.1f V", voltage);
-  spr.setCursor(90, y+dy);    spr.printf("%.1f A", current);
-  spr.setCursor(90, y+2*dy);  spr.printf("%.1f kW", power/1000.0);
-  spr.setCursor(90, y+3*dy);  spr.printf("%.0f %%", soc);
+// "S,<tag>:<period_ms>,...*HH" with the same XOR checksum as telemetry lines
+void sendSubscription() {
+  char line[48];
+  int n = snprintf(line, sizeof(line), "S,%s", PAGE_SUBSCRIPTIONS[page]);
 
-  spr.setCursor(240, y);       spr.printf("%.0f", rpm);
-  spr.setCursor(240, y+dy);    spr.printf("%.1f C", Btemp);
-  spr.setCursor(240, y+2*dy);  spr.printf("%.1f C", Mtemp);
+  uint8_t cs = 0;
+  for (int i = 0; i < n; i++) cs ^= (uint8_t)line[i];
+  n += snprintf(line + n, sizeof(line) - n, "*%02X\r\n", cs);
 
-  spr.pushSprite(0, 0);
+  SerialPort.write((const uint8_t *)line, n);
+  lastSubscriptionMs = millis();
 }
 
+// -------------------- Performance HUD --------------------
+
+// Turns the current window's counters into HUD text (per second / per frame)
+void formatHud(uint32_t windowMs) {
+  if (windowMs == 0) windowMs = 1;
+
+  snprintf(hudText[0], 12, "%lufps", (unsigned long)(perf.frames * 1000UL / windowMs));
+  snprintf(hudText[1], 12, "r%.1fms", perf.frames ? perf.renderUs / 1000.0f / perf.frames : 0.0f);
+  snprintf(hudText[2], 12, "p%luus", (unsigned long)(perf.parses ? perf.parseUs / perf.parses : 0));
+  snprintf(hudText[3], 12, "%luB/s", (unsigned long)(perf.bytes * 1000UL / windowMs));
+  snprintf(hudText[4], 12, "%lul/s", (unsigned long)(perf.lines * 1000UL / windowMs));
+  snprintf(hudText[5], 12, "E%lu/%lu", (unsigned long)perf.crcErrors, (unsigned long)perf.parseErrors);
+
+  uint32_t age = millis() - perf.lastLineMs;
+  if (perf.lastLineMs == 0) {
+    snprintf(hudText[6], 12, "age --");
+  } else if (age < 10000) {
+    snprintf(hudText[6], 12, "age%lums", (unsigned long)age);
+  } else {
+    snprintf(hudText[6], 12, "age%lus", (unsigned long)(age / 1000));
+  }
 
-void parseData(String line) {
-  line.trim();
-  if (line.length() == 0) return;
-
-  int idx = -1, last = 0;
-  mph     = line.substring(last, idx = line.indexOf(',', last)).toFloat(); last = idx+1;
-  voltage = line.substring(last, idx = line.indexOf(',', last)).toFloat(); last = idx+1;
-  current = line.substring(last, idx = line.indexOf(',', last)).toFloat(); last = idx+1;
-  power   = line.substring(last, idx = line.indexOf(',', last)).toFloat(); last = idx+1;
-  soc     = line.substring(last, idx = line.indexOf(',', last)).toFloat(); last = idx+1;
-  rpm     = line.substring(last, idx = line.indexOf(',', last)).toFloat(); last = idx+1;
-  Btemp   = line.substring(last, idx = line.indexOf(',', last)).toFloat(); last = idx+1;
-  Mtemp   = line.substring(last).toFloat();
+  perf.frames = perf.renderUs = 0;
+  perf.parses = perf.parseUs = 0;
+  perf.bytes = perf.lines = 0;
 }
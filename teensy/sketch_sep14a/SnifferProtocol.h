@@ -0,0 +1,84 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+
+// Binary USB stream of the CAN sniffer sketch, decoded on the host by
+// host/canlog/SnifferStream.h. Everything is little-endian.
+//
+// The stream is a sequence of packets, each a PacketHeader followed by
+// `length` payload bytes:
+//   PACKET_FRAMES  length / sizeof(SnifferFrame) frames from all buses,
+//                  in receive order, which is also t_us order
+//   PACKET_STATS   one SnifferStats, about once a second
+//
+// A decoder that loses sync scans for the next magic and checks the header
+// and payload checksums before trusting a packet.
+
+namespace sniffer {
+
+constexpr uint32_t PACKET_MAGIC = 0x31464E53;   // "SNF1"
+
+enum PacketType : uint8_t {
+  PACKET_FRAMES = 1,
+  PACKET_STATS  = 2,
+};
+
+// Bytes the host sends to switch modes
+constexpr char CMD_BINARY = 'b';
+constexpr char CMD_TEXT   = 't';
+
+struct PacketHeader {
+  uint32_t magic;      // PACKET_MAGIC
+  uint8_t  type;       // PacketType
+  uint8_t  reserved;
+  uint16_t length;     // payload bytes
+  uint32_t seq;        // packet counter, gaps mean lost packets
+  uint16_t checksum;   // fletcher16 of the payload
+  uint16_t header_check; // fletcher16 of the 14 bytes before it
+};
+static_assert(sizeof(PacketHeader) == 16, "PacketHeader layout");
+
+constexpr uint8_t FRAME_EXTENDED = 0x01;
+constexpr uint8_t FRAME_RTR      = 0x02;
+
+struct SnifferFrame {
+  uint32_t t_us;       // micros() in the receive interrupt, one clock for all buses
+  uint32_t id;
+  uint8_t  bus;        // 1..3 = CAN1..CAN3
+  uint8_t  dlc;
+  uint8_t  flags;      // FRAME_*
+  uint8_t  reserved;
+  uint8_t  data[8];
+};
+static_assert(sizeof(SnifferFrame) == 20, "SnifferFrame layout");
+
+struct SnifferStats {
+  uint32_t t_us;
+  uint32_t frames;       // frames received since boot
+  uint32_t ring_drops;   // frames lost because the ring was full
+  uint32_t packets;      // packets sent since boot
+  uint16_t ring_peak;    // highest ring fill seen
+  uint16_t ring_size;
+  uint32_t usb_waits;    // times the USB TX buffer was full
+  uint32_t bus_frames[3]; // frames received per bus, CAN1..CAN3
+};
+static_assert(sizeof(SnifferStats) == 36, "SnifferStats layout");
+
+constexpr size_t MAX_PACKET_FRAMES = 50;   // 1016-byte packets fit one USB TX buffer
+
+inline uint16_t fletcher16(const uint8_t *p, size_t n) {
+  uint32_t a = 0, b = 0;
+  while (n) {
+    size_t block = n < 359 ? n : 359;   // largest run without overflowing 32 bits
+    n -= block;
+    while (block--) {
+      a += *p++;
+      b += a;
+    }
+    a %= 255;
+    b %= 255;
+  }
+  return (uint16_t)((b << 8) | a);
+}
+
+} // namespace sniffer
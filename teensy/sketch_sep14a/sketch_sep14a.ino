@@ -1,34 +1,212 @@
 #include <Arduino.h>
 #include <FlexCAN_T4.h>
+#include <atomic>
+#include "SnifferProtocol.h"
 
-// CAN3 on Teensy 4.1 : CRX3=30, CTX3=31
-FlexCAN_T4<CAN1, RX_SIZE_256, TX_SIZE_16> can3;
+// Listens on all three Teensy 4.1 controllers at once:
+//   CAN1 : CRX1=23, CTX1=22   Delta-Q charger (500k)
+//   CAN2 : CRX2=0,  CTX2=1    Kelly motor controller (250k)
+//   CAN3 : CRX3=30, CTX3=31
+// A bus with baud 0 is left off.
+constexpr uint32_t CAN1_BAUD = 500000;
+constexpr uint32_t CAN2_BAUD = 250000;
+constexpr uint32_t CAN3_BAUD = 500000;
 
+FlexCAN_T4<CAN1, RX_SIZE_256, TX_SIZE_16> can1;
+FlexCAN_T4<CAN2, RX_SIZE_256, TX_SIZE_16> can2;
+FlexCAN_T4<CAN3, RX_SIZE_256, TX_SIZE_16> can3;
+
+// Frames from all buses are stamped in their receive interrupt and queued in
+// one ring; loop() streams them over USB either as text lines (default, for
+// a serial monitor) or as binary packets (SnifferProtocol.h) once the host
+// sends 'b'.
+//
+// events() is never called, so FlexCAN_T4 runs onRx straight from the
+// interrupt instead of deferring it to loop(). The stamp is taken and the
+// slot claimed with interrupts off, so ring order is micros() order across
+// the three buses and the stream needs no sorting. Three full buses are
+// ~10k frames/s; the ring holds ~400 ms of that.
+
+// -------------------- Receive ring --------------------
+constexpr uint32_t RING_SIZE = 4096;   // power of two
+static_assert((RING_SIZE & (RING_SIZE - 1)) == 0, "RING_SIZE must be a power of two");
+
+static DMAMEM sniffer::SnifferFrame ring[RING_SIZE];
+static std::atomic<uint32_t> ringHead{0};   // written by the interrupt
+static std::atomic<uint32_t> ringTail{0};   // written by loop()
+
+static volatile uint32_t framesSeen = 0;
+static volatile uint32_t busFrames[3] = {0, 0, 0};
+static volatile uint32_t ringDrops = 0;
+static uint32_t ringPeak = 0;
+
+// Shared by the three controllers; msg.bus says which one (1..3)
 void onRx(const CAN_message_t &msg) {
-  Serial.print("ID 0x"); Serial.print(msg.id, HEX);
-  Serial.print("  LEN "); Serial.print(msg.len);
+  // The three CAN interrupts share a priority today, but claim the slot with
+  // interrupts off anyway so stamp order and ring order cannot disagree.
+  // The slot is filled after interrupts are back on; loop() only reads the
+  // ring once every interrupt handler has returned, so it is complete by then.
+  __disable_irq();
+  const uint32_t now = micros();
+  const uint32_t head = ringHead.load(std::memory_order_relaxed);
+  const bool full = head - ringTail.load(std::memory_order_acquire) >= RING_SIZE;
+  if (!full) ringHead.store(head + 1, std::memory_order_relaxed);
+  framesSeen++;
+  if (msg.bus >= 1 && msg.bus <= 3) busFrames[msg.bus - 1]++;
+  if (full) ringDrops++;
+  __enable_irq();
+  if (full) return;
+
+  sniffer::SnifferFrame &f = ring[head & (RING_SIZE - 1)];
+  f.t_us = now;
+  f.id = msg.id;
+  f.bus = msg.bus;
+  f.dlc = msg.len > 8 ? 8 : msg.len;
+  f.flags = (msg.flags.extended ? sniffer::FRAME_EXTENDED : 0) | (msg.flags.remote ? sniffer::FRAME_RTR : 0);
+  f.reserved = 0;
+  memcpy(f.data, msg.buf, 8);
+}
+
+// -------------------- USB output --------------------
+static bool binaryMode = false;
+static uint32_t packetSeq = 0;
+static uint32_t usbWaits = 0;
+static elapsedMillis sinceStats;
+static elapsedMicros sinceFlush;
+
+static sniffer::SnifferFrame packet[sniffer::MAX_PACKET_FRAMES];
+static size_t packetFrames = 0;
+
+// Sends one packet if the USB buffer has room; false means try again later
+static bool sendPacket(uint8_t type, const void *payload, size_t len) {
+  const size_t total = sizeof(sniffer::PacketHeader) + len;
+  if ((size_t)Serial.availableForWrite() < total) {
+    usbWaits++;
+    return false;
+  }
+
+  sniffer::PacketHeader hdr;
+  hdr.magic = sniffer::PACKET_MAGIC;
+  hdr.type = type;
+  hdr.reserved = 0;
+  hdr.length = (uint16_t)len;
+  hdr.seq = packetSeq++;
+  hdr.checksum = sniffer::fletcher16((const uint8_t *)payload, len);
+  hdr.header_check = sniffer::fletcher16((const uint8_t *)&hdr, offsetof(sniffer::PacketHeader, header_check));
+
+  Serial.write((const uint8_t *)&hdr, sizeof(hdr));
+  Serial.write((const uint8_t *)payload, len);
+  return true;
+}
+
+static bool flushFrames() {
+  if (packetFrames == 0) return true;
+  if (!sendPacket(sniffer::PACKET_FRAMES, packet, packetFrames * sizeof(sniffer::SnifferFrame))) {
+    return false;
+  }
+  packetFrames = 0;
+  sinceFlush = 0;
+  return true;
+}
+
+static void sendStats() {
+  sniffer::SnifferStats s;
+  s.t_us = micros();
+  s.frames = framesSeen;
+  s.ring_drops = ringDrops;
+  s.packets = packetSeq;
+  s.ring_peak = (uint16_t)ringPeak;
+  s.ring_size = (uint16_t)RING_SIZE;
+  s.usb_waits = usbWaits;
+  for (int i = 0; i < 3; i++) s.bus_frames[i] = busFrames[i];
+  sendPacket(sniffer::PACKET_STATS, &s, sizeof(s));
+}
+
+static void printFrame(const sniffer::SnifferFrame &f) {
+  Serial.print("CAN"); Serial.print(f.bus);
+  Serial.print(" ID 0x"); Serial.print(f.id, HEX);
+  Serial.print("  LEN "); Serial.print(f.dlc);
   Serial.print("  DATA ");
-  for (uint8_t i = 0; i < msg.len; i++) {
-    if (msg.buf[i] < 0x10) Serial.print('0');
-    Serial.print(msg.buf[i], HEX); Serial.print(' ');
+  for (uint8_t i = 0; i < f.dlc; i++) {
+    if (f.data[i] < 0x10) Serial.print('0');
+    Serial.print(f.data[i], HEX); Serial.print(' ');
   }
   Serial.println();
 }
 
+static void serviceCommands() {
+  while (Serial.available()) {
+    const int c = Serial.read();
+    if (c == sniffer::CMD_BINARY) {
+      binaryMode = true;
+    } else if (c == sniffer::CMD_TEXT) {
+      flushFrames();
+      binaryMode = false;
+    }
+  }
+}
+
 void setup() {
-  Serial.begin(115200);
+  Serial.begin(115200);   // USB: the baud rate is ignored, it runs at 480 Mbit/s
   while (!Serial && millis() < 3000) {}
 
-  Serial.println("Teensy 4.1 CAN3 listener @ 500k");
+  Serial.printf("Teensy 4.1 CAN listener: CAN1 %lu, CAN2 %lu, CAN3 %lu (send 'b' for binary packets, 't' for text)\n",
+                (unsigned long)CAN1_BAUD, (unsigned long)CAN2_BAUD, (unsigned long)CAN3_BAUD);
 
-  can3.begin();
-  can3.setBaudRate(500000);
-  // Explicitly set pins (optional; CAN3 defaults to 30/31)
   // Accept all frames by default (don’t add REJECT filters here)
-  can3.onReceive(onRx);
-  can3.enableMBInterrupts();
+  if (CAN1_BAUD) {
+    can1.begin();
+    can1.setBaudRate(CAN1_BAUD);
+    can1.onReceive(onRx);
+    can1.enableMBInterrupts();
+  }
+  if (CAN2_BAUD) {
+    can2.begin();
+    can2.setBaudRate(CAN2_BAUD);
+    can2.onReceive(onRx);
+    can2.enableMBInterrupts();
+  }
+  if (CAN3_BAUD) {
+    can3.begin();
+    can3.setBaudRate(CAN3_BAUD);
+    can3.onReceive(onRx);
+    can3.enableMBInterrupts();
+  }
 }
 
 void loop() {
-  can3.events();  // required to dispatch callbacks
+  serviceCommands();
+
+  const uint32_t tail = ringTail.load(std::memory_order_relaxed);
+  const uint32_t fill = ringHead.load(std::memory_order_acquire) - tail;
+  if (fill > ringPeak) ringPeak = fill;
+
+  uint32_t taken = 0;
+  if (binaryMode) {
+    // Fill the packet from the ring; send when full or when frames have
+    // waited 2 ms, so a quiet bus still streams promptly
+    while (taken < fill) {
+      if (packetFrames == sniffer::MAX_PACKET_FRAMES && !flushFrames()) break;
+      packet[packetFrames++] = ring[(tail + taken) & (RING_SIZE - 1)];
+      taken++;
+    }
+    if (packetFrames == sniffer::MAX_PACKET_FRAMES || (packetFrames && sinceFlush >= 2000)) flushFrames();
+    if (sinceStats >= 1000) {
+      sinceStats = 0;
+      sendStats();
+    }
+  } else {
+    // Text is slow; print a few per pass and let the ring absorb bursts
+    while (taken < fill && taken < 16) {
+      printFrame(ring[(tail + taken) & (RING_SIZE - 1)]);
+      taken++;
+    }
+    if (sinceStats >= 10000) {
+      sinceStats = 0;
+      Serial.printf("[SNIFF] frames=%lu (can1=%lu can2=%lu can3=%lu) drops=%lu ringPeak=%lu\n",
+                    (unsigned long)framesSeen, (unsigned long)busFrames[0], (unsigned long)busFrames[1],
+                    (unsigned long)busFrames[2], (unsigned long)ringDrops, (unsigned long)ringPeak);
+    }
+  }
+  ringTail.store(tail + taken, std::memory_order_release);
 }